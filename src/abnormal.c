@@ -22,24 +22,35 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <unistd.h>
 #include <assert.h>
+#include <pthread.h>
 #include "sam.h"
-#include "list.h"
 #include "hash.h"
 #include "wrapper.h"
 #include "log.h"
 #include "utils.h"
-#include "str.h"
+#include "array.h"
+#include "heap.h"
+#include "idtable.h"
 #include "abnormal.h"
 
+#define CONTIG_NAME_BUFSIZ 256
+#define SPILL_TEMPLATE     "sider-spill-XXXXXX"
+#define SPILL_FAN_IN       16
+#define STREAM_MAX_MEMORY  (1024UL * 1024 * 1024) /* 1GiB */
+
 struct _AbnormalFilter
 {
 	int            tid;
 	int            inc_step;
+	int            source_id;
 	const char    *sam_file;
 	ExonTree      *exon_tree;
 	ChrStd        *cs;
 	sqlite3_stmt  *alignment_stmt;
+	sqlite3_stmt  *overlapping_stmt;
 	int            phred_quality;
 	int            queryname_sorted;
 	int            max_distance;
@@ -47,33 +58,233 @@ struct _AbnormalFilter
 	int            either;
 	float          exon_frac;
 	float          alignment_frac;
+	int            exonic_only;
+	int            fetch_mates;
+	int            single_pass;
+	htsThreadPool *hts_pool;
+	size_t         max_memory;
+	const char    *tmp_dir;
+	DBWriter      *writer;
+	DBBatch       *batch;
+	ExonCursor    *exon_cursor;
+	ChrTable      *ct;
+	int            coordinate_sorted;
+	int            stream;
 	samFile       *in;
 	bam_hdr_t     *hdr;
 	bam1_t        *align;
-	String        *cigar;
+	hts_itr_t     *itr;
+	hts_idx_t     *idx;
+	long           beg;
 	long           alignment_id;
 	long           alignment_acm;
 	long           abnormal_acm;
 	long           exonic_acm;
+	long           dropped_acm;
 };
 
 typedef struct _AbnormalFilter AbnormalFilter;
 
+/*
+ * An open file, its header and its index. The
+ * readers are recycled among the shards, so that
+ * the index is loaded at most once per worker
+ * thread, instead of once per shard and pass
+ */
+struct _ShardReader
+{
+	const char *sam_file;
+	samFile    *in;
+	bam_hdr_t  *hdr;
+	hts_idx_t  *idx;
+};
+
+typedef struct _ShardReader ShardReader;
+
+struct _ShardPool
+{
+	Array           *readers;
+	int              pending;
+	pthread_mutex_t  lock;
+	pthread_cond_t   done;
+};
+
+typedef struct _ShardPool ShardPool;
+
+struct _AbnormalShard
+{
+	AbnormalFilter  argf;
+	ShardPool      *pool;
+	ShardReader    *reader;
+	void          (*pass) (struct _AbnormalShard *);
+	int             rtid;
+	long            end;
+	IdTable        *abnormal_ids;
+	Array          *invalid_ids;
+	Array          *exonic_ids;
+};
+
+typedef struct _AbnormalShard AbnormalShard;
+
+/*
+ * Reads of the current fragment. The slots
+ * beyond 'len' are recycled by the next ones
+ */
+struct _AlignStack
+{
+	bam1_t **aligns;
+	size_t   len;
+	size_t   alloc;
+};
+
+typedef struct _AlignStack AlignStack;
+
+struct _Fragment
+{
+	char         *qname;
+	size_t        qname_alloc;
+	AbnormalType  type;
+	int           invalid;
+
+	// The farthest position referenced by the
+	// fragment reads: mates and supplementaries
+	int           tid;
+	long          pos;
+
+	// The farthest position when the fragment
+	// was pushed into the heap
+	int           heap_tid;
+	long          heap_pos;
+
+	// Reads of the fragment, recycled
+	// along with it from the pool
+	AlignStack   *aligns;
+};
+
+typedef struct _Fragment Fragment;
+
+struct _SpillRun
+{
+	const char *path;
+	samFile    *fp;
+	bam1_t     *align;
+	int         index;
+};
+
+typedef struct _SpillRun SpillRun;
+
+/*
+ * A sorted run at the temporary dir. The 'level'
+ * counts how many merges its reads went through
+ */
+struct _SpillFile
+{
+	char *path;
+	int   level;
+};
+
+typedef struct _SpillFile SpillFile;
+
+/*
+ * The farthest position referenced by
+ * an alignment and its supplementaries
+ */
+struct _Horizon
+{
+	int  tid;
+	long pos;
+};
+
+typedef struct _Horizon Horizon;
+
+/*
+ * Genomic intervals [beg, end) to be
+ * fetched from the index, 0-based
+ */
+struct _MateRegion
+{
+	int  tid;
+	long beg;
+	long end;
+};
+
+typedef struct _MateRegion MateRegion;
+
+struct _MateRegions
+{
+	MateRegion *regions;
+	size_t      len;
+	size_t      alloc;
+};
+
+typedef struct _MateRegions MateRegions;
+
+// The region intervals grew to 64 bits
+// at htslib 1.10, along with HTS_VERSION
+#ifdef HTS_VERSION
+typedef hts_pair_pos_t MatePair;
+#else
+typedef hts_pair32_t MatePair;
+#endif
+
+static void
+attach_thread_pool (htsThreadPool *hts_pool, samFile *fp,
+		const char *file)
+{
+	// No shared pool: decompress at the
+	// calling thread
+	if (hts_pool == NULL)
+		return;
+
+	// BGZF blocks (BAM) and CRAM containers
+	// will be decoded by the pool threads
+	if (hts_set_opt (fp, HTS_OPT_THREAD_POOL, hts_pool) < 0)
+		log_fatal ("Failed to set thread pool for '%s'", file);
+}
+
+static void
+set_required_fields (AbnormalFilter *argf)
+{
+	int fields = SAM_QNAME|SAM_FLAG|SAM_RNAME|SAM_POS
+		|SAM_MAPQ|SAM_CIGAR|SAM_RNEXT|SAM_PNEXT;
+
+	// No base is more frequent than
+	// the whole sequence
+	if (argf->max_base_freq < 1)
+		fields |= SAM_SEQ;
+
+	// The single pass mode and the mates
+	// fetching read the SA tags
+	if (argf->coordinate_sorted || argf->idx != NULL)
+		fields |= SAM_AUX;
+
+	sam_set_required_fields (argf->in, fields, argf->sam_file);
+}
+
 static void
 abnormal_filter_init (AbnormalFilter *argf)
 {
+	int coordinate = 0;
+
 	// Open SAM/BAM/CRAM file
 	argf->in = sam_open (argf->sam_file, "rb");
 	if (argf->in == NULL)
 		log_errno_fatal ("Failed to open '%s' for reading",
 				argf->sam_file);
 
+	// Share the decompression threads, if any
+	attach_thread_pool (argf->hts_pool, argf->in, argf->sam_file);
+
 	// Get the header
 	argf->hdr = sam_hdr_read (argf->in);
 	if (argf->hdr == NULL)
 		log_fatal ("Failed to read sam header from '%s'",
 				argf->sam_file);
 
+	// Standardize the header contigs once
+	argf->ct = chr_table_new (argf->cs, argf->hdr->n_targets,
+			argf->hdr->target_name);
+
 	// Alloc alignment fields struct
 	argf->align = bam_init1 ();
 	if (argf->align == NULL)
@@ -86,9 +297,39 @@ abnormal_filter_init (AbnormalFilter *argf)
 			&& sam_test_sorted_order (argf->hdr, "queryname"))
 		argf->queryname_sorted = 1;
 
-	// Alloc String cigar to avoid
-	// free and realloc often
-	argf->cigar = string_sized_new (128);
+	// Coordinate sorted files can pair the
+	// mates in a single pass, if asked for
+	coordinate = !argf->queryname_sorted
+		&& sam_test_sorted_order (argf->hdr, "coordinate");
+
+	if (coordinate && argf->single_pass)
+		argf->coordinate_sorted = 1;
+
+	// Pipes cannot be rewound: Only
+	// single pass modes are allowed
+	argf->stream = sam_is_stream (argf->sam_file);
+
+	// The mates of the abnormal reads will be
+	// fetched from the index, instead of reading
+	// the whole file twice again
+	if (argf->fetch_mates && !argf->queryname_sorted
+			&& !coordinate && !argf->stream)
+		{
+			argf->idx = sam_index_load (argf->in, argf->sam_file);
+			if (argf->idx == NULL)
+				log_warn ("Failed to load index for '%s'. The mates "
+						"will be searched by reading the file",
+						argf->sam_file);
+		}
+
+	// Skip the CRAM fields never read
+	set_required_fields (argf);
+
+	// The alignments will be dumped nearly in
+	// coordinate order: Sweep the exons instead
+	// of searching the tree for each one
+	if (coordinate)
+		argf->exon_cursor = exon_cursor_new (argf->exon_tree);
 
 	// Init alignment_id to its thread id
 	// Whenever it is needed to update its value,
@@ -101,6 +342,17 @@ abnormal_filter_init (AbnormalFilter *argf)
 	argf->alignment_acm = 0;
 	argf->abnormal_acm = 0;
 	argf->exonic_acm = 0;
+	argf->dropped_acm = 0;
+}
+
+static void
+flush_batch (AbnormalFilter *argf)
+{
+	if (argf->batch == NULL)
+		return;
+
+	db_writer_push_batch (argf->writer, argf->batch);
+	argf->batch = NULL;
 }
 
 static void
@@ -109,33 +361,54 @@ abnormal_filter_destroy (AbnormalFilter *argf)
 	if (argf == NULL)
 		return;
 
+	// The last rows
+	flush_batch (argf);
+
+	exon_cursor_free (argf->exon_cursor);
+	argf->exon_cursor = NULL;
+
+	chr_table_free (argf->ct);
+	argf->ct = NULL;
+
+	hts_idx_destroy (argf->idx);
+	argf->idx = NULL;
+
 	if (sam_close (argf->in) < 0)
 		log_errno_fatal ("Failed to close input stream for '%s'",
 				argf->sam_file);
 
 	bam_hdr_destroy (argf->hdr);
 	bam_destroy1 (argf->align);
-
-	string_free (argf->cigar, 1);
 }
 
-static int
-is_base_overly_freq (const bam1_t *align, float freq)
+static void
+shard_free (AbnormalShard *shard)
 {
-	uint8_t *seq = NULL;
-	int bases[5] = {};
-	int i = 0;
+	if (shard == NULL)
+		return;
 
-	seq = bam_get_seq (align);
+	bam_destroy1 (shard->argf.align);
+	array_free (shard->invalid_ids, 1);
+	array_free (shard->exonic_ids, 1);
+
+	xfree (shard);
+}
 
-	for (i = 0; i < align->core.l_qseq; i++)
-		bases[seq_nt16_int[bam_seqi (seq, i)]]++;
+static inline int
+read_next (AbnormalFilter *argf)
+{
+	int rc = 0;
 
-	for (i = 0; i < 5; i++)
-		if (((float) bases[i] / align->core.l_qseq) > freq)
-			return 1;
+	if (argf->itr == NULL)
+		return sam_read1 (argf->in, argf->hdr, argf->align);
 
-	return 0;
+	// Alignments starting before the region
+	// belong to the previous shard
+	while ((rc = sam_itr_next (argf->in, argf->itr, argf->align)) >= 0
+			&& argf->align->core.pos < argf->beg)
+		;
+
+	return rc;
 }
 
 static inline int
@@ -157,7 +430,7 @@ abnormal_classifier (const bam1_t *align, int max_distance,
 			|| (align->core.flag & 0x8)
 			|| (align->core.flag & 0x400)
 			|| (align->core.qual < phred_quality)
-			|| is_base_overly_freq (align, max_base_freq))
+			|| sam_is_base_overly_freq (align, max_base_freq))
 		{
 			return 0;
 		}
@@ -191,53 +464,65 @@ abnormal_classifier (const bam1_t *align, int max_distance,
 	return 1;
 }
 
+static int
+is_exonic (const AbnormalFilter *argf, const bam1_t *align)
+{
+	int rlen = bam_cigar2rlen (align->core.n_cigar,
+			bam_get_cigar (align));
+
+	// The same overlap as the one dumped, but
+	// searched at the tree: The fragment reads
+	// do not come in coordinate order
+	return exon_tree_lookup (argf->exon_tree,
+			chr_table_id (argf->ct, align->core.tid),
+			align->core.pos + 1, align->core.pos + (rlen < 1 ? 1 : rlen),
+			argf->exon_frac, argf->alignment_frac, argf->either) > 0;
+}
+
 static void
 dump_alignment (AbnormalFilter *argf, const bam1_t *align,
 		AbnormalType type)
 {
 	uint32_t *cigar = NULL;
-	int n_cigar = 0;
-	const char *chr = NULL;
 	const char *chr_std = NULL;
-	const char *chr_next = NULL;
-	const char *chr_std_next = NULL;
 	const char *qname = NULL;
+	int chr_id = 0;
+	int chr_next_id = 0;
 	int qlen = 0;
 	int rlen = 0;
 	int len = 0;
 	int acm = 0;
 
 	cigar = bam_get_cigar (align);
-	argf->cigar = string_clear (argf->cigar);
-
-	for (n_cigar = 0; n_cigar < align->core.n_cigar; n_cigar++)
-		argf->cigar = string_concat_printf (argf->cigar, "%d%c",
-				bam_cigar_oplen (cigar[n_cigar]),
-				bam_cigar_opchr (cigar[n_cigar]));
-
 	qlen = bam_cigar2qlen (align->core.n_cigar, cigar);
 	rlen = bam_cigar2rlen (align->core.n_cigar, cigar);
 	len = rlen < 1 ? 1 : rlen;
 
 	qname = bam_get_qname (align);
 
-	chr = align->core.tid > -1
-		? argf->hdr->target_name[align->core.tid]
-		: "*";
-
-	chr_next = align->core.mtid > -1
-		? argf->hdr->target_name[align->core.mtid]
-		: "*";
+	// Standardized chromosomes from the header table
+	chr_id = chr_table_id (argf->ct, align->core.tid);
+	chr_next_id = chr_table_id (argf->ct, align->core.mtid);
+	chr_std = chr_table_name (argf->ct, align->core.tid);
 
-	// Standardize chromosomes
-	chr_std = chr_std_lookup (argf->cs, chr);
-	chr_std_next = chr_std_lookup (argf->cs, chr_next);
+	// Fill a batch for the writer thread
+	// instead of locking the database
+	if (argf->writer != NULL && argf->batch == NULL)
+		argf->batch = db_writer_get_batch (argf->writer);
 
 	// Dump overlapping exon with alignment
-	acm = exon_tree_lookup_dump (argf->exon_tree, chr_std,
-			align->core.pos + 1, align->core.pos + len,
-			argf->exon_frac, argf->alignment_frac,
-			argf->either, argf->alignment_id);
+	if (argf->exon_cursor != NULL)
+		acm = exon_cursor_lookup_dump (argf->exon_cursor, chr_id,
+				align->core.pos + 1, align->core.pos + len,
+				argf->exon_frac, argf->alignment_frac,
+				argf->either, argf->alignment_id, argf->overlapping_stmt,
+				argf->batch);
+	else
+		acm = exon_tree_lookup_dump (argf->exon_tree, chr_id,
+				align->core.pos + 1, align->core.pos + len,
+				argf->exon_frac, argf->alignment_frac,
+				argf->either, argf->alignment_id, argf->overlapping_stmt,
+				argf->batch);
 
 	if (acm > 0)
 		{
@@ -252,11 +537,23 @@ dump_alignment (AbnormalFilter *argf, const bam1_t *align,
 			argf->alignment_id, qname, align->core.flag, chr_std,
 			(long int) align->core.pos + 1, type);
 
-	db_insert_alignment (argf->alignment_stmt,
-			argf->alignment_id, qname, align->core.flag,
-			chr_std, align->core.pos + 1, align->core.qual,
-			argf->cigar->str, qlen, rlen, chr_std_next,
-			align->core.mpos + 1, type, argf->tid);
+	if (argf->batch != NULL)
+		{
+			db_batch_add_alignment (argf->batch,
+					argf->alignment_id, qname, align->core.flag,
+					chr_id, align->core.pos + 1, align->core.qual,
+					cigar, align->core.n_cigar, qlen, rlen, chr_next_id,
+					align->core.mpos + 1, type, argf->source_id);
+
+			if (db_batch_is_full (argf->batch))
+				flush_batch (argf);
+		}
+	else
+		db_insert_alignment (argf->alignment_stmt,
+				argf->alignment_id, qname, align->core.flag,
+				chr_id, align->core.pos + 1, align->core.qual,
+				cigar, align->core.n_cigar, qlen, rlen, chr_next_id,
+				align->core.mpos + 1, type, argf->source_id);
 
 	// sum the number of files - in order to
 	// avoid database insertion chocking and
@@ -264,20 +561,37 @@ dump_alignment (AbnormalFilter *argf, const bam1_t *align,
 	argf->alignment_id += argf->inc_step;
 }
 
+static AlignStack *
+align_stack_new (void)
+{
+	return xcalloc (1, sizeof (AlignStack));
+}
+
+static void
+align_stack_free (AlignStack *stack)
+{
+	size_t i = 0;
+
+	if (stack == NULL)
+		return;
+
+	for (i = 0; i < stack->alloc; i++)
+		bam_destroy1 (stack->aligns[i]);
+
+	xfree (stack->aligns);
+	xfree (stack);
+}
+
 static inline void
-dump_stack_if_abnormal (AbnormalFilter *argf, const List *stack)
+dump_stack_if_abnormal (AbnormalFilter *argf, const AlignStack *stack)
 {
-	const ListElmt *cur = NULL;
-	const bam1_t *align = NULL;
 	AbnormalType rtype = ABNORMAL_NONE;
 	AbnormalType type = ABNORMAL_NONE;
+	size_t i = 0;
 
-	for (cur = list_head (stack); cur != NULL;
-			cur = list_next (cur))
+	for (i = 0; i < stack->len; i++)
 		{
-			align = list_data (cur);
-
-			if (!abnormal_classifier (align, argf->max_distance,
+			if (!abnormal_classifier (stack->aligns[i], argf->max_distance,
 						argf->phred_quality, argf->max_base_freq,
 						&rtype))
 				return;
@@ -285,85 +599,109 @@ dump_stack_if_abnormal (AbnormalFilter *argf, const List *stack)
 			type |= rtype;
 		}
 
-	if (type != ABNORMAL_NONE)
+	if (type == ABNORMAL_NONE)
+		return;
+
+	if (argf->exonic_only)
 		{
-			for (cur = list_head (stack); cur != NULL;
-					cur = list_next (cur))
+			for (i = 0; i < stack->len; i++)
+				if (is_exonic (argf, stack->aligns[i]))
+					break;
+
+			// No read of the fragment overlaps an exon
+			if (i == stack->len)
 				{
-					align = list_data (cur);
-					dump_alignment (argf, align, type);
-					argf->abnormal_acm++;
+					argf->dropped_acm += stack->len;
+					return;
 				}
 		}
+
+	for (i = 0; i < stack->len; i++)
+		{
+			dump_alignment (argf, stack->aligns[i], type);
+			argf->abnormal_acm++;
+		}
 }
 
 static inline void
-push (const bam1_t *align, List *in, List *trash)
+push (const bam1_t *align, AlignStack *stack)
 {
-	if (trash->size)
+	// Grow the pool: The new slots are
+	// kept for the next fragments
+	if (stack->len == stack->alloc)
 		{
-			ListElmt *head = list_head (trash);
+			stack->alloc = stack->alloc ? stack->alloc << 1 : 8;
+			stack->aligns = xrealloc (stack->aligns,
+					stack->alloc * sizeof (bam1_t *));
 
-			if (bam_copy1 (list_data (head), align) == NULL)
-				log_fatal ("Failed to copy sam alignment");
-
-			list_remove_link (trash, head);
-			list_append_link (in, head);
+			for (size_t i = stack->len; i < stack->alloc; i++)
+				{
+					stack->aligns[i] = bam_init1 ();
+					if (stack->aligns[i] == NULL)
+						log_errno_fatal ("Failed to create bam1_t");
+				}
 		}
-	else
-		{
-			bam1_t *align_copy = bam_dup1 (align);
 
-			if (align_copy == NULL)
-				log_fatal ("Failed to duplicate sam alignment");
+	if (bam_copy1 (stack->aligns[stack->len], align) == NULL)
+		log_fatal ("Failed to copy sam alignment");
 
-			list_append (in, align_copy);
-		}
+	stack->len++;
 }
 
 static inline void
-clean (List *in, List *trash)
+clean (AlignStack *stack)
 {
-	ListElmt *cur = list_head (in);
-
-	while (cur != NULL)
-		{
-			ListElmt *next = list_next (cur);
-			list_remove_link (in, cur);
-			list_append_link (trash, cur);
-			cur = next;
-		}
+	stack->len = 0;
 }
 
 static inline int
-inside_fragment (const bam1_t *align, const List *in)
+inside_fragment (const bam1_t *align, const AlignStack *stack)
+{
+	const bam1_t *head = stack->aligns[0];
+	const char *qname1 = bam_get_qname (align);
+	const char *qname2 = bam_get_qname (head);
+	int len1 = align->core.l_qname - align->core.l_extranul;
+	int len2 = head->core.l_qname - head->core.l_extranul;
+
+	if (len1 != len2)
+		return 0;
+
+	// Read names usually share the instrument
+	// and run prefix and differ at the end,
+	// so test the last bytes first
+	if (len1 > 1 && qname1[len1 - 2] != qname2[len1 - 2])
+		return 0;
+
+	return !memcmp (qname1, qname2, len1);
+}
+
+static inline void
+group_alignment (AbnormalFilter *argf, const bam1_t *align,
+		AlignStack *stack)
 {
-	return !strcmp (bam_get_qname (align),
-			bam_get_qname ((bam1_t *) list_data (list_head (in))));
+	if (stack->len
+			&& !inside_fragment (align, stack))
+		{
+			dump_stack_if_abnormal (argf, stack);
+			clean (stack);
+		}
+
+	push (align, stack);
 }
 
 static void
 parse_sorted_sam (AbnormalFilter *argf)
 {
 	// Keep all reads from the same fragment
-	// into the list
-	List *stack = list_new ((DestroyNotify) bam_destroy1);
-	List *cache = list_new ((DestroyNotify) bam_destroy1);
+	// into the stack
+	AlignStack *stack = align_stack_new ();
 
 	int rc = 0;
 
 	while ((rc = sam_read1 (argf->in, argf->hdr, argf->align)) >= 0)
 		{
 			argf->alignment_acm++;
-
-			if (list_size (stack)
-					&& !inside_fragment (argf->align, stack))
-				{
-					dump_stack_if_abnormal (argf, stack);
-					clean (stack, cache);
-				}
-
-			push (argf->align, stack, cache);
+			group_alignment (argf, argf->align, stack);
 		}
 
 	// Catch if it ocurred an error
@@ -379,8 +717,7 @@ parse_sorted_sam (AbnormalFilter *argf)
 	dump_stack_if_abnormal (argf, stack);
 
 	// Clean
-	list_free (stack);
-	list_free (cache);
+	align_stack_free (stack);
 }
 
 static void
@@ -397,32 +734,25 @@ sam_rewind (AbnormalFilter *argf)
 		log_errno_fatal ("Failed to rewind '%s'",
 				argf->sam_file);
 
+	attach_thread_pool (argf->hts_pool, argf->in, argf->sam_file);
+
 	// Get the header
 	argf->hdr = sam_hdr_read (argf->in);
 	if (argf->hdr == NULL)
 		log_fatal ("Failed to rewind '%s'",
 				argf->sam_file);
+
+	set_required_fields (argf);
 }
 
 static void
-parse_unsorted_sam (AbnormalFilter *argf)
+index_abnormal_ids (AbnormalFilter *argf, IdTable *abnormal_ids)
 {
 	int rc = 0;
 	int pass = 0;
-	const char *name = NULL;
 	AbnormalType type = 0;
-	AbnormalType *type_copy = NULL;
-	Hash *abnormal_ids = NULL;
-
-	// All abnormal alignments are keeped
-	// into a hash if the SAM/BAM/CRAM is not sorted
-	// by queryname
-	abnormal_ids = hash_new (xfree, xfree);
 
-	log_debug ("Index all fragment ids from '%s'", argf->sam_file);
-
-	/*First reading*/
-	while ((rc = sam_read1 (argf->in, argf->hdr, argf->align)) >= 0)
+	while ((rc = read_next (argf)) >= 0)
 		{
 			argf->alignment_acm++;
 
@@ -430,19 +760,7 @@ parse_unsorted_sam (AbnormalFilter *argf)
 					argf->phred_quality, argf->max_base_freq, &type);
 
 			if (pass && type != ABNORMAL_NONE)
-				{
-					type_copy = hash_lookup (abnormal_ids,
-							bam_get_qname (argf->align));
-
-					if (type_copy == NULL)
-						{
-							name = xstrdup (bam_get_qname (argf->align));
-							type_copy = xcalloc (1, sizeof (AbnormalType));
-							hash_insert (abnormal_ids, name, type_copy);
-						}
-
-					*type_copy |= type;
-				}
+				*idtable_insert (abnormal_ids, bam_get_qname (argf->align)) |= type;
 		}
 
 	// Catch if it ocurred an error
@@ -450,28 +768,49 @@ parse_unsorted_sam (AbnormalFilter *argf)
 	if (rc < -1)
 		log_errno_fatal ("Failed to read sam alignment from '%s'",
 				argf->sam_file);
+}
 
-	// Read file again to filter
-	sam_rewind (argf);
-
-	log_debug ("Filter all indexed abnormal fragments from '%s'",
-			argf->sam_file);
+static void
+filter_abnormal_ids (AbnormalFilter *argf, IdTable *abnormal_ids,
+		Array *invalid_ids, Array *exonic_ids)
+{
+	int rc = 0;
+	int pass = 0;
+	AbnormalType type = 0;
+	uint8_t *id_type = NULL;
 
-	// Second reading:
-	// Filter all reads from indexed fragments
-	while ((rc = sam_read1 (argf->in, argf->hdr, argf->align)) >= 0)
+	while ((rc = read_next (argf)) >= 0)
 		{
-			type_copy = hash_lookup (abnormal_ids,
-					bam_get_qname (argf->align));
+			id_type = idtable_lookup (abnormal_ids, bam_get_qname (argf->align));
+			if (id_type == NULL)
+				continue;
 
-			if (type_copy != NULL)
+			pass = abnormal_classifier (argf->align, argf->max_distance,
+					argf->phred_quality, argf->max_base_freq, &type);
+
+			if (pass)
 				{
-					pass = abnormal_classifier (argf->align, argf->max_distance,
-							argf->phred_quality, argf->max_base_freq, &type);
+					// Mark the fragments with some exonic read. If
+					// 'abnormal_ids' is shared, then keep their ids
+					// to be marked later
+					if (argf->exonic_only && !(*id_type & ABNORMAL_EXONIC)
+							&& is_exonic (argf, argf->align))
+						{
+							if (exonic_ids != NULL)
+								array_add (exonic_ids, xstrdup (bam_get_qname (argf->align)));
+							else
+								*id_type |= ABNORMAL_EXONIC;
+						}
 
-					if (!pass)
-						hash_remove (abnormal_ids, bam_get_qname (argf->align));
+					continue;
 				}
+
+			// If 'abnormal_ids' is shared, then keep
+			// the invalid ids to be removed later
+			if (invalid_ids != NULL)
+				array_add (invalid_ids, xstrdup (bam_get_qname (argf->align)));
+			else
+				idtable_remove (abnormal_ids, bam_get_qname (argf->align));
 		}
 
 	// Catch if it ocurred an error
@@ -479,25 +818,33 @@ parse_unsorted_sam (AbnormalFilter *argf)
 	if (rc < -1)
 		log_errno_fatal ("Failed to read sam alignment from '%s'",
 				argf->sam_file);
+}
 
-	// Read file once again in order to catch all abnormal reads
-	sam_rewind (argf);
-
-	log_debug ("Catch all indexed abnormal fragments from '%s'",
-			argf->sam_file);
+static void
+dump_abnormal_ids (AbnormalFilter *argf, IdTable *abnormal_ids)
+{
+	int rc = 0;
+	uint8_t *type = NULL;
 
-	// Third reading:
-	// Get all reads from indexed fragments
-	while ((rc = sam_read1 (argf->in, argf->hdr, argf->align)) >= 0)
+	while ((rc = read_next (argf)) >= 0)
 		{
-			type_copy = hash_lookup (abnormal_ids,
+			type = idtable_lookup (abnormal_ids,
 					bam_get_qname (argf->align));
 
-			if (type_copy != NULL)
+			if (type == NULL)
+				continue;
+
+			// No read of the fragment overlaps an exon
+			if (argf->exonic_only && !(*type & ABNORMAL_EXONIC))
 				{
-					dump_alignment (argf, argf->align, *type_copy);
-					argf->abnormal_acm++;
+					argf->dropped_acm++;
+					continue;
 				}
+
+			// The exonic mark is set again
+			// for each read on its own
+			dump_alignment (argf, argf->align, *type & ~ABNORMAL_EXONIC);
+			argf->abnormal_acm++;
 		}
 
 	// Catch if it ocurred an error
@@ -505,53 +852,1524 @@ parse_unsorted_sam (AbnormalFilter *argf)
 	if (rc < -1)
 		log_errno_fatal ("Failed to read sam alignment from '%s'",
 				argf->sam_file);
+}
+
+static void
+parse_unsorted_sam (AbnormalFilter *argf)
+{
+	IdTable *abnormal_ids = NULL;
+
+	// All abnormal alignments are keeped
+	// into a table if the SAM/BAM/CRAM is not sorted
+	// by queryname
+	abnormal_ids = idtable_new ();
+
+	log_debug ("Index all fragment ids from '%s'", argf->sam_file);
+
+	// First reading:
+	// Index all abnormal fragments
+	index_abnormal_ids (argf, abnormal_ids);
+
+	// Read file again to filter
+	sam_rewind (argf);
+
+	log_debug ("Filter all indexed abnormal fragments from '%s'",
+			argf->sam_file);
+
+	// Second reading:
+	// Filter all reads from indexed fragments
+	filter_abnormal_ids (argf, abnormal_ids, NULL, NULL);
+
+	// Read file once again in order to catch all abnormal reads
+	sam_rewind (argf);
+
+	log_debug ("Catch all indexed abnormal fragments from '%s'",
+			argf->sam_file);
+
+	// Third reading:
+	// Get all reads from indexed fragments
+	dump_abnormal_ids (argf, abnormal_ids);
 
 	// Clean
-	hash_free (abnormal_ids);
+	idtable_free (abnormal_ids);
 }
 
-void
-abnormal_filter (AbnormalArg *arg)
+static void
+fragment_free (Fragment *frag)
 {
-	assert (arg != NULL && arg->sam_file != NULL
-			&& arg->alignment_stmt != NULL && arg->exon_tree
-			&& arg->cs && arg->tid >= 0 && arg->inc_step > 0
-			&& arg->phred_quality >= 0 && arg->max_base_freq > 0);
-
-	AbnormalFilter argf = {};
-	memcpy (&argf, arg, sizeof (AbnormalArg));
+	if (frag == NULL)
+		return;
 
-	// Opon SAM/BAM/CRAM
-	// Allocate resources
-	abnormal_filter_init (&argf);
+	align_stack_free (frag->aligns);
+	xfree (frag->qname);
+	xfree (frag);
+}
 
-	log_info ("Searching for abnormal alignments into '%s'",
-			argf.sam_file);
+/*
+ * The fragments already dumped are kept into the
+ * pool, so that their names and read slots are
+ * recycled by the next ones
+ */
+static Fragment *
+fragment_pool_get (Array *pool, const bam1_t *align, int tid, long pos)
+{
+	Fragment *frag = NULL;
+	size_t len = align->core.l_qname;
 
-	// Let's make this work!
-	if (argf.queryname_sorted)
+	if (array_len (pool) > 0)
+		frag = array_remove_index (pool, array_len (pool) - 1);
+	else
 		{
-			log_info ("Parsing 'sorted file' mode");
-			parse_sorted_sam (&argf);
+			frag = xcalloc (1, sizeof (Fragment));
+			frag->aligns = align_stack_new ();
 		}
-	else
+
+	if (frag->qname_alloc < len)
 		{
-			log_info ("Parsing 'unsorted file' mode");
-			parse_unsorted_sam (&argf);
+			frag->qname = xrealloc (frag->qname, len);
+			frag->qname_alloc = len;
 		}
 
-	log_info ("Processed %li alignments for '%s'",
-			argf.alignment_acm, argf.sam_file);
+	// The name is NUL terminated inside 'l_qname'
+	memcpy (frag->qname, bam_get_qname (align), len);
+	clean (frag->aligns);
 
-	// Just print the amount of abnormal alignments
-	if (argf.abnormal_acm > 0)
-		log_info ("Found %li abnormal alignments for '%s': "
+	frag->type = ABNORMAL_NONE;
+	frag->invalid = 0;
+	frag->tid = frag->heap_tid = tid;
+	frag->pos = frag->heap_pos = pos;
+
+	return frag;
+}
+
+static inline void
+fragment_pool_put (Array *pool, Fragment *frag)
+{
+	array_add (pool, frag);
+}
+
+static void
+fragment_pool_free (Array *pool)
+{
+	int i = 0;
+
+	if (pool == NULL)
+		return;
+
+	for (i = 0; i < array_len (pool); i++)
+		fragment_free (array_get (pool, i));
+
+	array_free (pool, 1);
+}
+
+static inline int
+position_cmp (int tid1, long pos1, int tid2, long pos2)
+{
+	// Alignments with no coordinate
+	// come at the end of the file
+	if (tid1 != tid2)
+		{
+			if (tid1 < 0)
+				return 1;
+			if (tid2 < 0)
+				return -1;
+			return tid1 < tid2 ? -1 : 1;
+		}
+
+	return (pos1 > pos2) - (pos1 < pos2);
+}
+
+static int
+fragment_cmp (const void *a, const void *b)
+{
+	const Fragment *fa = a;
+	const Fragment *fb = b;
+
+	return position_cmp (fa->heap_tid, fa->heap_pos,
+			fb->heap_tid, fb->heap_pos);
+}
+
+static inline void
+extend_horizon (int *tid, long *pos, int tid_next, long pos_next)
+{
+	if (position_cmp (tid_next, pos_next, *tid, *pos) > 0)
+		{
+			*tid = tid_next;
+			*pos = pos_next;
+		}
+}
+
+typedef void (*SAFunc) (int tid, long pos, void *user_data);
+
+static void
+sa_foreach (bam_hdr_t *hdr, const bam1_t *align, SAFunc func,
+		void *user_data)
+{
+	char contig[CONTIG_NAME_BUFSIZ];
+	const char *sa = NULL;
+	const char *comma = NULL;
+	uint8_t *aux = NULL;
+	int sa_tid = 0;
+	size_t len = 0;
+
+	// Chimeric alignments: 'SA:Z:(rname,pos,strand,CIGAR,mapQ,NM;)+'
+	aux = bam_aux_get (align, "SA");
+	if (aux == NULL)
+		return;
+
+	for (sa = bam_aux2Z (aux); sa != NULL && *sa != '\0'; sa = strchr (sa, ';'))
+		{
+			if (*sa == ';')
+				sa++;
+
+			comma = strchr (sa, ',');
+			if (comma == NULL)
+				break;
+
+			len = comma - sa;
+			if (len >= CONTIG_NAME_BUFSIZ)
+				continue;
+
+			memcpy (contig, sa, len);
+			contig[len] = '\0';
+
+			sa_tid = bam_name2id (hdr, contig);
+			if (sa_tid >= 0)
+				func (sa_tid, strtol (comma + 1, NULL, 10) - 1, user_data);
+		}
+}
+
+static void
+extend_sa_horizon (int tid, long pos, Horizon *horizon)
+{
+	extend_horizon (&horizon->tid, &horizon->pos, tid, pos);
+}
+
+static void
+align_horizon (bam_hdr_t *hdr, const bam1_t *align,
+		int *tid, long *pos)
+{
+	Horizon horizon = { align->core.tid, align->core.pos };
+
+	// The mate
+	if ((align->core.flag & 0x1) && !(align->core.flag & 0x8))
+		extend_horizon (&horizon.tid, &horizon.pos,
+				align->core.mtid, align->core.mpos);
+
+	// The supplementary alignments
+	sa_foreach (hdr, align, (SAFunc) extend_sa_horizon, &horizon);
+
+	*tid = horizon.tid;
+	*pos = horizon.pos;
+}
+
+static void
+dump_fragment_if_abnormal (AbnormalFilter *argf, const Fragment *frag)
+{
+	const AlignStack *stack = frag->aligns;
+	size_t i = 0;
+
+	if (frag->invalid || frag->type == ABNORMAL_NONE)
+		return;
+
+	if (argf->exonic_only)
+		{
+			for (i = 0; i < stack->len; i++)
+				if (is_exonic (argf, stack->aligns[i]))
+					break;
+
+			// No read of the fragment overlaps an exon
+			if (i == stack->len)
+				{
+					argf->dropped_acm += stack->len;
+					return;
+				}
+		}
+
+	for (i = 0; i < stack->len; i++)
+		{
+			dump_alignment (argf, stack->aligns[i], frag->type);
+			argf->abnormal_acm++;
+		}
+}
+
+static void
+flush_fragments (AbnormalFilter *argf, Hash *pending,
+		Heap *horizon, Array *pool, int tid, long pos)
+{
+	Fragment *frag = NULL;
+
+	while ((frag = heap_peek (horizon)) != NULL
+			&& position_cmp (frag->heap_tid, frag->heap_pos, tid, pos) < 0)
+		{
+			heap_pop (horizon);
+
+			// The fragment grew after it was pushed:
+			// Wait for the farthest position
+			if (position_cmp (frag->tid, frag->pos, tid, pos) >= 0)
+				{
+					frag->heap_tid = frag->tid;
+					frag->heap_pos = frag->pos;
+					heap_push (horizon, frag);
+					continue;
+				}
+
+			// All reads from the fragment were seen
+			dump_fragment_if_abnormal (argf, frag);
+			hash_remove (pending, frag->qname);
+			fragment_pool_put (pool, frag);
+		}
+}
+
+/*
+ * Coordinate sorted files, when asked for a single
+ * pass: Each fragment is dumped as soon as the scan
+ * passes the farthest position of its reads, mates
+ * and supplementaries. The secondary alignments are
+ * referenced by no read, so a failing one placed
+ * after that position no longer invalidates the
+ * fragment, as in the other modes
+ */
+static void
+parse_coordinate_sam (AbnormalFilter *argf)
+{
+	// Fragments waiting for their mates,
+	// and the heap of their farthest positions
+	Hash *pending = hash_new (NULL, NULL);
+	Heap *horizon = heap_new (fragment_cmp, NULL);
+	Array *pool = array_new (NULL);
+
+	Fragment *frag = NULL;
+	AbnormalType type = 0;
+	int last_tid = 0;
+	long last_pos = 0;
+	int tid = 0;
+	long pos = 0;
+	int pass = 0;
+	int rc = 0;
+
+	while ((rc = sam_read1 (argf->in, argf->hdr, argf->align)) >= 0)
+		{
+			argf->alignment_acm++;
+
+			if (position_cmp (argf->align->core.tid, argf->align->core.pos,
+						last_tid, last_pos) < 0)
+				log_fatal ("File '%s' is not sorted by coordinate at '%s'",
+						argf->sam_file, bam_get_qname (argf->align));
+
+			last_tid = argf->align->core.tid;
+			last_pos = argf->align->core.pos;
+
+			// The scan passed their farthest position
+			flush_fragments (argf, pending, horizon, pool,
+					last_tid, last_pos);
+
+			pass = abnormal_classifier (argf->align, argf->max_distance,
+					argf->phred_quality, argf->max_base_freq, &type);
+
+			align_horizon (argf->hdr, argf->align, &tid, &pos);
+			frag = hash_lookup (pending, bam_get_qname (argf->align));
+
+			if (frag == NULL)
+				{
+					// Unplaced reads at the end of the file have
+					// no mapped mates: Nothing to keep
+					if (last_tid < 0)
+						continue;
+
+					frag = fragment_pool_get (pool, argf->align, tid, pos);
+					hash_insert (pending, frag->qname, frag);
+					heap_push (horizon, frag);
+				}
+			else
+				extend_horizon (&frag->tid, &frag->pos, tid, pos);
+
+			if (frag->invalid)
+				continue;
+
+			// A single invalid read invalidates the
+			// whole fragment. Keep it as a tombstone
+			// until all its reads pass by
+			if (!pass)
+				{
+					frag->invalid = 1;
+					clean (frag->aligns);
+					continue;
+				}
+
+			frag->type |= type;
+			push (argf->align, frag->aligns);
+		}
+
+	// Catch if it ocurred an error
+	// in reading from input
+	if (rc < -1)
+		log_errno_fatal ("Failed to read sam alignment from '%s'",
+				argf->sam_file);
+
+	// The remaining fragments
+	flush_fragments (argf, pending, horizon, pool, -1, LONG_MAX);
+
+	// Clean
+	heap_free (horizon);
+	hash_free (pending);
+	fragment_pool_free (pool);
+}
+
+static MateRegions *
+mate_regions_new (void)
+{
+	return xcalloc (1, sizeof (MateRegions));
+}
+
+static void
+mate_regions_free (MateRegions *regs)
+{
+	if (regs == NULL)
+		return;
+
+	xfree (regs->regions);
+	xfree (regs);
+}
+
+static void
+mate_regions_add (int tid, long pos, MateRegions *regs)
+{
+	if (regs->len == regs->alloc)
+		{
+			regs->alloc = regs->alloc ? regs->alloc << 1 : 1024;
+			regs->regions = xrealloc (regs->regions,
+					regs->alloc * sizeof (MateRegion));
+		}
+
+	// Any read overlapping the position is fetched,
+	// even the ones starting there: Enough to catch
+	// the mates by their 'mpos'
+	regs->regions[regs->len++] = (MateRegion) {
+		.tid = tid,
+		.beg = pos,
+		.end = pos + 1
+	};
+}
+
+static int
+mate_region_cmp (const void *a, const void *b)
+{
+	const MateRegion *ra = a;
+	const MateRegion *rb = b;
+
+	if (ra->tid != rb->tid)
+		return ra->tid < rb->tid ? -1 : 1;
+
+	return (ra->beg > rb->beg) - (ra->beg < rb->beg);
+}
+
+static void
+mate_regions_compact (MateRegions *regs)
+{
+	size_t i = 0;
+	size_t j = 0;
+
+	if (regs->len == 0)
+		return;
+
+	qsort (regs->regions, regs->len, sizeof (MateRegion),
+			mate_region_cmp);
+
+	// Merge the overlapping and adjacent regions,
+	// so that each BGZF block is read once
+	for (i = 1; i < regs->len; i++)
+		{
+			if (regs->regions[i].tid == regs->regions[j].tid
+					&& regs->regions[i].beg <= regs->regions[j].end)
+				{
+					if (regs->regions[i].end > regs->regions[j].end)
+						regs->regions[j].end = regs->regions[i].end;
+				}
+			else
+				regs->regions[++j] = regs->regions[i];
+		}
+
+	regs->len = j + 1;
+}
+
+static void
+index_mate_regions (AbnormalFilter *argf, IdTable *abnormal_ids,
+		MateRegions *regs)
+{
+	int rc = 0;
+	int pass = 0;
+	AbnormalType type = 0;
+
+	while ((rc = sam_read1 (argf->in, argf->hdr, argf->align)) >= 0)
+		{
+			argf->alignment_acm++;
+
+			pass = abnormal_classifier (argf->align, argf->max_distance,
+					argf->phred_quality, argf->max_base_freq, &type);
+
+			if (!pass || type == ABNORMAL_NONE)
+				continue;
+
+			*idtable_insert (abnormal_ids, bam_get_qname (argf->align)) |= type;
+
+			// The read itself, its mate and its supplementaries.
+			// The abnormal reads are all mapped with mapped mates
+			mate_regions_add (argf->align->core.tid,
+					argf->align->core.pos, regs);
+			mate_regions_add (argf->align->core.mtid,
+					argf->align->core.mpos, regs);
+			sa_foreach (argf->hdr, argf->align,
+					(SAFunc) mate_regions_add, regs);
+		}
+
+	// Catch if it ocurred an error
+	// in reading from input
+	if (rc < -1)
+		log_errno_fatal ("Failed to read sam alignment from '%s'",
+				argf->sam_file);
+}
+
+static int
+fragment_contains (const Fragment *frag, const bam1_t *align)
+{
+	const bam1_t *prev = NULL;
+	size_t i = 0;
+
+	for (i = 0; i < frag->aligns->len; i++)
+		{
+			prev = frag->aligns->aligns[i];
+			if (prev->core.flag == align->core.flag
+					&& prev->core.tid == align->core.tid
+					&& prev->core.pos == align->core.pos)
+				return 1;
+		}
+
+	return 0;
+}
+
+/*
+ * The regions by contig id, so that contig names
+ * with ':', such as 'HLA-A*01:01:01:01', are not
+ * parsed as region strings. The regions must be
+ * compacted
+ */
+static hts_reglist_t *
+mate_regions_reglist (const MateRegions *regs, const bam_hdr_t *hdr,
+		int *count)
+{
+	hts_reglist_t *reglist = NULL;
+	hts_reglist_t *reg = NULL;
+	size_t i = 0;
+	size_t j = 0;
+	size_t k = 0;
+	int n = 0;
+
+	// At most one entry per region
+	reglist = xcalloc (regs->len, sizeof (hts_reglist_t));
+
+	for (i = 0; i < regs->len; i = j)
+		{
+			for (j = i; j < regs->len
+					&& regs->regions[j].tid == regs->regions[i].tid; j++)
+				;
+
+			reg = &reglist[n++];
+			reg->reg = hdr->target_name[regs->regions[i].tid];
+			reg->tid = regs->regions[i].tid;
+			reg->count = j - i;
+			reg->intervals = xcalloc (reg->count, sizeof (MatePair));
+
+			for (k = i; k < j; k++)
+				{
+					reg->intervals[k - i].beg = regs->regions[k].beg;
+					reg->intervals[k - i].end = regs->regions[k].end;
+				}
+
+			reg->min_beg = regs->regions[i].beg;
+			reg->max_end = regs->regions[j - 1].end;
+		}
+
+	*count = n;
+	return reglist;
+}
+
+static void
+fetch_abnormal_ids (AbnormalFilter *argf, IdTable *abnormal_ids,
+		MateRegions *regs)
+{
+	// Fragments waiting for their reads,
+	// and the heap of their farthest positions
+	Hash *pending = hash_new (NULL, NULL);
+	Heap *horizon = heap_new (fragment_cmp, NULL);
+	Array *pool = array_new (NULL);
+
+	Fragment *frag = NULL;
+	AbnormalType type = 0;
+	hts_reglist_t *reglist = NULL;
+	hts_itr_t *itr = NULL;
+	int count = 0;
+	int tid = 0;
+	long pos = 0;
+	int pass = 0;
+	int rc = 0;
+
+	reglist = mate_regions_reglist (regs, argf->hdr, &count);
+
+	// The iterator takes the region list
+	itr = sam_itr_regions (argf->idx, argf->hdr, reglist,
+			(unsigned int) count);
+	if (itr == NULL)
+		log_fatal ("Failed to query %zu regions at '%s'",
+				regs->len, argf->sam_file);
+
+	while ((rc = sam_itr_next (argf->in, itr, argf->align)) >= 0)
+		{
+			// The reads come sorted by coordinate, so
+			// the iterator passed their farthest position
+			flush_fragments (argf, pending, horizon, pool,
+					argf->align->core.tid, argf->align->core.pos);
+
+			if (idtable_lookup (abnormal_ids, bam_get_qname (argf->align)) == NULL)
+				continue;
+
+			align_horizon (argf->hdr, argf->align, &tid, &pos);
+			frag = hash_lookup (pending, bam_get_qname (argf->align));
+
+			if (frag == NULL)
+				{
+					frag = fragment_pool_get (pool, argf->align, tid, pos);
+					hash_insert (pending, frag->qname, frag);
+					heap_push (horizon, frag);
+				}
+			else
+				extend_horizon (&frag->tid, &frag->pos, tid, pos);
+
+			// A read spanning two regions
+			// may be returned twice
+			if (frag->invalid || fragment_contains (frag, argf->align))
+				continue;
+
+			pass = abnormal_classifier (argf->align, argf->max_distance,
+					argf->phred_quality, argf->max_base_freq, &type);
+
+			// A single invalid read invalidates
+			// the whole fragment
+			if (!pass)
+				{
+					frag->invalid = 1;
+					clean (frag->aligns);
+					continue;
+				}
+
+			frag->type |= type;
+			push (argf->align, frag->aligns);
+		}
+
+	// Catch if it ocurred an error
+	// in reading from input
+	if (rc < -1)
+		log_errno_fatal ("Failed to read sam alignment from '%s'",
+				argf->sam_file);
+
+	// The remaining fragments
+	flush_fragments (argf, pending, horizon, pool, -1, LONG_MAX);
+
+	// Clean
+	sam_itr_destroy (itr);
+	heap_free (horizon);
+	hash_free (pending);
+	fragment_pool_free (pool);
+}
+
+/*
+ * Files neither sorted by queryname nor by coordinate,
+ * but indexed: The first reading indexes the abnormal
+ * fragments and the positions of their reads. Then
+ * only the BGZF blocks overlapping those positions
+ * are read, and each fragment is dumped as soon as
+ * the iterator passes its farthest position. The
+ * reads referenced by no mate or SA tag, such as
+ * the secondary alignments, are not fetched
+ */
+static void
+parse_indexed_sam (AbnormalFilter *argf)
+{
+	IdTable *abnormal_ids = idtable_new ();
+	MateRegions *regs = mate_regions_new ();
+
+	log_debug ("Index all fragment ids and their mates from '%s'",
+			argf->sam_file);
+
+	// First reading:
+	// Index all abnormal fragments
+	index_mate_regions (argf, abnormal_ids, regs);
+
+	// Sort and merge the positions, so that the
+	// iterator parses far fewer regions
+	mate_regions_compact (regs);
+
+	log_debug ("Fetch %zu regions with abnormal fragments from '%s'",
+			regs->len, argf->sam_file);
+
+	// Second reading:
+	// Get all reads from indexed fragments
+	if (regs->len > 0)
+		fetch_abnormal_ids (argf, abnormal_ids, regs);
+
+	// Clean
+	mate_regions_free (regs);
+	idtable_free (abnormal_ids);
+}
+
+static int
+spill_cmp (const void *a, const void *b)
+{
+	const bam1_t *align1 = * (bam1_t * const *) a;
+	const bam1_t *align2 = * (bam1_t * const *) b;
+
+	int rc = strcmp (bam_get_qname (align1),
+			bam_get_qname (align2));
+
+	// Keep the input order among the
+	// reads of the same fragment
+	if (rc == 0)
+		rc = (align1->id > align2->id) - (align1->id < align2->id);
+
+	return rc;
+}
+
+static int
+spill_run_cmp (const void *a, const void *b)
+{
+	const SpillRun *run1 = a;
+	const SpillRun *run2 = b;
+
+	int rc = strcmp (bam_get_qname (run1->align),
+			bam_get_qname (run2->align));
+
+	// Older runs hold older reads
+	if (rc == 0)
+		rc = run1->index - run2->index;
+
+	return rc;
+}
+
+static char *
+spill_path_new (const AbnormalFilter *argf)
+{
+	char *path = NULL;
+	int fd = 0;
+
+	xasprintf (&path, "%s/%s", argf->tmp_dir, SPILL_TEMPLATE);
+
+	fd = xmkstemp (path);
+	close (fd);
+
+	return path;
+}
+
+static SpillFile *
+spill_file_new (char *path, int level)
+{
+	SpillFile *file = xcalloc (1, sizeof (SpillFile));
+
+	file->path = path;
+	file->level = level;
+
+	return file;
+}
+
+static void
+spill_file_free (SpillFile *file)
+{
+	if (file == NULL)
+		return;
+
+	xfree (file->path);
+	xfree (file);
+}
+
+static samFile *
+spill_open (const AbnormalFilter *argf, const char *path)
+{
+	// The runs are short-lived: Favor
+	// speed over compression ratio
+	samFile *out = sam_open (path, "wb1");
+	if (out == NULL)
+		log_errno_fatal ("Failed to open '%s' for writing", path);
+
+	attach_thread_pool (argf->hts_pool, out, path);
+
+	if (sam_hdr_write (out, argf->hdr) < 0)
+		log_fatal ("Failed to write sam header to '%s'", path);
+
+	return out;
+}
+
+static void
+spill_close (samFile *out, const char *path)
+{
+	if (sam_close (out) < 0)
+		log_errno_fatal ("Failed to close '%s'", path);
+}
+
+static void
+spill_buffer (AbnormalFilter *argf, Array *buffer, size_t len,
+		Array *runs)
+{
+	char *path = spill_path_new (argf);
+	samFile *out = NULL;
+	size_t i = 0;
+
+	log_debug ("Spill %zu alignments from '%s' to '%s'",
+			len, argf->sam_file, path);
+
+	// Only the filled part of the buffer. The
+	// remaining alignments are kept for reuse
+	qsort (array_data (buffer), len, sizeof (void *), spill_cmp);
+
+	out = spill_open (argf, path);
+
+	for (i = 0; i < len; i++)
+		if (sam_write1 (out, argf->hdr, array_get (buffer, i)) < 0)
+			log_fatal ("Failed to write sam alignment to '%s'", path);
+
+	spill_close (out, path);
+	array_add (runs, spill_file_new (path, 0));
+}
+
+static inline int
+spill_read (AbnormalFilter *argf, SpillRun *run)
+{
+	int rc = sam_read1 (run->fp, argf->hdr, run->align);
+
+	if (rc < -1)
+		log_errno_fatal ("Failed to read sam alignment from '%s'",
+				run->path);
+
+	return rc >= 0;
+}
+
+/*
+ * Merge the runs from 'from' to the end of 'runs'
+ * into 'out', or group them into the 'stack' if
+ * there is no 'out'. The merged runs are removed
+ */
+static void
+merge_runs (AbnormalFilter *argf, Array *runs, int from,
+		samFile *out, const char *out_path, AlignStack *stack)
+{
+	int num_runs = array_len (runs) - from;
+	Heap *heap = heap_new (spill_run_cmp, NULL);
+	SpillRun *run_pool = xcalloc (num_runs, sizeof (SpillRun));
+	SpillRun *run = NULL;
+	SpillFile *file = NULL;
+	bam_hdr_t *hdr = NULL;
+	int i = 0;
+
+	log_debug ("Merge %d spilled runs from '%s'",
+			num_runs, argf->sam_file);
+
+	for (i = 0; i < num_runs; i++)
+		{
+			file = array_get (runs, from + i);
+			run = &run_pool[i];
+			run->path = file->path;
+			run->index = i;
+
+			run->fp = sam_open (run->path, "rb");
+			if (run->fp == NULL)
+				log_errno_fatal ("Failed to open '%s' for reading",
+						run->path);
+
+			attach_thread_pool (argf->hts_pool, run->fp, run->path);
+
+			// All runs share the input header
+			hdr = sam_hdr_read (run->fp);
+			if (hdr == NULL)
+				log_fatal ("Failed to read sam header from '%s'",
+						run->path);
+			bam_hdr_destroy (hdr);
+
+			run->align = bam_init1 ();
+			if (run->align == NULL)
+				log_errno_fatal ("Failed to create bam1_t for '%s'",
+						run->path);
+
+			if (spill_read (argf, run))
+				heap_push (heap, run);
+		}
+
+	// The smallest qname among the runs
+	// at each step
+	while (heap_len (heap))
+		{
+			run = heap_pop (heap);
+
+			if (out != NULL)
+				{
+					if (sam_write1 (out, argf->hdr, run->align) < 0)
+						log_fatal ("Failed to write sam alignment to '%s'",
+								out_path);
+				}
+			else
+				group_alignment (argf, run->align, stack);
+
+			if (spill_read (argf, run))
+				heap_push (heap, run);
+		}
+
+	for (i = 0; i < num_runs; i++)
+		{
+			run = &run_pool[i];
+
+			if (sam_close (run->fp) < 0)
+				log_errno_fatal ("Failed to close '%s'", run->path);
+
+			bam_destroy1 (run->align);
+			xunlink (run->path);
+		}
+
+	// The runs were consumed
+	while (array_len (runs) > from)
+		array_remove_index (runs, array_len (runs) - 1);
+
+	heap_free (heap);
+	xfree (run_pool);
+}
+
+/*
+ * Merge the last SPILL_FAN_IN runs into a single one
+ * of the next level while they share the same level,
+ * as a counter in base SPILL_FAN_IN. It bounds the open
+ * files and each read is rewritten only once per level
+ */
+static void
+compact_runs (AbnormalFilter *argf, Array *runs)
+{
+	SpillFile *file = NULL;
+	samFile *out = NULL;
+	char *path = NULL;
+	int from = 0;
+	int level = 0;
+
+	while (array_len (runs) >= SPILL_FAN_IN)
+		{
+			from = array_len (runs) - SPILL_FAN_IN;
+			file = array_get (runs, array_len (runs) - 1);
+			level = file->level;
+
+			// The levels decrease toward the end, so it is
+			// enough to test the first of the last runs
+			file = array_get (runs, from);
+			if (file->level != level)
+				break;
+
+			path = spill_path_new (argf);
+			out = spill_open (argf, path);
+
+			merge_runs (argf, runs, from, out, path, NULL);
+
+			spill_close (out, path);
+			array_add (runs, spill_file_new (path, level + 1));
+		}
+}
+
+/*
+ * Group the reads by name with external sorting. All
+ * reads are spilled, not only the abnormal ones: A read
+ * is dumped along with its abnormal mates, which may
+ * come later in a single pass. So the temporary dir
+ * holds the whole file, and twice the largest level
+ * while merging it
+ */
+static void
+parse_external_sam (AbnormalFilter *argf)
+{
+	// Alignments in memory and the
+	// sorted runs spilled to disk
+	Array *buffer = array_new ((DestroyNotify) bam_destroy1);
+	Array *runs = array_new ((DestroyNotify) spill_file_free);
+
+	// Keep all reads from the same fragment
+	// into the stack
+	AlignStack *stack = align_stack_new ();
+
+	bam1_t *align_copy = NULL;
+	size_t len = 0;
+	size_t mem = 0;
+	size_t i = 0;
+	int rc = 0;
+
+	while ((rc = sam_read1 (argf->in, argf->hdr, argf->align)) >= 0)
+		{
+			argf->alignment_acm++;
+
+			// Recycle the alignments from
+			// the last spilled run
+			if (len < array_len (buffer))
+				{
+					align_copy = array_get (buffer, len);
+					if (bam_copy1 (align_copy, argf->align) == NULL)
+						log_fatal ("Failed to copy sam alignment");
+				}
+			else
+				{
+					align_copy = bam_dup1 (argf->align);
+					if (align_copy == NULL)
+						log_fatal ("Failed to duplicate sam alignment");
+					array_add (buffer, align_copy);
+				}
+
+			align_copy->id = argf->alignment_acm;
+			mem += sizeof (bam1_t) + align_copy->m_data;
+			len++;
+
+			if (mem >= argf->max_memory)
+				{
+					spill_buffer (argf, buffer, len, runs);
+					compact_runs (argf, runs);
+					len = mem = 0;
+				}
+		}
+
+	// Catch if it ocurred an error
+	// in reading from input
+	if (rc < -1)
+		log_errno_fatal ("Failed to read sam alignment from '%s'",
+				argf->sam_file);
+
+	if (array_len (runs) == 0)
+		{
+			// It fits into memory: There is
+			// no need to touch the disk
+			qsort (array_data (buffer), len, sizeof (void *), spill_cmp);
+
+			for (i = 0; i < len; i++)
+				group_alignment (argf, array_get (buffer, i), stack);
+		}
+	else
+		{
+			if (len > 0)
+				spill_buffer (argf, buffer, len, runs);
+
+			merge_runs (argf, runs, 0, NULL, NULL, stack);
+		}
+
+	// The last bunch of alignments
+	dump_stack_if_abnormal (argf, stack);
+
+	// Clean
+	array_free (buffer, 1);
+	array_free (runs, 1);
+	align_stack_free (stack);
+}
+
+static void
+abnormal_filter_report (const AbnormalFilter *argf)
+{
+	log_info ("Processed %li alignments for '%s'",
+			argf->alignment_acm, argf->sam_file);
+
+	// Just print the amount of abnormal alignments
+	if (argf->abnormal_acm > 0)
+		log_info ("Found %li abnormal alignments for '%s': "
 			"%li abnormal alignments fall inside some exonic region (%.2f%%)",
-			argf.abnormal_acm, argf.sam_file, argf.exonic_acm,
-			(float) (argf.exonic_acm * 100) / argf.abnormal_acm);
+			argf->abnormal_acm, argf->sam_file, argf->exonic_acm,
+			(float) (argf->exonic_acm * 100) / argf->abnormal_acm);
+	else
+		log_info ("File '%s' has no abnormal alignments", argf->sam_file);
+
+	if (argf->exonic_only && argf->dropped_acm > 0)
+		log_info ("Dropped %li abnormal alignments for '%s' from "
+				"fragments with no read inside some exonic region",
+				argf->dropped_acm, argf->sam_file);
+}
+
+void
+abnormal_filter (AbnormalArg *arg)
+{
+	assert (arg != NULL && arg->sam_file != NULL
+			&& arg->alignment_stmt != NULL && arg->exon_tree
+			&& arg->cs && arg->tid >= 0 && arg->inc_step > 0
+			&& arg->source_id > 0
+			&& arg->phred_quality >= 0 && arg->max_base_freq > 0
+			&& (arg->max_memory == 0 || arg->tmp_dir != NULL));
+
+	AbnormalFilter argf = {};
+	memcpy (&argf, arg, sizeof (AbnormalArg));
+
+	// Opon SAM/BAM/CRAM
+	// Allocate resources
+	abnormal_filter_init (&argf);
+
+	log_info ("Searching for abnormal alignments into '%s'",
+			argf.sam_file);
+
+	// Let's make this work!
+	if (argf.queryname_sorted)
+		{
+			log_info ("Parsing 'sorted file' mode");
+			parse_sorted_sam (&argf);
+		}
+	else if (argf.coordinate_sorted)
+		{
+			log_info ("Parsing 'coordinate sorted file' mode");
+			parse_coordinate_sam (&argf);
+		}
+	else if (argf.idx != NULL)
+		{
+			log_info ("Parsing 'indexed file' mode");
+			parse_indexed_sam (&argf);
+		}
+	else if (argf.max_memory > 0 || argf.stream)
+		{
+			// No budget was set, but the stream
+			// must be grouped in a single pass
+			if (argf.max_memory == 0)
+				argf.max_memory = STREAM_MAX_MEMORY;
+
+			if (argf.tmp_dir == NULL)
+				log_fatal ("No temporary dir to sort the stream '%s'",
+						argf.sam_file);
+
+			log_info ("Parsing 'unsorted file' mode with %zu bytes of memory",
+					argf.max_memory);
+			parse_external_sam (&argf);
+		}
 	else
-		log_info ("File '%s' has no abnormal alignments", argf.sam_file);
+		{
+			log_info ("Parsing 'unsorted file' mode");
+			parse_unsorted_sam (&argf);
+		}
+
+	abnormal_filter_report (&argf);
 
 	// Cleanup
 	abnormal_filter_destroy (&argf);
 }
+
+static ShardReader *
+shard_reader_new (AbnormalFilter *argf)
+{
+	ShardReader *reader = xcalloc (1, sizeof (ShardReader));
+
+	reader->sam_file = argf->sam_file;
+
+	reader->in = sam_open (argf->sam_file, "rb");
+	if (reader->in == NULL)
+		log_errno_fatal ("Failed to open '%s' for reading",
+				argf->sam_file);
+
+	attach_thread_pool (argf->hts_pool, reader->in, argf->sam_file);
+
+	reader->hdr = sam_hdr_read (reader->in);
+	if (reader->hdr == NULL)
+		log_fatal ("Failed to read sam header from '%s'",
+				argf->sam_file);
+
+	argf->in = reader->in;
+	set_required_fields (argf);
+
+	// CRAM index is bound to the file handle,
+	// so each reader loads its own
+	reader->idx = sam_index_load (reader->in, argf->sam_file);
+	if (reader->idx == NULL)
+		log_fatal ("Failed to load index for '%s'",
+				argf->sam_file);
+
+	return reader;
+}
+
+static void
+shard_reader_free (ShardReader *reader)
+{
+	if (reader == NULL)
+		return;
+
+	hts_idx_destroy (reader->idx);
+	bam_hdr_destroy (reader->hdr);
+
+	if (sam_close (reader->in) < 0)
+		log_errno_fatal ("Failed to close input stream for '%s'",
+				reader->sam_file);
+
+	xfree (reader);
+}
+
+static ShardPool *
+shard_pool_new (void)
+{
+	ShardPool *pool = xcalloc (1, sizeof (ShardPool));
+
+	// The readers are taken out
+	// without being destroyed
+	pool->readers = array_new (NULL);
+	pthread_mutex_init (&pool->lock, NULL);
+	pthread_cond_init (&pool->done, NULL);
+
+	return pool;
+}
+
+static void
+shard_pool_free (ShardPool *pool)
+{
+	int i = 0;
+
+	if (pool == NULL)
+		return;
+
+	for (i = 0; i < array_len (pool->readers); i++)
+		shard_reader_free (array_get (pool->readers, i));
+
+	array_free (pool->readers, 1);
+	pthread_mutex_destroy (&pool->lock);
+	pthread_cond_destroy (&pool->done);
+
+	xfree (pool);
+}
+
+static ShardReader *
+shard_pool_get (ShardPool *pool, AbnormalFilter *argf)
+{
+	ShardReader *reader = NULL;
+
+	pthread_mutex_lock (&pool->lock);
+
+	if (array_len (pool->readers) > 0)
+		reader = array_remove_index (pool->readers,
+				array_len (pool->readers) - 1);
+
+	pthread_mutex_unlock (&pool->lock);
+
+	// No idle reader: This worker
+	// opens its own
+	if (reader == NULL)
+		reader = shard_reader_new (argf);
+
+	return reader;
+}
+
+static void
+shard_pool_put (ShardPool *pool, ShardReader *reader)
+{
+	pthread_mutex_lock (&pool->lock);
+	array_add (pool->readers, reader);
+	pthread_mutex_unlock (&pool->lock);
+}
+
+static void
+shard_open (AbnormalShard *shard)
+{
+	AbnormalFilter *argf = &shard->argf;
+
+	shard->reader = shard_pool_get (shard->pool, argf);
+
+	argf->in = shard->reader->in;
+	argf->hdr = shard->reader->hdr;
+
+	argf->itr = sam_itr_queryi (shard->reader->idx, shard->rtid,
+			argf->beg, shard->end);
+	if (argf->itr == NULL)
+		log_fatal ("Failed to query '%s:%li-%li' at '%s'",
+				argf->hdr->target_name[shard->rtid], argf->beg + 1,
+				shard->end, argf->sam_file);
+
+	// An indexed region is read in coordinate order
+	argf->exon_cursor = exon_cursor_new (argf->exon_tree);
+}
+
+static void
+shard_close (AbnormalShard *shard)
+{
+	AbnormalFilter *argf = &shard->argf;
+
+	flush_batch (argf);
+	exon_cursor_free (argf->exon_cursor);
+	sam_itr_destroy (argf->itr);
+
+	// The file stays open for the next shard
+	shard_pool_put (shard->pool, shard->reader);
+
+	argf->exon_cursor = NULL;
+	argf->itr = NULL;
+	argf->hdr = NULL;
+	argf->in = NULL;
+	shard->reader = NULL;
+}
+
+static void
+shard_index (AbnormalShard *shard)
+{
+	shard_open (shard);
+	index_abnormal_ids (&shard->argf, shard->abnormal_ids);
+	shard_close (shard);
+}
+
+static void
+shard_filter (AbnormalShard *shard)
+{
+	shard_open (shard);
+	filter_abnormal_ids (&shard->argf, shard->abnormal_ids,
+			shard->invalid_ids, shard->exonic_ids);
+	shard_close (shard);
+}
+
+static void
+shard_dump (AbnormalShard *shard)
+{
+	shard_open (shard);
+	dump_abnormal_ids (&shard->argf, shard->abnormal_ids);
+	shard_close (shard);
+}
+
+static void
+shard_run (AbnormalShard *shard)
+{
+	ShardPool *pool = shard->pool;
+
+	shard->pass (shard);
+
+	pthread_mutex_lock (&pool->lock);
+
+	if (--pool->pending == 0)
+		pthread_cond_signal (&pool->done);
+
+	pthread_mutex_unlock (&pool->lock);
+}
+
+static void
+run_shards (threadpool thpool, ShardPool *pool, Array *shards,
+		void (*fun) (AbnormalShard *))
+{
+	AbnormalShard *shard = NULL;
+	int i = 0;
+
+	pthread_mutex_lock (&pool->lock);
+	pool->pending = array_len (shards);
+	pthread_mutex_unlock (&pool->lock);
+
+	for (i = 0; i < array_len (shards); i++)
+		{
+			shard = array_get (shards, i);
+			shard->pass = fun;
+			thpool_add_work (thpool, (void *) shard_run, shard);
+		}
+
+	// Wait only for the shards of this file: The
+	// other files may be running at the same pool
+	pthread_mutex_lock (&pool->lock);
+
+	while (pool->pending > 0)
+		pthread_cond_wait (&pool->done, &pool->lock);
+
+	pthread_mutex_unlock (&pool->lock);
+}
+
+static void
+merge_abnormal_id (const char *id, uint8_t *type, IdTable *abnormal_ids)
+{
+	*idtable_insert (abnormal_ids, id) |= *type;
+}
+
+static Array *
+shards_new (const AbnormalArg *arg, const bam_hdr_t *hdr,
+		const hts_idx_t *idx, long shard_size)
+{
+	Array *shards = NULL;
+	AbnormalShard *shard = NULL;
+	uint64_t mapped = 0;
+	uint64_t unmapped = 0;
+	long beg = 0;
+	long len = 0;
+	int rtid = 0;
+
+	shards = array_new ((DestroyNotify) shard_free);
+
+	for (rtid = 0; rtid < hdr->n_targets; rtid++)
+		{
+			// Skip contigs with no reads at all. The stats
+			// are not available for CRAM index
+			if (hts_idx_get_stat (idx, rtid, &mapped, &unmapped) == 0
+					&& (mapped + unmapped) == 0)
+				continue;
+
+			len = hdr->target_len[rtid];
+
+			for (beg = 0; beg < len; beg += shard_size)
+				{
+					shard = xcalloc (1, sizeof (AbnormalShard));
+					memcpy (&shard->argf, arg, sizeof (AbnormalArg));
+
+					shard->rtid = rtid;
+					shard->end = beg + shard_size < len
+						? beg + shard_size
+						: len;
+
+					shard->argf.beg = beg;
+					shard->argf.align = bam_init1 ();
+					if (shard->argf.align == NULL)
+						log_errno_fatal ("Failed to create bam1_t for '%s'",
+								arg->sam_file);
+
+					array_add (shards, shard);
+				}
+		}
+
+	return shards;
+}
+
+int
+abnormal_filter_sharded (AbnormalArg *arg, threadpool thpool,
+		long shard_size)
+{
+	assert (arg != NULL && arg->sam_file != NULL
+			&& arg->alignment_stmt != NULL && arg->exon_tree
+			&& arg->cs && arg->tid >= 0 && arg->inc_step > 0
+			&& arg->source_id > 0
+			&& arg->phred_quality >= 0 && arg->max_base_freq > 0
+			&& thpool != NULL && shard_size > 0);
+
+	AbnormalFilter argf = {};
+	AbnormalShard *shard = NULL;
+	ShardPool *pool = NULL;
+	hts_idx_t *idx = NULL;
+	Array *shards = NULL;
+	IdTable *abnormal_ids = NULL;
+	ChrTable *ct = NULL;
+	uint8_t *type = NULL;
+	int num_shards = 0;
+	int sharded = 0;
+	int i, j;
+
+	memcpy (&argf, arg, sizeof (AbnormalArg));
+
+	argf.in = sam_open (argf.sam_file, "rb");
+	if (argf.in == NULL)
+		log_errno_fatal ("Failed to open '%s' for reading",
+				argf.sam_file);
+
+	argf.hdr = sam_hdr_read (argf.in);
+	if (argf.hdr == NULL)
+		log_fatal ("Failed to read sam header from '%s'",
+				argf.sam_file);
+
+	// Only coordinate sorted and indexed
+	// files can be splitted into regions
+	if (sam_test_sorted_order (argf.hdr, "coordinate"))
+		idx = sam_index_load (argf.in, argf.sam_file);
+
+	if (idx == NULL)
+		{
+			log_info ("File '%s' is not coordinate sorted and indexed. "
+					"Skip sharding", argf.sam_file);
+			goto Exit;
+		}
+
+	sharded = 1;
+	pool = shard_pool_new ();
+	shards = shards_new (arg, argf.hdr, idx, shard_size);
+
+	// All shards read the same header
+	ct = chr_table_new (argf.cs, argf.hdr->n_targets,
+			argf.hdr->target_name);
+	num_shards = array_len (shards);
+
+	log_info ("Searching for abnormal alignments into '%s' "
+			"splitted into %d shards", argf.sam_file, num_shards);
+
+	// Shards share the alignment_id sequence: The shard
+	// 'i' starts at 'tid + inc_step * i' and jumps the
+	// 'inc_step' of all shards
+	for (i = 0; i < num_shards; i++)
+		{
+			shard = array_get (shards, i);
+			shard->argf.alignment_id = arg->tid + arg->inc_step * i;
+			shard->argf.ct = ct;
+			shard->argf.inc_step = arg->inc_step * num_shards;
+			shard->abnormal_ids = idtable_new ();
+			shard->pool = pool;
+		}
+
+	log_debug ("Index all fragment ids from '%s'", argf.sam_file);
+
+	// First reading:
+	// Each shard indexes its own abnormal fragments
+	run_shards (thpool, pool, shards, shard_index);
+
+	// Merge all shards into the shared table
+	abnormal_ids = idtable_new ();
+
+	for (i = 0; i < num_shards; i++)
+		{
+			shard = array_get (shards, i);
+			idtable_foreach (shard->abnormal_ids, (IdFunc) merge_abnormal_id,
+					abnormal_ids);
+
+			argf.alignment_acm += shard->argf.alignment_acm;
+
+			idtable_free (shard->abnormal_ids);
+			shard->abnormal_ids = abnormal_ids;
+			shard->invalid_ids = array_new (xfree);
+			shard->exonic_ids = array_new (xfree);
+		}
+
+	log_debug ("Filter all indexed abnormal fragments from '%s'",
+			argf.sam_file);
+
+	// Second reading:
+	// Look for invalid reads from indexed fragments
+	run_shards (thpool, pool, shards, shard_filter);
+
+	for (i = 0; i < num_shards; i++)
+		{
+			shard = array_get (shards, i);
+
+			for (j = 0; j < array_len (shard->invalid_ids); j++)
+				idtable_remove (abnormal_ids, array_get (shard->invalid_ids, j));
+		}
+
+	for (i = 0; i < num_shards; i++)
+		{
+			shard = array_get (shards, i);
+
+			for (j = 0; j < array_len (shard->exonic_ids); j++)
+				{
+					type = idtable_lookup (abnormal_ids, array_get (shard->exonic_ids, j));
+					if (type != NULL)
+						*type |= ABNORMAL_EXONIC;
+				}
+		}
+
+	log_debug ("Catch all indexed abnormal fragments from '%s'",
+			argf.sam_file);
+
+	// Third reading:
+	// Get all reads from indexed fragments
+	run_shards (thpool, pool, shards, shard_dump);
+
+	for (i = 0; i < num_shards; i++)
+		{
+			shard = array_get (shards, i);
+			argf.abnormal_acm += shard->argf.abnormal_acm;
+			argf.exonic_acm += shard->argf.exonic_acm;
+			argf.dropped_acm += shard->argf.dropped_acm;
+		}
+
+	abnormal_filter_report (&argf);
+
+Exit:
+	if (sam_close (argf.in) < 0)
+		log_errno_fatal ("Failed to close input stream for '%s'",
+				argf.sam_file);
+
+	bam_hdr_destroy (argf.hdr);
+	hts_idx_destroy (idx);
+	chr_table_free (ct);
+	array_free (shards, 1);
+	shard_pool_free (pool);
+	idtable_free (abnormal_ids);
+
+	return sharded;
+}
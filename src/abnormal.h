@@ -19,9 +19,12 @@
 #ifndef ABNORMAL_H
 #define ABNORMAL_H
 
+#include "sam.h"
 #include "db.h"
 #include "chr.h"
 #include "exon.h"
+#include "thpool.h"
+#include "db_writer.h"
 
 enum _AbnormalType
 {
@@ -38,10 +41,12 @@ struct _AbnormalArg
 {
 	int            tid;
 	int            inc_step;
+	int            source_id;
 	const char    *sam_file;
 	ExonTree      *exon_tree;
 	ChrStd        *cs;
 	sqlite3_stmt  *alignment_stmt;
+	sqlite3_stmt  *overlapping_stmt;
 	int            phred_quality;
 	int            queryname_sorted;
 	int            max_distance;
@@ -49,10 +54,20 @@ struct _AbnormalArg
 	int            either;
 	float          exon_frac;
 	float          alignment_frac;
+	int            exonic_only;
+	int            fetch_mates;
+	int            single_pass;
+	htsThreadPool *hts_pool;
+	size_t         max_memory;
+	const char    *tmp_dir;
+	DBWriter      *writer;
 };
 
 typedef struct _AbnormalArg AbnormalArg;
 
 void abnormal_filter (AbnormalArg *arg);
 
+int  abnormal_filter_sharded (AbnormalArg *arg, threadpool thpool,
+		long shard_size);
+
 #endif /* abnormal.h */
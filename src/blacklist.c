@@ -24,7 +24,7 @@
 #include "log.h"
 #include "gff.h"
 #include "bed.h"
-#include "ibitree.h"
+#include "iindex.h"
 #include "str.h"
 #include "blacklist.h"
 
@@ -37,6 +37,18 @@ struct _BlacklistData
 
 typedef struct _BlacklistData BlacklistData;
 
+static void
+build_index (Hash *idx)
+{
+	HashIter iter;
+	IIndex *index = NULL;
+
+	// Sort the intervals and lay the tree over them
+	hash_iter_init (&iter, idx);
+	while (hash_iter_next (&iter, NULL, (void **) &index))
+		iindex_build (index);
+}
+
 Blacklist *
 blacklist_new (sqlite3_stmt *blacklist_stmt,
 		sqlite3_stmt *overlapping_blacklist_stmt,
@@ -55,7 +67,7 @@ blacklist_new (sqlite3_stmt *blacklist_stmt,
 	blacklist->cs = cs;
 
 	blacklist->idx = hash_new (xfree,
-			(DestroyNotify) ibitree_free);
+			(DestroyNotify) iindex_free);
 
 	return blacklist;
 }
@@ -95,7 +107,7 @@ blacklist_index_dump_from_gff (Blacklist *blacklist, const char *gff_file, const
 	GffFile *gff = gff_open_for_reading (gff_file);
 	GffEntry *entry = gff_entry_new ();
 
-	IBiTree *tree = NULL;
+	IIndex *tree = NULL;
 
 	long table_id = 0;
 	long *alloc_id = NULL;
@@ -122,19 +134,22 @@ blacklist_index_dump_from_gff (Blacklist *blacklist, const char *gff_file, const
 
 			if (tree == NULL)
 				{
-					tree = ibitree_new (xfree);
+					tree = iindex_new (xfree);
 					hash_insert (blacklist->idx,
 							xstrdup (chr_std), tree);
 				}
 
-			ibitree_insert (tree, entry->start, entry->end,
+			iindex_insert (tree, entry->start, entry->end,
 					alloc_id);
 
 			db_insert_blacklist (blacklist->blacklist_stmt,
-					table_id, gene_name, chr_std, entry->start,
+					table_id, gene_name,
+					chr_std_id (blacklist->cs, entry->seqname), entry->start,
 					entry->end);
 		}
 
+	build_index (blacklist->idx);
+
 	gff_entry_free (entry);
 	gff_close (gff);
 }
@@ -151,7 +166,7 @@ blacklist_index_dump_from_bed (Blacklist *blacklist, const char *bed_file)
 	BedFile *bed = bed_open_for_reading (bed_file);
 	BedEntry *entry = bed_entry_new ();
 
-	IBiTree *tree = NULL;
+	IIndex *tree = NULL;
 
 	long table_id = 0;
 	long *alloc_id = NULL;
@@ -177,25 +192,28 @@ blacklist_index_dump_from_bed (Blacklist *blacklist, const char *bed_file)
 
 			if (tree == NULL)
 				{
-					tree = ibitree_new (xfree);
+					tree = iindex_new (xfree);
 					hash_insert (blacklist->idx,
 							xstrdup (chr_std), tree);
 				}
 
-			ibitree_insert (tree, entry->chrom_start,
+			iindex_insert (tree, entry->chrom_start,
 					entry->chrom_end, alloc_id);
 
 			db_insert_blacklist (blacklist->blacklist_stmt,
-					table_id, name, chr_std, entry->chrom_start,
+					table_id, name,
+					chr_std_id (blacklist->cs, entry->chrom), entry->chrom_start,
 					entry->chrom_end);
 		}
 
+	build_index (blacklist->idx);
+
 	bed_entry_free (entry);
 	bed_close (bed);
 }
 
 static void
-dump_if_overlaps_blacklist (IBiTreeLookupData *ldata,
+dump_if_overlaps_blacklist (IIndexLookupData *ldata,
 		void *user_data)
 {
 	const long *blacklist_id = ldata->data;
@@ -219,7 +237,7 @@ blacklist_lookup (Blacklist *blacklist, const char *chr,
 			&& padding >= 0);
 
 	int acm = 0;
-	IBiTree *tree = NULL;
+	IIndex *tree = NULL;
 
 	tree = hash_lookup (blacklist->idx, chr);
 
@@ -227,7 +245,7 @@ blacklist_lookup (Blacklist *blacklist, const char *chr,
 		{
 			low -= padding;
 			BlacklistData data = {blacklist, cluster_id, cluster_sid};
-			acm = ibitree_lookup (tree, low > 0 ? low : 0, high + padding,
+			acm = iindex_lookup (tree, low > 0 ? low : 0, high + padding,
 					-1, -1, 0, dump_if_overlaps_blacklist, &data);
 		}
 
@@ -20,15 +20,31 @@
 
 #include <string.h>
 #include <assert.h>
+#include "wrapper.h"
+#include "log.h"
+#include "gz.h"
 #include "utils.h"
 #include "chr.h"
 
-#define CHR_BUFSIZ 32
+#define CHR_BUFSIZ 256
+
+static void
+chr_std_insert_alias (ChrStd *cs, const char *alias, const char *chr)
+{
+	char *alias_copy = xstrdup (alias);
+	hash_insert (cs->alias, lower (alias_copy), xstrdup (chr));
+}
 
 ChrStd *
 chr_std_new (void)
 {
-	ChrStd *cs = hash_new (NULL, NULL);
+	ChrStd *cs = xcalloc (1, sizeof (ChrStd));
+
+	cs->alias = hash_new (xfree, xfree);
+	cs->ids = hash_new (xfree, xfree);
+	cs->names = array_new (NULL);
+
+	pthread_mutex_init (&cs->lock, NULL);
 
 	/*
 	* Standardize human chromosome
@@ -36,64 +52,64 @@ chr_std_new (void)
 	*/
 
 	// Autosomal chromosomes with no "chr"
-	hash_insert (cs, "1", "chr1");
-	hash_insert (cs, "2", "chr2");
-	hash_insert (cs, "3", "chr3");
-	hash_insert (cs, "4", "chr4");
-	hash_insert (cs, "5", "chr5");
-	hash_insert (cs, "6", "chr6");
-	hash_insert (cs, "7", "chr7");
-	hash_insert (cs, "8", "chr8");
-	hash_insert (cs, "9", "chr9");
-	hash_insert (cs, "10", "chr10");
-	hash_insert (cs, "11", "chr11");
-	hash_insert (cs, "12", "chr12");
-	hash_insert (cs, "13", "chr13");
-	hash_insert (cs, "14", "chr14");
-	hash_insert (cs, "15", "chr15");
-	hash_insert (cs, "16", "chr16");
-	hash_insert (cs, "17", "chr17");
-	hash_insert (cs, "18", "chr18");
-	hash_insert (cs, "19", "chr19");
-	hash_insert (cs, "20", "chr20");
-	hash_insert (cs, "21", "chr21");
-	hash_insert (cs, "22", "chr22");
+	chr_std_insert_alias (cs, "1", "chr1");
+	chr_std_insert_alias (cs, "2", "chr2");
+	chr_std_insert_alias (cs, "3", "chr3");
+	chr_std_insert_alias (cs, "4", "chr4");
+	chr_std_insert_alias (cs, "5", "chr5");
+	chr_std_insert_alias (cs, "6", "chr6");
+	chr_std_insert_alias (cs, "7", "chr7");
+	chr_std_insert_alias (cs, "8", "chr8");
+	chr_std_insert_alias (cs, "9", "chr9");
+	chr_std_insert_alias (cs, "10", "chr10");
+	chr_std_insert_alias (cs, "11", "chr11");
+	chr_std_insert_alias (cs, "12", "chr12");
+	chr_std_insert_alias (cs, "13", "chr13");
+	chr_std_insert_alias (cs, "14", "chr14");
+	chr_std_insert_alias (cs, "15", "chr15");
+	chr_std_insert_alias (cs, "16", "chr16");
+	chr_std_insert_alias (cs, "17", "chr17");
+	chr_std_insert_alias (cs, "18", "chr18");
+	chr_std_insert_alias (cs, "19", "chr19");
+	chr_std_insert_alias (cs, "20", "chr20");
+	chr_std_insert_alias (cs, "21", "chr21");
+	chr_std_insert_alias (cs, "22", "chr22");
 
 	// Autosomal chromosomes with "chr"
-	hash_insert (cs, "chr1", "chr1");
-	hash_insert (cs, "chr2", "chr2");
-	hash_insert (cs, "chr3", "chr3");
-	hash_insert (cs, "chr4", "chr4");
-	hash_insert (cs, "chr5", "chr5");
-	hash_insert (cs, "chr6", "chr6");
-	hash_insert (cs, "chr7", "chr7");
-	hash_insert (cs, "chr8", "chr8");
-	hash_insert (cs, "chr9", "chr9");
-	hash_insert (cs, "chr10", "chr10");
-	hash_insert (cs, "chr11", "chr11");
-	hash_insert (cs, "chr12", "chr12");
-	hash_insert (cs, "chr13", "chr13");
-	hash_insert (cs, "chr14", "chr14");
-	hash_insert (cs, "chr15", "chr15");
-	hash_insert (cs, "chr16", "chr16");
-	hash_insert (cs, "chr17", "chr17");
-	hash_insert (cs, "chr18", "chr18");
-	hash_insert (cs, "chr19", "chr19");
-	hash_insert (cs, "chr20", "chr20");
-	hash_insert (cs, "chr21", "chr21");
-	hash_insert (cs, "chr22", "chr22");
+	chr_std_insert_alias (cs, "chr1", "chr1");
+	chr_std_insert_alias (cs, "chr2", "chr2");
+	chr_std_insert_alias (cs, "chr3", "chr3");
+	chr_std_insert_alias (cs, "chr4", "chr4");
+	chr_std_insert_alias (cs, "chr5", "chr5");
+	chr_std_insert_alias (cs, "chr6", "chr6");
+	chr_std_insert_alias (cs, "chr7", "chr7");
+	chr_std_insert_alias (cs, "chr8", "chr8");
+	chr_std_insert_alias (cs, "chr9", "chr9");
+	chr_std_insert_alias (cs, "chr10", "chr10");
+	chr_std_insert_alias (cs, "chr11", "chr11");
+	chr_std_insert_alias (cs, "chr12", "chr12");
+	chr_std_insert_alias (cs, "chr13", "chr13");
+	chr_std_insert_alias (cs, "chr14", "chr14");
+	chr_std_insert_alias (cs, "chr15", "chr15");
+	chr_std_insert_alias (cs, "chr16", "chr16");
+	chr_std_insert_alias (cs, "chr17", "chr17");
+	chr_std_insert_alias (cs, "chr18", "chr18");
+	chr_std_insert_alias (cs, "chr19", "chr19");
+	chr_std_insert_alias (cs, "chr20", "chr20");
+	chr_std_insert_alias (cs, "chr21", "chr21");
+	chr_std_insert_alias (cs, "chr22", "chr22");
 
 	// Sexual chromosomes with no "chr"
-	hash_insert (cs, "y", "chrY");
-	hash_insert (cs, "x", "chrX");
-	hash_insert (cs, "m", "chrM");
-	hash_insert (cs, "mt", "chrM");
+	chr_std_insert_alias (cs, "y", "chrY");
+	chr_std_insert_alias (cs, "x", "chrX");
+	chr_std_insert_alias (cs, "m", "chrM");
+	chr_std_insert_alias (cs, "mt", "chrM");
 
 	// Sexual chromosomes with "chr"
-	hash_insert (cs, "chry", "chrY");
-	hash_insert (cs, "chrx", "chrX");
-	hash_insert (cs, "chrm", "chrM");
-	hash_insert (cs, "chrmt", "chrM");
+	chr_std_insert_alias (cs, "chry", "chrY");
+	chr_std_insert_alias (cs, "chrx", "chrX");
+	chr_std_insert_alias (cs, "chrm", "chrM");
+	chr_std_insert_alias (cs, "chrmt", "chrM");
 
 	return cs;
 }
@@ -101,7 +117,16 @@ chr_std_new (void)
 void
 chr_std_free (ChrStd *cs)
 {
-	hash_free (cs);
+	if (cs == NULL)
+		return;
+
+	pthread_mutex_destroy (&cs->lock);
+
+	array_free (cs->names, 1);
+	hash_free (cs->ids);
+	hash_free (cs->alias);
+
+	xfree (cs);
 }
 
 const char *
@@ -115,10 +140,218 @@ chr_std_lookup (ChrStd *cs, const char *chr)
 	strncpy (chr_copy, chr, CHR_BUFSIZ - 1);
 	chr_copy[CHR_BUFSIZ - 1] = '\0';
 
-	chr_std = hash_lookup (cs, lower (chr_copy));
+	chr_std = hash_lookup (cs->alias, lower (chr_copy));
 
 	if (chr_std == NULL)
 		chr_std = chr;
 
 	return chr_std;
 }
+
+int
+chr_std_id (ChrStd *cs, const char *chr)
+{
+	assert (cs != NULL && chr != NULL);
+
+	const char *chr_std = NULL;
+	char *chr_copy = NULL;
+	int *id = NULL;
+
+	chr_std = chr_std_lookup (cs, chr);
+
+	// Several threads may meet a new contig
+	pthread_mutex_lock (&cs->lock);
+
+	id = hash_lookup (cs->ids, chr_std);
+
+	if (id == NULL)
+		{
+			chr_copy = xstrdup (chr_std);
+
+			id = xcalloc (1, sizeof (int));
+			*id = array_len (cs->names);
+
+			hash_insert (cs->ids, chr_copy, id);
+			array_add (cs->names, chr_copy);
+		}
+
+	pthread_mutex_unlock (&cs->lock);
+
+	return *id;
+}
+
+const char *
+chr_std_name (ChrStd *cs, int id)
+{
+	assert (cs != NULL);
+
+	const char *name = NULL;
+
+	pthread_mutex_lock (&cs->lock);
+
+	if (id >= 0 && id < array_len (cs->names))
+		name = array_get (cs->names, id);
+
+	pthread_mutex_unlock (&cs->lock);
+
+	return name;
+}
+
+void
+chr_std_load (ChrStd *cs, sqlite3 *db)
+{
+	assert (cs != NULL && db != NULL);
+
+	sqlite3_stmt *stmt = NULL;
+	const char *name = NULL;
+	char *name_copy = NULL;
+	int *id = NULL;
+	int db_id = 0;
+
+	stmt = db_prepare (db, "SELECT id,name FROM contig ORDER BY id ASC");
+
+	pthread_mutex_lock (&cs->lock);
+
+	while (db_step (stmt) == SQLITE_ROW)
+		{
+			db_id = db_column_int (stmt, 0);
+			name = db_column_text (stmt, 1);
+
+			// The names were standardized
+			// when they were dumped
+			id = hash_lookup (cs->ids, name);
+
+			if (id == NULL && db_id == array_len (cs->names))
+				{
+					name_copy = xstrdup (name);
+
+					id = xcalloc (1, sizeof (int));
+					*id = db_id;
+
+					hash_insert (cs->ids, name_copy, id);
+					array_add (cs->names, name_copy);
+				}
+
+			if (id == NULL || *id != db_id)
+				log_fatal ("Contig '%s' at database '%s' has the id %d, "
+						"which does not follow the contigs already seen",
+						name, sqlite3_db_filename (db, "main"), db_id);
+		}
+
+	pthread_mutex_unlock (&cs->lock);
+
+	db_finalize (stmt);
+}
+
+void
+chr_std_dump (ChrStd *cs, sqlite3_stmt *contig_stmt)
+{
+	assert (cs != NULL && contig_stmt != NULL);
+
+	int id = 0;
+
+	pthread_mutex_lock (&cs->lock);
+
+	for (; id < array_len (cs->names); id++)
+		db_insert_contig (contig_stmt, id, array_get (cs->names, id));
+
+	pthread_mutex_unlock (&cs->lock);
+}
+
+void
+chr_std_load_alias (ChrStd *cs, const char *path)
+{
+	assert (cs != NULL && path != NULL);
+
+	GzFile *gz = NULL;
+	char *buf = NULL;
+	size_t buf_size = 0;
+	char *saveptr = NULL;
+	const char *alias = NULL;
+	const char *chr = NULL;
+
+	gz = gz_open_for_reading (path);
+
+	/*
+	* Two columns: The contig name as found
+	* in the files and its standardized name
+	*/
+	while (gz_getline (gz, &buf, &buf_size))
+		{
+			// Skip comments and blank lines
+			if (buf[0] == '#' || buf[0] == '\n')
+				continue;
+
+			alias = strtok_r (chomp (buf), " \t", &saveptr);
+			chr = strtok_r (NULL, " \t", &saveptr);
+
+			if (alias == NULL || chr == NULL)
+				log_fatal ("%s: Missing contig alias at line %zu",
+						path, gz_get_num_line (gz));
+
+			log_debug ("Alias contig '%s' to '%s'", alias, chr);
+			chr_std_insert_alias (cs, alias, chr);
+		}
+
+	xfree (buf);
+	gz_close (gz);
+}
+
+ChrTable *
+chr_table_new (ChrStd *cs, int n_targets,
+		char * const *target_name)
+{
+	assert (cs != NULL && n_targets >= 0);
+
+	ChrTable *ct = NULL;
+	int tid = 0;
+	int id = 0;
+
+	ct = xcalloc (1, sizeof (ChrTable));
+
+	ct->size = n_targets;
+	ct->names = xcalloc (n_targets + 1, sizeof (char *));
+	ct->ids = xcalloc (n_targets + 1, sizeof (int));
+
+	for (; tid < n_targets; tid++)
+		{
+			id = chr_std_id (cs, target_name[tid]);
+
+			ct->ids[tid] = id;
+
+			if (id >= ct->tids_size)
+				ct->tids_size = id + 1;
+		}
+
+	// The names are only read back under the lock,
+	// since another thread may grow the array
+	pthread_mutex_lock (&cs->lock);
+
+	for (tid = 0; tid < n_targets; tid++)
+		ct->names[tid] = array_get (cs->names, ct->ids[tid]);
+
+	pthread_mutex_unlock (&cs->lock);
+
+	// And the way back, standardized contig => TID
+	ct->tids = xcalloc (ct->tids_size + 1, sizeof (int));
+
+	for (id = 0; id < ct->tids_size; id++)
+		ct->tids[id] = -1;
+
+	for (tid = 0; tid < n_targets; tid++)
+		ct->tids[ct->ids[tid]] = tid;
+
+	return ct;
+}
+
+void
+chr_table_free (ChrTable *ct)
+{
+	if (ct == NULL)
+		return;
+
+	xfree (ct->names);
+	xfree (ct->ids);
+	xfree (ct->tids);
+	xfree (ct);
+}
@@ -19,12 +19,64 @@
 #ifndef CHR_H
 #define CHR_H
 
+#include <pthread.h>
 #include "hash.h"
+#include "array.h"
+#include "db.h"
 
-typedef Hash ChrStd;
+/*
+ * Chromosome standardization. Each standardized
+ * contig gets an integer id the first time it
+ * is seen, so that the hot paths can carry ints
+ * and leave the names to the database
+ */
+struct _ChrStd
+{
+	Hash            *alias;
+	Hash            *ids;
+	Array           *names;
+	pthread_mutex_t  lock;
+};
+
+typedef struct _ChrStd ChrStd;
+
+/*
+ * TID => standardized contig, built once
+ * for each SAM/BAM/CRAM header
+ */
+struct _ChrTable
+{
+	const char  **names;
+	int          *ids;
+	int           size;
+	int          *tids;
+	int           tids_size;
+};
+
+typedef struct _ChrTable ChrTable;
+
+ChrStd     * chr_std_new        (void);
+void         chr_std_free       (ChrStd *cs);
+const char * chr_std_lookup     (ChrStd *cs, const char *chr);
+int          chr_std_id         (ChrStd *cs, const char *chr);
+void         chr_std_load_alias (ChrStd *cs, const char *path);
+const char * chr_std_name       (ChrStd *cs, int id);
+
+/*
+ * The ids are the ones of the contig table: The
+ * standardization of a later run on the same
+ * database must be loaded from it before
+ * handing out new ids
+ */
+void         chr_std_load       (ChrStd *cs, sqlite3 *db);
+void         chr_std_dump       (ChrStd *cs, sqlite3_stmt *contig_stmt);
+
+ChrTable   * chr_table_new      (ChrStd *cs, int n_targets,
+		char * const *target_name);
+void         chr_table_free     (ChrTable *ct);
 
-ChrStd     * chr_std_new    (void);
-const char * chr_std_lookup (ChrStd *cs, const char *chr);
-void         chr_std_free   (ChrStd *cs);
+#define chr_table_name(ct,tid) ((tid) < 0 ? "*" : (ct)->names[tid])
+#define chr_table_id(ct,tid)   ((tid) < 0 ? -1 : (ct)->ids[tid])
+#define chr_table_tid(ct,id)   ((id) < 0 || (id) >= (ct)->tids_size ? -1 : (ct)->tids[id])
 
 #endif /* chr.h */
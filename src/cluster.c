@@ -163,8 +163,8 @@ prepare_query_stmt (sqlite3 *db)
 	*/
 	const char sql[] =
 		"WITH\n"
-		"	alignment_overlaps_exon(id, qname, source_id, chr, pos, rlen, type, gene_name) AS (\n"
-		"		SELECT a.id, a.qname, a.source_id, a.chr, a.pos, a.rlen, a.type, e.gene_name\n"
+		"	alignment_overlaps_exon(id, qname, source_id, chr_id, pos, rlen, type, gene_name_id) AS (\n"
+		"		SELECT a.id, a.qname, a.source_id, a.chr_id, a.pos, a.rlen, a.type, e.gene_name_id\n"
 		"		FROM alignment AS a\n"
 		"		LEFT JOIN overlapping AS o\n"
 		"			ON a.id = o.alignment_id\n"
@@ -173,7 +173,7 @@ prepare_query_stmt (sqlite3 *db)
 		"		WHERE type != $NONE\n"
 		"	)\n"
 		"SELECT DISTINCT aoe1.id,\n"
-		"	aoe1.chr,\n"
+		"	aoe1.chr_id,\n"
 		"	aoe1.pos,\n"
 		"	CASE\n"
 		"		WHEN aoe1.rlen <= 0\n"
@@ -181,15 +181,15 @@ prepare_query_stmt (sqlite3 *db)
 		"		ELSE\n"
 		"			(aoe1.pos + aoe1.rlen - 1)\n"
 		"	END,\n"
-		"	aoe2.gene_name\n"
+		"	aoe2.gene_name_id\n"
 		"FROM alignment_overlaps_exon AS aoe1\n"
 		"INNER JOIN alignment_overlaps_exon AS aoe2\n"
 		"	USING (qname, source_id)\n"
 		"WHERE aoe1.id != aoe2.id\n"
 		"	AND aoe2.type & $EXONIC\n"
 		"	AND ((NOT aoe1.type & $EXONIC)\n"
-		"		OR (aoe1.type & $EXONIC AND aoe1.gene_name IS NOT aoe2.gene_name))\n"
-		"ORDER BY aoe1.chr ASC, aoe2.gene_name ASC";
+		"		OR (aoe1.type & $EXONIC AND aoe1.gene_name_id IS NOT aoe2.gene_name_id))\n"
+		"ORDER BY aoe1.chr_id ASC, aoe2.gene_name_id ASC";
 
 	log_debug ("Query schema:\n%s", sql);
 	stmt = db_prepare (db, sql);
@@ -240,11 +240,11 @@ clustering (sqlite3_stmt *clustering_stmt, const long eps,
 	DBSCAN *dbscan = NULL;
 	sqlite3_stmt *query_stmt = NULL;
 
-	char *chr_prev = NULL;
-	const char *chr = NULL;
+	int chr_id_prev = -1;
+	int chr_id = 0;
 
-	char *gene_name_prev = NULL;
-	const char *gene_name = NULL;
+	int gene_name_id_prev = -1;
+	int gene_name_id = 0;
 
 	int *aid_alloc = NULL;
 
@@ -270,25 +270,25 @@ clustering (sqlite3_stmt *clustering_stmt, const long eps,
 	while (db_step (query_stmt) == SQLITE_ROW)
 		{
 			aid       = db_column_int   (query_stmt, 0);
-			chr       = db_column_text  (query_stmt, 1);
-			astart    = db_column_int64 (query_stmt, 2);
-			aend      = db_column_int64 (query_stmt, 3);
-			gene_name = db_column_text  (query_stmt, 4);
+			chr_id       = db_column_int   (query_stmt, 1);
+			astart       = db_column_int64 (query_stmt, 2);
+			aend         = db_column_int64 (query_stmt, 3);
+			gene_name_id = db_column_int   (query_stmt, 4);
 
-			// First loop - Init dbscan, chr_prev and gene_name_prev
-			if (chr_prev == NULL && gene_name_prev == NULL)
+			// First loop - Init dbscan, chr_id_prev and gene_name_id_prev
+			if (dbscan == NULL)
 				{
 					dbscan = dbscan_new (xfree);
-					chr_prev = xstrdup (chr);
-					gene_name_prev = xstrdup (gene_name);
+					chr_id_prev = chr_id;
+					gene_name_id_prev = gene_name_id;
 				}
 
 			// If all alignments at chromosome and gene_name
 			// were cach, then cluster them
-			if (strcmp (chr_prev, chr) || strcmp (gene_name_prev, gene_name))
+			if (chr_id_prev != chr_id || gene_name_id_prev != gene_name_id)
 				{
-					log_debug ("Clustering by chr at '%s' for '%s'",
-							chr_prev, gene_name_prev);
+					log_debug ("Clustering by chr at [%d] for [%d]",
+							chr_id_prev, gene_name_id_prev);
 
 					acm = dbscan_cluster (dbscan, eps, min_pts,
 							dump_clustering, &c);
@@ -296,18 +296,15 @@ clustering (sqlite3_stmt *clustering_stmt, const long eps,
 					if (acm)
 						{
 							c.id += acm;
-							log_debug ("Found %d clusters at '%s' for '%s'",
-									acm, chr_prev, gene_name_prev);
+							log_debug ("Found %d clusters at [%d] for [%d]",
+									acm, chr_id_prev, gene_name_id_prev);
 						}
 
 					dbscan_free (dbscan);
 					dbscan = dbscan_new (xfree);
 
-					xfree (chr_prev);
-					xfree (gene_name_prev);
-
-					chr_prev = xstrdup (chr);
-					gene_name_prev = xstrdup (gene_name);
+					chr_id_prev = chr_id;
+					gene_name_id_prev = gene_name_id;
 				}
 
 			aid_alloc = xcalloc (1, sizeof (int));
@@ -323,8 +320,8 @@ clustering (sqlite3_stmt *clustering_stmt, const long eps,
 	// Test if there any entry
 	if (dbscan != NULL)
 		{
-			log_debug ("Clustering at '%s' for '%s'",
-					chr_prev, gene_name_prev);
+			log_debug ("Clustering at [%d] for [%d]",
+					chr_id_prev, gene_name_id_prev);
 
 			acm = dbscan_cluster (dbscan, eps, min_pts,
 					dump_clustering, &c);
@@ -332,13 +329,11 @@ clustering (sqlite3_stmt *clustering_stmt, const long eps,
 			if (acm)
 				{
 					c.id += acm;
-					log_debug ("Found %d clusters at '%s' for '%s'",
-							acm, chr_prev, gene_name_prev);
+					log_debug ("Found %d clusters at [%d] for [%d]",
+							acm, chr_id_prev, gene_name_id_prev);
 				}
 		}
 
-	xfree (chr_prev);
-	xfree (gene_name_prev);
 	dbscan_free (dbscan);
 	db_finalize (query_stmt);
 
@@ -515,14 +510,14 @@ prepare_filter_stmt (sqlite3 *db)
 
 	const char sql[] =
 		"WITH\n"
-		"	gene (gene_name, chr, start, end) AS (\n"
-		"		SELECT gene_name, chr, MIN(start), MAX(end)\n"
+		"	gene_range (gene_name_id, chr_id, start, end) AS (\n"
+		"		SELECT gene_name_id, chr_id, MIN(start), MAX(end)\n"
 		"		FROM exon\n"
-		"		GROUP BY gene_name\n"
+		"		GROUP BY gene_name_id\n"
 		"	),\n"
-		"	cluster (gene_name, id, sid, chr, start, end) AS (\n"
-		"		SELECT e.gene_name, cluster_id, cluster_sid,\n"
-		"			a1.chr, MIN(a1.pos), MAX(a1.pos + a1.rlen - 1)\n"
+		"	cluster (gene_name_id, id, sid, chr_id, start, end) AS (\n"
+		"		SELECT e.gene_name_id, cluster_id, cluster_sid,\n"
+		"			a1.chr_id, MIN(a1.pos), MAX(a1.pos + a1.rlen - 1)\n"
 		"		FROM clustering AS c\n"
 		"		INNER JOIN alignment AS a1\n"
 		"			ON c.alignment_id = a1.id\n"
@@ -534,11 +529,17 @@ prepare_filter_stmt (sqlite3 *db)
 		"			ON o.exon_id = e.id\n"
 		"		GROUP BY cluster_id, cluster_sid\n"
 		"	)\n"
-		"SELECT c.id, c.sid, c.chr, c.start, c.end,\n"
-		"	g.gene_name, g.chr, g.start, g.end\n"
+		"SELECT c.id, c.sid, c.chr_id, cc.name, c.start, c.end,\n"
+		"	g.gene_name_id, gn.name, g.chr_id, gc.name, g.start, g.end\n"
 		"FROM cluster AS c\n"
-		"INNER JOIN gene AS g\n"
-		"	USING (gene_name)";
+		"INNER JOIN gene_range AS g\n"
+		"	USING (gene_name_id)\n"
+		"INNER JOIN contig AS cc\n"
+		"	ON cc.id = c.chr_id\n"
+		"INNER JOIN contig AS gc\n"
+		"	ON gc.id = g.chr_id\n"
+		"INNER JOIN gene AS gn\n"
+		"	ON gn.id = g.gene_name_id";
 
 	log_debug ("Filter query schema:\n%s", sql);
 	return db_prepare (db, sql);
@@ -555,12 +556,15 @@ dump_and_filter_clusters (sqlite3_stmt *cluster_stmt, const int distance,
 	// Cluster info
 	int cluster_id = 0;
 	int cluster_sid = 0;
+	int cluster_chr_id = 0;
 	const char *cluster_chr = NULL;
 	long cluster_start = 0;
 	long cluster_end = 0;
 
 	// Parental info
+	int gene_name_id = 0;
 	const char *gene_name = NULL;
+	int gene_chr_id = 0;
 	const char *gene_chr = NULL;
 	long gene_start = 0;
 	long gene_end = 0;
@@ -585,15 +589,18 @@ dump_and_filter_clusters (sqlite3_stmt *cluster_stmt, const int distance,
 
 	while (db_step (filter_query) == SQLITE_ROW)
 		{
-			cluster_id    = db_column_int   (filter_query, 0);
-			cluster_sid   = db_column_int   (filter_query, 1);
-			cluster_chr   = db_column_text  (filter_query, 2);
-			cluster_start = db_column_int64 (filter_query, 3);
-			cluster_end   = db_column_int64 (filter_query, 4);
-			gene_name     = db_column_text  (filter_query, 5);
-			gene_chr      = db_column_text  (filter_query, 6);
-			gene_start    = db_column_int64 (filter_query, 7);
-			gene_end      = db_column_int64 (filter_query, 8);
+			cluster_id     = db_column_int   (filter_query, 0);
+			cluster_sid    = db_column_int   (filter_query, 1);
+			cluster_chr_id = db_column_int   (filter_query, 2);
+			cluster_chr    = db_column_text  (filter_query, 3);
+			cluster_start  = db_column_int64 (filter_query, 4);
+			cluster_end    = db_column_int64 (filter_query, 5);
+			gene_name_id   = db_column_int   (filter_query, 6);
+			gene_name      = db_column_text  (filter_query, 7);
+			gene_chr_id    = db_column_int   (filter_query, 8);
+			gene_chr       = db_column_text  (filter_query, 9);
+			gene_start     = db_column_int64 (filter_query, 10);
+			gene_end       = db_column_int64 (filter_query, 11);
 
 			filter = cluster_filter_get (cluster_h, cluster_id, cluster_sid);
 			assert (filter != NULL);
@@ -607,7 +614,7 @@ dump_and_filter_clusters (sqlite3_stmt *cluster_stmt, const int distance,
 				*filter |= CLUSTER_FILTER_CHR;
 
 			// Distance filter
-			if (strcmp (cluster_chr, gene_chr)
+			if (cluster_chr_id != gene_chr_id
 					|| !(cluster_start <= (gene_end + distance)
 						&& cluster_end >= (gene_start - distance)))
 				*filter |= CLUSTER_FILTER_DIST;
@@ -624,8 +631,8 @@ dump_and_filter_clusters (sqlite3_stmt *cluster_stmt, const int distance,
 					cluster_end, gene_name, *filter);
 
 			db_insert_cluster (cluster_stmt, cluster_id, cluster_sid,
-					cluster_chr, cluster_start, cluster_end,
-					gene_name, *filter);
+					cluster_chr_id, cluster_start, cluster_end,
+					gene_name_id, *filter);
 
 			if (*filter == all_filters)
 				num_clusters++;
@@ -18,11 +18,190 @@
 
 #include "config.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <htslib/sam.h>
 #include "wrapper.h"
 #include "log.h"
+#include "str.h"
 #include "db.h"
 
+/* SQL functions over the binary cigar */
+
+static inline uint32_t
+cigar_blob_get (const uint8_t *blob, int i)
+{
+	// The blob may be unaligned
+	uint32_t op = 0;
+	memcpy (&op, blob + i * sizeof (uint32_t), sizeof (uint32_t));
+	return op;
+}
+
+static void
+cigar_clip_side_func (sqlite3_context *ctx, int argc,
+		sqlite3_value **argv)
+{
+	const uint8_t *blob = NULL;
+	int match = 0;
+	int clip = 0;
+	int last = 0;
+	int n = 0;
+	int i = 0;
+
+	if (sqlite3_value_type (argv[0]) != SQLITE_BLOB)
+		{
+			sqlite3_result_null (ctx);
+			return;
+		}
+
+	blob = sqlite3_value_blob (argv[0]);
+	n = sqlite3_value_bytes (argv[0]) / sizeof (uint32_t);
+
+	if (n == 0)
+		{
+			sqlite3_result_null (ctx);
+			return;
+		}
+
+	// The same as the text patterns: '%M%S' or '%M%H'
+	// clip the right side and '%S%M' or '%H%M' clip
+	// the left side. So the last operation decides
+	// the side and the other one must come before
+	for (i = 0; i < n - 1; i++)
+		{
+			switch (bam_cigar_op (cigar_blob_get (blob, i)))
+				{
+				case BAM_CMATCH:
+					{
+						match = 1;
+						break;
+					}
+				case BAM_CSOFT_CLIP:
+				case BAM_CHARD_CLIP:
+					{
+						clip = 1;
+						break;
+					}
+				}
+		}
+
+	last = bam_cigar_op (cigar_blob_get (blob, n - 1));
+
+	if (match && (last == BAM_CSOFT_CLIP || last == BAM_CHARD_CLIP))
+		sqlite3_result_text (ctx, "right", -1, SQLITE_STATIC);
+	else if (clip && last == BAM_CMATCH)
+		sqlite3_result_text (ctx, "left", -1, SQLITE_STATIC);
+	else
+		sqlite3_result_null (ctx);
+}
+
+static void
+cigar_text_func (sqlite3_context *ctx, int argc,
+		sqlite3_value **argv)
+{
+	const uint8_t *blob = NULL;
+	String *text = NULL;
+	uint32_t op = 0;
+	int n = 0;
+	int i = 0;
+
+	if (sqlite3_value_type (argv[0]) != SQLITE_BLOB)
+		{
+			sqlite3_result_null (ctx);
+			return;
+		}
+
+	blob = sqlite3_value_blob (argv[0]);
+	n = sqlite3_value_bytes (argv[0]) / sizeof (uint32_t);
+
+	if (n == 0)
+		{
+			sqlite3_result_text (ctx, "*", -1, SQLITE_STATIC);
+			return;
+		}
+
+	text = string_sized_new (n * 4);
+
+	for (i = 0; i < n; i++)
+		{
+			op = cigar_blob_get (blob, i);
+			text = string_concat_printf (text, "%u%c",
+					bam_cigar_oplen (op), bam_cigar_opchr (op));
+		}
+
+	sqlite3_result_text (ctx, text->str, text->len, SQLITE_TRANSIENT);
+	string_free (text, 1);
+}
+
+static void
+cigar_blob_func (sqlite3_context *ctx, int argc,
+		sqlite3_value **argv)
+{
+	const char *text = NULL;
+	const char *op = NULL;
+	char *end = NULL;
+	uint32_t *ops = NULL;
+	unsigned long len = 0;
+	int n = 0;
+
+	// Already packed
+	if (sqlite3_value_type (argv[0]) != SQLITE_TEXT)
+		{
+			sqlite3_result_value (ctx, argv[0]);
+			return;
+		}
+
+	text = (const char *) sqlite3_value_text (argv[0]);
+
+	// No cigar
+	if (!strcmp (text, "*"))
+		{
+			sqlite3_result_zeroblob (ctx, 0);
+			return;
+		}
+
+	// Each operation takes at least two chars
+	ops = xcalloc (strlen (text) / 2 + 1, sizeof (uint32_t));
+
+	while (*text != '\0')
+		{
+			len = strtoul (text, &end, 10);
+
+			op = end != text && *end != '\0'
+				? strchr (BAM_CIGAR_STR, *end)
+				: NULL;
+
+			if (op == NULL)
+				{
+					sqlite3_result_error (ctx, "Malformed cigar text", -1);
+					xfree (ops);
+					return;
+				}
+
+			ops[n++] = bam_cigar_gen (len, op - BAM_CIGAR_STR);
+			text = end + 1;
+		}
+
+	sqlite3_result_blob (ctx, ops, n * sizeof (uint32_t),
+			SQLITE_TRANSIENT);
+
+	xfree (ops);
+}
+
+static void
+db_create_function (sqlite3 *db, const char *name,
+		void (*func) (sqlite3_context *, int, sqlite3_value **))
+{
+	int rc = sqlite3_create_function_v2 (db, name, 1,
+			SQLITE_UTF8|SQLITE_DETERMINISTIC, NULL, func,
+			NULL, NULL, NULL);
+
+	if (rc != SQLITE_OK)
+		log_fatal ("Failed sqlite3_create_function_v2 '%s': %s",
+				name, sqlite3_errmsg (db));
+}
+
 /* Low-level wrapper for sqlite3 interface */
 
 sqlite3 *
@@ -39,6 +218,11 @@ db_open (const char *path, int flags)
 		log_fatal ("Failed sqlite3_open_v2 '%s': %s",
 				path, sqlite3_errmsg (db));
 
+	// Let the queries inspect the
+	// binary cigar of the alignments
+	db_create_function (db, "cigar_clip_side", cigar_clip_side_func);
+	db_create_function (db, "cigar_text", cigar_text_func);
+
 	return db;
 }
 
@@ -204,6 +388,25 @@ db_bind_text (sqlite3_stmt *stmt,
 				i, value, sqlite3_errmsg (sqlite3_db_handle (stmt)));
 }
 
+void
+db_bind_blob (sqlite3_stmt *stmt,
+		int i, const void *value, int n)
+{
+	assert (stmt != NULL && n >= 0);
+
+	int rc = 0;
+
+	// A NULL pointer would bind NULL
+	// instead of an empty blob
+	rc = value != NULL
+		? sqlite3_bind_blob (stmt, i, value, n, SQLITE_TRANSIENT)
+		: sqlite3_bind_zeroblob (stmt, i, 0);
+
+	if (rc != SQLITE_OK)
+		log_fatal ("Failed sqlite3_bind_blob at '[%d] %d bytes': %s",
+				i, n, sqlite3_errmsg (sqlite3_db_handle (stmt)));
+}
+
 int
 db_column_int (sqlite3_stmt *stmt, int i)
 {
@@ -248,83 +451,109 @@ db_column_text (sqlite3_stmt *stmt, int i)
 	return (const char *) sqlite3_column_text (stmt, i);
 }
 
+const void *
+db_column_blob (sqlite3_stmt *stmt, int i)
+{
+	assert (stmt != NULL);
+
+	if (sqlite3_column_type (stmt, i) != SQLITE_BLOB)
+		log_fatal ("Failed sqlite3_column_blob at %d: Wrong type", i);
+
+	return sqlite3_column_blob (stmt, i);
+}
+
+int
+db_column_bytes (sqlite3_stmt *stmt, int i)
+{
+	assert (stmt != NULL);
+	return sqlite3_column_bytes (stmt, i);
+}
+
 /* db management functions */
 
-static void
-db_create_tables (sqlite3 *db)
+/*
+ * The tables, in creation order. The columns are
+ * shared by the creation of a new database and
+ * the migration of an old one
+ */
+struct _DBTable
 {
-	log_trace ("Inside %s", __func__);
+	const char *name;
+	const char *columns;
+};
 
-	const char sql[] =
-		"DROP TABLE IF EXISTS schema;\n"
-		"CREATE TABLE schema (\n"
+typedef struct _DBTable DBTable;
+
+static const DBTable db_tables[] =
+{
+	{"schema",
 		"	major_version INTEGER NOT NULL,\n"
-		"	minor_version INTEGER NOT NULL);\n"
-		"\n"
-		"DROP TABLE IF EXISTS batch;\n"
-		"CREATE TABLE batch (\n"
+		"	minor_version INTEGER NOT NULL"},
+	{"batch",
 		"	id INTEGER PRIMARY KEY,\n"
-		"	timestamp TEXT NOT NULL);\n"
-		"\n"
-		"DROP TABLE IF EXISTS source;\n"
-		"CREATE TABLE source (\n"
+		"	timestamp TEXT NOT NULL"},
+	{"source",
 		"	id INTEGER PRIMARY KEY,\n"
 		"	batch_id INTEGER NOT NULL,\n"
 		"	path TEXT NOT NULL,\n"
-		"	FOREIGN KEY (batch_id) REFERENCES batch(id));\n"
-		"\n"
-		"DROP TABLE IF EXISTS exon;\n"
-		"CREATE TABLE exon (\n"
+		"	done INTEGER DEFAULT 0,\n"
+		"	FOREIGN KEY (batch_id) REFERENCES batch(id)"},
+	{"contig",
+		"	id INTEGER PRIMARY KEY,\n"
+		"	name TEXT NOT NULL,\n"
+		"	UNIQUE (name)"},
+	{"gene",
+		"	id INTEGER PRIMARY KEY,\n"
+		"	name TEXT NOT NULL,\n"
+		"	UNIQUE (name)"},
+	{"exon",
 		"	id INTEGER PRIMARY KEY,\n"
-		"	gene_name TEXT NOT NULL,\n"
-		"	chr TEXT NOT NULL,\n"
+		"	gene_name_id INTEGER NOT NULL,\n"
+		"	chr_id INTEGER NOT NULL,\n"
 		"	start INTEGER NOT NULL,\n"
 		"	end INTEGER NOT NULL,\n"
 		"	strand TEXT NOT NULL,\n"
 		"	ensg TEXT NOT NULL,\n"
 		"	ense TEXT NOT NULL,\n"
-		"	UNIQUE (ense));\n"
-		"\n"
-		"DROP TABLE IF EXISTS alignment;\n"
-		"CREATE TABLE alignment (\n"
+		"	FOREIGN KEY (gene_name_id) REFERENCES gene(id),\n"
+		"	FOREIGN KEY (chr_id) REFERENCES contig(id),\n"
+		"	UNIQUE (ense)"},
+	{"alignment",
 		"	id INTEGER PRIMARY KEY,\n"
 		"	qname TEXT NOT NULL,\n"
 		"	flag INTEGER NOT NULL,\n"
-		"	chr TEXT NOT NULL,\n"
+		"	chr_id INTEGER NOT NULL,\n"
 		"	pos INTEGER NOT NULL,\n"
 		"	mapq INTEGER NOT NULL,\n"
-		"	cigar TEXT NOT NULL,\n"
+		"	cigar BLOB NOT NULL,\n"
 		"	qlen INTEGER DEFAULT -1,\n"
 		"	rlen INTEGER DEFAULT -1,\n"
-		"	chr_next TEXT NOT NULL,\n"
+		"	chr_next_id INTEGER NOT NULL,\n"
 		"	pos_next INTEGER NOT NULL,\n"
 		"	type INT DEFAULT 0,\n"
 		"	source_id INTEGER NOT NULL,\n"
-		"	FOREIGN KEY (source_id) REFERENCES source(id));\n"
-		"\n"
-		"DROP TABLE IF EXISTS overlapping;\n"
-		"CREATE TABLE overlapping (\n"
+		"	FOREIGN KEY (chr_id) REFERENCES contig(id),\n"
+		"	FOREIGN KEY (source_id) REFERENCES source(id)"},
+	{"overlapping",
 		"	exon_id INTEGER NOT NULL,\n"
 		"	alignment_id INTEGER NOT NULL,\n"
 		"	pos INTEGER NOT NULL,\n"
 		"	len INTEGER NOT NULL,\n"
 		"	FOREIGN KEY (exon_id) REFERENCES exon(id),\n"
 		"	FOREIGN KEY (alignment_id) REFERENCES alignment(id),\n"
-		"	PRIMARY KEY (exon_id, alignment_id));\n"
-		"\n"
-		"DROP TABLE IF EXISTS cluster;\n"
-		"CREATE TABLE cluster (\n"
+		"	PRIMARY KEY (exon_id, alignment_id)"},
+	{"cluster",
 		"	id INTEGER NOT NULL,\n"
 		"	sid INTEGER NOT NULL,\n"
-		"	chr TEXT NOT NULL,\n"
+		"	chr_id INTEGER NOT NULL,\n"
 		"	start INTEGER NOT NULL,\n"
 		"	end INTEGER NOT NULL,\n"
-		"	gene_name TEXT NOT NULL,\n"
+		"	gene_name_id INTEGER NOT NULL,\n"
 		"	filter INTEGER NOT NULL,\n"
-		"	PRIMARY KEY (id, sid));\n"
-		"\n"
-		"DROP TABLE IF EXISTS clustering;\n"
-		"CREATE TABLE clustering (\n"
+		"	FOREIGN KEY (chr_id) REFERENCES contig(id),\n"
+		"	FOREIGN KEY (gene_name_id) REFERENCES gene(id),\n"
+		"	PRIMARY KEY (id, sid)"},
+	{"clustering",
 		"	cluster_id INTEGER NOT NULL,\n"
 		"	cluster_sid INTEGER NOT NULL,\n"
 		"	alignment_id INTEGER NOT NULL,\n"
@@ -332,18 +561,15 @@ db_create_tables (sqlite3 *db)
 		"	neighbors INTEGER NOT NULL,\n"
 		"	FOREIGN KEY (cluster_id, cluster_sid) REFERENCES cluster(id, sid),\n"
 		"	FOREIGN KEY (alignment_id) REFERENCES alignment(id),\n"
-		"	PRIMARY KEY (cluster_id, cluster_sid, alignment_id));\n"
-		"\n"
-		"DROP TABLE IF EXISTS blacklist;\n"
-		"CREATE TABLE blacklist (\n"
+		"	PRIMARY KEY (cluster_id, cluster_sid, alignment_id)"},
+	{"blacklist",
 		"	id INTEGER PRIMARY KEY,\n"
 		"	name TEXT NOT NULL,\n"
-		"	chr TEXT NOT NULL,\n"
+		"	chr_id INTEGER NOT NULL,\n"
 		"	start INTEGER NOT NULL,\n"
-		"	end INTEGER NOT NULL);\n"
-		"\n"
-		"DROP TABLE IF EXISTS overlapping_blacklist;\n"
-		"CREATE TABLE overlapping_blacklist (\n"
+		"	end INTEGER NOT NULL,\n"
+		"	FOREIGN KEY (chr_id) REFERENCES contig(id)"},
+	{"overlapping_blacklist",
 		"	blacklist_id INTEGER NOT NULL,\n"
 		"	cluster_id INTEGER NOT NULL,\n"
 		"	cluster_sid INTEGER NOT NULL,\n"
@@ -351,12 +577,10 @@ db_create_tables (sqlite3 *db)
 		"	len INTEGER NOT NULL,\n"
 		"	FOREIGN KEY (blacklist_id) REFERENCES blacklist(id),\n"
 		"	FOREIGN KEY (cluster_id, cluster_sid) REFERENCES cluster(id, sid),\n"
-		"	PRIMARY KEY (blacklist_id, cluster_id, cluster_sid));\n"
-		"\n"
-		"DROP TABLE IF EXISTS retrocopy;\n"
-		"CREATE TABLE retrocopy (\n"
+		"	PRIMARY KEY (blacklist_id, cluster_id, cluster_sid)"},
+	{"retrocopy",
 		"	id INTEGER PRIMARY KEY,\n"
-		"	chr TEXT NOT NULL,\n"
+		"	chr_id INTEGER NOT NULL,\n"
 		"	window_start INTEGER NOT NULL,\n"
 		"	window_end INTEGER NOT NULL,\n"
 		"	parental_gene_name TEXT NOT NULL,\n"
@@ -364,19 +588,16 @@ db_create_tables (sqlite3 *db)
 		"	insertion_point INTEGER,\n"
 		"	insertion_point_type INTEGER,\n"
 		"	orientation_rho REAL,\n"
-		"	orientation_p_value REAL);\n"
-		"\n"
-		"DROP TABLE IF EXISTS cluster_merging;\n"
-		"CREATE TABLE cluster_merging (\n"
+		"	orientation_p_value REAL,\n"
+		"	FOREIGN KEY (chr_id) REFERENCES contig(id)"},
+	{"cluster_merging",
 		"	retrocopy_id INTEGER NOT NULL,\n"
 		"	cluster_id INTEGER NOT NULL,\n"
 		"	cluster_sid INTEGER NOT NULL,\n"
 		"	FOREIGN KEY (retrocopy_id) REFERENCES retrocopy(id),\n"
 		"	FOREIGN KEY (cluster_id, cluster_sid) REFERENCES cluster(id, sid),\n"
-		"	PRIMARY KEY (retrocopy_id, cluster_id, cluster_sid));\n"
-		"\n"
-		"DROP TABLE IF EXISTS genotype;\n"
-		"CREATE TABLE genotype (\n"
+		"	PRIMARY KEY (retrocopy_id, cluster_id, cluster_sid)"},
+	{"genotype",
 		"	source_id INTEGER NOT NULL,\n"
 		"	retrocopy_id INTEGER NOT NULL,\n"
 		"	reference_depth INTEGER NOT NULL,\n"
@@ -386,10 +607,41 @@ db_create_tables (sqlite3 *db)
 		"	ho_alt_likelihood NOT NULL,\n"
 		"	FOREIGN KEY (source_id) REFERENCES source(id),\n"
 		"	FOREIGN KEY (retrocopy_id) REFERENCES retrocopy(id),\n"
-		"	PRIMARY KEY (source_id, retrocopy_id));";
+		"	PRIMARY KEY (source_id, retrocopy_id)"},
+	{NULL, NULL}
+};
+
+static void
+db_create_table (sqlite3 *db, const char *name)
+{
+	const DBTable *t = db_tables;
+	char *sql = NULL;
+
+	for (; t->name != NULL && strcmp (t->name, name); t++)
+		;
+
+	assert (t->name != NULL);
+
+	xasprintf (&sql,
+			"DROP TABLE IF EXISTS %s;\n"
+			"CREATE TABLE %s (\n%s);",
+			t->name, t->name, t->columns);
 
 	log_debug ("Database schema:\n%s", sql);
 	db_exec (db, sql);
+
+	xfree (sql);
+}
+
+static void
+db_create_tables (sqlite3 *db)
+{
+	log_trace ("Inside %s", __func__);
+
+	const DBTable *t = db_tables;
+
+	for (; t->name != NULL; t++)
+		db_create_table (db, t->name);
 }
 
 static void
@@ -468,6 +720,172 @@ db_end_transaction (sqlite3 *db)
 	db_exec (db, "END TRANSACTION");
 }
 
+/*
+ * v0.12 => v0.13: The cigar text, as written by
+ * the releases up to 1.1.6, is packed into the
+ * BAM operations. The column keeps its declared
+ * type until the v0.14 step rebuilds the table
+ */
+static void
+db_migrate_v0_12 (sqlite3 *db)
+{
+	log_trace ("Inside %s", __func__);
+
+	db_create_function (db, "cigar_blob", cigar_blob_func);
+	db_exec (db, "UPDATE alignment SET cigar = cigar_blob(cigar)");
+}
+
+/*
+ * v0.13 => v0.14: The sources gain the 'done'
+ * column. The old ones were all finished
+ */
+static void
+db_migrate_v0_13 (sqlite3 *db)
+{
+	log_trace ("Inside %s", __func__);
+
+	db_exec (db, "ALTER TABLE source RENAME TO source_v0_13");
+	db_create_table (db, "source");
+
+	db_exec (db,
+		"INSERT INTO source (id,batch_id,path,done)\n"
+		"	SELECT id, batch_id, path, 1 FROM source_v0_13;\n"
+		"DROP TABLE source_v0_13;");
+}
+
+/*
+ * v0.14 => v0.15: The contig and gene names move
+ * into their dictionary tables. The contigs get
+ * dense ids from 0, as the ones handed out by the
+ * chromosome standardization, and the mate
+ * unmapped, '*', gets -1
+ */
+static const char *db_migrate_v0_14_tables[] =
+{
+	"exon",
+	"alignment",
+	"cluster",
+	"blacklist",
+	"retrocopy",
+	NULL
+};
+
+static void
+db_migrate_v0_14 (sqlite3 *db)
+{
+	log_trace ("Inside %s", __func__);
+
+	const char **table = NULL;
+	char *sql = NULL;
+
+	const char copy_sql[] =
+		"INSERT INTO contig (id,name)\n"
+		"	SELECT ROW_NUMBER() OVER (ORDER BY name) - 1, name\n"
+		"	FROM (\n"
+		"		SELECT chr AS name FROM exon_v0_14\n"
+		"		UNION SELECT chr FROM alignment_v0_14\n"
+		"		UNION SELECT chr_next FROM alignment_v0_14\n"
+		"		UNION SELECT chr FROM cluster_v0_14\n"
+		"		UNION SELECT chr FROM blacklist_v0_14\n"
+		"		UNION SELECT chr FROM retrocopy_v0_14)\n"
+		"	WHERE name != '*';\n"
+		"\n"
+		"INSERT INTO gene (name)\n"
+		"	SELECT gene_name FROM exon_v0_14\n"
+		"	UNION SELECT gene_name FROM cluster_v0_14;\n"
+		"\n"
+		"INSERT INTO exon\n"
+		"	SELECT e.id, g.id, c.id, start, end, strand, ensg, ense\n"
+		"	FROM exon_v0_14 AS e\n"
+		"	INNER JOIN gene AS g ON g.name = e.gene_name\n"
+		"	INNER JOIN contig AS c ON c.name = e.chr;\n"
+		"\n"
+		"INSERT INTO alignment\n"
+		"	SELECT a.id, qname, flag, IFNULL(c.id, -1), pos, mapq, cigar,\n"
+		"		qlen, rlen, IFNULL(n.id, -1), pos_next, type, source_id\n"
+		"	FROM alignment_v0_14 AS a\n"
+		"	LEFT JOIN contig AS c ON c.name = a.chr\n"
+		"	LEFT JOIN contig AS n ON n.name = a.chr_next;\n"
+		"\n"
+		"INSERT INTO cluster\n"
+		"	SELECT cl.id, sid, c.id, start, end, g.id, filter\n"
+		"	FROM cluster_v0_14 AS cl\n"
+		"	INNER JOIN contig AS c ON c.name = cl.chr\n"
+		"	INNER JOIN gene AS g ON g.name = cl.gene_name;\n"
+		"\n"
+		"INSERT INTO blacklist\n"
+		"	SELECT b.id, b.name, c.id, start, end\n"
+		"	FROM blacklist_v0_14 AS b\n"
+		"	INNER JOIN contig AS c ON c.name = b.chr;\n"
+		"\n"
+		"INSERT INTO retrocopy\n"
+		"	SELECT r.id, c.id, window_start, window_end, parental_gene_name,\n"
+		"		level, insertion_point, insertion_point_type, orientation_rho,\n"
+		"		orientation_p_value\n"
+		"	FROM retrocopy_v0_14 AS r\n"
+		"	INNER JOIN contig AS c ON c.name = r.chr;";
+
+	for (table = db_migrate_v0_14_tables; *table != NULL; table++)
+		{
+			xasprintf (&sql, "ALTER TABLE %s RENAME TO %s_v0_14",
+					*table, *table);
+			db_exec (db, sql);
+			xfree (sql);
+		}
+
+	db_create_table (db, "contig");
+	db_create_table (db, "gene");
+
+	for (table = db_migrate_v0_14_tables; *table != NULL; table++)
+		db_create_table (db, *table);
+
+	log_debug ("Migration schema:\n%s", copy_sql);
+	db_exec (db, copy_sql);
+
+	for (table = db_migrate_v0_14_tables; *table != NULL; table++)
+		{
+			xasprintf (&sql, "DROP TABLE %s_v0_14", *table);
+			db_exec (db, sql);
+			xfree (sql);
+		}
+}
+
+/*
+ * Run the steps from 'minor_version' up to the
+ * current version, all or none of them
+ */
+static void
+db_migrate (sqlite3 *db, int minor_version)
+{
+	log_trace ("Inside %s", __func__);
+
+	log_info ("Migrate database '%s' from schema version 'v0.%d' to 'v%d.%d'",
+			sqlite3_db_filename (db, "main"), minor_version,
+			DB_SCHEMA_MAJOR_VERSION, DB_SCHEMA_MINOR_VERSION);
+
+	// Keep the references of the other
+	// tables to the renamed ones
+	db_exec (db, "PRAGMA legacy_alter_table = ON");
+
+	db_begin_transaction (db);
+
+	if (minor_version <= 12)
+		db_migrate_v0_12 (db);
+
+	if (minor_version <= 13)
+		db_migrate_v0_13 (db);
+
+	if (minor_version <= 14)
+		db_migrate_v0_14 (db);
+
+	db_exec (db, "DELETE FROM schema");
+	db_insert_schema_version (db);
+
+	db_end_transaction (db);
+
+	db_exec (db, "PRAGMA legacy_alter_table = OFF");
+}
+
 static void
 db_check_schema_version (sqlite3 *db)
 {
@@ -489,6 +907,10 @@ db_check_schema_version (sqlite3 *db)
 	else
 		log_fatal ("Failed to request schema version");
 
+	// The migration cannot run
+	// with a pending statement
+	db_finalize (stmt);
+
 	if ((major_version > DB_SCHEMA_MAJOR_VERSION)
 			|| (major_version == DB_SCHEMA_MAJOR_VERSION
 				&& minor_version > DB_SCHEMA_MINOR_VERSION))
@@ -497,6 +919,11 @@ db_check_schema_version (sqlite3 *db)
 				major_version, minor_version, sqlite3_db_filename (db, "main"),
 				DB_SCHEMA_MAJOR_VERSION, DB_SCHEMA_MINOR_VERSION, PACKAGE_STRING);
 		}
+	else if (major_version == 0 && minor_version >= 12
+			&& minor_version < DB_SCHEMA_MINOR_VERSION)
+		{
+			db_migrate (db, minor_version);
+		}
 	else if ((major_version < DB_SCHEMA_MAJOR_VERSION)
 			|| (major_version == DB_SCHEMA_MAJOR_VERSION
 				&& minor_version < DB_SCHEMA_MINOR_VERSION))
@@ -505,8 +932,6 @@ db_check_schema_version (sqlite3 *db)
 				major_version, minor_version, sqlite3_db_filename (db, "main"),
 				DB_SCHEMA_MAJOR_VERSION, DB_SCHEMA_MINOR_VERSION, PACKAGE_STRING);
 		}
-
-	db_finalize (stmt);
 }
 
 sqlite3 *
@@ -526,6 +951,70 @@ db_connect (const char *path)
 	return db;
 }
 
+sqlite3_stmt *
+db_prepare_contig_stmt (sqlite3 *db)
+{
+	log_trace ("Inside %s", __func__);
+	assert (db != NULL);
+
+	// The contigs are dumped again
+	// as new ones come along
+	const char sql[] =
+		"INSERT OR IGNORE INTO contig (id,name) VALUES (?1,?2)";
+
+	return db_prepare (db, sql);
+}
+
+void
+db_insert_contig (sqlite3_stmt *stmt, int id, const char *name)
+{
+	log_trace ("Inside %s", __func__);
+	assert (stmt != NULL && name != NULL);
+
+	sqlite3_mutex_enter (sqlite3_db_mutex (sqlite3_db_handle (stmt)));
+
+	db_reset (stmt);
+	db_clear_bindings (stmt);
+
+	db_bind_int (stmt, 1, id);
+	db_bind_text (stmt, 2, name);
+
+	db_step (stmt);
+
+	sqlite3_mutex_leave (sqlite3_db_mutex (sqlite3_db_handle (stmt)));
+}
+
+sqlite3_stmt *
+db_prepare_gene_stmt (sqlite3 *db)
+{
+	log_trace ("Inside %s", __func__);
+	assert (db != NULL);
+
+	const char sql[] =
+		"INSERT INTO gene (id,name) VALUES (?1,?2)";
+
+	return db_prepare (db, sql);
+}
+
+void
+db_insert_gene (sqlite3_stmt *stmt, int id, const char *name)
+{
+	log_trace ("Inside %s", __func__);
+	assert (stmt != NULL && name != NULL);
+
+	sqlite3_mutex_enter (sqlite3_db_mutex (sqlite3_db_handle (stmt)));
+
+	db_reset (stmt);
+	db_clear_bindings (stmt);
+
+	db_bind_int (stmt, 1, id);
+	db_bind_text (stmt, 2, name);
+
+	db_step (stmt);
+
+	sqlite3_mutex_leave (sqlite3_db_mutex (sqlite3_db_handle (stmt)));
+}
+
 sqlite3_stmt *
 db_prepare_exon_stmt (sqlite3 *db)
 {
@@ -533,20 +1022,20 @@ db_prepare_exon_stmt (sqlite3 *db)
 	assert (db != NULL);
 
 	const char sql[] =
-		"INSERT INTO exon (id,gene_name,chr,start,end,strand,ensg,ense)"
+		"INSERT INTO exon (id,gene_name_id,chr_id,start,end,strand,ensg,ense)"
 		"	VALUES (?1,?2,?3,?4,?5,?6,?7,?8)";
 
 	return db_prepare (db, sql);
 }
 
 void
-db_insert_exon (sqlite3_stmt *stmt, int id, const char *gene_name,
-		const char *chr, long start, long end, const char *strand, const char *ensg,
+db_insert_exon (sqlite3_stmt *stmt, int id, int gene_name_id,
+		int chr_id, long start, long end, const char *strand, const char *ensg,
 		const char *ense)
 {
 	log_trace ("Inside %s", __func__);
-	assert (stmt != NULL && gene_name != NULL && chr != NULL
-			&& strand != NULL && ensg != NULL && ense != NULL);
+	assert (stmt != NULL && strand != NULL && ensg != NULL
+			&& ense != NULL);
 
 	sqlite3_mutex_enter (sqlite3_db_mutex (sqlite3_db_handle (stmt)));
 
@@ -554,8 +1043,8 @@ db_insert_exon (sqlite3_stmt *stmt, int id, const char *gene_name,
 	db_clear_bindings (stmt);
 
 	db_bind_int (stmt, 1, id);
-	db_bind_text (stmt, 2, gene_name);
-	db_bind_text (stmt, 3, chr);
+	db_bind_int (stmt, 2, gene_name_id);
+	db_bind_int (stmt, 3, chr_id);
 	db_bind_int64 (stmt, 4, start);
 	db_bind_int64 (stmt, 5, end);
 	db_bind_text (stmt, 6, strand);
@@ -639,7 +1128,7 @@ db_prepare_alignment_stmt (sqlite3 *db)
 	assert (db != NULL);
 
 	const char sql[] =
-		"INSERT INTO alignment (id,qname,flag,chr,pos,mapq,cigar,qlen,rlen,chr_next,pos_next,type,source_id)\n"
+		"INSERT INTO alignment (id,qname,flag,chr_id,pos,mapq,cigar,qlen,rlen,chr_next_id,pos_next,type,source_id)\n"
 		"VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,?11,?12,?13)";
 
 	return db_prepare (db, sql);
@@ -647,12 +1136,12 @@ db_prepare_alignment_stmt (sqlite3 *db)
 
 void
 db_insert_alignment (sqlite3_stmt *stmt, int id, const char *qname, int flag,
-		const char *chr, long pos, int mapq, const char *cigar, int qlen, int rlen,
-		const char *chr_next, long pos_next, int type, int source_id)
+		int chr_id, long pos, int mapq, const uint32_t *cigar, int n_cigar,
+		int qlen, int rlen, int chr_next_id, long pos_next, int type,
+		int source_id)
 {
 	log_trace ("Inside %s", __func__);
-	assert (stmt != NULL && qname != NULL && chr != NULL
-			&& cigar != NULL && chr_next != NULL);
+	assert (stmt != NULL && qname != NULL && n_cigar >= 0);
 
 	sqlite3_mutex_enter (sqlite3_db_mutex (sqlite3_db_handle (stmt)));
 
@@ -662,13 +1151,13 @@ db_insert_alignment (sqlite3_stmt *stmt, int id, const char *qname, int flag,
 	db_bind_int (stmt, 1, id);
 	db_bind_text (stmt, 2, qname);
 	db_bind_int (stmt, 3, flag);
-	db_bind_text (stmt, 4, chr);
+	db_bind_int (stmt, 4, chr_id);
 	db_bind_int64 (stmt, 5, pos);
 	db_bind_int (stmt, 6, mapq);
-	db_bind_text (stmt, 7, cigar);
+	db_bind_blob (stmt, 7, cigar, n_cigar * sizeof (uint32_t));
 	db_bind_int (stmt, 8, qlen);
 	db_bind_int (stmt, 9, rlen);
-	db_bind_text (stmt, 10, chr_next);
+	db_bind_int (stmt, 10, chr_next_id);
 	db_bind_int64 (stmt, 11, pos_next);
 	db_bind_int (stmt, 12, type);
 	db_bind_int (stmt, 13, source_id);
@@ -756,15 +1245,15 @@ db_prepare_cluster_stmt (sqlite3 *db)
 	assert (db != NULL);
 
 	const char sql[] =
-		"INSERT INTO cluster (id,sid,chr,start,end,gene_name,filter)\n"
+		"INSERT INTO cluster (id,sid,chr_id,start,end,gene_name_id,filter)\n"
 		"VALUES (?1,?2,?3,?4,?5,?6,?7)";
 
 	return db_prepare (db, sql);
 }
 
 void
-db_insert_cluster (sqlite3_stmt *stmt, int id, int sid, const char *chr,
-		long start, long end, const char *gene_name, int filter)
+db_insert_cluster (sqlite3_stmt *stmt, int id, int sid, int chr_id,
+		long start, long end, int gene_name_id, int filter)
 {
 	log_trace ("Inside %s", __func__);
 	assert (stmt != NULL);
@@ -776,10 +1265,10 @@ db_insert_cluster (sqlite3_stmt *stmt, int id, int sid, const char *chr,
 
 	db_bind_int (stmt, 1, id);
 	db_bind_int (stmt, 2, sid);
-	db_bind_text (stmt, 3, chr);
+	db_bind_int (stmt, 3, chr_id);
 	db_bind_int64 (stmt, 4, start);
 	db_bind_int64 (stmt, 5, end);
-	db_bind_text (stmt, 6, gene_name);
+	db_bind_int (stmt, 6, gene_name_id);
 	db_bind_int (stmt, 7, filter);
 
 	db_step (stmt);
@@ -794,7 +1283,7 @@ db_prepare_blacklist_stmt (sqlite3 *db)
 	assert (db != NULL);
 
 	const char sql[] =
-		"INSERT INTO blacklist (id,name,chr,start,end)"
+		"INSERT INTO blacklist (id,name,chr_id,start,end)"
 		"	VALUES (?1,?2,?3,?4,?5)";
 
 	return db_prepare (db, sql);
@@ -802,10 +1291,10 @@ db_prepare_blacklist_stmt (sqlite3 *db)
 
 void
 db_insert_blacklist (sqlite3_stmt *stmt, int id, const char *name,
-		const char *chr, long start, long end)
+		int chr_id, long start, long end)
 {
 	log_trace ("Inside %s", __func__);
-	assert (stmt != NULL && name != NULL && chr != NULL);
+	assert (stmt != NULL && name != NULL);
 
 	sqlite3_mutex_enter (sqlite3_db_mutex (sqlite3_db_handle (stmt)));
 
@@ -814,7 +1303,7 @@ db_insert_blacklist (sqlite3_stmt *stmt, int id, const char *name,
 
 	db_bind_int (stmt, 1, id);
 	db_bind_text (stmt, 2, name);
-	db_bind_text (stmt, 3, chr);
+	db_bind_int (stmt, 3, chr_id);
 	db_bind_int64 (stmt, 4, start);
 	db_bind_int64 (stmt, 5, end);
 
@@ -900,7 +1389,7 @@ db_prepare_retrocopy_stmt (sqlite3 *db)
 	assert (db != NULL);
 
 	const char sql[] =
-		"INSERT INTO retrocopy (id,chr,window_start,window_end,parental_gene_name,level,\n"
+		"INSERT INTO retrocopy (id,chr_id,window_start,window_end,parental_gene_name,level,\n"
 		"	insertion_point,insertion_point_type,orientation_rho,orientation_p_value)\n"
 		"VALUES (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10)";
 
@@ -908,7 +1397,7 @@ db_prepare_retrocopy_stmt (sqlite3 *db)
 }
 
 void
-db_insert_retrocopy (sqlite3_stmt *stmt, int id, const char *chr, long window_start,
+db_insert_retrocopy (sqlite3_stmt *stmt, int id, int chr_id, long window_start,
 		long window_end, const char *parental_gene_name, int level, long insertion_point,
 		int insertion_point_type, double orientation_rho, double orientation_p_value)
 {
@@ -921,7 +1410,7 @@ db_insert_retrocopy (sqlite3_stmt *stmt, int id, const char *chr, long window_st
 	db_clear_bindings (stmt);
 
 	db_bind_int    (stmt, 1, id);
-	db_bind_text   (stmt, 2, chr);
+	db_bind_int    (stmt, 2, chr_id);
 	db_bind_int64  (stmt, 3, window_start);
 	db_bind_int64  (stmt, 4, window_end);
 	db_bind_text   (stmt, 5, parental_gene_name);
@@ -25,7 +25,7 @@
 
 /* Database schema version */
 #define DB_SCHEMA_MAJOR_VERSION 0
-#define DB_SCHEMA_MINOR_VERSION 12
+#define DB_SCHEMA_MINOR_VERSION 15
 
 #define DB_DEFAULT_CACHE_SIZE 2000
 
@@ -47,11 +47,14 @@ void           db_bind_int (sqlite3_stmt *stmt, int i, int value);
 void           db_bind_int64 (sqlite3_stmt *stmt, int i, int64_t value);
 void           db_bind_double (sqlite3_stmt *stmt, int i, double value);
 void           db_bind_text (sqlite3_stmt *stmt, int i, const char *value);
+void           db_bind_blob (sqlite3_stmt *stmt, int i, const void *value, int n);
 
 int            db_column_int (sqlite3_stmt *stmt, int i);
 int64_t        db_column_int64 (sqlite3_stmt *stmt, int i);
 double         db_column_double (sqlite3_stmt *stmt, int i);
 const char   * db_column_text (sqlite3_stmt *stmt, int i);
+const void   * db_column_blob (sqlite3_stmt *stmt, int i);
+int            db_column_bytes (sqlite3_stmt *stmt, int i);
 
 /* database interface  */
 
@@ -61,9 +64,20 @@ void      db_cache_size        (sqlite3 *db, size_t size);
 void      db_begin_transaction (sqlite3 *db);
 void      db_end_transaction   (sqlite3 *db);
 
+/*
+ * The contig and gene names are kept once at
+ * their dictionary tables. The other tables
+ * refer to them by integer id
+ */
+sqlite3_stmt * db_prepare_contig_stmt (sqlite3 *db);
+void db_insert_contig (sqlite3_stmt *stmt, int id, const char *name);
+
+sqlite3_stmt * db_prepare_gene_stmt (sqlite3 *db);
+void db_insert_gene (sqlite3_stmt *stmt, int id, const char *name);
+
 sqlite3_stmt * db_prepare_exon_stmt (sqlite3 *db);
-void db_insert_exon (sqlite3_stmt *stmt, int id, const char *gene_name,
-		const char *chr, long start, long end, const char *strand, const char *ensg,
+void db_insert_exon (sqlite3_stmt *stmt, int id, int gene_name_id,
+		int chr_id, long start, long end, const char *strand, const char *ensg,
 		const char *ense);
 
 sqlite3_stmt *db_prepare_batch_stmt (sqlite3 *db);
@@ -75,9 +89,16 @@ void db_insert_source (sqlite3_stmt *stmt, int id,
 		int batch_id, const char *path);
 
 sqlite3_stmt * db_prepare_alignment_stmt (sqlite3 *db);
+/*
+ * The cigar is stored as the packed BAM operations,
+ * in host byte order. The SQL functions
+ * 'cigar_clip_side' and 'cigar_text' decode it.
+ * An unmapped contig, '*', has the id -1
+ */
 void db_insert_alignment (sqlite3_stmt *stmt, int id, const char *name,
-		int flag, const char *chr, long pos, int mapq, const char *cigar, int qlen,
-		int rlen, const char *chr_next, long pos_next, int type, int source_id);
+		int flag, int chr_id, long pos, int mapq, const uint32_t *cigar,
+		int n_cigar, int qlen, int rlen, int chr_next_id, long pos_next,
+		int type, int source_id);
 
 sqlite3_stmt * db_prepare_overlapping_stmt (sqlite3 *db);
 void db_insert_overlapping (sqlite3_stmt *stmt, int exon_id,
@@ -88,12 +109,12 @@ void db_insert_clustering (sqlite3_stmt *stmt, int cluster_id, int cluster_sid,
 		int alignment_id, int label, int neighbors);
 
 sqlite3_stmt * db_prepare_cluster_stmt (sqlite3 *db);
-void db_insert_cluster (sqlite3_stmt *stmt, int id, int sid, const char *chr,
-		long start, long end, const char *gene_name, int filter);
+void db_insert_cluster (sqlite3_stmt *stmt, int id, int sid, int chr_id,
+		long start, long end, int gene_name_id, int filter);
 
 sqlite3_stmt * db_prepare_blacklist_stmt (sqlite3 *db);
 void db_insert_blacklist (sqlite3_stmt *stmt, int id, const char *name,
-		const char *chr, long start, long end);
+		int chr_id, long start, long end);
 
 sqlite3_stmt * db_prepare_overlapping_blacklist_stmt (sqlite3 *db);
 void db_insert_overlapping_blacklist (sqlite3_stmt *stmt, int blacklist_id,
@@ -104,7 +125,7 @@ void db_insert_cluster_merging (sqlite3_stmt *stmt, int retrocopy_id,
 		int cluster_id, int cluster_sid);
 
 sqlite3_stmt * db_prepare_retrocopy_stmt (sqlite3 *db);
-void db_insert_retrocopy (sqlite3_stmt *stmt, int id, const char *chr, long window_start,
+void db_insert_retrocopy (sqlite3_stmt *stmt, int id, int chr_id, long window_start,
 		long window_end, const char *parental_gene_name, int level, long insertion_point,
 		int insertion_point_type, double orientation_rho, double orientation_p_value);
 
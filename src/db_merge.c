@@ -24,12 +24,14 @@
 #include "hash.h"
 #include "db_merge.h"
 
-#define NUM_TABLES 5
+#define NUM_TABLES 7
 
 enum _Tables
 {
 	BATCH,
 	SOURCE,
+	CONTIG,
+	GENE,
 	EXON,
 	ALIGNMENT,
 	OVERLAPPING
@@ -39,6 +41,8 @@ static const char *tables[NUM_TABLES] =
 {
 	"batch",
 	"source",
+	"contig",
+	"gene",
 	"exon",
 	"alignment",
 	"overlapping"
@@ -48,6 +52,8 @@ static const char *sel_sql[NUM_TABLES] =
 {
 	"SELECT * FROM batch",
 	"SELECT * FROM source",
+	"SELECT * FROM contig",
+	"SELECT * FROM gene",
 	"SELECT * FROM exon",
 	"SELECT * FROM alignment",
 	"SELECT * FROM overlapping",
@@ -57,6 +63,8 @@ static const char *max_id_sql[NUM_TABLES] =
 {
 	"SELECT MAX(id) FROM batch",
 	"SELECT MAX(id) FROM source",
+	NULL,
+	NULL,
 	"SELECT MAX(id) FROM exon",
 	"SELECT MAX(id) FROM alignment",
 	NULL
@@ -65,6 +73,83 @@ static const char *max_id_sql[NUM_TABLES] =
 static Hash *ense_h = NULL;
 static Hash *exon_id_h = NULL;
 
+// The dictionaries are merged by name
+static Hash *contig_h = NULL;
+static Hash *contig_id_h = NULL;
+static Hash *gene_h = NULL;
+static Hash *gene_id_h = NULL;
+
+static inline int
+remap_id (Hash *id_h, int id)
+{
+	const int *new_id = NULL;
+
+	// The unmapped contig, '*'
+	if (id < 0)
+		return id;
+
+	new_id = hash_lookup (id_h, &id);
+	assert (new_id != NULL);
+
+	return *new_id;
+}
+
+static void
+merge_dict (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
+		Hash *name_h, Hash *id_h, int first_id,
+		void (*insert_func) (sqlite3_stmt *, int, const char *))
+{
+	int id = 0;
+	const char *name = NULL;
+
+	int *new_id = NULL;
+	int *id_copy = NULL;
+
+	db_reset (sel_stmt);
+
+	while (db_step (sel_stmt) == SQLITE_ROW)
+		{
+			// Catch all values from db2
+			id = db_column_int (sel_stmt, 0);
+			name = db_column_text (sel_stmt, 1);
+
+			new_id = hash_lookup (name_h, name);
+
+			// A name not seen yet takes the next id
+			if (new_id == NULL)
+				{
+					new_id = xcalloc (1, sizeof (int));
+					*new_id = hash_size (name_h) + first_id;
+					hash_insert (name_h, xstrdup (name), new_id);
+
+					// Insert them into db
+					insert_func (in_stmt, *new_id, name);
+				}
+
+			id_copy = xcalloc (1, sizeof (int));
+			*id_copy = id;
+			hash_insert (id_h, id_copy, new_id);
+		}
+}
+
+static void
+merge_contig (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
+		int max_id[NUM_TABLES])
+{
+	// The ids of the chromosome
+	// standardization start at 0
+	merge_dict (in_stmt, sel_stmt, contig_h, contig_id_h,
+			0, db_insert_contig);
+}
+
+static void
+merge_gene (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
+		int max_id[NUM_TABLES])
+{
+	merge_dict (in_stmt, sel_stmt, gene_h, gene_id_h,
+			1, db_insert_gene);
+}
+
 static void
 merge_batch (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
 		int max_id[NUM_TABLES])
@@ -114,8 +199,8 @@ merge_exon (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
 		int max_id[NUM_TABLES])
 {
 	int id = 0;
-	const char *gene_name = NULL;
-	const char *chr = NULL;
+	int gene_name_id = 0;
+	int chr_id = 0;
 	long start = 0;
 	long end = 0;
 	const char *strand = NULL;
@@ -131,8 +216,8 @@ merge_exon (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
 		{
 			// Catch all values from db2
 			id = db_column_int (sel_stmt, 0);
-			gene_name = db_column_text (sel_stmt, 1);
-			chr = db_column_text (sel_stmt, 2);
+			gene_name_id = db_column_int (sel_stmt, 1);
+			chr_id = db_column_int (sel_stmt, 2);
 			start = db_column_int64 (sel_stmt, 3);
 			end = db_column_int64 (sel_stmt, 4);
 			strand = db_column_text (sel_stmt, 5);
@@ -161,8 +246,10 @@ merge_exon (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
 				}
 
 			// Insert them into db
-			db_insert_exon (in_stmt, id + max_id[EXON], gene_name,
-					chr, start, end, strand, ensg, ense);
+			db_insert_exon (in_stmt, id + max_id[EXON],
+					remap_id (gene_id_h, gene_name_id),
+					remap_id (contig_id_h, chr_id),
+					start, end, strand, ensg, ense);
 		}
 }
 
@@ -175,13 +262,14 @@ merge_alignment (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
 	int id = 0;
 	const char *qname = NULL;
 	int flag = 0;
-	const char *chr = NULL;
+	int chr_id = 0;
 	long pos = 0;
 	int mapq = 0;
-	const char *cigar = NULL;
+	const uint32_t *cigar = NULL;
+	int n_cigar = 0;
 	int qlen = 0;
 	int rlen = 0;
-	const char *chr_next = NULL;
+	int chr_next_id = 0;
 	long pos_next = 0;
 	int type = 0;
 	int source_id = 0;
@@ -191,19 +279,21 @@ merge_alignment (sqlite3_stmt *in_stmt, sqlite3_stmt *sel_stmt,
 			id = db_column_int (sel_stmt, 0);
 			qname = db_column_text (sel_stmt, 1);
 			flag = db_column_int (sel_stmt, 2);
-			chr = db_column_text (sel_stmt, 3);
+			chr_id = db_column_int (sel_stmt, 3);
 			pos = db_column_int64 (sel_stmt, 4);
 			mapq = db_column_int (sel_stmt, 5);
-			cigar = db_column_text (sel_stmt, 6);
+			cigar = db_column_blob (sel_stmt, 6);
+			n_cigar = db_column_bytes (sel_stmt, 6) / sizeof (uint32_t);
 			qlen = db_column_int (sel_stmt, 7);
 			rlen = db_column_int (sel_stmt, 8);
-			chr_next = db_column_text (sel_stmt, 9);
+			chr_next_id = db_column_int (sel_stmt, 9);
 			pos_next = db_column_int64 (sel_stmt, 10);
 			type = db_column_int (sel_stmt, 11);
 			source_id = db_column_int (sel_stmt, 12);
 
 			db_insert_alignment (in_stmt, id + max_id[ALIGNMENT], qname,
-					flag, chr, pos, mapq, cigar, qlen, rlen, chr_next,
+					flag, remap_id (contig_id_h, chr_id), pos, mapq, cigar,
+					n_cigar, qlen, rlen, remap_id (contig_id_h, chr_next_id),
 					pos_next, type, source_id + max_id[SOURCE]);
 		}
 }
@@ -245,6 +335,8 @@ static void
 {
 	merge_batch,
 	merge_souce,
+	merge_contig,
+	merge_gene,
 	merge_exon,
 	merge_alignment,
 	merge_overlapping
@@ -255,6 +347,8 @@ static sqlite3_stmt *
 {
 	db_prepare_batch_stmt,
 	db_prepare_source_stmt,
+	db_prepare_contig_stmt,
+	db_prepare_gene_stmt,
 	db_prepare_exon_stmt,
 	db_prepare_alignment_stmt,
 	db_prepare_overlapping_stmt
@@ -317,6 +411,32 @@ exon_id_init (sqlite3 *db)
 	db_finalize (sel_stmt);
 }
 
+static void
+dict_init (sqlite3 *db, const char *sql, Hash **name_h,
+		Hash **id_h)
+{
+	sqlite3_stmt *sel_stmt = NULL;
+	int *id = NULL;
+
+	// Init hash name => id
+	*name_h = hash_new (xfree, xfree);
+
+	// Init hash id at db2 => id
+	*id_h = hash_new_full (int_hash, int_equal, xfree, NULL);
+
+	sel_stmt = db_prepare (db, sql);
+
+	while (db_step (sel_stmt) == SQLITE_ROW)
+		{
+			id = xcalloc (1, sizeof (int));
+			*id = db_column_int (sel_stmt, 0);
+
+			hash_insert (*name_h, xstrdup (db_column_text (sel_stmt, 1)), id);
+		}
+
+	db_finalize (sel_stmt);
+}
+
 void
 db_merge (sqlite3 *db, int argc, char **argv)
 {
@@ -347,6 +467,11 @@ db_merge (sqlite3 *db, int argc, char **argv)
 	// in the database
 	exon_id_init (db);
 
+	// Init the dictionaries with the
+	// names already present
+	dict_init (db, sel_sql[CONTIG], &contig_h, &contig_id_h);
+	dict_init (db, sel_sql[GENE], &gene_h, &gene_id_h);
+
 	// Merge all files at argv
 	for (i = 0; i < argc; i++)
 		{
@@ -390,4 +515,49 @@ db_merge (sqlite3 *db, int argc, char **argv)
 
 	hash_free (ense_h);
 	hash_free (exon_id_h);
+	hash_free (contig_h);
+	hash_free (contig_id_h);
+	hash_free (gene_h);
+	hash_free (gene_id_h);
+}
+
+void
+db_merge_shard (sqlite3 *db, const char *path)
+{
+	log_trace ("Inside %s", __func__);
+	assert (db != NULL && path != NULL);
+
+	sqlite3_stmt *stmt = NULL;
+
+	// The shard holds alignments whose ids are
+	// already unique among all shards, so the rows
+	// are copied in bulk, with no id shifting.
+	// Its source entry comes along in the same
+	// transaction, so that a finished source is
+	// never half merged
+	log_debug ("Attach shard database '%s'", path);
+	stmt = db_prepare (db, "ATTACH DATABASE ?1 AS shard");
+	db_bind_text (stmt, 1, path);
+	db_step (stmt);
+	db_finalize (stmt);
+
+	db_begin_transaction (db);
+
+	// The contig ids are shared by all
+	// shards of the same run
+	log_debug ("Merging table 'contig' from shard database '%s'", path);
+	db_exec (db, "INSERT OR IGNORE INTO contig SELECT * FROM shard.contig");
+
+	log_debug ("Merging table 'alignment' from shard database '%s'", path);
+	db_exec (db, "INSERT INTO alignment SELECT * FROM shard.alignment");
+
+	log_debug ("Merging table 'overlapping' from shard database '%s'", path);
+	db_exec (db, "INSERT INTO overlapping SELECT * FROM shard.overlapping");
+
+	log_debug ("Merging table 'source' from shard database '%s'", path);
+	db_exec (db, "INSERT OR REPLACE INTO source SELECT * FROM shard.source");
+
+	db_end_transaction (db);
+
+	db_exec (db, "DETACH DATABASE shard");
 }
@@ -21,6 +21,7 @@
 
 #include "db.h"
 
-void db_merge (sqlite3 *db, int argc, char **argv);
+void db_merge       (sqlite3 *db, int argc, char **argv);
+void db_merge_shard (sqlite3 *db, const char *path);
 
 #endif /* db_merge.h */
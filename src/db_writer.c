@@ -0,0 +1,374 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <pthread.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "log.h"
+#include "db_writer.h"
+
+#define DB_BATCH_SIZE 4096 /* rows */
+
+struct _DBAlignmentRow
+{
+	int     id;
+	int     flag;
+	long    pos;
+	int     mapq;
+	int     n_cigar;
+	int     qlen;
+	int     rlen;
+	int     chr_id;
+	int     chr_next_id;
+	long    pos_next;
+	int     type;
+	int     source_id;
+
+	// Offsets into the batch buffer
+	size_t  qname;
+	size_t  cigar;
+};
+
+typedef struct _DBAlignmentRow DBAlignmentRow;
+
+struct _DBOverlappingRow
+{
+	int   exon_id;
+	int   alignment_id;
+	long  pos;
+	long  len;
+};
+
+typedef struct _DBOverlappingRow DBOverlappingRow;
+
+struct _DBBatch
+{
+	DBAlignmentRow    *alignments;
+	size_t             num_alignments;
+	DBOverlappingRow  *overlappings;
+	size_t             num_overlappings;
+	size_t             alloc_overlappings;
+	char              *buf;
+	size_t             buf_len;
+	size_t             buf_alloc;
+	DBBatch           *next;
+};
+
+struct _DBWriter
+{
+	sqlite3_stmt     *alignment_stmt;
+	sqlite3_stmt     *overlapping_stmt;
+	pthread_t         thread;
+	pthread_mutex_t   lock;
+	pthread_cond_t    has_batch;
+	pthread_cond_t    has_room;
+	DBBatch          *head;
+	DBBatch          *tail;
+	DBBatch          *free_batches;
+	int               queued;
+	int               max_queued;
+	int               done;
+	long              num_rows;
+};
+
+static DBBatch *
+db_batch_new (void)
+{
+	DBBatch *batch = xcalloc (1, sizeof (DBBatch));
+
+	batch->alignments = xcalloc (DB_BATCH_SIZE, sizeof (DBAlignmentRow));
+	batch->buf_alloc = DB_BATCH_SIZE * 64;
+	batch->buf = xcalloc (batch->buf_alloc, sizeof (char));
+
+	return batch;
+}
+
+static void
+db_batch_free (DBBatch *batch)
+{
+	if (batch == NULL)
+		return;
+
+	xfree (batch->alignments);
+	xfree (batch->overlappings);
+	xfree (batch->buf);
+	xfree (batch);
+}
+
+static inline void
+db_batch_clean (DBBatch *batch)
+{
+	batch->num_alignments = 0;
+	batch->num_overlappings = 0;
+	batch->buf_len = 0;
+	batch->next = NULL;
+}
+
+static size_t
+db_batch_copy (DBBatch *batch, const void *data, size_t len)
+{
+	size_t offset = batch->buf_len;
+
+	if (batch->buf_len + len > batch->buf_alloc)
+		{
+			while (batch->buf_len + len > batch->buf_alloc)
+				batch->buf_alloc <<= 1;
+
+			batch->buf = xrealloc (batch->buf, batch->buf_alloc);
+		}
+
+	memcpy (batch->buf + offset, data, len);
+	batch->buf_len += len;
+
+	return offset;
+}
+
+int
+db_batch_is_full (const DBBatch *batch)
+{
+	assert (batch != NULL);
+	return batch->num_alignments == DB_BATCH_SIZE;
+}
+
+void
+db_batch_add_alignment (DBBatch *batch, int id, const char *qname,
+		int flag, int chr_id, long pos, int mapq, const uint32_t *cigar,
+		int n_cigar, int qlen, int rlen, int chr_next_id, long pos_next,
+		int type, int source_id)
+{
+	assert (batch != NULL && qname != NULL && n_cigar >= 0
+			&& !db_batch_is_full (batch));
+
+	DBAlignmentRow *row = &batch->alignments[batch->num_alignments++];
+
+	*row = (DBAlignmentRow) {
+		.id          = id,
+		.flag        = flag,
+		.pos         = pos,
+		.mapq        = mapq,
+		.n_cigar     = n_cigar,
+		.qlen        = qlen,
+		.rlen        = rlen,
+		.chr_id      = chr_id,
+		.chr_next_id = chr_next_id,
+		.pos_next    = pos_next,
+		.type        = type,
+		.source_id   = source_id
+	};
+
+	row->qname = db_batch_copy (batch, qname, strlen (qname) + 1);
+	row->cigar = db_batch_copy (batch, cigar, n_cigar * sizeof (uint32_t));
+}
+
+void
+db_batch_add_overlapping (DBBatch *batch, int exon_id,
+		int alignment_id, long pos, long len)
+{
+	assert (batch != NULL);
+
+	if (batch->num_overlappings == batch->alloc_overlappings)
+		{
+			batch->alloc_overlappings = batch->alloc_overlappings
+				? batch->alloc_overlappings << 1
+				: DB_BATCH_SIZE;
+			batch->overlappings = xrealloc (batch->overlappings,
+					batch->alloc_overlappings * sizeof (DBOverlappingRow));
+		}
+
+	batch->overlappings[batch->num_overlappings++] = (DBOverlappingRow) {
+		.exon_id      = exon_id,
+		.alignment_id = alignment_id,
+		.pos          = pos,
+		.len          = len
+	};
+}
+
+static void
+db_writer_write_batch (DBWriter *writer, const DBBatch *batch)
+{
+	const DBAlignmentRow *a = NULL;
+	const DBOverlappingRow *o = NULL;
+	size_t i = 0;
+
+	for (i = 0; i < batch->num_alignments; i++)
+		{
+			a = &batch->alignments[i];
+			db_insert_alignment (writer->alignment_stmt, a->id,
+					batch->buf + a->qname, a->flag, a->chr_id,
+					a->pos, a->mapq, (const uint32_t *) (batch->buf + a->cigar),
+					a->n_cigar, a->qlen, a->rlen, a->chr_next_id,
+					a->pos_next, a->type, a->source_id);
+		}
+
+	for (i = 0; i < batch->num_overlappings; i++)
+		{
+			o = &batch->overlappings[i];
+			db_insert_overlapping (writer->overlapping_stmt, o->exon_id,
+					o->alignment_id, o->pos, o->len);
+		}
+
+	writer->num_rows += batch->num_alignments + batch->num_overlappings;
+}
+
+static void *
+db_writer_run (void *data)
+{
+	DBWriter *writer = data;
+	DBBatch *batch = NULL;
+
+	pthread_mutex_lock (&writer->lock);
+
+	for (;;)
+		{
+			while (writer->head == NULL && !writer->done)
+				pthread_cond_wait (&writer->has_batch, &writer->lock);
+
+			// Drain the queue before leaving
+			if (writer->head == NULL)
+				break;
+
+			batch = writer->head;
+			writer->head = batch->next;
+			if (writer->head == NULL)
+				writer->tail = NULL;
+
+			writer->queued--;
+			pthread_cond_signal (&writer->has_room);
+
+			// The workers keep filling their
+			// batches meanwhile
+			pthread_mutex_unlock (&writer->lock);
+			db_writer_write_batch (writer, batch);
+			db_batch_clean (batch);
+			pthread_mutex_lock (&writer->lock);
+
+			batch->next = writer->free_batches;
+			writer->free_batches = batch;
+		}
+
+	pthread_mutex_unlock (&writer->lock);
+	return NULL;
+}
+
+DBWriter *
+db_writer_new (sqlite3_stmt *alignment_stmt,
+		sqlite3_stmt *overlapping_stmt, int max_queued)
+{
+	assert (alignment_stmt != NULL && overlapping_stmt != NULL
+			&& max_queued > 0);
+
+	DBWriter *writer = xcalloc (1, sizeof (DBWriter));
+
+	writer->alignment_stmt = alignment_stmt;
+	writer->overlapping_stmt = overlapping_stmt;
+	writer->max_queued = max_queued;
+
+	pthread_mutex_init (&writer->lock, NULL);
+	pthread_cond_init (&writer->has_batch, NULL);
+	pthread_cond_init (&writer->has_room, NULL);
+
+	if (pthread_create (&writer->thread, NULL, db_writer_run, writer) != 0)
+		log_errno_fatal ("Failed to create database writer thread");
+
+	return writer;
+}
+
+void
+db_writer_free (DBWriter *writer)
+{
+	DBBatch *batch = NULL;
+
+	if (writer == NULL)
+		return;
+
+	pthread_mutex_lock (&writer->lock);
+	writer->done = 1;
+	pthread_cond_signal (&writer->has_batch);
+	pthread_mutex_unlock (&writer->lock);
+
+	// Wait for the pending batches
+	pthread_join (writer->thread, NULL);
+
+	log_debug ("Database writer dumped %li rows", writer->num_rows);
+
+	while (writer->free_batches != NULL)
+		{
+			batch = writer->free_batches;
+			writer->free_batches = batch->next;
+			db_batch_free (batch);
+		}
+
+	pthread_mutex_destroy (&writer->lock);
+	pthread_cond_destroy (&writer->has_batch);
+	pthread_cond_destroy (&writer->has_room);
+
+	xfree (writer);
+}
+
+DBBatch *
+db_writer_get_batch (DBWriter *writer)
+{
+	assert (writer != NULL);
+
+	DBBatch *batch = NULL;
+
+	// Recycle the batches already
+	// written, if any
+	pthread_mutex_lock (&writer->lock);
+
+	batch = writer->free_batches;
+	if (batch != NULL)
+		writer->free_batches = batch->next;
+
+	pthread_mutex_unlock (&writer->lock);
+
+	if (batch == NULL)
+		batch = db_batch_new ();
+
+	batch->next = NULL;
+	return batch;
+}
+
+void
+db_writer_push_batch (DBWriter *writer, DBBatch *batch)
+{
+	assert (writer != NULL && batch != NULL);
+
+	pthread_mutex_lock (&writer->lock);
+
+	// Bound the memory: Hold the workers
+	// while the writer is behind
+	while (writer->queued >= writer->max_queued)
+		pthread_cond_wait (&writer->has_room, &writer->lock);
+
+	batch->next = NULL;
+
+	if (writer->tail != NULL)
+		writer->tail->next = batch;
+	else
+		writer->head = batch;
+
+	writer->tail = batch;
+	writer->queued++;
+
+	pthread_cond_signal (&writer->has_batch);
+	pthread_mutex_unlock (&writer->lock);
+}
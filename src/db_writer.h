@@ -0,0 +1,51 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DB_WRITER_H
+#define DB_WRITER_H
+
+#include <stdint.h>
+#include "db.h"
+
+/*
+ * The worker threads fill their own batches of
+ * rows, with no locking, and hand the full ones
+ * to a single writer thread, which owns the
+ * prepared statements
+ */
+typedef struct _DBBatch  DBBatch;
+typedef struct _DBWriter DBWriter;
+
+DBWriter * db_writer_new  (sqlite3_stmt *alignment_stmt,
+		sqlite3_stmt *overlapping_stmt, int max_queued);
+void       db_writer_free (DBWriter *writer);
+
+DBBatch  * db_writer_get_batch  (DBWriter *writer);
+void       db_writer_push_batch (DBWriter *writer, DBBatch *batch);
+
+int db_batch_is_full (const DBBatch *batch);
+
+void db_batch_add_alignment (DBBatch *batch, int id, const char *qname,
+		int flag, int chr_id, long pos, int mapq, const uint32_t *cigar,
+		int n_cigar, int qlen, int rlen, int chr_next_id, long pos_next,
+		int type, int source_id);
+
+void db_batch_add_overlapping (DBBatch *batch, int exon_id,
+		int alignment_id, long pos, long len);
+
+#endif /* db_writer.h */
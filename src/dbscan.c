@@ -19,7 +19,7 @@
 #include "config.h"
 
 #include "set.h"
-#include "ibitree.h"
+#include "iindex.h"
 #include "wrapper.h"
 #include "dbscan.h"
 
@@ -40,7 +40,7 @@ dbscan_free (DBSCAN *db)
 		}
 
 	list_free (db->points);
-	ibitree_free (db->index);
+	iindex_free (db->index);
 	xfree (db);
 }
 
@@ -50,7 +50,7 @@ dbscan_new (DestroyNotify destroy_data)
 	DBSCAN *db = xcalloc (1, sizeof (DBSCAN));
 
 	db->points = list_new ((DestroyNotify) xfree);
-	db->index = ibitree_new (NULL);
+	db->index = iindex_new (NULL);
 	db->destroy_data = destroy_data;
 
 	return db;
@@ -69,11 +69,11 @@ dbscan_insert_point (DBSCAN *db,
 	};
 
 	list_append (db->points, p);
-	ibitree_insert (db->index, low, high, p);
+	iindex_insert (db->index, low, high, p);
 }
 
 static void
-get_point (IBiTreeLookupData *ldata,
+get_point (IIndexLookupData *ldata,
 		void *user_data)
 {
 	Point *p = ldata->data;
@@ -87,7 +87,7 @@ range_query (DBSCAN *db, List *neighbors,
 {
 	long center = (q->high + q->low) / 2;
 	long low = center - eps;
-	return ibitree_lookup (db->index, low > 0 ? low : 1,
+	return iindex_lookup (db->index, low > 0 ? low : 1,
 			center + eps, -1, -1, 0, get_point, neighbors);
 }
 
@@ -143,6 +143,9 @@ dbscan_cluster (DBSCAN *db, long eps, int min_pts, DFunc func, void *user_data)
 	// Set all points to UNDEFINED
 	reset_points (db->points);
 
+	// Sort the points inserted so far for the range queries
+	iindex_build (db->index);
+
 	cur = list_head (db->points);
 	for (; cur != NULL; cur = list_next (cur))
 		{
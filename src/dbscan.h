@@ -19,7 +19,7 @@
 #ifndef DBSCAN_H
 #define DBSCAN_H
 
-#include "ibitree.h"
+#include "iindex.h"
 #include "list.h"
 
 enum _Label
@@ -47,7 +47,7 @@ typedef struct _Point Point;
 struct _DBSCAN
 {
 	List          *points;
-	IBiTree       *index;
+	IIndex        *index;
 	DestroyNotify  destroy_data;
 };
 
@@ -35,10 +35,10 @@ struct _DedupData
 	int       id;
 	String   *qname;
 
-	String   *chr;
+	int       chr_id;
 	long      pos;
 
-	String   *chr_next;
+	int       chr_next_id;
 	long      pos_next;
 
 	int       source_id;
@@ -50,43 +50,41 @@ static inline void
 dedup_data_init (DedupData *data)
 {
 	data->qname = string_sized_new (STR_SIZE);
-	data->chr = string_sized_new (STR_SIZE);
-	data->chr_next = string_sized_new (STR_SIZE);
 }
 
 static inline void
 dedup_data_read (DedupData *data, sqlite3_stmt *stmt)
 {
-	data->id        = db_column_int   (stmt, 0);
-	data->pos       = db_column_int64 (stmt, 3);
-	data->pos_next  = db_column_int64 (stmt, 5);
-	data->source_id = db_column_int   (stmt, 6);
+	data->id          = db_column_int   (stmt, 0);
+	data->chr_id      = db_column_int   (stmt, 2);
+	data->pos         = db_column_int64 (stmt, 3);
+	data->chr_next_id = db_column_int   (stmt, 4);
+	data->pos_next    = db_column_int64 (stmt, 5);
+	data->source_id   = db_column_int   (stmt, 6);
 
 	string_set (data->qname, db_column_text (stmt, 1));
-	string_set (data->chr, db_column_text (stmt, 2));
-	string_set (data->chr_next, db_column_text (stmt, 4));
 }
 
 static inline void
 dedup_data_copy (DedupData *to, const DedupData *from)
 {
-	to->id        = from->id;
-	to->pos       = from->pos;
-	to->pos_next  = from->pos_next;
-	to->source_id = from->source_id;
+	to->id          = from->id;
+	to->chr_id      = from->chr_id;
+	to->pos         = from->pos;
+	to->chr_next_id = from->chr_next_id;
+	to->pos_next    = from->pos_next;
+	to->source_id   = from->source_id;
 
 	string_set (to->qname, from->qname->str);
-	string_set (to->chr, from->chr->str);
-	string_set (to->chr_next, from->chr_next->str);
 }
 
 static inline int
 dedup_data_is_dup (const DedupData *data1, const DedupData *data2)
 {
 	return data1->id != data2->id
-		&& !strcmp (data1->chr->str, data2->chr->str)
+		&& data1->chr_id == data2->chr_id
 		&& data1->pos == data2->pos
-		&& !strcmp (data1->chr_next->str, data2->chr_next->str)
+		&& data1->chr_next_id == data2->chr_next_id
 		&& data1->pos_next == data2->pos_next
 		&& data1->source_id == data2->source_id;
 }
@@ -95,8 +93,6 @@ static inline void
 dedup_data_destroy (DedupData *data)
 {
 	string_free (data->qname, 1);
-	string_free (data->chr, 1);
-	string_free (data->chr_next, 1);
 }
 
 static sqlite3_stmt *
@@ -105,11 +101,11 @@ prepare_alignment_query_stmt (sqlite3 *db)
 	log_trace ("Inside %s", __func__);
 
 	const char sql[] =
-		"SELECT id, qname, chr, pos, chr_next, pos_next, source_id\n"
+		"SELECT id, qname, chr_id, pos, chr_next_id, pos_next, source_id\n"
 		"FROM alignment\n"
 		"ORDER BY source_id ASC,\n"
-		"	chr ASC, pos ASC,\n"
-		"	chr_next ASC, pos_next ASC,\n"
+		"	chr_id ASC, pos ASC,\n"
+		"	chr_next_id ASC, pos_next ASC,\n"
 		"	qname ASC";
 
 	log_debug ("Query schema:\n%s", sql);
@@ -18,40 +18,228 @@
 
 #include "config.h"
 
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <assert.h>
 #include "wrapper.h"
 #include "log.h"
 #include "gff.h"
-#include "ibitree.h"
+#include "iindex.h"
 #include "chr.h"
+#include "utils.h"
 #include "exon.h"
 
+/*
+ * Annotation cache: the exons filtered from a GTF/GFF3
+ * file, dumped as fixed size records and a pool of
+ * strings, so that the file can be mapped as is. The
+ * interval indexes are saved as built, one node array
+ * per contig, and the exon rows carry the gene ids.
+ * The key covers the format version, the filter, the
+ * contig aliases and the annotation file content
+ */
+#define EXON_CACHE_MAGIC    "SIDEREXN"
+#define EXON_CACHE_VERSION  2
+#define EXON_CACHE_FILTER   "exon;transcript_type=protein_coding"
+#define EXON_CACHE_TEMPLATE "sider-exon-XXXXXX"
+
+struct _ExonCacheHeader
+{
+	char      magic[8];
+	uint32_t  version;
+	uint32_t  reserved;
+	uint64_t  key;
+	uint64_t  num_contigs;
+	uint64_t  num_genes;
+	uint64_t  num_exons;
+	uint64_t  pool_size;
+};
+
+typedef struct _ExonCacheHeader ExonCacheHeader;
+
+// The nodes of the contigs follow one another
+struct _ExonCacheContig
+{
+	uint32_t  name;
+	uint32_t  reserved;
+	uint64_t  num_nodes;
+};
+
+typedef struct _ExonCacheContig ExonCacheContig;
+
+// An IIndexNode, with the exon id as data
+struct _ExonCacheNode
+{
+	int64_t   low;
+	int64_t   high;
+	int64_t   max;
+	int64_t   id;
+};
+
+typedef struct _ExonCacheNode ExonCacheNode;
+
+struct _ExonCacheGene
+{
+	int64_t   id;
+	uint32_t  name;
+	uint32_t  reserved;
+};
+
+typedef struct _ExonCacheGene ExonCacheGene;
+
+// String fields are offsets into the pool
+struct _ExonCacheRecord
+{
+	int64_t   id;
+	int64_t   start;
+	int64_t   end;
+	uint32_t  contig;
+	uint32_t  gene_name_id;
+	uint32_t  strand;
+	uint32_t  gene_id;
+	uint32_t  exon_id;
+	uint32_t  reserved;
+};
+
+typedef struct _ExonCacheRecord ExonCacheRecord;
+
 struct _ExonTreeData
 {
-	ExonTree *tree;
-	long      alignment_id;
+	ExonTree     *tree;
+	long          alignment_id;
+	sqlite3_stmt *overlapping_stmt;
+	DBBatch      *batch;
 };
 
 typedef struct _ExonTreeData ExonTreeData;
 
+static void
+build_bins (ExonBins *bins, const IIndex *index)
+{
+	long high = 0;
+	long bin = 0;
+	long i = 0;
+
+	xfree (bins->bits);
+
+	for (i = 0; i < index->size; i++)
+		if (index->nodes[i].high > high)
+			high = index->nodes[i].high;
+
+	bins->len = (high >> EXON_BIN_SHIFT) + 1;
+	bins->bits = xcalloc ((bins->len + 63) / 64, sizeof (uint64_t));
+
+	for (i = 0; i < index->size; i++)
+		{
+			for (bin = index->nodes[i].low >> EXON_BIN_SHIFT;
+					bin <= index->nodes[i].high >> EXON_BIN_SHIFT; bin++)
+				bins->bits[bin >> 6] |= UINT64_C(1) << (bin & 63);
+		}
+}
+
+static inline int
+exon_bins_test (const ExonTree *exon_tree, int chr_id,
+		long low, long high)
+{
+	const ExonBins *bins = &exon_tree->bins[chr_id];
+	long bin = low >> EXON_BIN_SHIFT;
+	long last = high >> EXON_BIN_SHIFT;
+
+	if (last >= bins->len)
+		last = bins->len - 1;
+
+	// Alignments are shorter than a bin, but the
+	// ones with long gaps may cross a few of them
+	for (; bin <= last; bin++)
+		if (bins->bits[bin >> 6] & (UINT64_C(1) << (bin & 63)))
+			return 1;
+
+	return 0;
+}
+
+static void
+set_index (ExonTree *exon_tree, int id, IIndex *index)
+{
+	// Reach the index by contig id at lookup
+	if (id >= exon_tree->by_id_size)
+		{
+			exon_tree->by_id = xrealloc (exon_tree->by_id,
+					(id + 1) * sizeof (IIndex *));
+			memset (exon_tree->by_id + exon_tree->by_id_size, 0,
+					(id + 1 - exon_tree->by_id_size) * sizeof (IIndex *));
+			exon_tree->bins = xrealloc (exon_tree->bins,
+					(id + 1) * sizeof (ExonBins));
+			memset (exon_tree->bins + exon_tree->by_id_size, 0,
+					(id + 1 - exon_tree->by_id_size) * sizeof (ExonBins));
+			exon_tree->by_id_size = id + 1;
+		}
+
+	exon_tree->by_id[id] = index;
+	build_bins (&exon_tree->bins[id], index);
+}
+
+static void
+build_index (ExonTree *exon_tree)
+{
+	HashIter iter;
+	IIndex *index = NULL;
+	const char *chr = NULL;
+
+	hash_iter_init (&iter, exon_tree->idx);
+	while (hash_iter_next (&iter, (void **) &chr, (void **) &index))
+		{
+			// Sort the intervals and lay the tree over them
+			iindex_build (index);
+			set_index (exon_tree, chr_std_id (exon_tree->cs, chr), index);
+		}
+}
+
+static int
+exon_tree_gene_id (ExonTree *exon_tree, const char *gene_name)
+{
+	int *id = hash_lookup (exon_tree->genes, gene_name);
+
+	// The gene dictionary is filled along
+	// with the exons
+	if (id == NULL)
+		{
+			id = xcalloc (1, sizeof (int));
+			*id = hash_size (exon_tree->genes) + 1;
+
+			hash_insert (exon_tree->genes, xstrdup (gene_name), id);
+			db_insert_gene (exon_tree->gene_stmt, *id, gene_name);
+		}
+
+	return *id;
+}
+
 ExonTree *
-exon_tree_new (sqlite3_stmt *exon_stmt,
+exon_tree_new (sqlite3_stmt *exon_stmt, sqlite3_stmt *gene_stmt,
 		sqlite3_stmt *overlapping_stmt, ChrStd *cs)
 {
-	assert (exon_stmt != NULL && overlapping_stmt != NULL
-			&& cs != NULL);
+	assert (exon_stmt != NULL && gene_stmt != NULL
+			&& overlapping_stmt != NULL && cs != NULL);
 
 	ExonTree *exon_tree = xcalloc (1, sizeof (ExonTree));
 
 	exon_tree->exon_stmt = exon_stmt;
+	exon_tree->gene_stmt = gene_stmt;
 	exon_tree->overlapping_stmt = overlapping_stmt;
 
 	exon_tree->cs = cs;
 
 	exon_tree->idx = hash_new (xfree,
-			(DestroyNotify) ibitree_free);
+			(DestroyNotify) iindex_free);
 
 	exon_tree->cache = hash_new (xfree, NULL);
+	exon_tree->genes = hash_new (xfree, xfree);
 
 	return exon_tree;
 }
@@ -64,7 +252,14 @@ exon_tree_free (ExonTree *exon_tree)
 
 	hash_free (exon_tree->idx);
 	hash_free (exon_tree->cache);
+	hash_free (exon_tree->genes);
+
+	for (int i = 0; i < exon_tree->by_id_size; i++)
+		xfree (exon_tree->bins[i].bits);
 
+	xfree (exon_tree->bins);
+	xfree (exon_tree->by_id);
+	xfree (exon_tree->ids);
 	xfree (exon_tree);
 }
 
@@ -82,7 +277,12 @@ exon_tree_index_dump (ExonTree *exon_tree,
 	gff_filter_insert_hard_attribute (filter,
 			"transcript_type", "protein_coding");
 
-	IBiTree *tree = NULL;
+	// Skip the other attributes
+	gff_filter_insert_key (filter, "gene_name");
+	gff_filter_insert_key (filter, "gene_id");
+	gff_filter_insert_key (filter, "exon_id");
+
+	IIndex *tree = NULL;
 
 	long table_id = 0;
 	long *alloc_id = NULL;
@@ -92,7 +292,7 @@ exon_tree_index_dump (ExonTree *exon_tree,
 	const char *gene_id = NULL;
 	const char *exon_id = NULL;
 	const char *exon_id_copy = NULL;
-	char strand[1];
+	char strand[2] = {};
 
 	while (gff_read_filtered (gff, entry, filter))
 		{
@@ -131,26 +331,70 @@ exon_tree_index_dump (ExonTree *exon_tree,
 
 			if (tree == NULL)
 				{
-					tree = ibitree_new (xfree);
+					tree = iindex_new (xfree);
 					hash_insert (exon_tree->idx,
 							xstrdup (chr_std), tree);
 				}
 
-			ibitree_insert (tree, entry->start, entry->end,
+			iindex_insert (tree, entry->start, entry->end,
 					alloc_id);
 
-			db_insert_exon (exon_tree->exon_stmt,
-					table_id, gene_name, chr_std, entry->start,
+			db_insert_exon (exon_tree->exon_stmt, table_id,
+					exon_tree_gene_id (exon_tree, gene_name),
+					chr_std_id (exon_tree->cs, entry->seqname), entry->start,
 					entry->end, strand, gene_id, exon_id);
 		}
 
+	build_index (exon_tree);
+
 	gff_filter_free (filter);
 	gff_entry_free (entry);
 	gff_close (gff);
 }
 
+void
+exon_tree_index (ExonTree *exon_tree, sqlite3 *db)
+{
+	assert (exon_tree != NULL && db != NULL);
+
+	sqlite3_stmt *stmt = NULL;
+	IIndex *tree = NULL;
+	long *alloc_id = NULL;
+	const char *chr = NULL;
+
+	// The exons were already standardized and
+	// dumped by a previous run
+	stmt = db_prepare (db,
+			"SELECT e.id,c.name,e.start,e.end\n"
+			"FROM exon AS e\n"
+			"INNER JOIN contig AS c\n"
+			"	ON c.id = e.chr_id");
+
+	while (db_step (stmt) == SQLITE_ROW)
+		{
+			alloc_id = xcalloc (1, sizeof (long));
+			*alloc_id = db_column_int64 (stmt, 0);
+
+			chr = db_column_text (stmt, 1);
+			tree = hash_lookup (exon_tree->idx, chr);
+
+			if (tree == NULL)
+				{
+					tree = iindex_new (xfree);
+					hash_insert (exon_tree->idx,
+							xstrdup (chr), tree);
+				}
+
+			iindex_insert (tree, db_column_int64 (stmt, 2),
+					db_column_int64 (stmt, 3), alloc_id);
+		}
+
+	build_index (exon_tree);
+	db_finalize (stmt);
+}
+
 static void
-dump_if_overlaps_exon (IBiTreeLookupData *ldata,
+dump_if_overlaps_exon (IIndexLookupData *ldata,
 		void *user_data)
 {
 	const long *exon_id = ldata->data;
@@ -161,30 +405,577 @@ dump_if_overlaps_exon (IBiTreeLookupData *ldata,
 			ldata->interval_low, ldata->interval_high, ldata->overlap_pos,
 			ldata->overlap_pos + ldata->overlap_len - 1);
 
-	db_insert_overlapping (data->tree->overlapping_stmt, *exon_id,
-			data->alignment_id, ldata->overlap_pos, ldata->overlap_len);
+	if (data->batch != NULL)
+		db_batch_add_overlapping (data->batch, *exon_id,
+				data->alignment_id, ldata->overlap_pos, ldata->overlap_len);
+	else
+		db_insert_overlapping (data->overlapping_stmt, *exon_id,
+				data->alignment_id, ldata->overlap_pos, ldata->overlap_len);
 }
 
 int
-exon_tree_lookup_dump (ExonTree *exon_tree, const char *chr,
+exon_tree_lookup_dump (ExonTree *exon_tree, int chr_id,
 		long low, long high, float exon_overlap_frac,
 		float alignment_overlap_frac, int either,
-		long alignment_id)
+		long alignment_id, sqlite3_stmt *overlapping_stmt,
+		DBBatch *batch)
 {
-	assert (exon_tree != NULL && chr != NULL);
+	assert (exon_tree != NULL);
 
 	int acm = 0;
-	IBiTree *tree = NULL;
+	IIndex *tree = NULL;
 
-	tree = hash_lookup (exon_tree->idx, chr);
+	tree = exon_tree_get (exon_tree, chr_id);
 
-	if (tree != NULL)
+	if (tree != NULL && exon_bins_test (exon_tree, chr_id, low, high))
 		{
-			ExonTreeData data = {exon_tree, alignment_id};
-			acm = ibitree_lookup (tree, low, high, exon_overlap_frac,
+			// The rows may go to a database other than the
+			// one the exons were dumped into
+			ExonTreeData data = {exon_tree, alignment_id,
+				overlapping_stmt != NULL ? overlapping_stmt : exon_tree->overlapping_stmt,
+				batch};
+			acm = iindex_lookup (tree, low, high, exon_overlap_frac,
 					alignment_overlap_frac, either, dump_if_overlaps_exon,
 					&data);
 		}
 
 	return acm;
 }
+
+static void
+count_overlapping_exon (IIndexLookupData *ldata, void *user_data)
+{
+	// Only the number of exons is wanted
+}
+
+int
+exon_tree_lookup (ExonTree *exon_tree, int chr_id,
+		long low, long high, float exon_overlap_frac,
+		float alignment_overlap_frac, int either)
+{
+	assert (exon_tree != NULL);
+
+	IIndex *tree = exon_tree_get (exon_tree, chr_id);
+
+	if (tree == NULL || !exon_bins_test (exon_tree, chr_id, low, high))
+		return 0;
+
+	return iindex_lookup (tree, low, high, exon_overlap_frac,
+			alignment_overlap_frac, either, count_overlapping_exon,
+			NULL);
+}
+
+static uint64_t
+fnv1a (uint64_t h, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	size_t i = 0;
+
+	for (; i < len; i++)
+		{
+			h ^= p[i];
+			h *= 0x100000001b3ULL;
+		}
+
+	return h;
+}
+
+static uint64_t
+exon_cache_key (const char *gff_file, ChrStd *cs)
+{
+	char buf[BUFSIZ * 8];
+	uint32_t version = EXON_CACHE_VERSION;
+	uint64_t h = 0xcbf29ce484222325ULL;
+	uint64_t alias_h = 0;
+	uint64_t entry_h = 0;
+	HashIter iter;
+	void *alias = NULL;
+	void *chr = NULL;
+	FILE *fp = NULL;
+	size_t len = 0;
+
+	h = fnv1a (h, &version, sizeof (version));
+	h = fnv1a (h, EXON_CACHE_FILTER, sizeof (EXON_CACHE_FILTER));
+
+	// The cached contigs are standardized: Another
+	// '--chr-alias' table must not reuse them. The
+	// entries are summed, whatever their order
+	hash_iter_init (&iter, cs->alias);
+
+	while (hash_iter_next (&iter, &alias, &chr))
+		{
+			entry_h = fnv1a (0xcbf29ce484222325ULL, alias, strlen (alias) + 1);
+			alias_h += fnv1a (entry_h, chr, strlen (chr) + 1);
+		}
+
+	h = fnv1a (h, &alias_h, sizeof (alias_h));
+
+	// The raw content: A compressed file is
+	// hashed without being inflated
+	fp = xfopen (gff_file, "rb");
+
+	while ((len = fread (buf, 1, sizeof (buf), fp)) > 0)
+		h = fnv1a (h, buf, len);
+
+	if (ferror (fp))
+		log_errno_fatal ("Failed to read '%s'", gff_file);
+
+	xfclose (fp);
+
+	return h;
+}
+
+static int
+exon_cache_check (const ExonCacheHeader *header,
+		const ExonCacheContig *contigs, const ExonCacheGene *genes,
+		const ExonCacheRecord *rec, const char *pool)
+{
+	uint64_t pool_size = header->pool_size;
+	uint64_t num_nodes = 0;
+	uint64_t i = 0;
+
+	// Every string ends inside the pool
+	if (header->num_contigs + header->num_genes + header->num_exons > 0
+			&& (pool_size == 0 || pool[pool_size - 1] != '\0'))
+		return 0;
+
+	// The contigs share all the nodes out
+	for (i = 0; i < header->num_contigs; i++)
+		{
+			if (contigs[i].name >= pool_size
+					|| contigs[i].num_nodes > header->num_exons - num_nodes)
+				return 0;
+
+			num_nodes += contigs[i].num_nodes;
+		}
+
+	if (num_nodes != header->num_exons)
+		return 0;
+
+	for (i = 0; i < header->num_genes; i++)
+		{
+			if (genes[i].name >= pool_size)
+				return 0;
+		}
+
+	for (i = 0; i < header->num_exons; i++, rec++)
+		{
+			if (rec->contig >= header->num_contigs
+					|| rec->strand >= pool_size
+					|| rec->gene_id >= pool_size
+					|| rec->exon_id >= pool_size)
+				return 0;
+		}
+
+	return 1;
+}
+
+static int
+exon_cache_load (ExonTree *exon_tree, const char *path,
+		uint64_t key)
+{
+	const ExonCacheHeader *header = NULL;
+	const ExonCacheContig *contigs = NULL;
+	const ExonCacheNode *node = NULL;
+	const ExonCacheGene *genes = NULL;
+	const ExonCacheRecord *rec = NULL;
+	const char *pool = NULL;
+	void *map = NULL;
+	struct stat st;
+	IIndex *tree = NULL;
+	IIndexNode *nodes = NULL;
+	int *chr_ids = NULL;
+	int *gene_id = NULL;
+	long *ids = NULL;
+	uint64_t size = 0;
+	uint64_t i = 0;
+	uint64_t j = 0;
+	int fd = 0;
+
+	fd = open (path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	if (fstat (fd, &st) < 0 || st.st_size < (off_t) sizeof (ExonCacheHeader))
+		{
+			close (fd);
+			return 0;
+		}
+
+	map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+
+	if (map == MAP_FAILED)
+		return 0;
+
+	header = map;
+	size = st.st_size;
+
+	// A cache from another version, annotation or
+	// a truncated file. It will be rebuilt
+	if (memcmp (header->magic, EXON_CACHE_MAGIC, sizeof (header->magic))
+			|| header->version != EXON_CACHE_VERSION
+			|| header->key != key
+			|| header->num_contigs > size / sizeof (ExonCacheContig)
+			|| header->num_genes > size / sizeof (ExonCacheGene)
+			|| header->num_exons > size / (sizeof (ExonCacheNode) + sizeof (ExonCacheRecord))
+			|| header->pool_size > size
+			|| size != sizeof (ExonCacheHeader)
+				+ header->num_contigs * sizeof (ExonCacheContig)
+				+ header->num_exons * sizeof (ExonCacheNode)
+				+ header->num_genes * sizeof (ExonCacheGene)
+				+ header->num_exons * sizeof (ExonCacheRecord)
+				+ header->pool_size)
+		{
+			log_warn ("Ignore stale annotation cache '%s'", path);
+			munmap (map, st.st_size);
+			return 0;
+		}
+
+	contigs = (const ExonCacheContig *) (header + 1);
+	node = (const ExonCacheNode *) (contigs + header->num_contigs);
+	genes = (const ExonCacheGene *) (node + header->num_exons);
+	rec = (const ExonCacheRecord *) (genes + header->num_genes);
+	pool = (const char *) (rec + header->num_exons);
+
+	// A corrupted cache of the right size
+	// must not lead to reads beyond the pool
+	if (!exon_cache_check (header, contigs, genes, rec, pool))
+		{
+			log_warn ("Ignore corrupted annotation cache '%s'", path);
+			munmap (map, st.st_size);
+			return 0;
+		}
+
+	// The exon ids of all the contigs live in
+	// a single block, owned by the tree
+	ids = xcalloc (header->num_exons + 1, sizeof (long));
+	xfree (exon_tree->ids);
+	exon_tree->ids = ids;
+
+	chr_ids = xcalloc (header->num_contigs + 1, sizeof (int));
+
+	// The nodes are already sorted and the tree laid
+	// over them: They are copied as they are
+	for (i = 0; i < header->num_contigs; i++)
+		{
+			nodes = xcalloc (contigs[i].num_nodes, sizeof (IIndexNode));
+
+			for (j = 0; j < contigs[i].num_nodes; j++, node++, ids++)
+				{
+					*ids = node->id;
+					nodes[j] = (IIndexNode) {
+						.low  = node->low,
+						.high = node->high,
+						.max  = node->max,
+						.data = ids
+					};
+				}
+
+			tree = iindex_new (NULL);
+			iindex_load (tree, nodes, contigs[i].num_nodes);
+
+			hash_insert (exon_tree->idx,
+					xstrdup (pool + contigs[i].name), tree);
+
+			chr_ids[i] = chr_std_id (exon_tree->cs, pool + contigs[i].name);
+			set_index (exon_tree, chr_ids[i], tree);
+		}
+
+	for (i = 0; i < header->num_genes; i++)
+		{
+			gene_id = xcalloc (1, sizeof (int));
+			*gene_id = genes[i].id;
+
+			hash_insert (exon_tree->genes, xstrdup (pool + genes[i].name),
+					gene_id);
+			db_insert_gene (exon_tree->gene_stmt, *gene_id,
+					pool + genes[i].name);
+		}
+
+	// The ids are resolved: Each row is just
+	// bound and stepped, within the transaction
+	// of the caller
+	for (i = 0; i < header->num_exons; i++, rec++)
+		{
+			db_insert_exon (exon_tree->exon_stmt, rec->id,
+					rec->gene_name_id, chr_ids[rec->contig], rec->start,
+					rec->end, pool + rec->strand, pool + rec->gene_id,
+					pool + rec->exon_id);
+		}
+
+	xfree (chr_ids);
+	munmap (map, st.st_size);
+
+	return 1;
+}
+
+static uint32_t
+pool_add (char **pool, size_t *len, size_t *alloc,
+		const char *str)
+{
+	size_t size = strlen (str) + 1;
+	uint32_t offset = *len;
+
+	if (*len + size > *alloc)
+		{
+			*alloc = nearest_pow (*len + size);
+			*pool = xrealloc (*pool, *alloc);
+		}
+
+	memcpy (*pool + *len, str, size);
+	*len += size;
+
+	return offset;
+}
+
+static void
+exon_cache_save (ExonTree *exon_tree, const char *path,
+		const char *cache_dir, uint64_t key)
+{
+	sqlite3_stmt *stmt = NULL;
+	ExonCacheHeader header = {};
+	ExonCacheContig *contigs = NULL;
+	ExonCacheNode *nodes = NULL;
+	ExonCacheGene *genes = NULL;
+	ExonCacheRecord *recs = NULL;
+	const IIndex *index = NULL;
+	HashIter iter;
+	void *gene_name = NULL;
+	void *gene_id = NULL;
+	int *contig_of = NULL;
+	size_t num_contigs = 0;
+	size_t num_genes = 0;
+	size_t num_exons = 0;
+	size_t num_nodes = 0;
+	char *pool = NULL;
+	size_t pool_len = 0;
+	size_t pool_alloc = 0;
+	char *tmp_path = NULL;
+	FILE *fp = NULL;
+	long i = 0;
+	int id = 0;
+	int fd = 0;
+
+	for (id = 0; id < exon_tree->by_id_size; id++)
+		if (exon_tree->by_id[id] != NULL)
+			num_nodes += iindex_size (exon_tree->by_id[id]);
+
+	contigs = xcalloc (exon_tree->by_id_size + 1, sizeof (ExonCacheContig));
+	contig_of = xcalloc (exon_tree->by_id_size + 1, sizeof (int));
+	nodes = xcalloc (num_nodes + 1, sizeof (ExonCacheNode));
+	recs = xcalloc (num_nodes + 1, sizeof (ExonCacheRecord));
+	genes = xcalloc (hash_size (exon_tree->genes) + 1, sizeof (ExonCacheGene));
+
+	// The indexes as built, so that
+	// the next run needs no sorting
+	for (id = 0, num_nodes = 0; id < exon_tree->by_id_size; id++)
+		{
+			index = exon_tree->by_id[id];
+			if (index == NULL)
+				continue;
+
+			contig_of[id] = num_contigs;
+			contigs[num_contigs++] = (ExonCacheContig) {
+				.name      = pool_add (&pool, &pool_len, &pool_alloc,
+						chr_std_name (exon_tree->cs, id)),
+				.num_nodes = iindex_size (index)
+			};
+
+			for (i = 0; i < iindex_size (index); i++)
+				nodes[num_nodes++] = (ExonCacheNode) {
+					.low  = index->nodes[i].low,
+					.high = index->nodes[i].high,
+					.max  = index->nodes[i].max,
+					.id   = * (long *) index->nodes[i].data
+				};
+		}
+
+	hash_iter_init (&iter, exon_tree->genes);
+
+	while (hash_iter_next (&iter, &gene_name, &gene_id))
+		genes[num_genes++] = (ExonCacheGene) {
+			.id   = * (int *) gene_id,
+			.name = pool_add (&pool, &pool_len, &pool_alloc, gene_name)
+		};
+
+	// The contigs are not dumped yet
+	stmt = db_prepare (sqlite3_db_handle (exon_tree->exon_stmt),
+			"SELECT id,gene_name_id,chr_id,start,end,strand,ensg,ense\n"
+			"FROM exon\n"
+			"ORDER BY id");
+
+	while (db_step (stmt) == SQLITE_ROW && num_exons < num_nodes)
+		{
+			id = db_column_int (stmt, 2);
+			assert (id < exon_tree->by_id_size && exon_tree->by_id[id] != NULL);
+
+			recs[num_exons++] = (ExonCacheRecord) {
+				.id           = db_column_int64 (stmt, 0),
+				.gene_name_id = db_column_int (stmt, 1),
+				.contig       = contig_of[id],
+				.start        = db_column_int64 (stmt, 3),
+				.end          = db_column_int64 (stmt, 4),
+				.strand       = pool_add (&pool, &pool_len, &pool_alloc, db_column_text (stmt, 5)),
+				.gene_id      = pool_add (&pool, &pool_len, &pool_alloc, db_column_text (stmt, 6)),
+				.exon_id      = pool_add (&pool, &pool_len, &pool_alloc, db_column_text (stmt, 7))
+			};
+		}
+
+	db_finalize (stmt);
+
+	// Each exon is a node of some index
+	assert (num_exons == num_nodes);
+
+	memcpy (header.magic, EXON_CACHE_MAGIC, sizeof (header.magic));
+	header.version = EXON_CACHE_VERSION;
+	header.key = key;
+	header.num_contigs = num_contigs;
+	header.num_genes = num_genes;
+	header.num_exons = num_exons;
+	header.pool_size = pool_len;
+
+	// Concurrent runs may share the cache:
+	// Write it aside and rename it atomically
+	xasprintf (&tmp_path, "%s/%s", cache_dir, EXON_CACHE_TEMPLATE);
+
+	// mkstemp creates it readable only by the owner
+	fd = mkstemp (tmp_path);
+	if (fd < 0 || fchmod (fd, 0644) < 0
+			|| (fp = fdopen (fd, "wb")) == NULL)
+		{
+			log_errno_error ("Failed to create annotation cache at '%s'",
+					cache_dir);
+			if (fd >= 0)
+				{
+					close (fd);
+					unlink (tmp_path);
+				}
+			goto Exit;
+		}
+
+	if (fwrite (&header, sizeof (header), 1, fp) != 1
+			|| fwrite (contigs, sizeof (ExonCacheContig), num_contigs, fp) != num_contigs
+			|| fwrite (nodes, sizeof (ExonCacheNode), num_exons, fp) != num_exons
+			|| fwrite (genes, sizeof (ExonCacheGene), num_genes, fp) != num_genes
+			|| fwrite (recs, sizeof (ExonCacheRecord), num_exons, fp) != num_exons
+			|| fwrite (pool, 1, pool_len, fp) != pool_len
+			|| fclose (fp) != 0
+			|| rename (tmp_path, path) < 0)
+		{
+			log_errno_error ("Failed to write annotation cache '%s'", path);
+			unlink (tmp_path);
+			goto Exit;
+		}
+
+	log_info ("Cache annotation into '%s'", path);
+
+Exit:
+	xfree (tmp_path);
+	xfree (contigs);
+	xfree (contig_of);
+	xfree (nodes);
+	xfree (genes);
+	xfree (recs);
+	xfree (pool);
+}
+
+void
+exon_tree_index_dump_cached (ExonTree *exon_tree,
+		const char *gff_file, const char *cache_dir)
+{
+	assert (exon_tree != NULL && gff_file != NULL
+			&& cache_dir != NULL);
+
+	uint64_t key = 0;
+	char *path = NULL;
+
+	key = exon_cache_key (gff_file, exon_tree->cs);
+	xasprintf (&path, "%s/exon-%016" PRIx64 ".sidx", cache_dir, key);
+
+	if (exon_cache_load (exon_tree, path, key))
+		{
+			log_info ("Load annotation '%s' from cache '%s'", gff_file, path);
+			goto Exit;
+		}
+
+	log_info ("Index annotation file '%s'", gff_file);
+	exon_tree_index_dump (exon_tree, gff_file);
+
+	mkdir_p (cache_dir);
+	exon_cache_save (exon_tree, path, cache_dir, key);
+
+Exit:
+	xfree (path);
+}
+
+ExonCursor *
+exon_cursor_new (ExonTree *exon_tree)
+{
+	assert (exon_tree != NULL);
+
+	ExonCursor *cursor = xcalloc (1, sizeof (ExonCursor));
+
+	cursor->exon_tree = exon_tree;
+	cursor->size = exon_tree->by_id_size;
+	cursor->cursors = xcalloc (cursor->size + 1,
+			sizeof (IIndexCursor *));
+
+	return cursor;
+}
+
+void
+exon_cursor_free (ExonCursor *cursor)
+{
+	if (cursor == NULL)
+		return;
+
+	int i = 0;
+
+	for (; i < cursor->size; i++)
+		iindex_cursor_free (cursor->cursors[i]);
+
+	xfree (cursor->cursors);
+	xfree (cursor);
+}
+
+int
+exon_cursor_lookup_dump (ExonCursor *cursor, int chr_id,
+		long low, long high, float exon_overlap_frac,
+		float alignment_overlap_frac, int either,
+		long alignment_id, sqlite3_stmt *overlapping_stmt,
+		DBBatch *batch)
+{
+	assert (cursor != NULL);
+
+	IIndexCursor *icursor = NULL;
+	IIndex *tree = NULL;
+
+	// No exon at this chromosome
+	if (chr_id < 0 || chr_id >= cursor->size)
+		return 0;
+
+	tree = exon_tree_get (cursor->exon_tree, chr_id);
+
+	// Nor near the alignment. The cursor
+	// catches up at the next exonic one
+	if (tree == NULL
+			|| !exon_bins_test (cursor->exon_tree, chr_id, low, high))
+		return 0;
+
+	icursor = cursor->cursors[chr_id];
+
+	if (icursor == NULL)
+		{
+			icursor = iindex_cursor_new (tree);
+			cursor->cursors[chr_id] = icursor;
+		}
+
+	ExonTreeData data = {cursor->exon_tree, alignment_id,
+		overlapping_stmt != NULL ? overlapping_stmt : cursor->exon_tree->overlapping_stmt,
+		batch};
+
+	return iindex_cursor_lookup (icursor, low, high, exon_overlap_frac,
+			alignment_overlap_frac, either, dump_if_overlaps_exon,
+			&data);
+}
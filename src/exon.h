@@ -19,31 +19,93 @@
 #ifndef EXON_H
 #define EXON_H
 
+#include <stdint.h>
 #include "hash.h"
+#include "iindex.h"
 #include "chr.h"
 #include "db.h"
+#include "db_writer.h"
+
+/*
+ * Bins of EXON_BIN_SIZE bases of a contig, with
+ * one bit set for each bin touched by some exon:
+ * Most alignments fall far from any exon and are
+ * rejected before the interval lookup
+ */
+#define EXON_BIN_SHIFT 10
+#define EXON_BIN_SIZE  (1L << EXON_BIN_SHIFT)
+
+struct _ExonBins
+{
+	uint64_t     *bits;
+	long          len;
+};
+
+typedef struct _ExonBins ExonBins;
 
 struct _ExonTree
 {
 	Hash         *idx;
 	Hash         *cache;
+	Hash         *genes;
 	sqlite3_stmt *exon_stmt;
+	sqlite3_stmt *gene_stmt;
 	sqlite3_stmt *overlapping_stmt;
 	ChrStd       *cs;
+	IIndex      **by_id;
+	ExonBins     *bins;
+	long         *ids;
+	int           by_id_size;
 };
 
 typedef struct _ExonTree ExonTree;
 
-ExonTree * exon_tree_new (sqlite3_stmt *exon_stmt,
+/*
+ * Per-thread overlap cursors, one for each
+ * chromosome, for alignments that come sorted
+ * by coordinate
+ */
+struct _ExonCursor
+{
+	ExonTree     *exon_tree;
+	IIndexCursor **cursors;
+	int           size;
+};
+
+typedef struct _ExonCursor ExonCursor;
+
+ExonTree * exon_tree_new (sqlite3_stmt *exon_stmt, sqlite3_stmt *gene_stmt,
 		sqlite3_stmt *overlapping_stmt, ChrStd *cs);
 
 void exon_tree_free (ExonTree *exon_tree);
 
 void exon_tree_index_dump (ExonTree *exon_tree, const char *gff_file);
+void exon_tree_index      (ExonTree *exon_tree, sqlite3 *db);
+
+void exon_tree_index_dump_cached (ExonTree *exon_tree, const char *gff_file,
+		const char *cache_dir);
+
+int exon_tree_lookup_dump (ExonTree *exon_tree, int chr_id,
+		long low, long high, float exon_overlap_frac,
+		float alignment_overlap_frac, int either,
+		long alignment_id, sqlite3_stmt *overlapping_stmt,
+		DBBatch *batch);
 
-int exon_tree_lookup_dump (ExonTree *exon_tree, const char *chr,
+// The same overlap test, with nothing dumped
+int exon_tree_lookup (ExonTree *exon_tree, int chr_id,
+		long low, long high, float exon_overlap_frac,
+		float alignment_overlap_frac, int either);
+
+ExonCursor * exon_cursor_new  (ExonTree *exon_tree);
+void         exon_cursor_free (ExonCursor *cursor);
+
+int exon_cursor_lookup_dump (ExonCursor *cursor, int chr_id,
 		long low, long high, float exon_overlap_frac,
 		float alignment_overlap_frac, int either,
-		long alignment_id);
+		long alignment_id, sqlite3_stmt *overlapping_stmt,
+		DBBatch *batch);
+
+// The exons of a standardized contig id
+#define exon_tree_get(t,id) ((id) < 0 || (id) >= (t)->by_id_size ? NULL : (t)->by_id[id])
 
 #endif /* exon.h */
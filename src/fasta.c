@@ -62,7 +62,9 @@ fasta_open_for_reading (const char *path)
 	fasta = xcalloc (1, sizeof (FastaFile));
 	fasta->gz = gz_open_for_reading (path);
 
-	gzbuffer (gz_get_fp (fasta->gz), GZ_BUFSIZ);
+	// BGZF input is buffered by htslib
+	if (!gz_is_bgzf (fasta->gz))
+		gzbuffer (gz_get_fp (fasta->gz), GZ_BUFSIZ);
 
 	return fasta;
 }
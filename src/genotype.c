@@ -25,16 +25,19 @@
 #include "db.h"
 #include "log.h"
 #include "chr.h"
-#include "ibitree.h"
+#include "iindex.h"
 #include "hash.h"
 #include "array.h"
+#include "utils.h"
 #include "list.h"
 #include "thpool.h"
+#include "sam.h"
 #include "genotype.h"
 
 struct _Region
 {
 	const char *chr;
+	int         chr_id;
 
 	long        window_start;
 	long        window_end;
@@ -82,13 +85,14 @@ struct _CrossWindowLinear
 typedef struct _CrossWindowLinear CrossWindowLinear;
 
 static Region *
-region_new (const char *chr, const long window_start,
+region_new (const char *chr, const int chr_id, const long window_start,
 		const long window_end, const long insertion_point)
 {
 	Region *r = xcalloc (1, sizeof (Region));
 
 	*r = (Region) {
 		.chr             = xstrdup (chr),
+		.chr_id          = chr_id,
 		.window_start    = window_start,
 		.window_end      = window_end,
 		.insertion_point = insertion_point
@@ -169,7 +173,7 @@ clean_genotype_table (sqlite3 *db)
 }
 
 static Hash *
-genotype_index_retrocopy (sqlite3 *db)
+genotype_index_retrocopy (sqlite3 *db, ChrStd *cs)
 {
 	log_trace ("Inside %s", __func__);
 
@@ -187,8 +191,10 @@ genotype_index_retrocopy (sqlite3 *db)
 	long insertion_point = 0;
 
 	const char sql[] =
-		"SELECT id, chr, window_start, window_end, insertion_point\n"
-		"FROM retrocopy";
+		"SELECT r.id, c.name, window_start, window_end, insertion_point\n"
+		"FROM retrocopy AS r\n"
+		"INNER JOIN contig AS c\n"
+		"	ON c.id = r.chr_id";
 
 	log_debug ("Query schema:\n%s", sql);
 	stmt = db_prepare (db, sql);
@@ -204,8 +210,8 @@ genotype_index_retrocopy (sqlite3 *db)
 			window_end      = db_column_int64 (stmt, 3);
 			insertion_point = db_column_int64 (stmt, 4);
 
-			r = region_new (chr, window_start, window_end,
-					insertion_point);
+			r = region_new (chr, chr_std_id (cs, chr), window_start,
+					window_end, insertion_point);
 
 			id = xcalloc (1, sizeof (int));
 			*id = retrocopy_id;
@@ -382,32 +388,6 @@ genotype_index_zygosity_data (sqlite3 *db, Hash *retrocopy_h)
 	return zi;
 }
 
-static Hash *
-chr_std2tid (ChrStd *cs, const bam_hdr_t *hdr)
-{
-	log_trace ("Inside %s", __func__);
-
-	Hash *chr_tid = NULL;
-	const char *chr_std = NULL;
-	int *tid_copy = NULL;
-	int tid = 0;
-
-	chr_tid = hash_new_full (str_hash, str_equal,
-			NULL, xfree);
-
-	for (; tid < hdr->n_targets; tid++)
-		{
-			chr_std = chr_std_lookup (cs, hdr->target_name[tid]);
-
-			tid_copy = xcalloc (1, sizeof (int));
-			*tid_copy = tid;
-
-			hash_insert (chr_tid, chr_std, tid_copy);
-		}
-
-	return chr_tid;
-}
-
 static inline void
 calculate_align_start_end (const bam1_t *align, long *start, long *end)
 {
@@ -459,23 +439,21 @@ cross_insertion_point (const bam1_t *align, const long insertion_point,
 		&& (insertion_point + half_decil) <= end;
 }
 
-static Hash *
-index_region (const List *genotype, Hash *chr_tid)
+static IIndex **
+index_region (const List *genotype, const ChrTable *ct)
 {
 	log_trace ("Inside %s", __func__);
 
-	Hash *ir = NULL;
+	IIndex **ir = NULL;
 
-	IBiTree *tree = NULL;
 	ListElmt *cur = NULL;
 
 	Genotype *g = NULL;
 	Region *r = NULL;
-	const int *tid = NULL;
+	int tid = 0;
 
 	// Init TID => TREE
-	ir = hash_new_full (int_hash, int_equal,
-			NULL, (DestroyNotify) ibitree_free);
+	ir = xcalloc (ct->size + 1, sizeof (IIndex *));
 
 	cur = list_head (genotype);
 	for (; cur != NULL; cur = list_next (cur))
@@ -484,25 +462,25 @@ index_region (const List *genotype, Hash *chr_tid)
 			r = g->region;
 
 			// Get standardized tid
-			tid = hash_lookup (chr_tid, r->chr);
-			if (tid == NULL)
+			tid = chr_table_tid (ct, r->chr_id);
+			if (tid < 0)
 				{
 					log_warn ("No %s contig from retrocopy [%d] found in SAM header",
 							r->chr, g->retrocopy_id);
 					continue;
 				}
 
-			tree = hash_lookup (ir, tid);
-			if (tree == NULL)
-				{
-					tree = ibitree_new (NULL);
-					hash_insert (ir, tid, tree);
-				}
+			if (ir[tid] == NULL)
+				ir[tid] = iindex_new (NULL);
 
-			ibitree_insert (tree, r->window_start,
+			iindex_insert (ir[tid], r->window_start,
 					r->window_end, g);
 		}
 
+	for (tid = 0; tid < ct->size; tid++)
+		if (ir[tid] != NULL)
+			iindex_build (ir[tid]);
+
 	return ir;
 }
 
@@ -525,7 +503,7 @@ dump_genotype (sqlite3_stmt *stmt, const Genotype *g)
 }
 
 static void
-cross_window (IBiTreeLookupData *ldata, void *user_data)
+cross_window (IIndexLookupData *ldata, void *user_data)
 {
 	const CrossWindowLinear *c = user_data;
 	Genotype *g = ldata->data;
@@ -541,13 +519,13 @@ cross_window (IBiTreeLookupData *ldata, void *user_data)
 
 static void
 zygosity_linear_search (samFile *fp, bam_hdr_t *hdr, bam1_t *align,
-		ZygosityData *zd, Hash *chr_tid)
+		ZygosityData *zd, const ChrTable *ct)
 {
 	log_trace ("Inside %s", __func__);
 
 	// Indexed regions: TID => TREE
-	Hash *ir = NULL;
-	IBiTree *tree = NULL;
+	IIndex **ir = NULL;
+	IIndex *tree = NULL;
 
 	Genotype *g = NULL;
 	ListElmt *cur = NULL;
@@ -560,18 +538,21 @@ zygosity_linear_search (samFile *fp, bam_hdr_t *hdr, bam1_t *align,
 	int rc = 0;
 
 	// Index all retrocopies into a tree by chr
-	ir = index_region (zd->genotype, chr_tid);
+	ir = index_region (zd->genotype, ct);
 
 	while ((rc = sam_read1 (fp, hdr, align)) >= 0)
 		{
-			tree = hash_lookup (ir, &align->core.tid);
+			if (align->core.tid < 0)
+				continue;
+
+			tree = ir[align->core.tid];
 			if (tree == NULL)
 				continue;
 
 			calculate_align_start_end (align, &start, &end);
 			c.align = align;
 
-			ibitree_lookup (tree, start, end,
+			iindex_lookup (tree, start, end,
 					-1, -1, 0, cross_window, &c);
 		}
 
@@ -585,12 +566,15 @@ zygosity_linear_search (samFile *fp, bam_hdr_t *hdr, bam1_t *align,
 			dump_genotype (zd->stmt, g);
 		}
 
-	hash_free (ir);
+	for (rc = 0; rc < ct->size; rc++)
+		iindex_free (ir[rc]);
+
+	xfree (ir);
 }
 
 static void
 zygosity_indexed_search (samFile *fp, bam_hdr_t *hdr, bam1_t *align,
-		hts_idx_t *idx, ZygosityData *zd, Hash *chr_tid)
+		hts_idx_t *idx, ZygosityData *zd, const ChrTable *ct)
 {
 	log_trace ("Inside %s", __func__);
 
@@ -601,7 +585,7 @@ zygosity_indexed_search (samFile *fp, bam_hdr_t *hdr, bam1_t *align,
 
 	ListElmt *cur = NULL;
 
-	const int *tid = NULL;
+	int tid = 0;
 	int *q = NULL;
 	int rc = 0;
 
@@ -612,12 +596,19 @@ zygosity_indexed_search (samFile *fp, bam_hdr_t *hdr, bam1_t *align,
 			r = g->region;
 
 			// Get standardized tid
-			tid = hash_lookup (chr_tid, r->chr);
+			tid = chr_table_tid (ct, r->chr_id);
+			if (tid < 0)
+				{
+					log_warn ("No %s contig from retrocopy [%d] found in SAM header",
+							r->chr, g->retrocopy_id);
+					dump_genotype (zd->stmt, g);
+					continue;
+				}
 
 			// Query position CHR:START-END
 			// START is 0-based
 			// END is 1-based
-			itr = sam_itr_queryi (idx, *tid,
+			itr = sam_itr_queryi (idx, tid,
 					r->window_start - 1, r->window_end);
 
 			if (itr == NULL)
@@ -654,7 +645,7 @@ zygosity (ZygosityData *zd)
 
 	hts_idx_t *idx = NULL;
 
-	Hash *chr_tid = NULL;
+	ChrTable *ct = NULL;
 
 	// Open BAM file for reading
 	fp = sam_open (zd->path, "rb");
@@ -666,13 +657,18 @@ zygosity (ZygosityData *zd)
 	if (hdr == NULL)
 		log_fatal ("Failed to read sam header");
 
+	// Only the position and the quality
+	// of the alignment are needed
+	sam_set_required_fields (fp, SAM_FLAG|SAM_RNAME|SAM_POS
+			|SAM_MAPQ|SAM_CIGAR, zd->path);
+
 	// And allocate BAM align entry
 	align = bam_init1 ();
 	if (align == NULL)
 		log_errno_fatal ("Failed to create bam_init1");
 
 	// Get standardized tid
-	chr_tid = chr_std2tid (zd->cs, hdr);
+	ct = chr_table_new (zd->cs, hdr->n_targets, hdr->target_name);
 
 	// Look for the index
 	idx = sam_index_load (fp, zd->path);
@@ -680,48 +676,58 @@ zygosity (ZygosityData *zd)
 	if (idx == NULL)
 		{
 			log_warn ("Failed to open BAM/CRAM INDEX for '%s'. Make a linear search", zd->path);
-			zygosity_linear_search (fp, hdr, align, zd, chr_tid);
+			zygosity_linear_search (fp, hdr, align, zd, ct);
 		}
 	else
 		{
 			log_info ("Open BAM/CRAM INDEX for '%s'. Make an indexed search", zd->path);
-			zygosity_indexed_search (fp, hdr, align, idx, zd, chr_tid);
+			zygosity_indexed_search (fp, hdr, align, idx, zd, ct);
 		}
 
 	if (sam_close (fp) < 0)
 		log_errno_fatal ("Failed to close '%s'", zd->path);
 
-	hash_free (chr_tid);
+	chr_table_free (ct);
 	hts_idx_destroy (idx);
 	bam_hdr_destroy (hdr);
 	bam_destroy1 (align);
 }
 
+static int
+cmp_zygosity_size (const void *p1, const void *p2)
+{
+	long s1 = file_size ((* (ZygosityData * const *) p1)->path);
+	long s2 = file_size ((* (ZygosityData * const *) p2)->path);
+
+	// Largest first
+	return (s1 < s2) - (s1 > s2);
+}
+
 void
-genotype (sqlite3_stmt *genotype_stmt, int threads, int phred_quality)
+genotype (sqlite3_stmt *genotype_stmt, ChrStd *cs, int threads,
+		int phred_quality)
 {
 	log_trace ("Inside %s", __func__);
 	assert (genotype_stmt != NULL
+			&& cs != NULL
 			&& threads > 0
 			&& phred_quality >= 0);
 
 	sqlite3 *db = NULL;
 	threadpool thpool = NULL;
 
-	ChrStd *cs = NULL;
 	Hash *retrocopy_h, *zygosity_h;
 	retrocopy_h = zygosity_h = NULL;
 
 	HashIter itr = {};
 	const char *path = NULL;
 	ZygosityData *zd = NULL;
+	Array *jobs = NULL;
+	int i = 0;
 
 	// Get DB handle
 	db = sqlite3_db_handle (genotype_stmt);
 
-	// Necessary for get the right chr tid
-	cs = chr_std_new ();
-
 	// Alloc n threads into the pool
 	thpool = thpool_init (threads);
 
@@ -731,26 +737,38 @@ genotype (sqlite3_stmt *genotype_stmt, int threads, int phred_quality)
 	log_info ("Index all retrocopies");
 
 	// RETROCOPY_ID => REGION
-	retrocopy_h = genotype_index_retrocopy (db);
+	retrocopy_h = genotype_index_retrocopy (db, cs);
 
 	log_info ("Index all SAM/BAM/CRAM path => retrocopy relationship");
 
 	// PATH => @ZYGOSITYDATA
 	zygosity_h = genotype_index_zygosity_data (db, retrocopy_h);
 
+	jobs = array_new (NULL);
+
 	// Iterator through paths
 	hash_iter_init (&itr, zygosity_h);
 
 	while (hash_iter_next (&itr, (void **) &path, (void **) &zd))
 		{
-			log_debug ("Look for retrocopies zygosity of file '%s'", path);
-
 			// Don't forget to give chromosome standardization and
 			// genotype statement
 			zd->cs = cs;
 			zd->stmt = genotype_stmt;
 			zd->phred_quality = phred_quality;
 
+			array_add (jobs, zd);
+		}
+
+	// The largest files first, so that the last
+	// thread running does not hold a big file
+	array_sort (jobs, cmp_zygosity_size);
+
+	for (i = 0; i < array_len (jobs); i++)
+		{
+			zd = array_get (jobs, i);
+			log_debug ("Look for retrocopies zygosity of file '%s'", zd->path);
+
 			// Let's rock!
 			thpool_add_work (thpool, (void *) zygosity, (void *) zd);
 		}
@@ -760,7 +778,7 @@ genotype (sqlite3_stmt *genotype_stmt, int threads, int phred_quality)
 
 	// Clean up
 	thpool_destroy (thpool);
-	chr_std_free (cs);
+	array_free (jobs, 1);
 	hash_free (retrocopy_h);
 	hash_free (zygosity_h);
 }
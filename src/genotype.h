@@ -20,7 +20,9 @@
 #define GENOTYPE_H
 
 #include "db.h"
+#include "chr.h"
 
-void genotype (sqlite3_stmt *genotype_stmt, int threads, int phred_quality);
+void genotype (sqlite3_stmt *genotype_stmt, ChrStd *cs, int threads,
+		int phred_quality);
 
 #endif /* genotype.h */
@@ -201,115 +201,143 @@ gff_attribute_find (const GffEntry *entry, const char *key)
 	return value;
 }
 
-int
-gff_read (GffFile *gff, GffEntry *entry)
+static const char *field_names[] =
 {
-	assert (gff != NULL && entry != NULL);
+	"seqname", "source", "feature", "start",
+	"end", "score", "strand", "frame"
+};
 
-	int rc, i;
-	char *token, *subtoken;
-	char *attr_key, *attr_value;
-	char *saveptr1, *saveptr2, *saveptr3;
+#define GFF_NUM_FIELDS 8
 
-	token = subtoken = attr_key = attr_value = NULL;
-	saveptr1 = saveptr2 = saveptr3 = NULL;
-
-	// end of file
-	if (gff->eof)
-		return 0;
+/*
+ * Slice the current line in place: 'fields' point
+ * into 'gff->buf' and the attributes are left raw
+ */
+static char *
+split_fields (GffFile *gff, GffEntry *entry, char **fields)
+{
+	char *saveptr = NULL;
+	int i = 0;
 
 	gff->buf = chomp (gff->buf);
 	entry->num_line = gz_get_num_line (gff->gz);
 
-	token = strtok_r (gff->buf, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'seqname' (field 1) at line %zu", entry->num_line);
+	for (i = 0; i < GFF_NUM_FIELDS; i++)
+		{
+			fields[i] = strtok_r (i == 0 ? gff->buf : NULL, "\t", &saveptr);
+			if (fields[i] == NULL)
+				log_fatal ("missing '%s' (field %d) at line %zu",
+						field_names[i], i + 1, entry->num_line);
+		}
 
-	entry->seqname_size = entry_set (&entry->seqname,
-			entry->seqname_size, token);
+	return strtok_r (NULL, "", &saveptr);
+}
 
-	token = strtok_r (NULL, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'source' (field 2) at line %zu", entry->num_line);
+static void
+set_fields (GffEntry *entry, char **fields)
+{
+	entry->seqname_size = entry_set (&entry->seqname,
+			entry->seqname_size, fields[0]);
 
 	entry->source_size = entry_set (&entry->source,
-			entry->source_size, token);
-
-	token = strtok_r (NULL, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'feature' (field 3) at line %zu", entry->num_line);
+			entry->source_size, fields[1]);
 
 	entry->feature_size = entry_set (&entry->feature,
-			entry->feature_size, token);
+			entry->feature_size, fields[2]);
 
-	token = strtok_r (NULL, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'start' (field 4) at line %zu", entry->num_line);
+	entry->start = atol (fields[3]);
+	entry->end = atol (fields[4]);
 
-	entry->start = atol (token);
+	entry->score = strcmp (fields[5], ".")
+		? atof (fields[5])
+		: -1;
 
-	token = strtok_r (NULL, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'end' (field 5) at line %zu", entry->num_line);
+	entry->strand = *fields[6];
 
-	entry->end = atol (token);
+	entry->frame = strcmp (fields[7], ".")
+		? atoi (fields[7])
+		: -1 ;
+}
 
-	token = strtok_r (NULL, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'score' (field 6) at line %zu", entry->num_line);
+static inline int
+is_selected_key (const GffFilter *filter, const char *key)
+{
+	const ListElmt *cur = NULL;
 
-	entry->score = strcmp (token, ".")
-		? atof (token)
-		: -1;
+	// Just a few keys: Cheaper than hashing
+	for (cur = list_head (set_list (filter->keys)); cur != NULL;
+			cur = list_next (cur))
+		if (!strcmp (list_data (cur), key))
+			return 1;
 
-	token = strtok_r (NULL, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'strand' (field 7) at line %zu", entry->num_line);
+	return 0;
+}
 
-	entry->strand = *token;
+/*
+ * If the filter selects the keys, only their first
+ * occurrence is copied into the entry, and the scan
+ * stops as soon as all of them were found
+ */
+static void
+set_attributes (GffEntry *entry, char *attributes,
+		const GffFilter *filter)
+{
+	char *subtoken = NULL;
+	char *attr_key = NULL;
+	char *attr_value = NULL;
+	char *saveptr1 = NULL;
+	char *saveptr2 = NULL;
+	size_t num_keys = 0;
+	int i = 0;
 
-	token = strtok_r (NULL, "\t", &saveptr1);
-	if (token == NULL)
-		log_fatal ("missing 'frame' (field 8) at line %zu", entry->num_line);
+	if (filter != NULL && filter->select_keys)
+		num_keys = set_size (filter->keys);
 
-	entry->frame = strcmp (token, ".")
-		? atoi (token)
-		: -1 ;
+	entry->num_attributes = 0;
 
-	token = strtok_r (NULL, "", &saveptr1);
-	entry->num_attributes = i = 0;
+	if (attributes == NULL)
+		return;
 
-	if (token != NULL)
+	for (subtoken = strtok_r (attributes, ";", &saveptr1); subtoken != NULL;
+			subtoken = strtok_r (NULL, ";", &saveptr1))
 		{
-			for (subtoken = strtok_r (token, ";", &saveptr2); subtoken != NULL;
-					subtoken = strtok_r (NULL, ";", &saveptr2))
-				{
-					attr_key = strtok_r (subtoken, " =", &saveptr3);
-					attr_value = strtok_r (NULL, "", &saveptr3);
+			attr_key = strtok_r (subtoken, " =", &saveptr2);
+			attr_value = strtok_r (NULL, "", &saveptr2);
+
+			if (attr_value == NULL)
+				log_fatal ("missing value for attribute %d (%s) at line %zu",
+						i, attr_key, entry->num_line);
 
-					if (attr_value == NULL)
-						log_fatal ("missing value for attribute %d (%s) at line %zu",
-								i, attr_key, entry->num_line);
+			attr_key = trim (attr_key);
 
-					if ((i + 1) > entry->attributes_size)
-						entry->attributes_size = buf_expand ((void **) &entry->attributes,
-								sizeof (GffAttribute), entry->attributes_size, GFF_ATTRSIZ);
+			if (num_keys > 0
+					&& (!is_selected_key (filter, attr_key)
+						|| gff_attribute_find (entry, attr_key) != NULL))
+				continue;
 
-					attr_key = trim (attr_key);
+			if ((i + 1) > entry->attributes_size)
+				entry->attributes_size = buf_expand ((void **) &entry->attributes,
+						sizeof (GffAttribute), entry->attributes_size, GFF_ATTRSIZ);
 
-					entry->attributes[i].key_size = entry_set (&entry->attributes[i].key,
-							entry->attributes[i].key_size, attr_key);
+			entry->attributes[i].key_size = entry_set (&entry->attributes[i].key,
+					entry->attributes[i].key_size, attr_key);
 
-					attr_value = trimc (trim (attr_value), '"');
+			attr_value = trimc (trim (attr_value), '"');
 
-					entry->attributes[i].value_size = entry_set (&entry->attributes[i].value,
-							entry->attributes[i].value_size, attr_value);
+			entry->attributes[i].value_size = entry_set (&entry->attributes[i].value,
+					entry->attributes[i].value_size, attr_value);
 
-					i++;
-				}
+			entry->num_attributes = ++i;
+
+			if (i == num_keys)
+				break;
 		}
+}
 
-	entry->num_attributes = i;
+static void
+next_line (GffFile *gff)
+{
+	int rc = 0;
 
 	/*
 	* get next entry
@@ -322,6 +350,26 @@ gff_read (GffFile *gff, GffEntry *entry)
 	// Reached end of file
 	if (!rc)
 		gff->eof = 1;
+}
+
+int
+gff_read (GffFile *gff, GffEntry *entry)
+{
+	assert (gff != NULL && entry != NULL);
+
+	char *fields[GFF_NUM_FIELDS];
+	char *attributes = NULL;
+
+	// end of file
+	if (gff->eof)
+		return 0;
+
+	attributes = split_fields (gff, entry, fields);
+
+	set_fields (entry, fields);
+	set_attributes (entry, attributes, NULL);
+
+	next_line (gff);
 
 	return 1;
 }
@@ -347,6 +395,7 @@ gff_filter_new (void)
 			(DestroyNotify) set_free);
 	filter->values_regex = hash_new (NULL,
 			(DestroyNotify) regex_free);
+	filter->keys = set_new_full (str_hash, str_equal, xfree);
 
 	return filter;
 }
@@ -361,6 +410,7 @@ gff_filter_free (GffFilter *filter)
 	hash_free (filter->hard_attributes);
 	hash_free (filter->soft_attributes);
 	hash_free (filter->values_regex);
+	set_free (filter->keys);
 
 	xfree (filter);
 }
@@ -374,6 +424,24 @@ gff_filter_insert_feature (GffFilter *filter, const char *feature)
 		: NULL;
 }
 
+static inline void
+gff_filter_insert_attribute_key (GffFilter *filter, const char *key)
+{
+	if (!set_is_member (filter->keys, key))
+		set_insert (filter->keys, xstrdup (key));
+}
+
+void
+gff_filter_insert_key (GffFilter *filter, const char *key)
+{
+	assert (filter != NULL && key != NULL);
+
+	// From now on, the attributes not asked
+	// for are skipped
+	gff_filter_insert_attribute_key (filter, key);
+	filter->select_keys = 1;
+}
+
 static inline void
 gff_filter_insert_value_regex (GffFilter *filter,
 		const char *value)
@@ -409,6 +477,8 @@ gff_filter_insert_hard_attribute (GffFilter *filter,
 			hash_insert (filter->hard_attributes, xstrdup (key), values);
 		}
 
+	gff_filter_insert_attribute_key (filter, key);
+
 	if (set_insert (values, xstrdup (value)))
 		gff_filter_insert_value_regex (filter, value);
 }
@@ -427,6 +497,8 @@ gff_filter_insert_soft_attribute (GffFilter *filter,
 			hash_insert (filter->soft_attributes, xstrdup (key), values);
 		}
 
+	gff_filter_insert_attribute_key (filter, key);
+
 	if (set_insert (values, xstrdup (value)))
 		gff_filter_insert_value_regex (filter, value);
 }
@@ -513,11 +585,31 @@ gff_filter_lookup (const GffFilter *filter, const GffEntry *entry)
 int
 gff_read_filtered (GffFile *gff, GffEntry *entry, const GffFilter *filter)
 {
-	assert (filter != NULL);
+	assert (gff != NULL && entry != NULL && filter != NULL);
 
-	while (gff_read (gff, entry))
-		if (gff_filter_lookup (filter, entry))
-			return 1;
+	char *fields[GFF_NUM_FIELDS];
+	char *attributes = NULL;
+	int pass = 0;
+
+	while (!gff->eof)
+		{
+			attributes = split_fields (gff, entry, fields);
+
+			// Reject by feature before copying anything
+			if (filter->feature == NULL
+					|| !strcmp (filter->feature, fields[2]))
+				{
+					set_fields (entry, fields);
+					set_attributes (entry, attributes, filter);
+					pass = gff_filter_lookup (filter, entry);
+				}
+
+			// The slices are gone from now on
+			next_line (gff);
+
+			if (pass)
+				return 1;
+		}
 
 	return 0;
 }
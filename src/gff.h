@@ -21,6 +21,7 @@
 
 #include <stdlib.h>
 #include "hash.h"
+#include "set.h"
 #include "gz.h"
 
 struct _GffFile
@@ -71,6 +72,8 @@ struct _GffFilter
 	Hash       *hard_attributes;
 	Hash       *soft_attributes;
 	Hash       *values_regex;
+	Set        *keys;
+	int         select_keys;
 };
 
 typedef struct _GffFilter GffFilter;
@@ -89,6 +92,7 @@ void         gff_filter_insert_feature          (GffFilter *filter, const char *
 void         gff_filter_free                    (GffFilter *filter);
 void         gff_filter_insert_hard_attribute   (GffFilter *filter, const char *key, const char *value);
 void         gff_filter_insert_soft_attribute   (GffFilter *filter, const char *key, const char *value);
+void         gff_filter_insert_key              (GffFilter *filter, const char *key);
 int          gff_read_filtered                  (GffFile *gff, GffEntry *entry, const GffFilter *filter);
 
 #define gff_attribute_get(entry,i) (&(entry)->attributes[(i)])
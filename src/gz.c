@@ -22,11 +22,47 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <htslib/hts.h>
+#include <htslib/bgzf.h>
 #include "wrapper.h"
-#include "utils.h"
 #include "log.h"
 #include "gz.h"
 
+#define GZ_CHUNK_SIZE       (1 << 16) //  64KiB
+#define GZ_BGZF_SUB_BLOCKS  256
+
+// Decompression threads for BGZF input
+static int gz_threads = 1;
+
+void
+gz_set_threads (int threads)
+{
+	gz_threads = threads > 1 ? threads : 1;
+}
+
+static BGZF *
+gz_open_bgzf (const char *path)
+{
+	BGZF *fp = NULL;
+
+	fp = bgzf_open (path, "r");
+	if (fp == NULL)
+		log_errno_fatal ("Could not open '%s' for reading", path);
+
+	// Plain gzip and uncompressed files are left to zlib
+	if (bgzf_compression (fp) != bgzf)
+		{
+			bgzf_close (fp);
+			return NULL;
+		}
+
+	if (gz_threads > 1 && bgzf_mt (fp, gz_threads, GZ_BGZF_SUB_BLOCKS) < 0)
+		log_fatal ("Could not start %d decompression threads for '%s'",
+				gz_threads, path);
+
+	return fp;
+}
+
 GzFile *
 gz_open_for_reading (const char *path)
 {
@@ -35,14 +71,18 @@ gz_open_for_reading (const char *path)
 	GzFile *gz = NULL;
 
 	gz = xcalloc (1, sizeof (GzFile));
-	gz->fp = gzopen (path, "rb");
+	gz->bgzf = gz_open_bgzf (path);
 
-	if (gz->fp == NULL)
-		log_errno_fatal ("Could not open '%s' for reading", path);
+	if (gz->bgzf == NULL)
+		{
+			gz->fp = gzopen (path, "rb");
+			if (gz->fp == NULL)
+				log_errno_fatal ("Could not open '%s' for reading", path);
+		}
 
 	gz->filename = xstrdup (path);
-	gz->buf = xcalloc (BUFSIZ, sizeof (char));
-	gz->buf_size = BUFSIZ;
+	gz->buf = xcalloc (GZ_CHUNK_SIZE, sizeof (char));
+	gz->buf_size = GZ_CHUNK_SIZE;
 
 	return gz;
 }
@@ -55,10 +95,18 @@ gz_close (GzFile *gz)
 
 	int rc;
 
-	rc = gzclose (gz->fp);
-	if (rc != Z_OK)
-		log_fatal ("Could not close file '%s': %s", gz->filename,
-				gzerror (gz->fp, &rc));
+	if (gz->bgzf != NULL)
+		{
+			if (bgzf_close (gz->bgzf) < 0)
+				log_fatal ("Could not close file '%s'", gz->filename);
+		}
+	else
+		{
+			rc = gzclose (gz->fp);
+			if (rc != Z_OK)
+				log_fatal ("Could not close file '%s': %s", gz->filename,
+						gzerror (gz->fp, &rc));
+		}
 
 	xfree (gz->buf);
 	xfree ((void *) gz->filename);
@@ -79,48 +127,77 @@ gz_check_error (const GzFile *gz)
 				gz->filename, err_msg);
 }
 
+static int
+gz_fill (GzFile *gz)
+{
+	ssize_t len = 0;
+
+	if (gz->eof)
+		return 0;
+
+	if (gz->bgzf != NULL)
+		{
+			len = bgzf_read (gz->bgzf, gz->buf, gz->buf_size);
+			if (len < 0)
+				log_fatal ("Could not read entry from '%s'", gz->filename);
+		}
+	else
+		{
+			len = gzread (gz->fp, gz->buf, gz->buf_size);
+			if (len < 0)
+				{
+					gz_check_error (gz);
+					len = 0;
+				}
+		}
+
+	gz->buf_pos = 0;
+	gz->buf_len = len;
+	gz->eof = len == 0;
+
+	return !gz->eof;
+}
+
 int
 gz_getline (GzFile *gz, char **lineptr, size_t *n)
 {
 	assert (gz != NULL && lineptr != NULL && n != NULL);
 
-	char *line = NULL;
+	const char *start = NULL;
+	const char *end = NULL;
+	size_t chunk = 0;
 	size_t len = 0;
 
-	line = gzgets (gz->fp, gz->buf, gz->buf_size);
-
-	if (line == NULL)
-		{
-			gz_check_error (gz);
-			return 0;
-		}
-
-	for (len = strlen (line); line[len - 1] != '\n'; len = strlen (line))
+	// Split the line straight from the decompressed
+	// block, so a line costs a single memchr and copy
+	do
 		{
-			size_t old_size = gz->buf_size;
+			if (gz->buf_pos == gz->buf_len && !gz_fill (gz))
+				break;
 
-			gz->buf_size = buf_expand ((void **) &gz->buf,
-					sizeof (char), gz->buf_size, BUFSIZ);
+			start = gz->buf + gz->buf_pos;
+			end = memchr (start, '\n', gz->buf_len - gz->buf_pos);
 
-			line = gzgets (gz->fp, &gz->buf[old_size - 1],
-					gz->buf_size - old_size + 1);
+			chunk = end != NULL
+				? (size_t) (end - start) + 1
+				: gz->buf_len - gz->buf_pos;
 
-			if (line == NULL)
+			if (*lineptr == NULL || *n < (len + chunk + 1))
 				{
-					gz_check_error (gz);
-					break;
+					*n = len + chunk + 1;
+					*lineptr = xrealloc (*lineptr, *n);
 				}
-		}
-
-	len = strlen (gz->buf);
 
-	if (*lineptr == NULL || *n < (len + 1))
-		{
-			*n = len + 1;
-			*lineptr = xrealloc (*lineptr, *n);
+			memcpy (*lineptr + len, start, chunk);
+			gz->buf_pos += chunk;
+			len += chunk;
 		}
+	while (end == NULL);
+
+	if (len == 0)
+		return 0;
 
-	strncpy (*lineptr, gz->buf, *n);
+	(*lineptr)[len] = '\0';
 	gz->num_line ++;
 
 	return 1;
@@ -22,12 +22,25 @@
 #include <stdlib.h>
 #include <zlib.h>
 
+struct BGZF;
+
+/*
+ * BGZF input (bgzip) is read by htslib, which
+ * can decompress blocks in parallel. Plain gzip
+ * and uncompressed files fall back to zlib. In
+ * both cases, lines are split straight from the
+ * decompressed block buffer
+ */
 struct _GzFile
 {
 	gzFile        fp;
+	struct BGZF  *bgzf;
 	const char   *filename;
 	char         *buf;
 	size_t        buf_size;
+	size_t        buf_pos;
+	size_t        buf_len;
+	int           eof;
 	size_t        num_line;
 };
 
@@ -36,8 +49,10 @@ typedef struct _GzFile GzFile;
 GzFile     * gz_open_for_reading (const char *path);
 void         gz_close            (GzFile *gz);
 int          gz_getline          (GzFile *gz, char **lineptr, size_t *n);
+void         gz_set_threads      (int threads);
 
 #define      gz_get_fp(gz)       ((gz)->fp)
+#define      gz_is_bgzf(gz)      ((gz)->bgzf != NULL)
 #define      gz_get_filename(gz) ((gz)->filename)
 #define      gz_get_num_line(gz) ((gz)->num_line)
 
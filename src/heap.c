@@ -0,0 +1,137 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "utils.h"
+#include "heap.h"
+
+Heap *
+heap_new (CompareFunc compare_func, DestroyNotify element_free_func)
+{
+	assert (compare_func != NULL);
+
+	Heap *heap = xcalloc (1, sizeof (Heap));
+
+	heap->compare_func = compare_func;
+	heap->element_free_func = element_free_func;
+
+	return heap;
+}
+
+void
+heap_free (Heap *heap)
+{
+	if (heap == NULL)
+		return;
+
+	size_t i = 0;
+
+	if (heap->element_free_func != NULL)
+		{
+			for (i = 0; i < heap->len; i++)
+				heap->element_free_func (heap->pdata[i]);
+		}
+
+	xfree (heap->pdata);
+	xfree (heap);
+}
+
+static inline void
+heap_swap (Heap *heap, size_t i, size_t j)
+{
+	void *tmp = heap->pdata[i];
+	heap->pdata[i] = heap->pdata[j];
+	heap->pdata[j] = tmp;
+}
+
+void
+heap_push (Heap *heap, void *ptr)
+{
+	assert (heap != NULL);
+
+	size_t i = 0;
+	size_t parent = 0;
+
+	if (heap->len == heap->alloc)
+		{
+			heap->alloc = nearest_pow (heap->len + 1);
+			heap->pdata = xrealloc (heap->pdata,
+					sizeof (void *) * heap->alloc);
+		}
+
+	i = heap->len++;
+	heap->pdata[i] = ptr;
+
+	// Sift up
+	while (i > 0)
+		{
+			parent = (i - 1) / 2;
+
+			if (heap->compare_func (heap->pdata[i], heap->pdata[parent]) >= 0)
+				break;
+
+			heap_swap (heap, i, parent);
+			i = parent;
+		}
+}
+
+void *
+heap_pop (Heap *heap)
+{
+	assert (heap != NULL);
+
+	void *ptr = NULL;
+	size_t i = 0;
+	size_t left = 0;
+	size_t right = 0;
+	size_t min = 0;
+
+	if (heap->len == 0)
+		return NULL;
+
+	ptr = heap->pdata[0];
+	heap->pdata[0] = heap->pdata[--heap->len];
+
+	// Sift down
+	while (1)
+		{
+			left = 2 * i + 1;
+			right = left + 1;
+			min = i;
+
+			if (left < heap->len
+					&& heap->compare_func (heap->pdata[left], heap->pdata[min]) < 0)
+				min = left;
+
+			if (right < heap->len
+					&& heap->compare_func (heap->pdata[right], heap->pdata[min]) < 0)
+				min = right;
+
+			if (min == i)
+				break;
+
+			heap_swap (heap, i, min);
+			i = min;
+		}
+
+	return ptr;
+}
@@ -0,0 +1,49 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdlib.h>
+#include "types.h"
+
+/*
+ * Binary min-heap. The compare function
+ * receives the elements themselves, not
+ * pointers to them as in 'array_sort'
+ */
+struct _Heap
+{
+	void          **pdata;
+	size_t          len;
+	size_t          alloc;
+	CompareFunc     compare_func;
+	DestroyNotify   element_free_func;
+};
+
+typedef struct _Heap Heap;
+
+Heap * heap_new  (CompareFunc compare_func, DestroyNotify element_free_func);
+void   heap_free (Heap *heap);
+void   heap_push (Heap *heap, void *ptr);
+void * heap_pop  (Heap *heap);
+
+#define heap_len(heap)  ((heap)->len)
+#define heap_peek(heap) ((heap)->len ? (heap)->pdata[0] : NULL)
+
+#endif /* heap.h */
@@ -0,0 +1,251 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "idtable.h"
+
+#define IDTABLE_INITIAL_SIZE 1024
+#define IDTABLE_BLOCK_SIZE   65536 /* fits 'IdEntry.offset' */
+
+static inline uint64_t
+fingerprint (const char *id)
+{
+	// FNV-1a followed by the
+	// murmur3 finalizer
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (; *id; id++)
+		{
+			h ^= (uint8_t) *id;
+			h *= 0x100000001b3ULL;
+		}
+
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	// Zero marks an empty slot
+	return h ? h : 1;
+}
+
+static inline const char *
+entry_id (const IdTable *table, const IdEntry *entry)
+{
+	return table->blocks[entry->block] + entry->offset;
+}
+
+IdTable *
+idtable_new (void)
+{
+	IdTable *table = xcalloc (1, sizeof (IdTable));
+
+	table->alloc = IDTABLE_INITIAL_SIZE;
+	table->entries = xcalloc (table->alloc, sizeof (IdEntry));
+
+	return table;
+}
+
+void
+idtable_free (IdTable *table)
+{
+	size_t i = 0;
+
+	if (table == NULL)
+		return;
+
+	for (i = 0; i < table->num_blocks; i++)
+		xfree (table->blocks[i]);
+
+	xfree (table->blocks);
+	xfree (table->entries);
+	xfree (table);
+}
+
+static inline size_t
+idtable_find (const IdTable *table, const char *id, uint64_t fp)
+{
+	size_t mask = table->alloc - 1;
+	size_t i = fp & mask;
+
+	// Linear probing up to the id
+	// or an empty slot
+	for (; table->entries[i].fingerprint != 0; i = (i + 1) & mask)
+		if (table->entries[i].fingerprint == fp
+				&& !strcmp (entry_id (table, &table->entries[i]), id))
+			break;
+
+	return i;
+}
+
+static void
+idtable_grow (IdTable *table)
+{
+	IdEntry *old_entries = table->entries;
+	size_t old_alloc = table->alloc;
+	size_t mask = 0;
+	size_t i, j;
+
+	table->alloc <<= 1;
+	table->entries = xcalloc (table->alloc, sizeof (IdEntry));
+	mask = table->alloc - 1;
+
+	// The fingerprints are kept: There
+	// is no need to hash the ids again
+	for (i = 0; i < old_alloc; i++)
+		{
+			if (old_entries[i].fingerprint == 0)
+				continue;
+
+			j = old_entries[i].fingerprint & mask;
+			while (table->entries[j].fingerprint != 0)
+				j = (j + 1) & mask;
+
+			table->entries[j] = old_entries[i];
+		}
+
+	xfree (old_entries);
+}
+
+static void
+idtable_store_id (IdTable *table, IdEntry *entry, const char *id)
+{
+	size_t len = strlen (id) + 1;
+
+	assert (len <= IDTABLE_BLOCK_SIZE);
+
+	// The ids are packed into fixed blocks. A new
+	// block is opened when the id does not fit
+	if (table->num_blocks == 0
+			|| table->block_used + len > IDTABLE_BLOCK_SIZE)
+		{
+			if (table->num_blocks == table->alloc_blocks)
+				{
+					table->alloc_blocks = table->alloc_blocks
+						? table->alloc_blocks << 1
+						: 16;
+					table->blocks = xrealloc (table->blocks,
+							table->alloc_blocks * sizeof (char *));
+				}
+
+			table->blocks[table->num_blocks++] = xmalloc (IDTABLE_BLOCK_SIZE);
+			table->block_used = 0;
+		}
+
+	entry->block = table->num_blocks - 1;
+	entry->offset = table->block_used;
+
+	memcpy (table->blocks[entry->block] + entry->offset, id, len);
+	table->block_used += len;
+}
+
+uint8_t *
+idtable_insert (IdTable *table, const char *id)
+{
+	assert (table != NULL && id != NULL);
+
+	uint64_t fp = fingerprint (id);
+	IdEntry *entry = NULL;
+
+	// Keep the load factor under 0.7
+	if ((table->size + 1) * 10 > table->alloc * 7)
+		idtable_grow (table);
+
+	entry = &table->entries[idtable_find (table, id, fp)];
+
+	if (entry->fingerprint == 0)
+		{
+			entry->fingerprint = fp;
+			entry->value = 0;
+			idtable_store_id (table, entry, id);
+			table->size++;
+		}
+
+	return &entry->value;
+}
+
+uint8_t *
+idtable_lookup (const IdTable *table, const char *id)
+{
+	assert (table != NULL && id != NULL);
+
+	IdEntry *entry = &table->entries[idtable_find (table, id,
+			fingerprint (id))];
+
+	return entry->fingerprint != 0
+		? &entry->value
+		: NULL;
+}
+
+int
+idtable_remove (IdTable *table, const char *id)
+{
+	assert (table != NULL && id != NULL);
+
+	size_t mask = table->alloc - 1;
+	size_t i = idtable_find (table, id, fingerprint (id));
+	size_t j = i;
+	size_t k = 0;
+
+	if (table->entries[i].fingerprint == 0)
+		return 0;
+
+	// Backward shift deletion: Move back the entries
+	// that would be unreachable after the hole.
+	// The id copy is left into its block
+	for (;;)
+		{
+			j = (j + 1) & mask;
+
+			if (table->entries[j].fingerprint == 0)
+				break;
+
+			// The home slot of the entry 'j'
+			k = table->entries[j].fingerprint & mask;
+
+			if ((j > i && (k <= i || k > j))
+					|| (j < i && (k <= i && k > j)))
+				{
+					table->entries[i] = table->entries[j];
+					i = j;
+				}
+		}
+
+	table->entries[i].fingerprint = 0;
+	table->size--;
+
+	return 1;
+}
+
+void
+idtable_foreach (IdTable *table, IdFunc func, void *user_data)
+{
+	assert (table != NULL && func != NULL);
+
+	size_t i = 0;
+
+	for (i = 0; i < table->alloc; i++)
+		if (table->entries[i].fingerprint != 0)
+			func (entry_id (table, &table->entries[i]),
+					&table->entries[i].value, user_data);
+}
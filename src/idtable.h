@@ -0,0 +1,65 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDTABLE_H
+#define IDTABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Open addressing table of ids (read names) keyed
+ * by a 64-bit fingerprint. Each slot holds the
+ * fingerprint, the location of the id copy, used
+ * to verify collisions, and a byte of flags
+ */
+struct _IdEntry
+{
+	uint64_t  fingerprint;
+	uint32_t  block;
+	uint16_t  offset;
+	uint8_t   value;
+};
+
+typedef struct _IdEntry IdEntry;
+
+struct _IdTable
+{
+	IdEntry   *entries;
+	size_t     size;
+	size_t     alloc;
+	char     **blocks;
+	size_t     num_blocks;
+	size_t     alloc_blocks;
+	size_t     block_used;
+};
+
+typedef struct _IdTable IdTable;
+
+typedef void (*IdFunc) (const char *id, uint8_t *value, void *user_data);
+
+IdTable * idtable_new     (void);
+void      idtable_free    (IdTable *table);
+uint8_t * idtable_insert  (IdTable *table, const char *id);
+uint8_t * idtable_lookup  (const IdTable *table, const char *id);
+int       idtable_remove  (IdTable *table, const char *id);
+void      idtable_foreach (IdTable *table, IdFunc func, void *user_data);
+
+#define idtable_size(table) ((table)->size)
+
+#endif /* idtable.h */
@@ -0,0 +1,494 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <assert.h>
+#include "wrapper.h"
+#include "iindex.h"
+
+#define _MAX(a,b) ((a) > (b) ? (a) : (b))
+#define _MIN(a,b) ((a) > (b) ? (b) : (a))
+
+#define DEFAULT_NODE_OVERLAP_FRAC      0.0000000001
+#define DEFAULT_INTERVAL_OVERLAP_FRAC  0.0000000001
+
+/*
+ * Subtrees at this level or below are small
+ * enough to be scanned linearly
+ */
+#define IINDEX_SCAN_LEVEL 3
+
+/*
+ * The cursor is reseeded from the tree if a
+ * query jumps over more intervals than that
+ */
+#define IINDEX_CURSOR_MAX_SKIP 32
+
+IIndex *
+iindex_new (DestroyNotify destroy_fun)
+{
+	IIndex *index = xcalloc (1, sizeof (IIndex));
+	index->destroy_fun = destroy_fun;
+	return index;
+}
+
+void
+iindex_free (IIndex *index)
+{
+	if (index == NULL)
+		return;
+
+	long i = 0;
+
+	if (index->destroy_fun != NULL)
+		for (; i < index->size; i++)
+			index->destroy_fun (index->nodes[i].data);
+
+	xfree (index->nodes);
+	xfree (index);
+}
+
+void
+iindex_insert (IIndex *index, long low, long high, const void *data)
+{
+	assert (index != NULL && (high >= low));
+
+	if (index->size == index->alloc)
+		{
+			index->alloc = index->alloc > 0
+				? index->alloc << 1
+				: 16;
+			index->nodes = xrealloc (index->nodes,
+					sizeof (IIndexNode) * index->alloc);
+		}
+
+	index->nodes[index->size++] = (IIndexNode) {
+		.low  = low,
+		.high = high,
+		.max  = high,
+		.data = (void *) data
+	};
+
+	index->built = 0;
+}
+
+static int
+cmp_node (const void *a, const void *b)
+{
+	const IIndexNode *n1 = a;
+	const IIndexNode *n2 = b;
+
+	// At sorting time, 'max' holds the insertion order
+	if (n1->low != n2->low)
+		return n1->low < n2->low ? -1 : 1;
+
+	return (n1->max > n2->max) - (n1->max < n2->max);
+}
+
+void
+iindex_build (IIndex *index)
+{
+	assert (index != NULL);
+
+	IIndexNode *a = index->nodes;
+	long n = index->size;
+	long i, last_i, last, x, i0, step, e;
+	int k;
+
+	if (index->built)
+		return;
+
+	index->max_level = 0;
+	index->built = 1;
+
+	if (n == 0)
+		return;
+
+	// Intervals loaded in order need no sorting
+	for (i = 1; i < n && a[i - 1].low <= a[i].low; i++)
+		;
+
+	/*
+	* Keep intervals with the same 'low' in
+	* insertion order, as the tree used to do
+	*/
+	if (i < n)
+		{
+			for (i = 0; i < n; i++)
+				a[i].max = i;
+
+			qsort (a, n, sizeof (IIndexNode), cmp_node);
+		}
+
+	/*
+	* Nodes at even indexes are the leaves. Each level k
+	* puts its nodes at (2^k - 1) + j * 2^(k + 1) and the
+	* children of x at x -+ 2^(k - 1). 'last' keeps the max
+	* of the rightmost existing subtree, for the nodes whose
+	* right child falls beyond the array end
+	*/
+	for (i = 0, last_i = 0, last = 0; i < n; i += 2)
+		{
+			last_i = i;
+			last = a[i].max = a[i].high;
+		}
+
+	for (k = 1; (1L << k) <= n; k++)
+		{
+			x = 1L << (k - 1);
+			i0 = (x << 1) - 1;
+			step = x << 2;
+
+			for (i = i0; i < n; i += step)
+				{
+					e = _MAX (a[i].high, a[i - x].max);
+					e = _MAX (e, i + x < n ? a[i + x].max : last);
+					a[i].max = e;
+				}
+
+			last_i = (last_i >> k) & 1
+				? last_i - x
+				: last_i + x;
+
+			if (last_i < n && a[last_i].max > last)
+				last = a[last_i].max;
+		}
+
+	index->max_level = k - 1;
+}
+
+void
+iindex_load (IIndex *index, IIndexNode *nodes, long size)
+{
+	assert (index != NULL && index->size == 0);
+	assert (nodes != NULL || size == 0);
+
+	int k = 0;
+
+	/*
+	* The nodes were laid by 'iindex_build' and saved
+	* as they were: Only the tree height is missing.
+	* The index takes the array
+	*/
+	xfree (index->nodes);
+
+	index->nodes = nodes;
+	index->size = index->alloc = size;
+
+	for (k = 1; (1L << k) <= size; k++)
+		;
+
+	index->max_level = size > 0 ? k - 1 : 0;
+	index->built = 1;
+}
+
+void
+iindex_iter_init (IIndexIter *iter, const IIndex *index,
+		long low, long high)
+{
+	assert (iter != NULL && index != NULL && high >= low);
+	assert (index->built || index->size == 0);
+
+	*iter = (IIndexIter) {
+		.index = index,
+		.low   = low,
+		.high  = high
+	};
+
+	if (index->size > 0)
+		iter->stack[iter->t++] = (IIndexStack) {
+			.x = (1L << index->max_level) - 1,
+			.k = index->max_level,
+			.w = 0
+		};
+}
+
+int
+iindex_iter_next (IIndexIter *iter, const IIndexNode **node)
+{
+	assert (iter != NULL && node != NULL);
+
+	const IIndexNode *a = iter->index->nodes;
+	long n = iter->index->size;
+	IIndexStack z;
+	long y = 0;
+
+	for (;;)
+		{
+			// Resume the linear scan of a small subtree
+			for (; iter->i < iter->end; iter->i++)
+				{
+					if (a[iter->i].low > iter->high)
+						{
+							iter->end = iter->i;
+							break;
+						}
+
+					if (a[iter->i].high >= iter->low)
+						{
+							*node = &a[iter->i++];
+							return 1;
+						}
+				}
+
+			if (iter->t == 0)
+				return 0;
+
+			z = iter->stack[--iter->t];
+
+			if (z.k <= IINDEX_SCAN_LEVEL)
+				{
+					iter->i = z.x >> z.k << z.k;
+					iter->end = iter->i + (1L << (z.k + 1)) - 1;
+					if (iter->end > n)
+						iter->end = n;
+				}
+			else if (z.w == 0)
+				{
+					/*
+					* Visit the left subtree first, so the intervals
+					* come out sorted. The node is stacked back to
+					* be seen after it
+					*/
+					y = z.x - (1L << (z.k - 1));
+					iter->stack[iter->t++] = (IIndexStack) {z.x, z.k, 1};
+
+					if (y >= n || a[y].max >= iter->low)
+						iter->stack[iter->t++] = (IIndexStack) {y, z.k - 1, 0};
+				}
+			else if (z.x < n && a[z.x].low <= iter->high)
+				{
+					iter->stack[iter->t++] = (IIndexStack) {
+						z.x + (1L << (z.k - 1)), z.k - 1, 0};
+
+					if (a[z.x].high >= iter->low)
+						{
+							*node = &a[z.x];
+							return 1;
+						}
+				}
+		}
+}
+
+static int
+do_overlap (const IIndexNode *node, long low, long high,
+		float node_overlap_frac, float interval_overlap_frac,
+		int either, IIndexLookupData *ldata)
+{
+	// Node window
+	long wn = node->high - node->low;
+
+	// Interval window
+	long wi = high - low;
+
+	/*
+	* If overlaps wn with wi, then:
+	* wn + wi > max - min, so the in
+	* box (overlapped) is wn + wi - max + min
+	*/
+	long in = wn + wi - _MAX (node->high, high)
+		+ _MIN (node->low, low);
+
+	*ldata = (IIndexLookupData) {
+		.node_low      = node->low,
+		.node_high     = node->high,
+		.interval_low  = low,
+		.interval_high = high,
+		.overlap_pos   = _MAX (node->low, low),
+		.overlap_len   = in + 1,
+		.data          = node->data
+	};
+
+	return either
+		? (in >= (int)(wn * node_overlap_frac))
+			|| (in >= (int)(wi * interval_overlap_frac))
+		: (in >= (int)(wn * node_overlap_frac))
+			&& (in >= (int)(wi * interval_overlap_frac));
+}
+
+int
+iindex_lookup (const IIndex *index, long low, long high, float node_overlap_frac,
+		float interval_overlap_frac, int either, IIndexLookupFunc func, void *user_data)
+{
+	assert (index != NULL && high >= low && func != NULL);
+
+	IIndexIter iter;
+	IIndexLookupData ldata = {};
+	const IIndexNode *node = NULL;
+	int acm = 0;
+
+	if (node_overlap_frac < 0)
+		node_overlap_frac = DEFAULT_NODE_OVERLAP_FRAC;
+
+	if (interval_overlap_frac < 0)
+		interval_overlap_frac = DEFAULT_INTERVAL_OVERLAP_FRAC;
+
+	iindex_iter_init (&iter, index, low, high);
+
+	while (iindex_iter_next (&iter, &node))
+		{
+			if (do_overlap (node, low, high, node_overlap_frac,
+						interval_overlap_frac, either, &ldata))
+				{
+					func (&ldata, user_data);
+					acm++;
+				}
+		}
+
+	return acm;
+}
+
+IIndexCursor *
+iindex_cursor_new (const IIndex *index)
+{
+	assert (index != NULL);
+	assert (index->built || index->size == 0);
+
+	IIndexCursor *cursor = xcalloc (1, sizeof (IIndexCursor));
+	cursor->index = index;
+
+	return cursor;
+}
+
+void
+iindex_cursor_free (IIndexCursor *cursor)
+{
+	if (cursor == NULL)
+		return;
+
+	xfree (cursor->active);
+	xfree (cursor);
+}
+
+static inline void
+cursor_add (IIndexCursor *cursor, long i)
+{
+	if (cursor->len == cursor->alloc)
+		{
+			cursor->alloc = cursor->alloc > 0
+				? cursor->alloc << 1
+				: 16;
+			cursor->active = xrealloc (cursor->active,
+					sizeof (long) * cursor->alloc);
+		}
+
+	cursor->active[cursor->len++] = i;
+}
+
+static void
+cursor_seed (IIndexCursor *cursor, long low, long high)
+{
+	const IIndexNode *a = cursor->index->nodes;
+	long n = cursor->index->size;
+	const IIndexNode *node = NULL;
+	IIndexIter iter;
+	long l = 0;
+	long r = n;
+	long m = 0;
+
+	cursor->len = 0;
+
+	// The open intervals are just the overlapping ones
+	iindex_iter_init (&iter, cursor->index, low, high);
+	while (iindex_iter_next (&iter, &node))
+		cursor_add (cursor, node - a);
+
+	// The first interval not seen yet
+	while (l < r)
+		{
+			m = l + ((r - l) >> 1);
+			if (a[m].low <= high)
+				l = m + 1;
+			else
+				r = m;
+		}
+
+	cursor->next = l;
+	cursor->seeded = 1;
+}
+
+static void
+cursor_advance (IIndexCursor *cursor, long low, long high)
+{
+	const IIndexNode *a = cursor->index->nodes;
+	long n = cursor->index->size;
+	long i = 0;
+	long j = 0;
+
+	// Close the intervals left behind, keeping the order
+	for (i = 0; i < cursor->len; i++)
+		if (a[cursor->active[i]].high >= low)
+			cursor->active[j++] = cursor->active[i];
+
+	cursor->len = j;
+
+	for (; cursor->next < n && a[cursor->next].low <= high; cursor->next++)
+		if (a[cursor->next].high >= low)
+			cursor_add (cursor, cursor->next);
+}
+
+int
+iindex_cursor_lookup (IIndexCursor *cursor, long low, long high,
+		float node_overlap_frac, float interval_overlap_frac, int either,
+		IIndexLookupFunc func, void *user_data)
+{
+	assert (cursor != NULL && high >= low && func != NULL);
+
+	const IIndexNode *a = cursor->index->nodes;
+	long n = cursor->index->size;
+	IIndexLookupData ldata = {};
+	const IIndexNode *node = NULL;
+	long skip = cursor->next + IINDEX_CURSOR_MAX_SKIP;
+	long i = 0;
+	int acm = 0;
+
+	if (node_overlap_frac < 0)
+		node_overlap_frac = DEFAULT_NODE_OVERLAP_FRAC;
+
+	if (interval_overlap_frac < 0)
+		interval_overlap_frac = DEFAULT_INTERVAL_OVERLAP_FRAC;
+
+	// Out of order or too far ahead
+	if (!cursor->seeded || low < cursor->last_low
+			|| (skip < n && a[skip].low <= high))
+		cursor_seed (cursor, low, high);
+	else
+		cursor_advance (cursor, low, high);
+
+	cursor->last_low = low;
+
+	for (i = 0; i < cursor->len; i++)
+		{
+			node = &a[cursor->active[i]];
+
+			// Opened by a previous and longer query
+			if (node->low > high)
+				break;
+
+			if (do_overlap (node, low, high, node_overlap_frac,
+						interval_overlap_frac, either, &ldata))
+				{
+					func (&ldata, user_data);
+					acm++;
+				}
+		}
+
+	return acm;
+}
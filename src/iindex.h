@@ -0,0 +1,135 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IINDEX_H
+#define IINDEX_H
+
+#include "types.h"
+
+/*
+ * Flat interval index in the spirit of cgranges: the
+ * intervals live sorted by 'low' in a contiguous array
+ * and an implicit augmented binary tree is laid over
+ * the array indexes. All intervals must be inserted
+ * before 'iindex_build' and no lookup may happen before
+ * it. After built, the index is read-only and can be
+ * shared among threads
+ */
+
+struct _IIndexNode
+{
+	long    low;
+	long    high;
+	long    max;
+	void   *data;
+};
+
+typedef struct _IIndexNode IIndexNode;
+
+struct _IIndex
+{
+	IIndexNode     *nodes;
+	long            size;
+	long            alloc;
+	int             max_level;
+	int             built;
+	DestroyNotify   destroy_fun;
+};
+
+typedef struct _IIndex IIndex;
+
+IIndex * iindex_new    (DestroyNotify destroy_fun);
+void     iindex_free   (IIndex *index);
+void     iindex_insert (IIndex *index, long low, long high, const void *data);
+void     iindex_build  (IIndex *index);
+void     iindex_load   (IIndex *index, IIndexNode *nodes, long size);
+
+#define IINDEX_STACK_SIZE 128
+
+struct _IIndexStack
+{
+	long    x;
+	int     k;
+	int     w;
+};
+
+typedef struct _IIndexStack IIndexStack;
+
+struct _IIndexIter
+{
+	const IIndex  *index;
+	long           low;
+	long           high;
+	long           i;
+	long           end;
+	int            t;
+	IIndexStack    stack[IINDEX_STACK_SIZE];
+};
+
+typedef struct _IIndexIter IIndexIter;
+
+void iindex_iter_init (IIndexIter *iter, const IIndex *index, long low, long high);
+int  iindex_iter_next (IIndexIter *iter, const IIndexNode **node);
+
+struct _IIndexLookupData
+{
+	void   *data;
+	long    node_low;
+	long    node_high;
+	long    interval_low;
+	long    interval_high;
+	long    overlap_pos;
+	long    overlap_len;
+};
+
+typedef struct _IIndexLookupData IIndexLookupData;
+
+typedef void (*IIndexLookupFunc) (IIndexLookupData *ldata, void *user_data);
+
+int iindex_lookup (const IIndex *index, long low, long high, float node_overlap_frac,
+		float interval_overlap_frac, int either, IIndexLookupFunc func, void *user_data);
+
+/*
+ * Sweep-line cursor for queries that come in ascending
+ * order of 'low', as from a coordinate sorted stream:
+ * It walks the sorted intervals once and keeps the ones
+ * still open. Out of order queries and long jumps reseed
+ * it from the tree
+ */
+struct _IIndexCursor
+{
+	const IIndex  *index;
+	long          *active;
+	long           len;
+	long           alloc;
+	long           next;
+	long           last_low;
+	int            seeded;
+};
+
+typedef struct _IIndexCursor IIndexCursor;
+
+IIndexCursor * iindex_cursor_new    (const IIndex *index);
+void           iindex_cursor_free   (IIndexCursor *cursor);
+int            iindex_cursor_lookup (IIndexCursor *cursor, long low, long high,
+		float node_overlap_frac, float interval_overlap_frac, int either,
+		IIndexLookupFunc func, void *user_data);
+
+#define iindex_size(index) ((index)->size)
+
+#endif /* iindex.h */
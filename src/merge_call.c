@@ -31,9 +31,11 @@
 #include "list.h"
 #include "set.h"
 #include "gff.h"
+#include "gz.h"
 #include "str.h"
 #include "chr.h"
 #include "array.h"
+#include "sam.h"
 #include "blacklist.h"
 #include "cluster.h"
 #include "db_merge.h"
@@ -94,6 +96,7 @@ struct _MergeCall
 	List        *hard_attributes;
 	List        *soft_attributes;
 	ChrStd      *cs;
+	const char  *chr_alias;
 	int          padding;
 	int          parental_dist;
 	int          support;
@@ -102,6 +105,7 @@ struct _MergeCall
 	// Genotyping
 	int          threads;
 	int          phred_quality;
+	const char  *ref_cache;
 };
 
 typedef struct _MergeCall MergeCall;
@@ -113,6 +117,7 @@ run (MergeCall *mc)
 
 	sqlite3 *db = NULL;
 
+	sqlite3_stmt *contig_stmt = NULL;
 	sqlite3_stmt *cluster_stmt = NULL;
 	sqlite3_stmt *clustering_stmt = NULL;
 	sqlite3_stmt *blacklist_stmt = NULL;
@@ -155,6 +160,12 @@ run (MergeCall *mc)
 	// Increase the cache size
 	db_cache_size (db, mc->cache_size);
 
+	// The contigs already there keep their ids
+	chr_std_load (mc->cs, db);
+
+	// Create contig statement
+	contig_stmt = db_prepare_contig_stmt (db);
+
 	// Create cluster statement
 	cluster_stmt = db_prepare_cluster_stmt (db);
 
@@ -188,6 +199,9 @@ run (MergeCall *mc)
 			// Begin transaction to speed up
 			db_begin_transaction (db);
 
+			// Blacklist compressed by bgzip
+			gz_set_threads (mc->threads);
+
 			if (gff_looks_like_gff_file (mc->blacklist_region))
 				{
 					log_info ("Index blacklist entries from GTF/GFF3 file '%s'",
@@ -203,6 +217,9 @@ run (MergeCall *mc)
 							mc->blacklist_region);
 				}
 
+			// The contigs of the blacklist
+			chr_std_dump (mc->cs, contig_stmt);
+
 			// Commit
 			db_end_transaction (db);
 		}
@@ -220,6 +237,9 @@ run (MergeCall *mc)
 
 			// Commit
 			db_end_transaction (db);
+
+			// Take the contigs of the merged files
+			chr_std_load (mc->cs, db);
 		}
 
 	// Begin transaction to speed up
@@ -253,9 +273,14 @@ run (MergeCall *mc)
 			// Begin transaction to speed up
 			db_begin_transaction (db);
 
+			// CRAM references fetched by MD5
+			// are kept in a local directory
+			if (mc->ref_cache != NULL)
+				sam_set_ref_cache (mc->ref_cache);
+
 			// Genotyping
 			log_info ("Run genotype annotation step for '%s'", db_file);
-			genotype (genotype_stmt, mc->threads, mc->phred_quality);
+			genotype (genotype_stmt, mc->cs, mc->threads, mc->phred_quality);
 
 			// Commit
 			db_end_transaction (db);
@@ -267,6 +292,7 @@ run (MergeCall *mc)
 
 	// Cleanup
 	xfree (db_file);
+	db_finalize (contig_stmt);
 	db_finalize (cluster_stmt);
 	db_finalize (clustering_stmt);
 	db_finalize (blacklist_stmt);
@@ -290,8 +316,8 @@ print_usage (FILE *fp)
 		"       %*c            [-c INT] [-I] [-e INT] [-m INT] [-b STR]\n"
 		"       %*c            [-B FILE] [[-T STR] [[-H|S] KEY=VALUE]]\n"
 		"       %*c            [-P INT] [-x INT] [-g INT] [-n INT]\n"
-		"       %*c            [-t INT] [-Q INT] [-i FILE]\n"
-		"       %*c            <FILE> ...\n"
+		"       %*c            [-t INT] [-Q INT] [-R DIR] [-L FILE]\n"
+		"       %*c            [-i FILE] <FILE> ...\n"
 		"\n"
 		"Discover and annotate retrocopies\n"
 		"\n"
@@ -366,11 +392,18 @@ print_usage (FILE *fp)
 		"                              (SAM/BAM/CRAM) within a cluster [default:\"%d\"]\n"
 		"   -n, --near-gene-rank       Minimum ranked distance between genes in order to\n"
 		"                              consider them close [default:\"%d\"]\n"
+		"   -L, --chr-alias            Two columns file with the contig names of the\n"
+		"                              alignment and blacklist files and their\n"
+		"                              standardized names. It must be the same file\n"
+		"                              passed to 'process-sample'\n"
 		"\n"
 		"Genotyping Options:\n"
 		"   -t, --threads              Number of threads [default:\"%d\"]\n"
 		"   -Q, --phred-quality        Minimum mapping quality used to define reference\n"
 		"                              allele reads [default:\"%d\"]\n"
+		"   -R, --ref-cache            Directory to cache the CRAM reference sequences\n"
+		"                              fetched by their MD5. If not set, the htslib\n"
+		"                              default is used\n"
 		"\n",
 		PACKAGE_STRING, PACKAGE, pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ',
 		DEFAULT_OUTPUT_DIR, DEFAULT_PREFIX, DEFAULT_CACHE_SIZE, DEFAULT_EPS, DEFAULT_MIN_PTS,
@@ -410,12 +443,14 @@ merge_call_init (MergeCall *mc)
 		.hard_attributes  = list_new (xfree),
 		.soft_attributes  = list_new (xfree),
 		.cs               = chr_std_new (),
+		.chr_alias        = NULL,
 		.padding          = DEFAULT_BLACKLIST_PADDING,
 		.parental_dist    = DEFAULT_PARENTAL_DISTANCE,
 		.support          = DEFAULT_SUPPORT,
 		.near_gene_rank   = DEFAULT_NEAR_GENE_RANK,
 		.threads          = DEFAULT_THREADS,
-		.phred_quality    = DEFAULT_PHRED_QUALITY
+		.phred_quality    = DEFAULT_PHRED_QUALITY,
+		.ref_cache        = NULL
 	};
 }
 
@@ -440,6 +475,8 @@ merge_call_destroy (MergeCall *mc)
 static int
 merge_call_validate (MergeCall *mc)
 {
+	Set *blacklist_chr = NULL;
+	ListElmt *cur = NULL;
 	int rc = EXIT_SUCCESS;
 	int i = 0;
 
@@ -471,6 +508,14 @@ merge_call_validate (MergeCall *mc)
 		fprintf (stderr, "%s: --blacklist-region '%s': No such file\n", PACKAGE,
 				mc->blacklist_region);
 
+	// Validate chr_alias file
+	if (mc->chr_alias != NULL && !exists (mc->chr_alias))
+		{
+			fprintf (stderr, "%s: --chr-alias '%s': No such file\n", PACKAGE,
+					mc->chr_alias);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
 	// Validate cache_size >= DEFAULT_CACHE_SIZE
 	if (mc->cache_size < DEFAULT_CACHE_SIZE)
 		{
@@ -529,11 +574,26 @@ merge_call_validate (MergeCall *mc)
 
 	/*Final settings*/
 
+	// The aliases come before any
+	// chromosome standardization
+	if (mc->chr_alias != NULL)
+		chr_std_load_alias (mc->cs, mc->chr_alias);
+
 	// Add default blacklisted chr if none
 	// has been passed
 	if (set_size (mc->blacklist_chr) == 0)
-		set_insert (mc->blacklist_chr,
-				chr_std_lookup (mc->cs, DEFAULT_BLACKLIST_CHR));
+		set_insert (mc->blacklist_chr, DEFAULT_BLACKLIST_CHR);
+
+	// Standardize the blacklisted chr
+	blacklist_chr = set_new_full (str_hash, str_equal, NULL);
+
+	cur = list_head (set_list (mc->blacklist_chr));
+	for (; cur != NULL; cur = list_next (cur))
+		set_insert (blacklist_chr,
+				chr_std_lookup (mc->cs, list_data (cur)));
+
+	set_free (mc->blacklist_chr);
+	mc->blacklist_chr = blacklist_chr;
 
 	// If gff_feature was not set
 	if (mc->filter->feature == NULL)
@@ -559,6 +619,10 @@ merge_call_validate (MergeCall *mc)
 					DEFAULT_GFF_ATTRIBUTE_VALUE2);
 		}
 
+	// The blacklist reads nothing else
+	// but the gene name
+	gff_filter_insert_key (mc->filter, "gene_name");
+
 	// Copy the name of possible output file, if the
 	// user chose --in-place
 	if (mc->in_place)
@@ -684,10 +748,24 @@ merge_call_print (const MergeCall *mc)
 		"  --genotype-support=%d \\\n"
 		"  --near-gene-rank=%d \\\n"
 		"  --threads=%d \\\n"
-		"  --phred-quality=%d\n",
+		"  --phred-quality=%d",
 		mc->parental_dist, mc->support, mc->near_gene_rank,
 		mc->threads, mc->phred_quality);
 
+	if (mc->ref_cache != NULL)
+		{
+			string_concat_printf (msg, " \\\n");
+			string_concat_printf (msg, "  --ref-cache='%s'", mc->ref_cache);
+		}
+
+	if (mc->chr_alias != NULL)
+		{
+			string_concat_printf (msg, " \\\n");
+			string_concat_printf (msg, "  --chr-alias='%s'", mc->chr_alias);
+		}
+
+	string_concat_printf (msg, "\n");
+
 	log_info ("%s", msg->str);
 	string_free (msg, 1);
 }
@@ -731,6 +809,8 @@ parse_merge_call_command_opt (int argc, char **argv)
 		{"crossing-reads",     required_argument, 0, 'C'},
 		{"phred-quality",      required_argument, 0, 'Q'},
 		{"threads",            required_argument, 0, 't'},
+		{"ref-cache",          required_argument, 0, 'R'},
+		{"chr-alias",          required_argument, 0, 'L'},
 		{0,                    0,                 0,  0 }
 	};
 
@@ -742,7 +822,7 @@ parse_merge_call_command_opt (int argc, char **argv)
 	int option_index = 0;
 	int c, i;
 
-	while ((c = getopt_long (argc, argv, "hqdIl:o:p:c:e:m:b:B:P:T:H:S:x:g:n:Q:t:i:", opt, &option_index)) >= 0)
+	while ((c = getopt_long (argc, argv, "hqdIl:o:p:c:e:m:b:B:P:T:H:S:x:g:n:Q:t:R:L:i:", opt, &option_index)) >= 0)
 		{
 			switch (c)
 				{
@@ -799,8 +879,7 @@ parse_merge_call_command_opt (int argc, char **argv)
 					}
 				case 'b':
 					{
-						set_insert (mc.blacklist_chr,
-								chr_std_lookup (mc.cs, optarg));
+						set_insert (mc.blacklist_chr, optarg);
 						break;
 					}
 				case 'x':
@@ -828,6 +907,16 @@ parse_merge_call_command_opt (int argc, char **argv)
 						mc.threads = atoi (optarg);
 						break;
 					}
+				case 'R':
+					{
+						mc.ref_cache = optarg;
+						break;
+					}
+				case 'L':
+					{
+						mc.chr_alias = optarg;
+						break;
+					}
 				case 'B':
 					{
 						mc.blacklist_region = optarg;
@@ -20,8 +20,11 @@
 
 #include <stdio.h>
 #include <time.h>
+#include <limits.h>
 #include <getopt.h>
 #include <assert.h>
+#include <pthread.h>
+#include <htslib/thread_pool.h>
 #include "wrapper.h"
 #include "array.h"
 #include "utils.h"
@@ -31,21 +34,32 @@
 #include "logger.h"
 #include "io.h"
 #include "str.h"
+#include "gz.h"
 #include "thpool.h"
 #include "exon.h"
 #include "abnormal.h"
 #include "dedup.h"
+#include "sam.h"
+#include "db_merge.h"
 #include "process_sample.h"
 
 #define DEFAULT_MAX_DISTANCE    10000
 #define DEFAULT_CACHE_SIZE      200000 /* 200MiB */
+#define DEFAULT_PRIVATE_DB      0
+#define DEFAULT_RESUME          0
 #define DEFAULT_THREADS         1
+#define DEFAULT_HTS_THREADS     0 /* auto, if not set */
 #define DEFAULT_SORTED          0
+#define DEFAULT_SHARD_SIZE      0 /* disabled */
+#define DEFAULT_MAX_MEMORY      0 /* disabled */
+#define DEFAULT_FETCH_MATES     0
+#define DEFAULT_SINGLE_PASS     0
 #define DEFAULT_DEDUPLICATE     0
 #define DEFAULT_EXON_FRAC       1e-09
 #define DEFAULT_ALIGNMENT_FRAC  1e-09
 #define DEFAULT_EITHER          0
 #define DEFAULT_RECIPROCAL      0
+#define DEFAULT_EXONIC_ONLY     0
 #define DEFAULT_PREFIX          "out"
 #define DEFAULT_OUTPUT_DIR      "."
 #define DEFAULT_LOG_SILENT      0
@@ -60,9 +74,12 @@ struct _ProcessSample
 	const char  *gff_file;
 
 	// I/O
+	const char  *annotation_cache;
 	const char  *input_file;
 	const char  *output_dir;
 	const char  *prefix;
+	int          resume;
+	const char  *append;
 
 	// Log
 	Logger      *logger;
@@ -72,6 +89,7 @@ struct _ProcessSample
 
 	// SQLite3
 	int          cache_size;
+	int          private_db;
 
 	// Read Quality
 	float        max_base_freq;
@@ -80,17 +98,196 @@ struct _ProcessSample
 
 	// Processing
 	int          threads;
+	int          hts_threads;
+	int          hts_threads_set;
 	int          sorted;
+	long         shard_size;
+	long         max_memory;
+	int          fetch_mates;
+	int          single_pass;
+	const char  *tmp_dir;
+	const char  *ref_cache;
+	const char  *chr_alias;
 	int          max_distance;
 	float        exon_frac;
 	float        alignment_frac;
 	int          alignment_frac_set;
 	int          reciprocal;
 	int          either;
+	int          exonic_only;
 };
 
 typedef struct _ProcessSample ProcessSample;
 
+struct _Source
+{
+	AbnormalArg   arg;
+	int           done;
+	long          cost;
+
+	// Private database
+	char         *path;
+	sqlite3      *db;
+	sqlite3      *out;
+	sqlite3_stmt *alignment_stmt;
+	sqlite3_stmt *overlapping_stmt;
+};
+
+typedef struct _Source Source;
+
+// Only one private database is attached
+// to the output at a time
+static pthread_mutex_t merge_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+source_db_open (Source *src, sqlite3 *out, const char *prefix,
+		int batch_id)
+{
+	sqlite3_stmt *source_stmt = NULL;
+
+	xasprintf (&src->path, "%s/%s.%d.db", src->arg.tmp_dir,
+			prefix, src->arg.source_id);
+
+	log_debug ("Create private database '%s'", src->path);
+	src->db = db_create (src->path);
+	src->out = out;
+	src->alignment_stmt = db_prepare_alignment_stmt (src->db);
+	src->overlapping_stmt = db_prepare_overlapping_stmt (src->db);
+
+	// It is a temporary file, rebuilt from
+	// scratch if anything goes wrong
+	db_exec (src->db, "PRAGMA journal_mode = OFF");
+	db_exec (src->db, "PRAGMA synchronous = OFF");
+
+	db_begin_transaction (src->db);
+
+	// The source is marked as done when its
+	// rows reach the output
+	source_stmt = db_prepare_source_stmt (src->db);
+	db_insert_source (source_stmt, src->arg.source_id, batch_id,
+			src->arg.sam_file);
+	db_finalize (source_stmt);
+
+	db_exec (src->db, "UPDATE source SET done = 1");
+
+	src->arg.alignment_stmt = src->alignment_stmt;
+	src->arg.overlapping_stmt = src->overlapping_stmt;
+}
+
+static void
+source_db_commit (Source *src)
+{
+	sqlite3_stmt *contig_stmt = NULL;
+
+	// The contigs met so far, so that the
+	// alignments never refer to a missing one
+	contig_stmt = db_prepare_contig_stmt (src->db);
+	chr_std_dump (src->arg.cs, contig_stmt);
+	db_finalize (contig_stmt);
+
+	db_end_transaction (src->db);
+
+	db_finalize (src->alignment_stmt);
+	db_finalize (src->overlapping_stmt);
+	db_close (src->db);
+	src->db = NULL;
+
+	// The alignment ids are unique among all files,
+	// so the private database is copied as it is
+	pthread_mutex_lock (&merge_lock);
+	log_info ("Merge private database of '%s'", src->arg.sam_file);
+	db_merge_shard (src->out, src->path);
+	pthread_mutex_unlock (&merge_lock);
+
+	xunlink (src->path);
+	xfree (src->path);
+}
+
+static void
+source_filter (Source *src)
+{
+	abnormal_filter (&src->arg);
+
+	// Checkpoint
+	if (src->db != NULL)
+		source_db_commit (src);
+}
+
+static void
+resume_sources (sqlite3 *db, Source *sources, int num_files)
+{
+	sqlite3_stmt *stmt = NULL;
+	const char *path = NULL;
+	int i = 0;
+
+	stmt = db_prepare (db, "SELECT id,path,done FROM source ORDER BY id ASC");
+
+	// The alignment ids depend on the source ids,
+	// so the files must be the same of the last run
+	for (i = 0; db_step (stmt) == SQLITE_ROW; i++)
+		{
+			path = db_column_text (stmt, 1);
+
+			if (i >= num_files
+					|| db_column_int (stmt, 0) != sources[i].arg.source_id
+					|| strcmp (path, sources[i].arg.sam_file))
+				log_fatal ("Cannot resume '%s': the alignment files differ "
+						"from the previous run", sqlite3_db_filename (db, "main"));
+
+			sources[i].done = db_column_int (stmt, 2);
+
+			if (sources[i].done)
+				log_info ("Skip '%s': already processed", path);
+		}
+
+	if (i != num_files)
+		log_fatal ("Cannot resume '%s': the alignment files differ "
+				"from the previous run", sqlite3_db_filename (db, "main"));
+
+	db_finalize (stmt);
+}
+
+static int
+max_id (sqlite3 *db, const char *table)
+{
+	sqlite3_stmt *stmt = NULL;
+	char *sql = NULL;
+	int id = 0;
+
+	xasprintf (&sql, "SELECT MAX(id) FROM %s", table);
+	stmt = db_prepare (db, sql);
+
+	// An empty table gives NULL, which is 0
+	if (db_step (stmt) == SQLITE_ROW)
+		id = db_column_int (stmt, 0);
+
+	db_finalize (stmt);
+	xfree (sql);
+
+	return id;
+}
+
+static long
+abnormal_filter_cost (const AbnormalArg *arg)
+{
+	// Pipes cannot be measured nor split,
+	// so they start as soon as possible
+	if (sam_is_stream (arg->sam_file))
+		return LONG_MAX;
+
+	return file_size (arg->sam_file);
+}
+
+static int
+cmp_abnormal_filter_cost (const void *p1, const void *p2)
+{
+	long c1 = (* (Source * const *) p1)->cost;
+	long c2 = (* (Source * const *) p2)->cost;
+
+	// Largest first
+	return (c1 < c2) - (c1 > c2);
+}
+
 static void
 run (ProcessSample *ps)
 {
@@ -101,14 +298,24 @@ run (ProcessSample *ps)
 	sqlite3_stmt *source_stmt = NULL;
 	sqlite3_stmt *alignment_stmt = NULL;
 	sqlite3_stmt *exon_stmt = NULL;
+	sqlite3_stmt *gene_stmt = NULL;
+	sqlite3_stmt *contig_stmt = NULL;
 	sqlite3_stmt *overlapping_stmt = NULL;
 
 	ExonTree *exon_tree = NULL;
 	ChrStd *cs = NULL;
+	DBWriter *writer = NULL;
+	Source *sources = NULL;
+	Source *src = NULL;
 
 	threadpool thpool = NULL;
+	htsThreadPool hts_pool = {NULL, 0};
+	int hts_threads = 0;
+	int workers = 0;
 
-	const int batch_id = 1;
+	int batch_id = 1;
+	int source_offset = 0;
+	int alignment_offset = 0;
 	char timestamp[32] = {};
 	time_t t = 0;
 	struct tm *lt = NULL;
@@ -116,91 +323,294 @@ run (ProcessSample *ps)
 	const char *sam_file = NULL;
 	const int num_files = array_len (ps->sam_files);
 	char *db_file = NULL;
+	Array *jobs = NULL;
+	Array *shards = NULL;
+	int resume = 0;
 	int i = 0;
 
 	// Assemble database output filename
-	xasprintf_concat (&db_file, "%s/%s.db",
-			ps->output_dir, ps->prefix);
+	if (ps->append != NULL)
+		db_file = xstrdup (ps->append);
+	else
+		xasprintf_concat (&db_file, "%s/%s.db",
+				ps->output_dir, ps->prefix);
 
 	log_info ("Create output dir '%s'", ps->output_dir);
 	mkdir_p (ps->output_dir);
 
+	// Pick up the work of a previous run
+	resume = ps->resume && exists (db_file);
+
 	// Create and connect to database
-	log_info ("Create and connect to database '%s'", db_file);
-	db = db_create (db_file);
+	if (resume)
+		{
+			log_info ("Resume database '%s'", db_file);
+			db = db_connect (db_file);
+		}
+	else if (ps->append != NULL)
+		{
+			log_info ("Append to database '%s'", db_file);
+			db = db_connect (db_file);
+
+			// The new batch, sources and alignments
+			// come after the ones already there
+			batch_id = max_id (db, "batch") + 1;
+			source_offset = max_id (db, "source");
+			alignment_offset = max_id (db, "alignment");
+		}
+	else
+		{
+			log_info ("Create and connect to database '%s'", db_file);
+			db = db_create (db_file);
+		}
+
 	batch_stmt = db_prepare_batch_stmt (db);
 	source_stmt = db_prepare_source_stmt (db);
 	alignment_stmt = db_prepare_alignment_stmt (db);
 	exon_stmt = db_prepare_exon_stmt (db);
+	gene_stmt = db_prepare_gene_stmt (db);
+	contig_stmt = db_prepare_contig_stmt (db);
 	overlapping_stmt = db_prepare_overlapping_stmt (db);
 
 	// Increase the cache size
 	db_cache_size (db, ps->cache_size);
 
-	// Begin transaction to speed up
-	db_begin_transaction (db);
+	// Get chromosome standardization
+	cs = chr_std_new ();
 
-	// Get current local datetime as timestamp
-	// for batch table
-	t = time (NULL);
-	lt = localtime (&t);
-	timestamp[strftime (timestamp, sizeof (timestamp),
-			"%Y-%m-%d %H:%M:%S", lt)] = '\0';
+	if (ps->chr_alias != NULL)
+		{
+			log_info ("Load contig aliases from '%s'", ps->chr_alias);
+			chr_std_load_alias (cs, ps->chr_alias);
+		}
 
-	// Dump batch entry
-	log_debug ("Dump batch entry %d => %s", batch_id, timestamp);
-	db_insert_batch (batch_stmt, batch_id, timestamp);
+	// The alignments already there refer
+	// to the contigs by their ids
+	if (resume || ps->append != NULL)
+		chr_std_load (cs, db);
 
-	// Get chromosome standardization
-	cs = chr_std_new ();
+	// CRAM references fetched by MD5
+	// are kept in a local directory
+	if (ps->ref_cache != NULL)
+		sam_set_ref_cache (ps->ref_cache);
 
-	// Index protein coding genes into the database
-	// and its exons into an intervalar tree by
-	// chromosome
-	log_info ("Index annotation file '%s'", ps->gff_file);
-	exon_tree = exon_tree_new (exon_stmt, overlapping_stmt, cs);
-	exon_tree_index_dump (exon_tree, ps->gff_file);
+	// Annotation compressed by bgzip is decompressed
+	// by all threads, since it is loaded up front
+	gz_set_threads (ps->threads);
 
 	log_info ("Create thread pool");
 	thpool = thpool_init (ps->threads);
 
-	AbnormalArg *ab_args = xcalloc (num_files, sizeof (AbnormalArg));
+	// Each file writes into its own database, or the
+	// workers fill batches of rows and a single thread
+	// writes them. Either way, no worker waits for the
+	// database lock
+	if (!ps->private_db)
+		{
+			log_info ("Create database writer thread");
+			writer = db_writer_new (alignment_stmt, overlapping_stmt,
+					2 * ps->threads);
+		}
+
+	exon_tree = exon_tree_new (exon_stmt, gene_stmt, overlapping_stmt, cs);
+	sources = xcalloc (num_files, sizeof (Source));
 
 	for (i = 0; i < num_files; i++)
 		{
 			sam_file = array_get (ps->sam_files, i);
 
 			// Init abnormal_filter arg
-			ab_args[i] = (AbnormalArg)
+			sources[i].arg = (AbnormalArg)
 			{
-				.tid              = i + 1,
+				.tid              = alignment_offset + i + 1,
 				.inc_step         = num_files,
+				.source_id        = source_offset + i + 1,
 				.sam_file         = sam_file,
 				.either           = ps->either,
 				.exon_frac        = ps->exon_frac,
 				.alignment_frac   = ps->alignment_frac,
+				.exonic_only      = ps->exonic_only,
 				.exon_tree        = exon_tree,
 				.cs               = cs,
 				.alignment_stmt   = alignment_stmt,
+				.overlapping_stmt = overlapping_stmt,
 				.queryname_sorted = ps->sorted,
 				.max_distance     = ps->max_distance,
 				.phred_quality    = ps->phred_quality,
-				.max_base_freq    = ps->max_base_freq
+				.max_base_freq    = ps->max_base_freq,
+				.max_memory       = ps->max_memory * 1024 * 1024,
+				.fetch_mates      = ps->fetch_mates,
+				.single_pass      = ps->single_pass,
+				.tmp_dir          = ps->tmp_dir != NULL ? ps->tmp_dir : ps->output_dir,
+				.writer           = writer
 			};
+		}
+
+	// Begin transaction to speed up
+	db_begin_transaction (db);
+
+	if (resume)
+		{
+			// The exons were dumped by the previous run
+			log_info ("Index annotation from database '%s'", db_file);
+			exon_tree_index (exon_tree, db);
+
+			resume_sources (db, sources, num_files);
+		}
+	else
+		{
+			// Get current local datetime as timestamp
+			// for batch table
+			t = time (NULL);
+			lt = localtime (&t);
+			timestamp[strftime (timestamp, sizeof (timestamp),
+					"%Y-%m-%d %H:%M:%S", lt)] = '\0';
+
+			// Dump batch entry
+			log_debug ("Dump batch entry %d => %s", batch_id, timestamp);
+			db_insert_batch (batch_stmt, batch_id, timestamp);
+
+			if (ps->append != NULL)
+				{
+					// Reuse the exons of the first samples
+					log_info ("Index annotation from database '%s'", db_file);
+					exon_tree_index (exon_tree, db);
+				}
+			else if (ps->annotation_cache != NULL)
+				{
+					// The annotation parsed by a previous
+					// run, if it was the same file
+					exon_tree_index_dump_cached (exon_tree, ps->gff_file,
+							ps->annotation_cache);
+				}
+			else
+				{
+					// Index protein coding genes into the database
+					// and its exons into an intervalar tree by
+					// chromosome
+					log_info ("Index annotation file '%s'", ps->gff_file);
+					exon_tree_index_dump (exon_tree, ps->gff_file);
+				}
+
+			for (i = 0; i < num_files; i++)
+				{
+					log_debug ("Dump source entry '%s'", sources[i].arg.sam_file);
+					db_insert_source (source_stmt, sources[i].arg.source_id,
+							batch_id, sources[i].arg.sam_file);
+				}
+		}
+
+	// The contigs of the annotation
+	chr_std_dump (cs, contig_stmt);
+
+	// Checkpoint: the annotation and the sources
+	// are kept, even if some file fails
+	db_end_transaction (db);
+
+	// The shared database takes all the files
+	// in a single transaction
+	if (writer != NULL)
+		db_begin_transaction (db);
+
+	jobs = array_new (NULL);
+	shards = array_new (NULL);
+
+	for (i = 0; i < num_files; i++)
+		{
+			src = &sources[i];
+
+			if (src->done)
+				continue;
+
+			if (ps->private_db)
+				source_db_open (src, db, ps->prefix, batch_id);
+
+			// Indexed files are splitted into regions and all
+			// threads work at the same file
+			if (ps->shard_size > 0 && sam_is_indexed (src->arg.sam_file))
+				{
+					array_add (shards, src);
+					continue;
+				}
+
+			// Measure once, not at each comparison
+			src->cost = abnormal_filter_cost (&src->arg);
+			array_add (jobs, src);
+		}
+
+	// When not set, the threads left idle by the
+	// workers are used to decompress the SAM/BAM/CRAM
+	// blocks. The shards keep all the workers busy
+	workers = array_len (shards) > 0 || array_len (jobs) > ps->threads
+		? ps->threads
+		: array_len (jobs);
+
+	hts_threads = ps->hts_threads_set
+		? ps->hts_threads
+		: ps->threads - workers;
+
+	if (hts_threads > 0)
+		{
+			log_info ("Create decompression thread pool with %d threads",
+					hts_threads);
+			hts_pool.pool = hts_tpool_init (hts_threads);
+			if (hts_pool.pool == NULL)
+				log_errno_fatal ("Failed to create decompression thread pool");
+
+			for (i = 0; i < num_files; i++)
+				sources[i].arg.hts_pool = &hts_pool;
+		}
+
+	// The whole files cannot be splitted, so they are
+	// queued before the shards, and the largest first:
+	// The shards fill the threads left idle by them
+	array_sort (jobs, cmp_abnormal_filter_cost);
 
-			log_debug ("Dump source entry '%s'", sam_file);
-			db_insert_source (source_stmt, i + 1, batch_id, sam_file);
+	for (i = 0; i < array_len (jobs); i++)
+		{
+			src = array_get (jobs, i);
+
+			log_info ("Run abnormal filter for '%s'", src->arg.sam_file);
+			thpool_add_work (thpool, (void *) source_filter,
+					(void *) src);
+		}
 
-			log_info ("Run abnormal filter for '%s'", sam_file);
-			thpool_add_work (thpool, (void *) abnormal_filter,
-					(void *) &ab_args[i]);
+	// Each sharded file waits only for its own
+	// shards, not for the whole files queued above
+	for (i = 0; i < array_len (shards); i++)
+		{
+			src = array_get (shards, i);
+
+			log_info ("Run sharded abnormal filter for '%s'",
+					src->arg.sam_file);
+
+			if (abnormal_filter_sharded (&src->arg, thpool,
+						ps->shard_size))
+				{
+					if (src->db != NULL)
+						source_db_commit (src);
+				}
+			else
+				thpool_add_work (thpool, (void *) source_filter,
+						(void *) src);
 		}
 
 	// Wait all threads to return
 	thpool_wait (thpool);
 
-	// Commit database
-	db_end_transaction (db);
+	if (writer != NULL)
+		{
+			// Write the remaining batches
+			db_writer_free (writer);
+
+			// The contigs met at the alignment files
+			chr_std_dump (cs, contig_stmt);
+
+			db_exec (db, "UPDATE source SET done = 1");
+
+			// Commit database
+			db_end_transaction (db);
+		}
 
 	if (ps->deduplicate)
 		{
@@ -221,6 +631,8 @@ run (ProcessSample *ps)
 
 	// Time to clean
 	db_finalize (exon_stmt);
+	db_finalize (gene_stmt);
+	db_finalize (contig_stmt);
 	db_finalize (batch_stmt);
 	db_finalize (source_stmt);
 	db_finalize (alignment_stmt);
@@ -228,12 +640,17 @@ run (ProcessSample *ps)
 	db_close (db);
 
 	xfree (db_file);
-	xfree (ab_args);
+	xfree (sources);
+	array_free (jobs, 1);
+	array_free (shards, 1);
 
 	chr_std_free (cs);
 	exon_tree_free (exon_tree);
 
 	thpool_destroy (thpool);
+
+	if (hts_pool.pool != NULL)
+		hts_tpool_destroy (hts_pool.pool);
 }
 
 static void
@@ -244,10 +661,12 @@ print_usage (FILE *fp)
 		"%s\n"
 		"\n"
 		"Usage: %s process-sample [-h] [-q] [-d] [-s] [-l FILE] [-o DIR]\n"
-		"       %*c                [-p STR] [-t INT] [-c INT] [-Q INT]\n"
-		"       %*c                [-m INT] [-f FLOAT] [-F FLOAT | -r]\n"
-		"       %*c                [-D] [-M FLOAT] [-e] [-i FILE]\n"
-		"       %*c                -a FILE <FILE> ...\n"
+		"       %*c                [-p STR] [-t INT] [-T INT] [-c INT]\n"
+		"       %*c                [-Q INT] [-m INT] [-f FLOAT] [-F FLOAT | -r]\n"
+		"       %*c                [-D] [-M FLOAT] [-e] [-S INT] [-i FILE]\n"
+		"       %*c                [-b INT] [-I] [-O] [-B DIR] [-P] [-R DIR]\n"
+		"       %*c                [-C DIR] [-L FILE] [-k] [-E]\n"
+		"       %*c                (-a FILE | -A FILE) <FILE> ...\n"
 		"\n"
 		"Extract alignments related to event of retrocopy\n"
 		"\n"
@@ -255,12 +674,15 @@ print_usage (FILE *fp)
 		"   $ sider ps -l ps.log -a gencode.gff3.gz -o result in.bam\n"
 		"   $ sider ps -t 3 -a gencode.gtf in1.bam in2.sam in3.bam\n"
 		"   $ sider ps -t 5 -m 15000 -Q 20 -F 0.9 -a exon.gtf -i list.txt\n"
+		"   $ samtools view -h in.bam | sider ps -a gencode.gtf -\n"
+		"   $ sider ps -A result/out.db late.bam\n"
 		"\n"
 		"Output:\n"
 		"   A SQLite3 database that can be processed at 'merge-call' step\n"
 		"\n"
 		"Arguments:\n"
-		"   One or more alignment file in SAM/BAM/CRAM format\n"
+		"   One or more alignment file in SAM/BAM/CRAM format.\n"
+		"   Use '-' to read from the standard input\n"
 		"\n"
 		"Mandatory Options:\n"
 		"   -a, --annotation-file   Gene annotation on the reference genome\n"
@@ -287,9 +709,24 @@ print_usage (FILE *fp)
 		"   -o, --output-dir        Output directory. Create the directory if it does\n"
 		"                           not exist [default:\"%s\"]\n"
 		"   -p, --prefix            Prefix output files [default:\"%s\"]\n"
+		"   -C, --annotation-cache  Directory to cache the exons filtered from\n"
+		"                           'annotation-file'. A later run with the same\n"
+		"                           annotation loads them from there, instead of\n"
+		"                           parsing the file again\n"
+		"   -A, --append            Append the alignment files to the database FILE\n"
+		"                           of a previous run, reusing its annotation.\n"
+		"                           The option '--annotation-file' is not required\n"
+		"   -k, --resume            Resume a previous run with the same output.\n"
+		"                           The files already processed are skipped.\n"
+		"                           It implies '--private-db', so that each file\n"
+		"                           is committed as soon as it finishes\n"
 		"\n"
 		"SQLite3 Options:\n"
 		"   -c, --cache-size        Set SQLite3 cache size in KiB [default:\"%d\"]\n"
+		"   -P, --private-db        Each file writes its alignments into a private\n"
+		"                           database at 'tmp-dir', which is merged into the\n"
+		"                           output at the end. The threads never wait for\n"
+		"                           one another to write, at the cost of disk space\n"
 		"\n"
 		"Read Quality Options:\n"
 		"   -Q, --phred-quality     Minimum mapping quality of the reads required\n"
@@ -304,6 +741,44 @@ print_usage (FILE *fp)
 		"   -s, --sorted            Assume all reads are grouped by queryname, even if\n"
 		"                           there is no SAM/BAM/CRAM header tag 'SO:queryname'\n"
 		"   -t, --threads           Number of threads [default:\"%d\"]\n"
+		"   -T, --hts-threads       Number of threads shared among all files to\n"
+		"                           decompress SAM/BAM/CRAM blocks. If not set, the\n"
+		"                           threads exceeding the number of files are used,\n"
+		"                           none if some file is splitted by '--shard-size'.\n"
+		"                           A value of 0 disables the shared pool\n"
+		"   -S, --shard-size        Split coordinate sorted and indexed files into\n"
+		"                           genomic regions of INT bases, so that all threads\n"
+		"                           work at the same file. A value of 0 disables the\n"
+		"                           splitting [default:\"%d\"]\n"
+		"   -b, --max-memory        Maximum memory in MiB per file to group the reads\n"
+		"                           of files sorted neither by queryname nor by\n"
+		"                           coordinate. The exceeding reads are sorted into\n"
+		"                           temporary files at 'tmp-dir', which must hold up\n"
+		"                           to twice the file size in BAM. A value of 0 keeps\n"
+		"                           the abnormal read names in memory, but pipes and\n"
+		"                           the standard input, which cannot be read twice,\n"
+		"                           use 1024\n"
+		"                           [default:\"%d\"]\n"
+		"   -I, --fetch-mates       Files with no 'SO:queryname' nor 'SO:coordinate'\n"
+		"                           header tag, but indexed, are read once. Then the\n"
+		"                           mates of the abnormal reads are fetched from the\n"
+		"                           index, which is faster when they are few. The\n"
+		"                           secondary alignments are not fetched\n"
+		"   -O, --single-pass       Files with 'SO:coordinate' header tag are read\n"
+		"                           once, pairing the reads as the scan passes by\n"
+		"                           their mates, instead of three times. A failing\n"
+		"                           secondary alignment placed after all the other\n"
+		"                           reads of its fragment no longer drops it\n"
+		"   -B, --tmp-dir           Directory for the temporary files. If not set,\n"
+		"                           'output-dir' is used\n"
+		"   -R, --ref-cache         Directory to cache the CRAM reference sequences\n"
+		"                           fetched by their MD5. If not set, the htslib\n"
+		"                           default is used\n"
+		"   -L, --chr-alias         Two columns file with the contig names of the\n"
+		"                           alignment and annotation files and their\n"
+		"                           standardized names, for assemblies other than\n"
+		"                           the human. The same file must be passed to\n"
+		"                           'merge-call'\n"
 		"   -m, --max-distance      Maximum distance allowed between paired-end reads\n"
 		"                           [default:\"%d\"]\n"
 		"   -f, --exon-frac         Minimum overlap required as a fraction of exon\n"
@@ -316,10 +791,16 @@ print_usage (FILE *fp)
 		"   -r, --reciprocal        The fraction overlap must be reciprocal for exon and\n"
 		"                           alignment. If '-f' is 0.5, then '-F' will be set to\n"
 		"                           0.5 as well\n"
+		"   -E, --exonic-only       Keep only the abnormal fragments with at least one\n"
+		"                           read overlapping an exon. The other ones are never\n"
+		"                           clustered by 'merge-call', so the database gets\n"
+		"                           smaller and faster to merge\n"
 		"\n",
-		PACKAGE_STRING, PACKAGE, pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ',
+		PACKAGE_STRING, PACKAGE, pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ', pkg_len, ' ',
+		pkg_len, ' ',
 		PACKAGE, DEFAULT_OUTPUT_DIR, DEFAULT_PREFIX, DEFAULT_CACHE_SIZE, DEFAULT_PHRED_QUALITY,
-		DEFAULT_MAX_BASE_FREQ, DEFAULT_THREADS, DEFAULT_MAX_DISTANCE,
+		DEFAULT_MAX_BASE_FREQ, DEFAULT_THREADS, DEFAULT_SHARD_SIZE, DEFAULT_MAX_MEMORY,
+		DEFAULT_MAX_DISTANCE,
 		DEFAULT_EXON_FRAC, DEFAULT_ALIGNMENT_FRAC);
 }
 
@@ -339,22 +820,36 @@ process_sample_init (ProcessSample *ps)
 		.input_file         = NULL,
 		.output_dir         = DEFAULT_OUTPUT_DIR,
 		.prefix             = DEFAULT_PREFIX,
+		.resume             = DEFAULT_RESUME,
+		.append             = NULL,
 		.logger             = NULL,
 		.log_file           = NULL,
 		.log_level          = DEFAULT_LOG_LEVEL,
 		.silent             = DEFAULT_LOG_SILENT,
 		.cache_size         = DEFAULT_CACHE_SIZE,
+		.private_db         = DEFAULT_PRIVATE_DB,
 		.max_base_freq      = DEFAULT_MAX_BASE_FREQ,
 		.phred_quality      = DEFAULT_PHRED_QUALITY,
 		.deduplicate        = DEFAULT_DEDUPLICATE,
 		.threads            = DEFAULT_THREADS,
+		.hts_threads        = DEFAULT_HTS_THREADS,
+		.hts_threads_set    = 0,
 		.sorted             = DEFAULT_SORTED,
+		.shard_size         = DEFAULT_SHARD_SIZE,
+		.max_memory         = DEFAULT_MAX_MEMORY,
+		.fetch_mates        = DEFAULT_FETCH_MATES,
+		.single_pass        = DEFAULT_SINGLE_PASS,
+		.tmp_dir            = NULL,
+		.ref_cache          = NULL,
+		.annotation_cache   = NULL,
+		.chr_alias          = NULL,
 		.max_distance       = DEFAULT_MAX_DISTANCE,
 		.exon_frac          = DEFAULT_EXON_FRAC,
 		.alignment_frac     = DEFAULT_ALIGNMENT_FRAC,
 		.alignment_frac_set = 0,
 		.reciprocal         = DEFAULT_RECIPROCAL,
-		.either             = DEFAULT_EITHER
+		.either             = DEFAULT_EITHER,
+		.exonic_only        = DEFAULT_EXONIC_ONLY
 	};
 }
 
@@ -392,23 +887,32 @@ process_sample_validate (ProcessSample *ps)
 	for (i = 0; i < array_len (ps->sam_files); i++)
 		{
 			const char *sam_file = array_get (ps->sam_files, i);
-			if (!exists (sam_file))
+			// The standard input is read from '-'
+			if (strcmp (sam_file, "-") && !exists (sam_file))
 				{
 					fprintf (stderr, "%s: alignment file '%s': No such file\n", PACKAGE, sam_file);
 					rc = EXIT_FAILURE; goto Exit;
 				}
 		}
 
-	// If no annotation-file was passed, throw an error
-	if (ps->gff_file == NULL)
+	// If no annotation-file was passed, throw an error.
+	// The appended database has its annotation
+	if (ps->gff_file == NULL && ps->append == NULL)
 		{
 			fprintf (stderr, "%s: Missing annotation file (GTF/GFF3)\n", PACKAGE);
 			print_try_help (stderr);
 			rc = EXIT_FAILURE; goto Exit;
 		}
 
+	// Test if chr_alias exists
+	if (ps->chr_alias != NULL && !exists (ps->chr_alias))
+		{
+			fprintf (stderr, "%s: --chr-alias '%s': No such file\n", PACKAGE, ps->chr_alias);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
 	// Test if annotation file exists
-	if (!exists (ps->gff_file))
+	if (ps->gff_file != NULL && !exists (ps->gff_file))
 		{
 			fprintf (stderr, "%s: annotation file '%s': No such file\n", PACKAGE, ps->gff_file);
 			rc = EXIT_FAILURE; goto Exit;
@@ -418,6 +922,20 @@ process_sample_validate (ProcessSample *ps)
 	* Validate options
 	*/
 
+	// Test if the database to append exists
+	if (ps->append != NULL && !exists (ps->append))
+		{
+			fprintf (stderr, "%s: database '%s': No such file\n", PACKAGE, ps->append);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
+	// A resumed run must have the same sources
+	if (ps->append != NULL && ps->resume)
+		{
+			fprintf (stderr, "%s: --append and --resume are mutually exclusive\n", PACKAGE);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
 	// If --reciprocal, set alignment_frac to exon_frac
 	if (ps->reciprocal)
 		{
@@ -450,6 +968,34 @@ process_sample_validate (ProcessSample *ps)
 			rc = EXIT_FAILURE; goto Exit;
 		}
 
+	// Validate hts_threads >= 0
+	if (ps->hts_threads < 0)
+		{
+			fprintf (stderr, "%s: --hts-threads must be greater or equal to 0\n", PACKAGE);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
+	// Validate shard_size >= 0
+	if (ps->shard_size < 0)
+		{
+			fprintf (stderr, "%s: --shard-size must be a positive value\n", PACKAGE);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
+	// Validate max_memory >= 0
+	if (ps->max_memory < 0)
+		{
+			fprintf (stderr, "%s: --max-memory must be a positive value\n", PACKAGE);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
+	// Test if tmp_dir exists
+	if (ps->tmp_dir != NULL && !exists (ps->tmp_dir))
+		{
+			fprintf (stderr, "%s: tmp dir '%s': No such directory\n", PACKAGE, ps->tmp_dir);
+			rc = EXIT_FAILURE; goto Exit;
+		}
+
 	// Validate cache_size >= DEFAULT_CACHE_SIZE
 	if (ps->cache_size < DEFAULT_CACHE_SIZE)
 		{
@@ -485,6 +1031,11 @@ process_sample_validate (ProcessSample *ps)
 	// Avoid to include repetitive files
 	array_uniq (ps->sam_files, cmpstringp);
 
+	// Each file must be committed on its
+	// own in order to be resumed
+	if (ps->resume)
+		ps->private_db = 1;
+
 	// If it's silent and no log file
 	// was passed, then set log_level
 	// to LOG_ERROR - At least print
@@ -529,10 +1080,15 @@ process_sample_print (const ProcessSample *ps)
 		"# Run %s\n"
 		"$ %s process-sample\n"
 		"  --input-file='my-inputfile.txt' \\\n"
-		"  --annotation-file='%s' \\\n"
 		"  --output-dir='%s' \\\n"
 		"  --prefix='%s' \\\n",
-		PACKAGE, PACKAGE, ps->gff_file, ps->output_dir, ps->prefix);
+		PACKAGE, PACKAGE, ps->output_dir, ps->prefix);
+
+	if (ps->gff_file != NULL)
+		string_concat_printf (msg, "  --annotation-file='%s' \\\n", ps->gff_file);
+
+	if (ps->annotation_cache != NULL)
+		string_concat_printf (msg, "  --annotation-cache='%s' \\\n", ps->annotation_cache);
 
 	if (ps->log_file != NULL)
 		string_concat_printf (msg, "  --log-file='%s' \\\n", ps->log_file);
@@ -549,12 +1105,45 @@ process_sample_print (const ProcessSample *ps)
 		"  --phred-quality=%d \\\n",
 		ps->cache_size, ps->max_base_freq,  ps->phred_quality);
 
+	if (ps->private_db)
+		string_concat_printf (msg, "  --private-db \\\n");
+
+	if (ps->resume)
+		string_concat_printf (msg, "  --resume \\\n");
+
+	if (ps->append != NULL)
+		string_concat_printf (msg, "  --append='%s' \\\n", ps->append);
+
 	if (ps->deduplicate)
 		string_concat_printf (msg, "  --deduplicate \\\n");
 
 	if (ps->sorted)
 		string_concat_printf (msg, "  --sorted \\\n");
 
+	if (ps->shard_size > 0)
+		string_concat_printf (msg, "  --shard-size=%ld \\\n", ps->shard_size);
+
+	if (ps->max_memory > 0)
+		string_concat_printf (msg, "  --max-memory=%ld \\\n", ps->max_memory);
+
+	if (ps->fetch_mates)
+		string_concat_printf (msg, "  --fetch-mates \\\n");
+
+	if (ps->single_pass)
+		string_concat_printf (msg, "  --single-pass \\\n");
+
+	if (ps->tmp_dir != NULL)
+		string_concat_printf (msg, "  --tmp-dir='%s' \\\n", ps->tmp_dir);
+
+	if (ps->ref_cache != NULL)
+		string_concat_printf (msg, "  --ref-cache='%s' \\\n", ps->ref_cache);
+
+	if (ps->chr_alias != NULL)
+		string_concat_printf (msg, "  --chr-alias='%s' \\\n", ps->chr_alias);
+
+	if (ps->hts_threads_set)
+		string_concat_printf (msg, "  --hts-threads=%d \\\n", ps->hts_threads);
+
 	string_concat_printf (msg,
 		"  --threads=%d \\\n"
 		"  --max-distance=%d \\\n"
@@ -569,6 +1158,12 @@ process_sample_print (const ProcessSample *ps)
 			string_concat_printf (msg, "  --either");
 		}
 
+	if (ps->exonic_only)
+		{
+			string_concat_printf (msg, " \\\n");
+			string_concat_printf (msg, "  --exonic-only");
+		}
+
 	string_concat_printf (msg, "\n");
 
 	log_info ("%s", msg->str);
@@ -596,19 +1191,32 @@ parse_process_sample_command_opt (int argc, char **argv)
 		{"debug",           no_argument,       0, 'd'},
 		{"log-file",        required_argument, 0, 'l'},
 		{"annotation-file", required_argument, 0, 'a'},
+		{"annotation-cache", required_argument, 0, 'C'},
 		{"output-dir",      required_argument, 0, 'o'},
 		{"prefix",          required_argument, 0, 'p'},
+		{"resume",          no_argument,       0, 'k'},
+		{"append",          required_argument, 0, 'A'},
 		{"threads",         required_argument, 0, 't'},
+		{"hts-threads",     required_argument, 0, 'T'},
 		{"phred-quality",   required_argument, 0, 'Q'},
 		{"max-distance",    required_argument, 0, 'm'},
 		{"max-base-freq",   required_argument, 0, 'M'},
 		{"cache-size",      required_argument, 0, 'c'},
+		{"private-db",      no_argument,       0, 'P'},
 		{"sorted",          no_argument,       0, 's'},
+		{"shard-size",      required_argument, 0, 'S'},
+		{"max-memory",      required_argument, 0, 'b'},
+		{"fetch-mates",     no_argument,       0, 'I'},
+		{"single-pass",     no_argument,       0, 'O'},
+		{"tmp-dir",         required_argument, 0, 'B'},
+		{"ref-cache",       required_argument, 0, 'R'},
+		{"chr-alias",       required_argument, 0, 'L'},
 		{"deduplicate",     no_argument,       0, 'D'},
 		{"exon-frac",       required_argument, 0, 'f'},
 		{"alignment-frac",  required_argument, 0, 'F'},
 		{"either",          no_argument,       0, 'e'},
 		{"reciprocal",      no_argument,       0, 'r'},
+		{"exonic-only",     no_argument,       0, 'E'},
 		{"input-file",      required_argument, 0, 'i'},
 		{0,                 0,                 0,  0 }
 	};
@@ -621,7 +1229,7 @@ parse_process_sample_command_opt (int argc, char **argv)
 	int option_index = 0;
 	int c, i;
 
-	while ((c = getopt_long (argc, argv, "hqdsDl:a:o:p:t:m:M:c:Q:f:F:eri:", opt, &option_index)) >= 0)
+	while ((c = getopt_long (argc, argv, "hqdsDPkEIOA:l:a:C:o:p:t:T:m:M:c:Q:f:F:eri:S:b:B:R:L:", opt, &option_index)) >= 0)
 		{
 			switch (c)
 				{
@@ -666,6 +1274,12 @@ parse_process_sample_command_opt (int argc, char **argv)
 						ps.threads = atoi (optarg);
 						break;
 					}
+				case 'T':
+					{
+						ps.hts_threads = atoi (optarg);
+						ps.hts_threads_set = 1;
+						break;
+					}
 				case 'c':
 					{
 						ps.cache_size = atoi (optarg);
@@ -696,6 +1310,61 @@ parse_process_sample_command_opt (int argc, char **argv)
 						ps.sorted = 1;
 						break;
 					}
+				case 'P':
+					{
+						ps.private_db = 1;
+						break;
+					}
+				case 'k':
+					{
+						ps.resume = 1;
+						break;
+					}
+				case 'A':
+					{
+						ps.append = optarg;
+						break;
+					}
+				case 'S':
+					{
+						ps.shard_size = atol (optarg);
+						break;
+					}
+				case 'b':
+					{
+						ps.max_memory = atol (optarg);
+						break;
+					}
+				case 'I':
+					{
+						ps.fetch_mates = 1;
+						break;
+					}
+				case 'O':
+					{
+						ps.single_pass = 1;
+						break;
+					}
+				case 'B':
+					{
+						ps.tmp_dir = optarg;
+						break;
+					}
+				case 'R':
+					{
+						ps.ref_cache = optarg;
+						break;
+					}
+				case 'C':
+					{
+						ps.annotation_cache = optarg;
+						break;
+					}
+				case 'L':
+					{
+						ps.chr_alias = optarg;
+						break;
+					}
 				case 'f':
 					{
 						ps.exon_frac = atof (optarg);
@@ -717,6 +1386,11 @@ parse_process_sample_command_opt (int argc, char **argv)
 						ps.reciprocal = 1;
 						break;
 					}
+				case 'E':
+					{
+						ps.exonic_only = 1;
+						break;
+					}
 				case 'i':
 					{
 						ps.input_file = optarg;
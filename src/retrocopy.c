@@ -38,18 +38,18 @@
 struct _ClusterEntry
 {
 	// CLUSTER
-	int         cid;
-	int         sid;
-	const char *cchr;
-	long        cstart;
-	long        cend;
+	int   cid;
+	int   sid;
+	int   cchr_id;
+	long  cstart;
+	long  cend;
 
 	// PARENTAL
-	const char *gene_name;
-	const char *gchr;
-	long        gstart;
-	long        gend;
-	int         dist;
+	int   gene_name_id;
+	int   gchr_id;
+	long  gstart;
+	long  gend;
+	int   dist;
 };
 
 typedef struct _ClusterEntry ClusterEntry;
@@ -64,22 +64,22 @@ struct _RetrocopyEntry
 typedef struct _RetrocopyEntry RetrocopyEntry;
 
 static ClusterEntry *
-cluster_entry_new (int cid, int sid, const char *cchr, long cstart, long cend,
-		const char *gene_name, const char *gchr, long gstart, long gend, int dist)
+cluster_entry_new (int cid, int sid, int cchr_id, long cstart, long cend,
+		int gene_name_id, int gchr_id, long gstart, long gend, int dist)
 {
 	ClusterEntry *c = xcalloc (1, sizeof (ClusterEntry));
 
 	*c = (ClusterEntry) {
-		.cid       = cid,
-		.sid       = sid,
-		.cchr      = xstrdup (cchr),
-		.cstart    = cstart,
-		.cend      = cend,
-		.gene_name = xstrdup (gene_name),
-		.gchr      = xstrdup (gchr),
-		.gstart    = gstart,
-		.gend      = gend,
-		.dist      = dist
+		.cid          = cid,
+		.sid          = sid,
+		.cchr_id      = cchr_id,
+		.cstart       = cstart,
+		.cend         = cend,
+		.gene_name_id = gene_name_id,
+		.gchr_id      = gchr_id,
+		.gstart       = gstart,
+		.gend         = gend,
+		.dist         = dist
 	};
 
 	return c;
@@ -91,10 +91,6 @@ cluster_entry_free (ClusterEntry *c)
 	if (c == NULL)
 		return;
 
-	xfree ((void *) c->cchr);
-	xfree ((void *) c->gene_name);
-	xfree ((void *) c->gchr);
-
 	xfree (c);
 }
 
@@ -120,26 +116,26 @@ prepare_cluster_query_stmt (sqlite3 *db, const int filter)
 
 	const char sql[] =
 		"WITH\n"
-		"	gene (gene_name, chr, start, end) AS (\n"
-		"		SELECT gene_name, chr, MIN(start), MAX(end)\n"
+		"	gene_range (gene_name_id, chr_id, start, end) AS (\n"
+		"		SELECT gene_name_id, chr_id, MIN(start), MAX(end)\n"
 		"		FROM exon\n"
-		"		GROUP BY gene_name\n"
+		"		GROUP BY gene_name_id\n"
 		"	),\n"
-		"	gene_rank (gene_name, chr, start, end, dist) AS (\n"
+		"	gene_rank (gene_name_id, chr_id, start, end, dist) AS (\n"
 		"		SELECT *,\n"
 		"			DENSE_RANK() OVER (\n"
-		"				PARTITION BY chr\n"
+		"				PARTITION BY chr_id\n"
 		"				ORDER BY start ASC, end ASC\n"
 		"			)\n"
-		"		FROM gene\n"
+		"		FROM gene_range\n"
 		"	)\n"
-		"SELECT c.id, c.sid, c.chr, c.start, c.end,\n"
-		"	c.gene_name, g.chr, g.start, g.end, g.dist\n"
+		"SELECT c.id, c.sid, c.chr_id, c.start, c.end,\n"
+		"	c.gene_name_id, g.chr_id, g.start, g.end, g.dist\n"
 		"FROM cluster AS c\n"
 		"INNER JOIN gene_rank AS g\n"
-		"	USING (gene_name)\n"
+		"	USING (gene_name_id)\n"
 		"WHERE c.filter = $FILTER\n"
-		"ORDER BY c.chr ASC, c.start ASC, c.end ASC";
+		"ORDER BY c.chr_id ASC, c.start ASC, c.end ASC";
 
 	log_debug ("Query schema:\n%s", sql);
 	stmt = db_prepare (db, sql);
@@ -152,21 +148,21 @@ prepare_cluster_query_stmt (sqlite3 *db, const int filter)
 }
 
 static inline int
-overlaps (const char *chr1, const long start1, const long end1,
-		const char *chr2, const long start2, const long end2)
+overlaps (const int chr_id1, const long start1, const long end1,
+		const int chr_id2, const long start2, const long end2)
 {
-	if (!strcmp (chr1, chr2) && (start1 <= end2 && end1 >= start2))
+	if (chr_id1 == chr_id2 && (start1 <= end2 && end1 >= start2))
 		return 1;
 
 	return 0;
 }
 
 static inline int
-is_near (const char *chr1, const int dist1,
-		const char *chr2, const int dist2,
+is_near (const int chr_id1, const int dist1,
+		const int chr_id2, const int dist2,
 		const int near_gene_dist)
 {
-	if (!strcmp (chr1, chr2) && abs (dist1 - dist2) <= near_gene_dist)
+	if (chr_id1 == chr_id2 && abs (dist1 - dist2) <= near_gene_dist)
 		return 1;
 
 	return 0;
@@ -178,7 +174,7 @@ cmp_cluster (const void *p1, const void *p2)
 	ClusterEntry *c1 = * (ClusterEntry **) p1;
 	ClusterEntry *c2 = * (ClusterEntry **) p2;
 
-	int rc = strcmp (c1->gchr, c2->gchr);
+	int rc = (c1->gchr_id > c2->gchr_id) - (c1->gchr_id < c2->gchr_id);
 
 	if (!rc)
 		{
@@ -256,15 +252,15 @@ cluster_entry_merge_and_classify (sqlite3_stmt *cluster_merging_stmt,
 		{
 			c = array_get (stack, i);
 
-			if (overlaps (c_prev->gchr, c_prev->gstart, gend_prev,
-						c->gchr, c->gstart, c->gend))
+			if (overlaps (c_prev->gchr_id, c_prev->gstart, gend_prev,
+						c->gchr_id, c->gstart, c->gend))
 				{
 					list_append (to_merge, c);
-					if (strcmp (c_prev->gene_name, c->gene_name))
+					if (c_prev->gene_name_id != c->gene_name_id)
 						level |= RETROCOPY_OVERLAPPED_PARENTALS;
 				}
-			else if (is_near (c_prev->gchr, c_prev->dist,
-						c->gchr, c->dist, near_gene_dist))
+			else if (is_near (c_prev->gchr_id, c_prev->dist,
+						c->gchr_id, c->dist, near_gene_dist))
 				{
 					list_append (to_merge, c);
 					level |= RETROCOPY_NEAR_PARENTALS;
@@ -311,14 +307,13 @@ cluster_entry_merge_and_classify (sqlite3_stmt *cluster_merging_stmt,
 }
 
 static inline void
-merge_cluster_init (Array **a, char **chr, long *start, long *end,
-		const char *chr_v, const long start_v, const long end_v)
+merge_cluster_init (Array **a, int *chr_id, long *start, long *end,
+		const int chr_id_v, const long start_v, const long end_v)
 {
 	array_free (*a, 1);
 	*a = array_new ((DestroyNotify) cluster_entry_free);
 
-	xfree (*chr);
-	*chr = xstrdup (chr_v);
+	*chr_id = chr_id_v;
 
 	*start = start_v;
 	*end = end_v;
@@ -342,19 +337,19 @@ merge_cluster (sqlite3_stmt *cluster_merging_stmt,
 	// CLUSTER
 	int cid = 0;
 	int sid = 0;
-	const char *cchr = NULL;
+	int cchr_id = 0;
 	long cstart = 0;
 	long cend = 0;
 
 	// PARENTAL
-	const char *gene_name = NULL;
-	const char *gchr = NULL;
+	int gene_name_id = 0;
+	int gchr_id = 0;
 	long gstart = 0;
 	long gend = 0;
 	int dist = 0;
 
 	// Previous
-	char *cchr_prev = NULL;
+	int cchr_id_prev = 0;
 	long cstart_prev = 0;
 	long cend_prev = 0;
 
@@ -365,36 +360,36 @@ merge_cluster (sqlite3_stmt *cluster_merging_stmt,
 
 	while (db_step (cluster_query_stmt) == SQLITE_ROW)
 		{
-			cid       = db_column_int   (cluster_query_stmt, 0);
-			sid       = db_column_int   (cluster_query_stmt, 1);
-			cchr      = db_column_text  (cluster_query_stmt, 2);
-			cstart    = db_column_int64 (cluster_query_stmt, 3);
-			cend      = db_column_int64 (cluster_query_stmt, 4);
-
-			gene_name = db_column_text  (cluster_query_stmt, 5);
-			gchr      = db_column_text  (cluster_query_stmt, 6);
-			gstart    = db_column_int64 (cluster_query_stmt, 7);
-			gend      = db_column_int64 (cluster_query_stmt, 8);
-			dist      = db_column_int   (cluster_query_stmt, 9);
+			cid          = db_column_int   (cluster_query_stmt, 0);
+			sid          = db_column_int   (cluster_query_stmt, 1);
+			cchr_id      = db_column_int   (cluster_query_stmt, 2);
+			cstart       = db_column_int64 (cluster_query_stmt, 3);
+			cend         = db_column_int64 (cluster_query_stmt, 4);
+
+			gene_name_id = db_column_int   (cluster_query_stmt, 5);
+			gchr_id      = db_column_int   (cluster_query_stmt, 6);
+			gstart       = db_column_int64 (cluster_query_stmt, 7);
+			gend         = db_column_int64 (cluster_query_stmt, 8);
+			dist         = db_column_int   (cluster_query_stmt, 9);
 
 			// First loop
 			if (stack == NULL)
-				merge_cluster_init (&stack, &cchr_prev, &cstart_prev, &cend_prev,
-						cchr, cstart, cend);
+				merge_cluster_init (&stack, &cchr_id_prev, &cstart_prev, &cend_prev,
+						cchr_id, cstart, cend);
 
 			// Process stacked clusters
-			if (!overlaps (cchr_prev, cstart_prev, cend_prev,
-						cchr, cstart, cend))
+			if (!overlaps (cchr_id_prev, cstart_prev, cend_prev,
+						cchr_id, cstart, cend))
 				{
 					cluster_entry_merge_and_classify (cluster_merging_stmt,
 							stack, rtc_h, near_gene_dist, &rid);
 
-					merge_cluster_init (&stack, &cchr_prev, &cstart_prev, &cend_prev,
-							cchr, cstart, cend);
+					merge_cluster_init (&stack, &cchr_id_prev, &cstart_prev, &cend_prev,
+							cchr_id, cstart, cend);
 				}
 
-			c = cluster_entry_new (cid, sid, cchr, cstart, cend,
-					gene_name, gchr, gstart, gend, dist);
+			c = cluster_entry_new (cid, sid, cchr_id, cstart, cend,
+					gene_name_id, gchr_id, gstart, gend, dist);
 
 			array_add (stack, c);
 
@@ -409,7 +404,6 @@ merge_cluster (sqlite3_stmt *cluster_merging_stmt,
 		cluster_entry_merge_and_classify (cluster_merging_stmt,
 				stack, rtc_h, near_gene_dist, &rid);
 
-	xfree (cchr_prev);
 	array_free (stack, 1);
 	db_finalize (cluster_query_stmt);
 }
@@ -593,10 +587,10 @@ prepare_cluster_merging_query_stmt (sqlite3 *db)
 		"	),\n"
 		"	cluster_cigar_mode (id, sid, pos) AS (\n"
 		"		SELECT cluster_id, cluster_sid,\n"
-		"			(SELECT CASE\n"
-		"				WHEN cigar LIKE '%M%S' OR cigar LIKE '%M%H' THEN\n"
+		"			(SELECT CASE cigar_clip_side(cigar)\n"
+		"				WHEN 'right' THEN\n"
 		"					pos + rlen\n"
-		"				WHEN cigar LIKE '%S%M' OR cigar LIKE '%H%M' THEN\n"
+		"				WHEN 'left' THEN\n"
 		"					pos\n"
 		"				ELSE\n"
 		"					NULL\n"
@@ -630,16 +624,18 @@ prepare_cluster_merging_query_stmt (sqlite3 *db)
 		"		LEFT JOIN cluster_cigar_mode AS b\n"
 		"			USING (id, sid)\n"
 		"	),\n"
-		"	cluster_merge (rid, id, sid, chr, start, end, gene) AS (\n"
+		"	cluster_merge (rid, id, sid, chr_id, start, end, gene) AS (\n"
 		"		SELECT retrocopy_id, c.id, c.sid,\n"
-		"			chr, MIN(start), MAX(end),\n"
-		"			REPLACE(GROUP_CONCAT(DISTINCT gene_name),',','/')\n"
+		"			chr_id, MIN(start), MAX(end),\n"
+		"			REPLACE(GROUP_CONCAT(DISTINCT g.name),',','/')\n"
 		"		FROM cluster AS c\n"
 		"		INNER JOIN cluster_merging AS m\n"
 		"			ON c.id = m.cluster_id AND c.sid = m.cluster_sid\n"
+		"		INNER JOIN gene AS g\n"
+		"			ON g.id = c.gene_name_id\n"
 		"		GROUP BY retrocopy_id\n"
 		"	)\n"
-		"SELECT rid, chr, start, end, gene, ip, ip_type\n"
+		"SELECT rid, chr_id, start, end, gene, ip, ip_type\n"
 		"FROM cluster_merge AS c\n"
 		"INNER JOIN cluster_ip AS i\n"
 		"	USING (id, sid)";
@@ -666,7 +662,7 @@ annotate_retrocopy (sqlite3_stmt *retrocopy_stmt, Hash *rtc_h)
 	sqlite3_stmt *cluster_merging_query_stmt = NULL;
 
 	int rid = 0;
-	const char *chr = NULL;
+	int chr_id = 0;
 	long start = 0;
 	long end = 0;
 	const char *gene = NULL;
@@ -681,7 +677,7 @@ annotate_retrocopy (sqlite3_stmt *retrocopy_stmt, Hash *rtc_h)
 	while (db_step (cluster_merging_query_stmt) == SQLITE_ROW)
 		{
 			rid     = db_column_int   (cluster_merging_query_stmt, 0);
-			chr     = db_column_text  (cluster_merging_query_stmt, 1);
+			chr_id  = db_column_int   (cluster_merging_query_stmt, 1);
 			start   = db_column_int64 (cluster_merging_query_stmt, 2);
 			end     = db_column_int64 (cluster_merging_query_stmt, 3);
 			gene    = db_column_text  (cluster_merging_query_stmt, 4);
@@ -691,11 +687,11 @@ annotate_retrocopy (sqlite3_stmt *retrocopy_stmt, Hash *rtc_h)
 			e = hash_lookup (rtc_h, &rid);
 			assert (e != NULL);
 
-			log_debug ("%d %s %li %li %s %d %li %d %.6f %.6f",
-					rid, chr, start, end, gene, e->level, ip, ip_type,
+			log_debug ("%d [%d] %li %li %s %d %li %d %.6f %.6f",
+					rid, chr_id, start, end, gene, e->level, ip, ip_type,
 					e->orientation_rho, e->orientation_p_value);
 
-			db_insert_retrocopy (retrocopy_stmt, rid, chr, start, end,
+			db_insert_retrocopy (retrocopy_stmt, rid, chr_id, start, end,
 					gene, e->level, ip, ip_type, e->orientation_rho,
 					e->orientation_p_value);
 		}
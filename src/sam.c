@@ -20,13 +20,18 @@
 
 #include <htslib/hts.h>
 #include <htslib/hfile.h>
+#include <sys/stat.h>
 #include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "wrapper.h"
 #include "utils.h"
 #include "log.h"
 #include "sam.h"
 
+#define BASE_CHUNK_SIZE 64 /* bytes: up to 128 bases per lane */
+
 int
 sam_to_bam_fp (FILE *fp, const char *output_file)
 {
@@ -175,3 +180,160 @@ sam_test_sorted_order (const bam_hdr_t *hdr, const char *value)
 	xfree (sorted_by);
 	return success;
 }
+
+int
+sam_is_stream (const char *file)
+{
+	assert (file != NULL);
+
+	struct stat st;
+
+	// htslib reads the standard input
+	// from the file name '-'
+	if (!strcmp (file, "-"))
+		return 1;
+
+	// Named pipes, sockets and devices
+	// cannot be rewound
+	if (stat (file, &st) == 0)
+		return !S_ISREG (st.st_mode);
+
+	return 0;
+}
+
+int
+sam_is_indexed (const char *file)
+{
+	assert (file != NULL);
+
+	samFile *fp = NULL;
+	bam_hdr_t *hdr = NULL;
+	hts_idx_t *idx = NULL;
+	int indexed = 0;
+
+	if (sam_is_stream (file))
+		return 0;
+
+	fp = sam_open (file, "rb");
+	if (fp == NULL)
+		return 0;
+
+	// The index is only meaningful
+	// for coordinate sorted files
+	hdr = sam_hdr_read (fp);
+	if (hdr != NULL && sam_test_sorted_order (hdr, "coordinate"))
+		idx = sam_index_load (fp, file);
+
+	if (idx != NULL)
+		{
+			hts_idx_destroy (idx);
+			indexed = 1;
+		}
+
+	bam_hdr_destroy (hdr);
+	sam_close (fp);
+
+	return indexed;
+}
+
+void
+sam_set_required_fields (samFile *fp, int fields, const char *file)
+{
+	assert (fp != NULL && file != NULL);
+
+	// Only CRAM decodes each field from
+	// its own data series
+	if (hts_get_format (fp)->format != cram)
+		return;
+
+	if (hts_set_opt (fp, CRAM_OPT_REQUIRED_FIELDS, fields) < 0)
+		log_fatal ("Failed to set the required fields for '%s'", file);
+
+	// The MD and NM tags are never read
+	if (hts_set_opt (fp, CRAM_OPT_DECODE_MD, 0) < 0)
+		log_fatal ("Failed to disable MD/NM decoding for '%s'", file);
+}
+
+void
+sam_set_ref_cache (const char *dir)
+{
+	assert (dir != NULL);
+
+	char *ref_cache = NULL;
+
+	// htslib saves the CRAM references, fetched
+	// by their MD5, into REF_CACHE
+	xasprintf (&ref_cache, "%s/%%2s/%%2s/%%s", dir);
+
+	if (setenv ("REF_CACHE", ref_cache, 1) < 0)
+		log_errno_fatal ("Failed to set the reference cache '%s'", dir);
+
+	xfree (ref_cache);
+}
+
+/*
+ * Each 4-bit base code (=ACMGRSVTWYHKDBN) as
+ * an increment of its 8-bit lane: A, C, G, T
+ * and all the others, as in 'seq_nt16_int'
+ */
+static const uint64_t nt16_lane[16] =
+{
+	1ULL << 32, 1ULL << 0,  1ULL << 8,  1ULL << 32,
+	1ULL << 16, 1ULL << 32, 1ULL << 32, 1ULL << 32,
+	1ULL << 24, 1ULL << 32, 1ULL << 32, 1ULL << 32,
+	1ULL << 32, 1ULL << 32, 1ULL << 32, 1ULL << 32
+};
+
+int
+sam_is_base_overly_freq (const bam1_t *align, float freq)
+{
+	assert (align != NULL);
+
+	const uint8_t *seq = bam_get_seq (align);
+	int l_qseq = align->core.l_qseq;
+	int nbytes = l_qseq / 2;
+	int bases[5] = {};
+	uint64_t lanes = 0;
+	int max = 0;
+	int end = 0;
+	int i, j;
+
+	// The sequence is not decoded from
+	// CRAM when the filter is off
+	if (l_qseq <= 0 || freq >= 1)
+		return 0;
+
+	// Count the packed bytes, two bases at a time, in
+	// chunks small enough to not overflow the lanes
+	for (i = 0; i < nbytes; i = end)
+		{
+			end = i + BASE_CHUNK_SIZE < nbytes
+				? i + BASE_CHUNK_SIZE
+				: nbytes;
+
+			for (lanes = 0, j = i; j < end; j++)
+				lanes += nt16_lane[seq[j] >> 4] + nt16_lane[seq[j] & 0xf];
+
+			for (j = 0; j < 5; j++)
+				{
+					bases[j] += (lanes >> (j * 8)) & 0xff;
+					if (bases[j] > max)
+						max = bases[j];
+				}
+
+			// The counts only grow: Stop as soon
+			// as a base is overly frequent
+			if (((float) max / l_qseq) > freq)
+				return 1;
+		}
+
+	// The last base of odd length reads
+	if (l_qseq & 1)
+		{
+			j = seq_nt16_int[bam_seqi (seq, l_qseq - 1)];
+			if (++bases[j] > max)
+				max = bases[j];
+		}
+
+	return ((float) max / l_qseq) > freq;
+}
@@ -24,5 +24,18 @@
 int sam_to_bam_fp (FILE *fp, const char *output_file);
 int sam_to_bam    (const char *input_file, const char *output_file);
 int sam_test_sorted_order (const bam_hdr_t *hdr, const char *value);
+int sam_is_stream         (const char *file);
+int sam_is_indexed        (const char *file);
+
+void sam_set_required_fields (samFile *fp, int fields, const char *file);
+void sam_set_ref_cache       (const char *dir);
+
+/*
+ * Test whether the most frequent base, A, C, G, T
+ * or any other code, exceeds 'freq' of the read
+ * length. A 'freq' of 1 or more never does, and the
+ * sequence is not even read
+ */
+int  sam_is_base_overly_freq (const bam1_t *align, float freq);
 
 #endif /* sam.h */
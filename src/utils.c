@@ -271,6 +271,13 @@ exists (const char *file)
 	return stat (file, &sb) == 0 && sb.st_mode & S_IFREG;
 }
 
+long
+file_size (const char *file)
+{
+	struct stat sb;
+	return stat (file, &sb) == 0 ? sb.st_size : -1;
+}
+
 void
 mkdir_p (const char *path)
 {
@@ -282,16 +282,18 @@ prepare_retrocopy_query_stmt (sqlite3 *db, const long near_gene_dist)
 
 	const char sql[] =
 		"WITH\n"
-		"	gene (gene_name, strand, chr, start, end) AS (\n"
-		"		SELECT gene_name, strand, chr, MIN(start), MAX(end)\n"
-		"		FROM exon\n"
-		"		GROUP BY gene_name\n"
+		"	gene_range (gene_name, strand, chr_id, start, end) AS (\n"
+		"		SELECT g.name, strand, chr_id, MIN(start), MAX(end)\n"
+		"		FROM exon AS e\n"
+		"		INNER JOIN gene AS g\n"
+		"			ON g.id = e.gene_name_id\n"
+		"		GROUP BY gene_name_id\n"
 		"	),\n"
 		"	intragenic (rid, host) AS (\n"
 		"		SELECT DISTINCT r.id, g.gene_name\n"
 		"		FROM retrocopy AS r\n"
-		"		CROSS JOIN gene AS g\n"
-		"		WHERE r.chr = g.chr\n"
+		"		CROSS JOIN gene_range AS g\n"
+		"		WHERE r.chr_id = g.chr_id\n"
 		"			AND r.insertion_point BETWEEN g.start AND g.end\n"
 		"	),\n"
 		"	intragenic_g (rid, host) AS (\n"
@@ -300,10 +302,12 @@ prepare_retrocopy_query_stmt (sqlite3 *db, const long near_gene_dist)
 		"		GROUP BY rid\n"
 		"	),\n"
 		"	exonic (rid, host) AS (\n"
-		"		SELECT DISTINCT r.id, e.gene_name\n"
+		"		SELECT DISTINCT r.id, g.name\n"
 		"		FROM retrocopy AS r\n"
 		"		CROSS JOIN exon AS e\n"
-		"		WHERE r.chr = e.chr\n"
+		"		INNER JOIN gene AS g\n"
+		"			ON g.id = e.gene_name_id\n"
+		"		WHERE r.chr_id = e.chr_id\n"
 		"			AND r.insertion_point BETWEEN e.start AND e.end\n"
 		"	),\n"
 		"	exonic_g (rid, host) AS (\n"
@@ -314,8 +318,8 @@ prepare_retrocopy_query_stmt (sqlite3 *db, const long near_gene_dist)
 		"	near (rid, gene) AS (\n"
 		"		SELECT DISTINCT r.id, g.gene_name\n"
 		"		FROM retrocopy AS r\n"
-		"		CROSS JOIN gene AS g\n"
-		"		WHERE r.chr = g.chr\n"
+		"		CROSS JOIN gene_range AS g\n"
+		"		WHERE r.chr_id = g.chr_id\n"
 		"			AND ((r.insertion_point BETWEEN g.start - 1\n"
 		"					AND g.start - $DIST)\n"
 		"				OR (r.insertion_point BETWEEN g.end + 1\n"
@@ -353,15 +357,15 @@ prepare_retrocopy_query_stmt (sqlite3 *db, const long near_gene_dist)
 		"				ON a.id = c.alignment_id\n"
 		"			WHERE a.flag & 0x800\n"
 		"				AND (\n"
-		"					((cigar LIKE '%M%S' OR cigar LIKE '%M%H')\n"
+		"					(cigar_clip_side(cigar) = 'right'\n"
 		"							AND (a.pos + a.rlen) = insertion_point)\n"
-		"						OR ((cigar LIKE '%S%M' OR cigar LIKE '%H%M')\n"
+		"						OR (cigar_clip_side(cigar) = 'left'\n"
 		"							AND a.pos = insertion_point)\n"
 		"				)\n"
 		"		)\n"
 		"		GROUP BY retrocopy_id\n"
 		"	)\n"
-		"SELECT r.id, r.chr, window_start, window_end,\n"
+		"SELECT r.id, c.name, window_start, window_end,\n"
 		"	parental_gene_name,\n"
 		"	CASE\n"
 		"		WHEN strand IS NOT NULL\n"
@@ -398,7 +402,9 @@ prepare_retrocopy_query_stmt (sqlite3 *db, const long near_gene_dist)
 		"		ELSE '?'\n"
 		"	END\n"
 		"FROM retrocopy AS r\n"
-		"LEFT JOIN gene AS g\n"
+		"INNER JOIN contig AS c\n"
+		"	ON c.id = r.chr_id\n"
+		"LEFT JOIN gene_range AS g\n"
 		"	ON r.parental_gene_name = g.gene_name\n"
 		"INNER JOIN genotype AS gn\n"
 		"	ON r.id = gn.retrocopy_id\n"
@@ -410,7 +416,7 @@ prepare_retrocopy_query_stmt (sqlite3 *db, const long near_gene_dist)
 		"	ON r.id = i.rid\n"
 		"LEFT JOIN exonic_g AS e\n"
 		"	ON r.id = e.rid\n"
-		"ORDER BY r.chr ASC, insertion_point ASC";
+		"ORDER BY c.name ASC, insertion_point ASC";
 
 	log_debug ("Query schema:\n%s", sql);
 	stmt = db_prepare (db, sql);
@@ -24,8 +24,7 @@ Suite * make_hash_suite           (void);
 Suite * make_array_suite          (void);
 Suite * make_utils_suite          (void);
 Suite * make_sam_suite            (void);
-Suite * make_bitree_suite         (void);
-Suite * make_ibitree_suite        (void);
+Suite * make_iindex_suite         (void);
 Suite * make_str_suite            (void);
 Suite * make_db_suite             (void);
 Suite * make_chr_suite            (void);
@@ -48,5 +47,7 @@ Suite * make_genotype_suite       (void);
 Suite * make_fasta_suite          (void);
 Suite * make_vcf_suite            (void);
 Suite * make_gz_suite             (void);
+Suite * make_heap_suite           (void);
+Suite * make_idtable_suite        (void);
 
 #endif /* check_sider.h */
@@ -23,11 +23,14 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <check.h>
+#include <htslib/thread_pool.h>
 #include "check_sider.h"
 
 #include "../src/wrapper.h"
 #include "../src/utils.h"
 #include "../src/db.h"
+#include "../src/sam.h"
+#include "../src/thpool.h"
 #include "../src/abnormal.h"
 
 #define TEST_ABNORMAL_BUFSIZ 64
@@ -40,6 +43,7 @@ struct _TestAbnormal
 
 	sqlite3 *db;
 	sqlite3_stmt *exon_stmt;
+	sqlite3_stmt *gene_stmt;
 	sqlite3_stmt *overlapping_stmt;
 	sqlite3_stmt *alignment_stmt;
 
@@ -85,6 +89,43 @@ static const char *sam_unsorted =
 	"D3\t145\tchr2\t20000\t60\t10M\t=\t20\t-19990\tCCCCCTTTAG\t~~~~~~~~~~\n"
 	"S4\t2195\tchr2\t100\t60\t5H5M\tchr1\t100\t0\tCCCCC\t~~~~~\n";
 
+static const char *sam_coordinate =
+	"@HD\tVN:1.0\tSO:coordinate\n"
+	"@SQ\tSN:chr1\tLN:200\n"
+	"@SQ\tSN:chr2\tLN:20100\n"
+	"@PG\tID:bwa\tPN:bwa\tVN:0.7.17-r1188	CL:bwa mem -t 1 ponga/ponga.fa ponga.fastq\n"
+	"E1\t109\tchr1\t1\t60\t10M\t=\t20\t29\tATCGATCGAT\t~~~~~~~~~~\n"
+	"E1\t157\tchr1\t1\t60\t10M\t=\t20\t29\tATCGATCGAT\t~~~~~~~~~~\n"
+	"N1\t99\tchr1\t1\t60\t10M\t=\t20\t29\tATCGATCGAT\t~~~~~~~~~~\n"
+	"N1\t147\tchr1\t20\t60\t10M\t=\t1\t-29\tAAAGGGCCCT\t~~~~~~~~~~\n"
+	"C2\t97\tchr1\t40\t60\t10M\tchr2\t1\t0\tAAATTTCCGA\t~~~~~~~~~~\n"
+	"L5\t1121\tchr1\t60\t60\t10M\tchr2\t50\t0\tAAATTTCCGA\t~~~~~~~~~~\n"
+	"S4\t99\tchr1\t95\t60\t10M\t=\t120\t35\tAAACCCGGGG\t~~~~~~~~~~\n"
+	"S4\t147\tchr1\t120\t60\t5M5S\t=\t95\t-35\tGGGCCCCCCC\t~~~~~~~~~~\tSA:Z:chr2,100,+,5H5M,60,0;\n"
+	"C2\t145\tchr2\t1\t60\t10M\tchr1\t40\t0\tTTTTTGGGGA\t~~~~~~~~~~\n"
+	"D3\t97\tchr2\t20\t60\t10M\t=\t20000\t19990\tAAAAGGGCCC\t~~~~~~~~~~\n"
+	"L5\t145\tchr2\t50\t60\t10M\tchr1\t60\t0\tTTTTTGGGGA\t~~~~~~~~~~\n"
+	"S4\t2195\tchr2\t100\t60\t5H5M\tchr1\t95\t0\tCCCCC\t~~~~~\tSA:Z:chr1,120,-,5M5S,60,0;\n"
+	"D3\t145\tchr2\t20000\t60\t10M\t=\t20\t-19990\tCCCCCTTTAG\t~~~~~~~~~~\n";
+
+static const char *sam_indexed =
+	"@SQ\tSN:chr1\tLN:200\n"
+	"@SQ\tSN:chr2\tLN:20100\n"
+	"@PG\tID:bwa\tPN:bwa\tVN:0.7.17-r1188	CL:bwa mem -t 1 ponga/ponga.fa ponga.fastq\n"
+	"E1\t109\tchr1\t1\t60\t10M\t=\t20\t29\tATCGATCGAT\t~~~~~~~~~~\n"
+	"E1\t157\tchr1\t1\t60\t10M\t=\t20\t29\tATCGATCGAT\t~~~~~~~~~~\n"
+	"N1\t99\tchr1\t1\t60\t10M\t=\t20\t29\tATCGATCGAT\t~~~~~~~~~~\n"
+	"N1\t147\tchr1\t20\t60\t10M\t=\t1\t-29\tAAAGGGCCCT\t~~~~~~~~~~\n"
+	"C2\t97\tchr1\t40\t60\t10M\tchr2\t1\t0\tAAATTTCCGA\t~~~~~~~~~~\n"
+	"L5\t1121\tchr1\t60\t60\t10M\tchr2\t50\t0\tAAATTTCCGA\t~~~~~~~~~~\n"
+	"S4\t99\tchr1\t95\t60\t10M\t=\t120\t35\tAAACCCGGGG\t~~~~~~~~~~\n"
+	"S4\t147\tchr1\t120\t60\t5M5S\t=\t95\t-35\tGGGCCCCCCC\t~~~~~~~~~~\tSA:Z:chr2,100,+,5H5M,60,0;\n"
+	"C2\t145\tchr2\t1\t60\t10M\tchr1\t40\t0\tTTTTTGGGGA\t~~~~~~~~~~\n"
+	"D3\t97\tchr2\t20\t60\t10M\t=\t20000\t19990\tAAAAGGGCCC\t~~~~~~~~~~\n"
+	"L5\t145\tchr2\t50\t60\t10M\tchr1\t60\t0\tTTTTTGGGGA\t~~~~~~~~~~\n"
+	"S4\t2195\tchr2\t100\t60\t5H5M\tchr1\t95\t0\tCCCCC\t~~~~~\tSA:Z:chr1,120,-,5M5S,60,0;\n"
+	"D3\t145\tchr2\t20000\t60\t10M\t=\t20\t-19990\tCCCCCTTTAG\t~~~~~~~~~~\n";
+
 static const char *gtf =
 	"chr1\t.\texon\t45\t65\t.\t+\t.\t"
 	"gene_name \"e1\"; gene_id \"ENG1\"; transcript_id \"t1\"; transcript_type \"protein_coding\"; "
@@ -134,6 +175,7 @@ test_abnormal_init (TestAbnormal *a, const char *sam)
 
 	a->db = create_db (a->db_path);
 	a->exon_stmt = db_prepare_exon_stmt (a->db);
+	a->gene_stmt = db_prepare_gene_stmt (a->db);
 	a->overlapping_stmt = db_prepare_overlapping_stmt (a->db);
 	a->alignment_stmt = db_prepare_alignment_stmt (a->db);
 
@@ -142,7 +184,7 @@ test_abnormal_init (TestAbnormal *a, const char *sam)
 	create_file (a->sam_path, sam);
 	create_file (a->gtf_path, gtf);
 
-	a->exon_tree = exon_tree_new (a->exon_stmt,
+	a->exon_tree = exon_tree_new (a->exon_stmt, a->gene_stmt,
 			a->overlapping_stmt, a->cs);
 
 	exon_tree_index_dump (a->exon_tree, a->gtf_path);
@@ -152,6 +194,7 @@ test_abnormal_init (TestAbnormal *a, const char *sam)
 	*a->arg = (AbnormalArg) {
 		.tid = 1,
 		.inc_step = 1,
+		.source_id = 1,
 		.sam_file = a->sam_path,
 		.exon_tree = a->exon_tree,
 		.cs = a->cs,
@@ -172,6 +215,7 @@ test_abnormal_destroy (TestAbnormal *a)
 		return;
 
 	db_finalize (a->exon_stmt);
+	db_finalize (a->gene_stmt);
 	db_finalize (a->overlapping_stmt);
 	db_finalize (a->alignment_stmt);
 
@@ -189,10 +233,20 @@ test_abnormal_destroy (TestAbnormal *a)
 }
 
 static sqlite3_stmt *
-prepare_alignment_search (sqlite3 *db)
+prepare_alignment_search (sqlite3 *db, ChrStd *cs)
 {
 	const char sql[] =
-		"SELECT qname, chr, type FROM alignment ORDER BY qname ASC, chr ASC";
+		"SELECT a.qname, c.name, a.type\n"
+		"FROM alignment AS a\n"
+		"INNER JOIN contig AS c\n"
+		"	ON c.id = a.chr_id\n"
+		"ORDER BY a.qname ASC, c.name ASC";
+
+	// Alignments keep only the contig id
+	sqlite3_stmt *contig_stmt = db_prepare_contig_stmt (db);
+	chr_std_dump (cs, contig_stmt);
+	db_finalize (contig_stmt);
+
 	return db_prepare (db, sql);
 }
 
@@ -236,7 +290,7 @@ START_TEST (test_abnormal_filter_sorted)
 	abnormal_filter (a.arg);
 
 	// Let's get the alignment table values
-	search_stmt = prepare_alignment_search (a.db);
+	search_stmt = prepare_alignment_search (a.db, a.cs);
 
 	/* TIME TO TEST */
 	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
@@ -299,7 +353,297 @@ START_TEST (test_abnormal_filter_unsorted)
 	abnormal_filter (a.arg);
 
 	// Let's get the alignment table values
-	search_stmt = prepare_alignment_search (a.db);
+	search_stmt = prepare_alignment_search (a.db, a.cs);
+
+	/* TIME TO TEST */
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			qname = db_column_text (search_stmt, 0);
+			ck_assert_str_eq (qname, qnames_with_chr[i][0]);
+
+			chr = db_column_text (search_stmt, 1);
+			ck_assert_str_eq (chr, qnames_with_chr[i][1]);
+
+			type = db_column_int (search_stmt, 2);
+			ck_assert_int_eq (type, types[i]);
+		}
+
+	ck_assert_uint_eq (i, alignment_size);
+
+	// Time to cleanup
+	db_finalize (search_stmt);
+	test_abnormal_destroy (&a);
+}
+END_TEST
+
+START_TEST (test_abnormal_filter_external)
+{
+	// Init AbnormalArg struct and create database
+	// and sam files
+	TestAbnormal a;
+	test_abnormal_init (&a, sam_unsorted);
+
+	sqlite3_stmt *search_stmt = NULL;
+	const char *qname = NULL;
+	const char *chr = NULL;
+	int type = 0;
+	int i = 0;
+
+	// A single byte spills every alignment to
+	// its own run. A MiB keeps them in memory
+	size_t max_memory[] = {1, 1024 * 1024};
+
+	/* TRUE POSITIVE VALUES */
+	int alignment_size = 7;
+
+	const char *qnames_with_chr[][2] = {
+		{"C2", "chr1"},
+		{"C2", "chr2"},
+		{"D3", "chr2"},
+		{"D3", "chr2"},
+		{"S4", "chr1"},
+		{"S4", "chr1"},
+		{"S4", "chr2"},
+	};
+
+	int types[] = {
+		ABNORMAL_CHROMOSOME|ABNORMAL_EXONIC,
+		ABNORMAL_CHROMOSOME,
+		ABNORMAL_DISTANCE,
+		ABNORMAL_DISTANCE|ABNORMAL_EXONIC,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME
+	};
+
+	a.arg->max_memory = max_memory[_i];
+	a.arg->tmp_dir = "/tmp";
+
+	// RUN FOOLS
+	abnormal_filter (a.arg);
+
+	// Let's get the alignment table values
+	search_stmt = prepare_alignment_search (a.db, a.cs);
+
+	/* TIME TO TEST */
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			qname = db_column_text (search_stmt, 0);
+			ck_assert_str_eq (qname, qnames_with_chr[i][0]);
+
+			chr = db_column_text (search_stmt, 1);
+			ck_assert_str_eq (chr, qnames_with_chr[i][1]);
+
+			type = db_column_int (search_stmt, 2);
+			ck_assert_int_eq (type, types[i]);
+		}
+
+	ck_assert_uint_eq (i, alignment_size);
+
+	// Time to cleanup
+	db_finalize (search_stmt);
+	test_abnormal_destroy (&a);
+}
+END_TEST
+
+START_TEST (test_abnormal_filter_thread_pool)
+{
+	// Init AbnormalArg struct and create database
+	// and sam files
+	TestAbnormal a;
+	test_abnormal_init (&a, sam_unsorted);
+
+	sqlite3_stmt *search_stmt = NULL;
+	htsThreadPool hts_pool = {NULL, 0};
+	const char *qname = NULL;
+	int i = 0;
+
+	/* TRUE POSITIVE VALUES */
+	int alignment_size = 7;
+
+	const char *qnames[] = {"C2", "C2", "D3", "D3", "S4", "S4", "S4"};
+
+	// Share a decompression pool with the filter
+	hts_pool.pool = hts_tpool_init (2);
+	ck_assert (hts_pool.pool != NULL);
+
+	a.arg->hts_pool = &hts_pool;
+
+	// RUN FOOLS
+	abnormal_filter (a.arg);
+
+	// Let's get the alignment table values
+	search_stmt = prepare_alignment_search (a.db, a.cs);
+
+	/* TIME TO TEST */
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			qname = db_column_text (search_stmt, 0);
+			ck_assert_str_eq (qname, qnames[i]);
+		}
+
+	ck_assert_uint_eq (i, alignment_size);
+
+	// Time to cleanup
+	db_finalize (search_stmt);
+	hts_tpool_destroy (hts_pool.pool);
+	test_abnormal_destroy (&a);
+}
+END_TEST
+
+START_TEST (test_abnormal_filter_writer)
+{
+	// Init AbnormalArg struct and create database
+	// and sam files
+	TestAbnormal a;
+	test_abnormal_init (&a, sam_unsorted);
+
+	sqlite3_stmt *search_stmt = NULL;
+	const char *qname = NULL;
+	int i = 0;
+
+	/* TRUE POSITIVE VALUES */
+	int alignment_size = 7;
+
+	const char *qnames[] = {"C2", "C2", "D3", "D3", "S4", "S4", "S4"};
+
+	// Hand the rows to the writer thread
+	a.arg->writer = db_writer_new (a.alignment_stmt,
+			a.overlapping_stmt, 2);
+
+	// RUN FOOLS
+	abnormal_filter (a.arg);
+
+	// Wait the last batch to be written
+	db_writer_free (a.arg->writer);
+
+	// Let's get the alignment table values
+	search_stmt = prepare_alignment_search (a.db, a.cs);
+
+	/* TIME TO TEST */
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			qname = db_column_text (search_stmt, 0);
+			ck_assert_str_eq (qname, qnames[i]);
+		}
+
+	ck_assert_uint_eq (i, alignment_size);
+
+	// Time to cleanup
+	db_finalize (search_stmt);
+	test_abnormal_destroy (&a);
+}
+END_TEST
+
+START_TEST (test_abnormal_filter_coordinate)
+{
+	// Init AbnormalArg struct and create database
+	// and sam files
+	TestAbnormal a;
+	test_abnormal_init (&a, sam_coordinate);
+
+	sqlite3_stmt *search_stmt = NULL;
+	const char *qname = NULL;
+	const char *chr = NULL;
+	int type = 0;
+	int i = 0;
+
+	/* TRUE POSITIVE VALUES */
+	int alignment_size = 7;
+
+	const char *qnames_with_chr[][2] = {
+		{"C2", "chr1"},
+		{"C2", "chr2"},
+		{"D3", "chr2"},
+		{"D3", "chr2"},
+		{"S4", "chr1"},
+		{"S4", "chr1"},
+		{"S4", "chr2"},
+	};
+
+	int types[] = {
+		ABNORMAL_CHROMOSOME|ABNORMAL_EXONIC,
+		ABNORMAL_CHROMOSOME,
+		ABNORMAL_DISTANCE,
+		ABNORMAL_DISTANCE|ABNORMAL_EXONIC,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME
+	};
+
+	// RUN FOOLS
+	// The header 'SO:coordinate' leads to the single
+	// pass mode, if asked for, or to the three passes
+	// one. Both must find the same fragments
+	a.arg->single_pass = _i;
+	abnormal_filter (a.arg);
+
+	// Let's get the alignment table values
+	search_stmt = prepare_alignment_search (a.db, a.cs);
+
+	/* TIME TO TEST */
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			qname = db_column_text (search_stmt, 0);
+			ck_assert_str_eq (qname, qnames_with_chr[i][0]);
+
+			chr = db_column_text (search_stmt, 1);
+			ck_assert_str_eq (chr, qnames_with_chr[i][1]);
+
+			type = db_column_int (search_stmt, 2);
+			ck_assert_int_eq (type, types[i]);
+		}
+
+	ck_assert_uint_eq (i, alignment_size);
+
+	// Time to cleanup
+	db_finalize (search_stmt);
+	test_abnormal_destroy (&a);
+}
+END_TEST
+
+START_TEST (test_abnormal_filter_exonic_only)
+{
+	// The fragments grouped by queryname, by the
+	// table of ids and by coordinate
+	const char *sams[] = {sam_sorted, sam_unsorted, sam_coordinate};
+
+	// Init AbnormalArg struct and create database
+	// and sam files
+	TestAbnormal a;
+	test_abnormal_init (&a, sams[_i]);
+
+	sqlite3_stmt *search_stmt = NULL;
+	const char *qname = NULL;
+	const char *chr = NULL;
+	int type = 0;
+	int i = 0;
+
+	/* TRUE POSITIVE VALUES */
+	int alignment_size = 4;
+
+	// 'S4' has no read inside an exon
+	const char *qnames_with_chr[][2] = {
+		{"C2", "chr1"},
+		{"C2", "chr2"},
+		{"D3", "chr2"},
+		{"D3", "chr2"}
+	};
+
+	int types[] = {
+		ABNORMAL_CHROMOSOME|ABNORMAL_EXONIC,
+		ABNORMAL_CHROMOSOME,
+		ABNORMAL_DISTANCE,
+		ABNORMAL_DISTANCE|ABNORMAL_EXONIC
+	};
+
+	// RUN FOOLS
+	a.arg->exonic_only = 1;
+	a.arg->single_pass = 1;
+	abnormal_filter (a.arg);
+
+	// Let's get the alignment table values
+	search_stmt = prepare_alignment_search (a.db, a.cs);
 
 	/* TIME TO TEST */
 	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
@@ -322,6 +666,183 @@ START_TEST (test_abnormal_filter_unsorted)
 }
 END_TEST
 
+START_TEST (test_abnormal_filter_fetch_mates)
+{
+	// Init AbnormalArg struct and create database
+	// and sam files
+	TestAbnormal a;
+	test_abnormal_init (&a, sam_indexed);
+
+	sqlite3_stmt *search_stmt = NULL;
+	FILE *fp = NULL;
+	char *bai_path = NULL;
+	const char *qname = NULL;
+	const char *chr = NULL;
+	int type = 0;
+	int i = 0;
+
+	/* TRUE POSITIVE VALUES */
+	int alignment_size = 7;
+
+	const char *qnames_with_chr[][2] = {
+		{"C2", "chr1"},
+		{"C2", "chr2"},
+		{"D3", "chr2"},
+		{"D3", "chr2"},
+		{"S4", "chr1"},
+		{"S4", "chr1"},
+		{"S4", "chr2"},
+	};
+
+	int types[] = {
+		ABNORMAL_CHROMOSOME|ABNORMAL_EXONIC,
+		ABNORMAL_CHROMOSOME,
+		ABNORMAL_DISTANCE,
+		ABNORMAL_DISTANCE|ABNORMAL_EXONIC,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME
+	};
+
+	// Index works only on BAM
+	fp = xfopen (a.sam_path, "rb+");
+	sam_to_bam_fp (fp, a.sam_path);
+	xfclose (fp);
+
+	ck_assert_int_eq (sam_index_build (a.sam_path, 0), 0);
+
+	// There is no 'SO' tag: The mates of 'S4' are
+	// found by the 'SA' tag and the duplicated
+	// 'L5' by the mate position
+	a.arg->fetch_mates = 1;
+
+	// RUN FOOLS
+	abnormal_filter (a.arg);
+
+	// Let's get the alignment table values
+	search_stmt = prepare_alignment_search (a.db, a.cs);
+
+	/* TIME TO TEST */
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			qname = db_column_text (search_stmt, 0);
+			ck_assert_str_eq (qname, qnames_with_chr[i][0]);
+
+			chr = db_column_text (search_stmt, 1);
+			ck_assert_str_eq (chr, qnames_with_chr[i][1]);
+
+			type = db_column_int (search_stmt, 2);
+			ck_assert_int_eq (type, types[i]);
+		}
+
+	ck_assert_uint_eq (i, alignment_size);
+
+	// Time to cleanup
+	db_finalize (search_stmt);
+	test_abnormal_destroy (&a);
+
+	xasprintf (&bai_path, "%s.bai", a.sam_path);
+	xunlink (bai_path);
+	xfree (bai_path);
+}
+END_TEST
+
+START_TEST (test_abnormal_filter_sharded)
+{
+	// Init AbnormalArg struct and create database
+	// and sam files
+	TestAbnormal a;
+	test_abnormal_init (&a, sam_coordinate);
+
+	sqlite3_stmt *search_stmt = NULL;
+	threadpool thpool = NULL;
+	FILE *fp = NULL;
+	char *bai_path = NULL;
+	const char *qname = NULL;
+	const char *chr = NULL;
+	int type = 0;
+	int i = 0;
+
+	/* TRUE POSITIVE VALUES */
+	int alignment_size = 7;
+
+	const char *qnames_with_chr[][2] = {
+		{"C2", "chr1"},
+		{"C2", "chr2"},
+		{"D3", "chr2"},
+		{"D3", "chr2"},
+		{"S4", "chr1"},
+		{"S4", "chr1"},
+		{"S4", "chr2"},
+	};
+
+	int types[] = {
+		ABNORMAL_CHROMOSOME|ABNORMAL_EXONIC,
+		ABNORMAL_CHROMOSOME,
+		ABNORMAL_DISTANCE,
+		ABNORMAL_DISTANCE|ABNORMAL_EXONIC,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME,
+		ABNORMAL_SUPPLEMENTARY|ABNORMAL_CHROMOSOME
+	};
+
+	// Index works only on BAM
+	fp = xfopen (a.sam_path, "rb+");
+	sam_to_bam_fp (fp, a.sam_path);
+	xfclose (fp);
+
+	ck_assert_int_eq (sam_index_build (a.sam_path, 0), 0);
+
+	thpool = thpool_init (2);
+
+	// RUN FOOLS
+	// The region 'chr1:1-100' cuts the first 'S4'
+	ck_assert_int_eq (abnormal_filter_sharded (a.arg, thpool, 100), 1);
+
+	// Let's get the alignment table values
+	search_stmt = prepare_alignment_search (a.db, a.cs);
+
+	/* TIME TO TEST */
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			qname = db_column_text (search_stmt, 0);
+			ck_assert_str_eq (qname, qnames_with_chr[i][0]);
+
+			chr = db_column_text (search_stmt, 1);
+			ck_assert_str_eq (chr, qnames_with_chr[i][1]);
+
+			type = db_column_int (search_stmt, 2);
+			ck_assert_int_eq (type, types[i]);
+		}
+
+	ck_assert_uint_eq (i, alignment_size);
+
+	// Time to cleanup
+	db_finalize (search_stmt);
+	thpool_destroy (thpool);
+	test_abnormal_destroy (&a);
+
+	xasprintf (&bai_path, "%s.bai", a.sam_path);
+	xunlink (bai_path);
+	xfree (bai_path);
+}
+END_TEST
+
+START_TEST (test_abnormal_filter_sharded_no_index)
+{
+	TestAbnormal a;
+	test_abnormal_init (&a, sam_unsorted);
+
+	threadpool thpool = thpool_init (1);
+
+	// There is no index, so no work is done
+	ck_assert_int_eq (abnormal_filter_sharded (a.arg, thpool, 100), 0);
+
+	thpool_destroy (thpool);
+	test_abnormal_destroy (&a);
+}
+END_TEST
+
 Suite *
 make_abnormal_suite (void)
 {
@@ -335,6 +856,14 @@ make_abnormal_suite (void)
 
 	tcase_add_test (tc_core, test_abnormal_filter_sorted);
 	tcase_add_test (tc_core, test_abnormal_filter_unsorted);
+	tcase_add_loop_test (tc_core, test_abnormal_filter_external, 0, 2);
+	tcase_add_test (tc_core, test_abnormal_filter_thread_pool);
+	tcase_add_test (tc_core, test_abnormal_filter_writer);
+	tcase_add_loop_test (tc_core, test_abnormal_filter_coordinate, 0, 2);
+	tcase_add_loop_test (tc_core, test_abnormal_filter_exonic_only, 0, 3);
+	tcase_add_test (tc_core, test_abnormal_filter_fetch_mates);
+	tcase_add_test (tc_core, test_abnormal_filter_sharded);
+	tcase_add_test (tc_core, test_abnormal_filter_sharded_no_index);
 	suite_add_tcase (s, tc_core);
 
 	return s;
@@ -28,7 +28,7 @@
 #include "../src/wrapper.h"
 #include "../src/log.h"
 #include "../src/hash.h"
-#include "../src/ibitree.h"
+#include "../src/iindex.h"
 #include "../src/utils.h"
 #include "../src/db.h"
 #include "../src/blacklist.h"
@@ -131,7 +131,7 @@ test_blacklist_destroy (TestBlacklist *t)
 
 START_TEST (test_blacklist_index_dump_from_gff)
 {
-	IBiTree *tree = NULL;
+	IIndex *tree = NULL;
 	TestBlacklist t;
 	test_blacklist_init (&t, gtf);
 
@@ -157,7 +157,7 @@ END_TEST
 
 START_TEST (test_blacklist_index_dump_from_bed)
 {
-	IBiTree *tree = NULL;
+	IIndex *tree = NULL;
 	TestBlacklist t;
 	test_blacklist_init (&t, bed);
 
@@ -18,8 +18,10 @@
 
 #include "config.h"
 
+#include <stdio.h>
 #include <check.h>
 #include "check_sider.h"
+#include "../src/wrapper.h"
 #include "../src/chr.h"
 
 START_TEST (test_chr_std_lookup)
@@ -50,6 +52,88 @@ START_TEST (test_chr_std_lookup)
 }
 END_TEST
 
+START_TEST (test_chr_std_id)
+{
+	ChrStd *cs = chr_std_new ();
+	int id1, id2, id3;
+
+	id1 = chr_std_id (cs, "chr1");
+	id2 = chr_std_id (cs, "ponga");
+
+	ck_assert_int_ne (id1, id2);
+
+	// Aliases of the same contig
+	ck_assert_int_eq (chr_std_id (cs, "1"), id1);
+	ck_assert_int_eq (chr_std_id (cs, "CHR1"), id1);
+
+	id3 = chr_std_id (cs, "chrX");
+	ck_assert_int_eq (chr_std_id (cs, "x"), id3);
+	ck_assert_int_eq (chr_std_id (cs, "ponga"), id2);
+
+	chr_std_free (cs);
+}
+END_TEST
+
+START_TEST (test_chr_table)
+{
+	ChrStd *cs = chr_std_new ();
+	ChrTable *ct = NULL;
+
+	char *target_name[] = {"1", "chrMT", "ponga"};
+
+	ct = chr_table_new (cs, 3, target_name);
+
+	ck_assert_int_eq (ct->size, 3);
+
+	ck_assert_str_eq (chr_table_name (ct, 0), "chr1");
+	ck_assert_str_eq (chr_table_name (ct, 1), "chrM");
+	ck_assert_str_eq (chr_table_name (ct, 2), "ponga");
+	ck_assert_str_eq (chr_table_name (ct, -1), "*");
+
+	ck_assert_int_eq (chr_table_id (ct, 0), chr_std_id (cs, "chr1"));
+	ck_assert_int_eq (chr_table_id (ct, -1), -1);
+
+	ck_assert_int_eq (chr_table_tid (ct, chr_std_id (cs, "chrM")), 1);
+	ck_assert_int_eq (chr_table_tid (ct, chr_std_id (cs, "ponga")), 2);
+	ck_assert_int_eq (chr_table_tid (ct, chr_std_id (cs, "chr2")), -1);
+
+	chr_table_free (ct);
+	chr_std_free (cs);
+}
+END_TEST
+
+START_TEST (test_chr_std_load_alias)
+{
+	ChrStd *cs = chr_std_new ();
+	char path[] = "/tmp/ponga.alias.XXXXXX";
+	FILE *fp = NULL;
+	int fd;
+
+	fd = xmkstemp (path);
+	fp = xfdopen (fd, "w");
+
+	xfprintf (fp,
+		"# Non-human assembly\n"
+		"NC_045512.2\tchrA\n"
+		"\n"
+		"scaffold_1  chrB\n");
+
+	xfclose (fp);
+
+	chr_std_load_alias (cs, path);
+
+	ck_assert_str_eq (chr_std_lookup (cs, "NC_045512.2"), "chrA");
+	ck_assert_str_eq (chr_std_lookup (cs, "Scaffold_1"), "chrB");
+	ck_assert_str_eq (chr_std_lookup (cs, "chr1"), "chr1");
+
+	ck_assert_int_eq (chr_std_id (cs, "scaffold_1"),
+			chr_std_id (cs, "chrB"));
+
+	xunlink (path);
+	chr_std_free (cs);
+}
+END_TEST
+
 Suite *
 make_chr_suite (void)
 {
@@ -62,6 +146,9 @@ make_chr_suite (void)
 	tc_core = tcase_create ("Core");
 
 	tcase_add_test (tc_core, test_chr_std_lookup);
+	tcase_add_test (tc_core, test_chr_std_id);
+	tcase_add_test (tc_core, test_chr_table);
+	tcase_add_test (tc_core, test_chr_std_load_alias);
 	suite_add_tcase (s, tc_core);
 
 	return s;
@@ -51,32 +51,38 @@ populate_db (sqlite3 *db)
 	// Database dump
 	static const char schema[] =
 		"BEGIN TRANSACTION;\n"
-		"INSERT INTO exon VALUES (1,'gene1','chr11',1,3000,'+','eg1','ee1');\n"
-		"INSERT INTO exon VALUES (2,'gene2','chr12',1,3000,'-','eg2','ee2');\n"
-		"INSERT INTO alignment VALUES(1,'id1',66,'chr11',1000,60,'100M',101,101,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES(2,'id1',66,'chr1',1000,60,'100M',101,101,'chr1',1,2,1);\n"
-		"INSERT INTO alignment VALUES(3,'id2',66,'chr11',1050,60,'100M',101,101,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES(4,'id2',66,'chr1',1050,60,'100M',101,101,'chr1',1,2,1);\n"
-		"INSERT INTO alignment VALUES(5,'id3',66,'chr11',1300,60,'100M',101,101,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES(6,'id3',66,'chr1',1300,60,'100M',101,101,'chr1',1,2,1);\n"
-		"INSERT INTO alignment VALUES(7,'id4',66,'chr11',2000,60,'100M',101,101,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES(8,'id4',66,'chr1',2000,60,'100M',101,101,'chr1',1,2,1);\n"
-		"INSERT INTO alignment VALUES(9,'id5',66,'chr11',2500,60,'100M',101,101,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES(10,'id5',66,'chr1',2500,60,'100M',101,101,'chr1',1,2,1);\n"
-		"INSERT INTO alignment VALUES(11,'id6',66,'chr11',2560,60,'100M',101,101,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES(12,'id6',66,'chr1',2560,60,'100M',101,101,'chr1',1,2,1);\n"
-		"INSERT INTO alignment VALUES(13,'id7',66,'chr12',1000,60,'100M',101,101,'chr2',1,8,1);\n"
-		"INSERT INTO alignment VALUES(14,'id7',66,'chr2',1000,60,'100M',101,101,'chr2',1,2,1);\n"
-		"INSERT INTO alignment VALUES(15,'id8',66,'chr12',1050,60,'100M',101,101,'chr2',1,8,1);\n"
-		"INSERT INTO alignment VALUES(16,'id8',66,'chr2',1050,60,'100M',101,101,'chr2',1,2,1);\n"
-		"INSERT INTO alignment VALUES(17,'id9',66,'chr12',1300,60,'100M',101,101,'chr2',1,8,1);\n"
-		"INSERT INTO alignment VALUES(18,'id9',66,'chr2',1300,60,'100M',101,101,'chr2',1,2,1);\n"
-		"INSERT INTO alignment VALUES(19,'id10',66,'chr12',2000,60,'100M',101,101,'chr2',1,8,1);\n"
-		"INSERT INTO alignment VALUES(20,'id10',66,'chr2',2000,60,'100M',101,101,'chr2',1,2,1);\n"
-		"INSERT INTO alignment VALUES(21,'id11',66,'chr12',2500,60,'100M',101,101,'chr2',1,8,1);\n"
-		"INSERT INTO alignment VALUES(22,'id11',66,'chr2',2500,60,'100M',101,101,'chr2',1,2,1);\n"
-		"INSERT INTO alignment VALUES(23,'id12',66,'chr12',2560,60,'100M',101,101,'chr2',1,8,1);\n"
-		"INSERT INTO alignment VALUES(24,'id12',66,'chr2',2560,60,'100M',101,101,'chr2',1,2,1);\n"
+		"INSERT INTO contig VALUES (0,'chr1');\n"
+		"INSERT INTO contig VALUES (1,'chr11');\n"
+		"INSERT INTO contig VALUES (2,'chr12');\n"
+		"INSERT INTO contig VALUES (3,'chr2');\n"
+		"INSERT INTO gene VALUES (1,'gene1');\n"
+		"INSERT INTO gene VALUES (2,'gene2');\n"
+		"INSERT INTO exon VALUES (1,1,1,1,3000,'+','eg1','ee1');\n"
+		"INSERT INTO exon VALUES (2,2,2,1,3000,'-','eg2','ee2');\n"
+		"INSERT INTO alignment VALUES(1,'id1',66,1,1000,60,'100M',101,101,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES(2,'id1',66,0,1000,60,'100M',101,101,0,1,2,1);\n"
+		"INSERT INTO alignment VALUES(3,'id2',66,1,1050,60,'100M',101,101,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES(4,'id2',66,0,1050,60,'100M',101,101,0,1,2,1);\n"
+		"INSERT INTO alignment VALUES(5,'id3',66,1,1300,60,'100M',101,101,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES(6,'id3',66,0,1300,60,'100M',101,101,0,1,2,1);\n"
+		"INSERT INTO alignment VALUES(7,'id4',66,1,2000,60,'100M',101,101,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES(8,'id4',66,0,2000,60,'100M',101,101,0,1,2,1);\n"
+		"INSERT INTO alignment VALUES(9,'id5',66,1,2500,60,'100M',101,101,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES(10,'id5',66,0,2500,60,'100M',101,101,0,1,2,1);\n"
+		"INSERT INTO alignment VALUES(11,'id6',66,1,2560,60,'100M',101,101,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES(12,'id6',66,0,2560,60,'100M',101,101,0,1,2,1);\n"
+		"INSERT INTO alignment VALUES(13,'id7',66,2,1000,60,'100M',101,101,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES(14,'id7',66,3,1000,60,'100M',101,101,3,1,2,1);\n"
+		"INSERT INTO alignment VALUES(15,'id8',66,2,1050,60,'100M',101,101,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES(16,'id8',66,3,1050,60,'100M',101,101,3,1,2,1);\n"
+		"INSERT INTO alignment VALUES(17,'id9',66,2,1300,60,'100M',101,101,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES(18,'id9',66,3,1300,60,'100M',101,101,3,1,2,1);\n"
+		"INSERT INTO alignment VALUES(19,'id10',66,2,2000,60,'100M',101,101,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES(20,'id10',66,3,2000,60,'100M',101,101,3,1,2,1);\n"
+		"INSERT INTO alignment VALUES(21,'id11',66,2,2500,60,'100M',101,101,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES(22,'id11',66,3,2500,60,'100M',101,101,3,1,2,1);\n"
+		"INSERT INTO alignment VALUES(23,'id12',66,2,2560,60,'100M',101,101,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES(24,'id12',66,3,2560,60,'100M',101,101,3,1,2,1);\n"
 		"INSERT INTO overlapping VALUES(1,1,1,100);\n"
 		"INSERT INTO overlapping VALUES(1,3,1,100);\n"
 		"INSERT INTO overlapping VALUES(1,5,1,100);\n"
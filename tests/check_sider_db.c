@@ -212,6 +212,105 @@ START_TEST (test_db_column_text_abort)
 }
 END_TEST
 
+START_TEST (test_db_cigar_functions)
+{
+	sqlite3 *db = db_open (":memory:",
+			SQLITE_OPEN_CREATE|SQLITE_OPEN_READWRITE);
+
+	// 100M10S, 10H100M, 110M and no cigar
+	sqlite3_stmt *stmt = db_prepare (db,
+			"SELECT cigar_clip_side(X'40060000A4000000'),\n"
+			"	cigar_clip_side(X'A500000040060000'),\n"
+			"	cigar_clip_side(X'E0060000'),\n"
+			"	cigar_clip_side(X''),\n"
+			"	cigar_text(X'40060000A4000000'),\n"
+			"	cigar_text(X'')");
+
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+
+	ck_assert_str_eq (db_column_text (stmt, 0), "right");
+	ck_assert_str_eq (db_column_text (stmt, 1), "left");
+	ck_assert_int_eq (sqlite3_column_type (stmt, 2), SQLITE_NULL);
+	ck_assert_int_eq (sqlite3_column_type (stmt, 3), SQLITE_NULL);
+	ck_assert_str_eq (db_column_text (stmt, 4), "100M10S");
+	ck_assert_str_eq (db_column_text (stmt, 5), "*");
+
+	db_finalize (stmt);
+	db_close (db);
+}
+END_TEST
+
+START_TEST (test_db_cigar_clip_side_like)
+{
+	sqlite3 *db = db_open (":memory:",
+			SQLITE_OPEN_CREATE|SQLITE_OPEN_READWRITE);
+
+	sqlite3_stmt *insert_stmt = NULL;
+	sqlite3_stmt *search_stmt = NULL;
+	int i = 0;
+
+	// The text cigars and their packed operations:
+	// M=0, I=1, D=2, S=4, H=5
+	const char *texts[] = {
+		"100M10S", "10H100M", "5S100M5S", "10S100M5I",
+		"50M10S50M", "100M5S5H", "5H5S100M", "10S100M5D",
+		"110M", "10S", "5I100M10S", "10S5I100M"
+	};
+
+	const uint32_t cigars[][4] = {
+		{100 << 4 | 0, 10 << 4 | 4},
+		{10 << 4 | 5, 100 << 4 | 0},
+		{5 << 4 | 4, 100 << 4 | 0, 5 << 4 | 4},
+		{10 << 4 | 4, 100 << 4 | 0, 5 << 4 | 1},
+		{50 << 4 | 0, 10 << 4 | 4, 50 << 4 | 0},
+		{100 << 4 | 0, 5 << 4 | 4, 5 << 4 | 5},
+		{5 << 4 | 5, 5 << 4 | 4, 100 << 4 | 0},
+		{10 << 4 | 4, 100 << 4 | 0, 5 << 4 | 2},
+		{110 << 4 | 0},
+		{10 << 4 | 4},
+		{5 << 4 | 1, 100 << 4 | 0, 10 << 4 | 4},
+		{10 << 4 | 4, 5 << 4 | 1, 100 << 4 | 0}
+	};
+
+	const int n_cigars[] = {2, 2, 3, 3, 3, 3, 3, 3, 1, 1, 3, 3};
+
+	db_exec (db, "CREATE TABLE ponga (text TEXT, cigar BLOB)");
+
+	insert_stmt = db_prepare (db,
+			"INSERT INTO ponga (text, cigar) VALUES (?1, ?2)");
+
+	for (i = 0; i < 12; i++)
+		{
+			db_bind_text (insert_stmt, 1, texts[i]);
+			ck_assert_int_eq (sqlite3_bind_blob (insert_stmt, 2, cigars[i],
+						n_cigars[i] * sizeof (uint32_t), SQLITE_STATIC), SQLITE_OK);
+			db_step (insert_stmt);
+			db_reset (insert_stmt);
+		}
+
+	// The patterns used before the binary cigar
+	search_stmt = db_prepare (db,
+			"SELECT COUNT(*)\n"
+			"FROM ponga\n"
+			"WHERE cigar_clip_side(cigar) IS NOT\n"
+			"	CASE\n"
+			"		WHEN text LIKE '%M%S' OR text LIKE '%M%H' THEN\n"
+			"			'right'\n"
+			"		WHEN text LIKE '%S%M' OR text LIKE '%H%M' THEN\n"
+			"			'left'\n"
+			"		ELSE\n"
+			"			NULL\n"
+			"	END");
+
+	ck_assert_int_eq (db_step (search_stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (search_stmt, 0), 0);
+
+	db_finalize (insert_stmt);
+	db_finalize (search_stmt);
+	db_close (db);
+}
+END_TEST
+
 START_TEST (test_db_schema)
 {
 	char db_path[] = "/tmp/ponga.db.XXXXXX";
@@ -220,8 +319,13 @@ START_TEST (test_db_schema)
 
 	db = db_create (db_path);
 
+	// 101M
+	uint32_t cigar[] = {101 << 4};
+
 	sqlite3_stmt *batch_stmt = db_prepare_batch_stmt (db);
 	sqlite3_stmt *source_stmt = db_prepare_source_stmt (db);
+	sqlite3_stmt *contig_stmt = db_prepare_contig_stmt (db);
+	sqlite3_stmt *gene_stmt = db_prepare_gene_stmt (db);
 	sqlite3_stmt *exon_stmt = db_prepare_exon_stmt (db);
 	sqlite3_stmt *alignment_stmt = db_prepare_alignment_stmt (db);
 	sqlite3_stmt *overlapping_stmt = db_prepare_overlapping_stmt (db);
@@ -239,17 +343,19 @@ START_TEST (test_db_schema)
 
 	db_insert_batch (batch_stmt, 1, "2019-02-31");
 	db_insert_source (source_stmt, 1, 1, "ponga.bam");
-	db_insert_exon (exon_stmt, 1, "PONGA", "chr1", 1, 200, "+",
+	db_insert_contig (contig_stmt, 0, "chr1");
+	db_insert_gene (gene_stmt, 1, "PONGA");
+	db_insert_exon (exon_stmt, 1, 1, 0, 1, 200, "+",
 			"ENSG000666", "ENSE000666");
-	db_insert_alignment (alignment_stmt, 1, "run1", 99, "chr1", 1, 20,
-			"101M", 101, 101, "chr1", 200, 0, 1);
+	db_insert_alignment (alignment_stmt, 1, "run1", 99, 0, 1, 20,
+			cigar, 1, 101, 101, 0, 200, 0, 1);
 	db_insert_overlapping (overlapping_stmt, 1, 1, 1, 101);
 	db_insert_clustering (clustering_stmt, 1, 1, 1, 0, 1);
-	db_insert_cluster (cluster_stmt, 1, 1, "chr1", 1, 101, "PONGA", 1);
-	db_insert_blacklist (blacklist_stmt, 1, "blackponga", "chr1", 1, 200);
+	db_insert_cluster (cluster_stmt, 1, 1, 0, 1, 101, 1, 1);
+	db_insert_blacklist (blacklist_stmt, 1, "blackponga", 0, 1, 200);
 	db_insert_overlapping_blacklist (overlapping_blacklist_stmt, 1, 1, 1, 1, 101);
 	db_insert_cluster_merging (cluster_merge_stmt, 1, 1, 1);
-	db_insert_retrocopy (retrocopy_stmt, 1, "chr1", 1, 200, "ponga1/ponga2",
+	db_insert_retrocopy (retrocopy_stmt, 1, 0, 1, 200, "ponga1/ponga2",
 			12, 100, 1, -0.87, 0.00001);
 	db_insert_genotype (genotype_stmt, 1, 1, 10, 10, -533.23, -23.67, -123.49);
 
@@ -257,6 +363,8 @@ START_TEST (test_db_schema)
 
 	db_finalize (batch_stmt);
 	db_finalize (source_stmt);
+	db_finalize (contig_stmt);
+	db_finalize (gene_stmt);
 	db_finalize (exon_stmt);
 	db_finalize (alignment_stmt);
 	db_finalize (overlapping_stmt);
@@ -272,6 +380,145 @@ START_TEST (test_db_schema)
 }
 END_TEST
 
+START_TEST (test_db_migrate_v0_12)
+{
+	char db_path[] = "/tmp/ponga.db.XXXXXX";
+	sqlite3 *db = create_db (db_path);
+	sqlite3_stmt *stmt = NULL;
+	db_close (db);
+
+	// Tables as they were at the schema v0.12,
+	// written by the releases up to 1.1.6
+	const char sql[] =
+		"DROP TABLE contig;\n"
+		"DROP TABLE gene;\n"
+		"DROP TABLE source;\n"
+		"CREATE TABLE source (id INTEGER PRIMARY KEY,\n"
+		"	batch_id INTEGER NOT NULL, path TEXT NOT NULL);\n"
+		"DROP TABLE exon;\n"
+		"CREATE TABLE exon (id INTEGER PRIMARY KEY, gene_name TEXT NOT NULL,\n"
+		"	chr TEXT NOT NULL, start INTEGER NOT NULL, end INTEGER NOT NULL,\n"
+		"	strand TEXT NOT NULL, ensg TEXT NOT NULL, ense TEXT NOT NULL,\n"
+		"	UNIQUE (ense));\n"
+		"DROP TABLE alignment;\n"
+		"CREATE TABLE alignment (id INTEGER PRIMARY KEY, qname TEXT NOT NULL,\n"
+		"	flag INTEGER NOT NULL, chr TEXT NOT NULL, pos INTEGER NOT NULL,\n"
+		"	mapq INTEGER NOT NULL, cigar TEXT NOT NULL, qlen INTEGER DEFAULT -1,\n"
+		"	rlen INTEGER DEFAULT -1, chr_next TEXT NOT NULL,\n"
+		"	pos_next INTEGER NOT NULL, type INT DEFAULT 0,\n"
+		"	source_id INTEGER NOT NULL);\n"
+		"DROP TABLE cluster;\n"
+		"CREATE TABLE cluster (id INTEGER NOT NULL, sid INTEGER NOT NULL,\n"
+		"	chr TEXT NOT NULL, start INTEGER NOT NULL, end INTEGER NOT NULL,\n"
+		"	gene_name TEXT NOT NULL, filter INTEGER NOT NULL,\n"
+		"	PRIMARY KEY (id, sid));\n"
+		"DROP TABLE blacklist;\n"
+		"CREATE TABLE blacklist (id INTEGER PRIMARY KEY, name TEXT NOT NULL,\n"
+		"	chr TEXT NOT NULL, start INTEGER NOT NULL, end INTEGER NOT NULL);\n"
+		"DROP TABLE retrocopy;\n"
+		"CREATE TABLE retrocopy (id INTEGER PRIMARY KEY, chr TEXT NOT NULL,\n"
+		"	window_start INTEGER NOT NULL, window_end INTEGER NOT NULL,\n"
+		"	parental_gene_name TEXT NOT NULL, level INTEGER NOT NULL,\n"
+		"	insertion_point INTEGER, insertion_point_type INTEGER,\n"
+		"	orientation_rho REAL, orientation_p_value REAL);\n"
+		"UPDATE schema SET major_version = 0, minor_version = 12;\n"
+		"INSERT INTO batch VALUES (1,'2020-01-01');\n"
+		"INSERT INTO source VALUES (1,1,'ponga.bam');\n"
+		"INSERT INTO exon VALUES (1,'PONGA','chr2',1,200,'+','ENSG1','ENSE1');\n"
+		"INSERT INTO alignment VALUES (1,'r1',99,'chr2',1,20,'100M10S',101,101,'*',0,0,1);\n"
+		"INSERT INTO alignment VALUES (2,'r2',99,'chr10',1,20,'10H100M',101,101,'chr2',1,0,1);\n"
+		"INSERT INTO alignment VALUES (3,'r3',99,'chr10',1,20,'*',101,101,'chr2',1,0,1);\n"
+		"INSERT INTO cluster VALUES (1,1,'chr10',1,101,'PONGA',0);\n"
+		"INSERT INTO blacklist VALUES (1,'black','chr1',1,200);\n"
+		"INSERT INTO retrocopy VALUES (1,'chr10',1,200,'PONGA',1,100,1,0.0,0.0);";
+
+	db = db_create (db_path);
+	db_exec (db, sql);
+	db_close (db);
+
+	// Migrate to the current schema
+	db = db_connect (db_path);
+
+	stmt = db_prepare (db, "SELECT major_version,minor_version FROM schema");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), DB_SCHEMA_MAJOR_VERSION);
+	ck_assert_int_eq (db_column_int (stmt, 1), DB_SCHEMA_MINOR_VERSION);
+	db_finalize (stmt);
+
+	// Contig ids are dense from 0 by name
+	stmt = db_prepare (db, "SELECT id,name FROM contig ORDER BY id ASC");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 0);
+	ck_assert_str_eq (db_column_text (stmt, 1), "chr1");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	ck_assert_str_eq (db_column_text (stmt, 1), "chr10");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 2);
+	ck_assert_str_eq (db_column_text (stmt, 1), "chr2");
+	ck_assert_int_eq (db_step (stmt), SQLITE_DONE);
+	db_finalize (stmt);
+
+	// The unmapped mate keeps no contig
+	stmt = db_prepare (db,
+			"SELECT chr_id,chr_next_id FROM alignment ORDER BY id ASC");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 2);
+	ck_assert_int_eq (db_column_int (stmt, 1), -1);
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	ck_assert_int_eq (db_column_int (stmt, 1), 2);
+	db_finalize (stmt);
+
+	// The cigar text is packed
+	stmt = db_prepare (db,
+			"SELECT typeof(cigar), cigar_clip_side(cigar), cigar_text(cigar)\n"
+			"FROM alignment ORDER BY id ASC");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_str_eq (db_column_text (stmt, 0), "blob");
+	ck_assert_str_eq (db_column_text (stmt, 1), "right");
+	ck_assert_str_eq (db_column_text (stmt, 2), "100M10S");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_str_eq (db_column_text (stmt, 0), "blob");
+	ck_assert_str_eq (db_column_text (stmt, 1), "left");
+	ck_assert_str_eq (db_column_text (stmt, 2), "10H100M");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_str_eq (db_column_text (stmt, 0), "blob");
+	ck_assert_int_eq (sqlite3_column_type (stmt, 1), SQLITE_NULL);
+	ck_assert_str_eq (db_column_text (stmt, 2), "*");
+	db_finalize (stmt);
+
+	// The old sources were all finished
+	stmt = db_prepare (db, "SELECT done FROM source WHERE id = 1");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	db_finalize (stmt);
+
+	stmt = db_prepare (db,
+			"SELECT g.name, c.name\n"
+			"FROM cluster AS cl\n"
+			"INNER JOIN gene AS g ON g.id = cl.gene_name_id\n"
+			"INNER JOIN contig AS c ON c.id = cl.chr_id");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_str_eq (db_column_text (stmt, 0), "PONGA");
+	ck_assert_str_eq (db_column_text (stmt, 1), "chr10");
+	db_finalize (stmt);
+
+	stmt = db_prepare (db,
+			"SELECT COUNT(*) FROM exon AS e\n"
+			"INNER JOIN gene AS g ON g.id = e.gene_name_id\n"
+			"INNER JOIN blacklist AS b ON b.chr_id = 0\n"
+			"INNER JOIN retrocopy AS r ON r.chr_id = 1\n"
+			"WHERE e.chr_id = 2");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	db_finalize (stmt);
+
+	db_close (db);
+	xunlink (db_path);
+}
+END_TEST
+
 Suite *
 make_db_suite (void)
 {
@@ -291,7 +538,10 @@ make_db_suite (void)
 	tcase_add_test (tc_core, test_db_open);
 	tcase_add_test (tc_core, test_db_exec);
 	tcase_add_test (tc_core, test_db_prepare);
+	tcase_add_test (tc_core, test_db_cigar_functions);
+	tcase_add_test (tc_core, test_db_cigar_clip_side_like);
 	tcase_add_test (tc_core, test_db_schema);
+	tcase_add_test (tc_core, test_db_migrate_v0_12);
 
 	tcase_add_exit_test (tc_abort, test_db_open_abort,          EXIT_FAILURE);
 	tcase_add_exit_test (tc_abort, test_db_close_abort,         EXIT_FAILURE);
@@ -31,9 +31,11 @@ create_db (char *path)
 {
 	const char sql[] =
 		"INSERT INTO batch VALUES(1,\"2019-02-31\");\n"
-		"INSERT INTO source VALUES(1,1,\"ponga.bam\");\n"
-		"INSERT INTO exon VALUES(1,\"g1\",\"chr1\",1,200,\"+\",\"ENG0066\",\"ENSE0066\");\n"
-		"INSERT INTO alignment VALUES(1,\"r1\",99,\"chr1\",1,20,\"101M\",101,101,\"chr1\",200,0,1);\n"
+		"INSERT INTO source VALUES(1,1,\"ponga.bam\",1);\n"
+		"INSERT INTO contig VALUES(0,\"chr1\");\n"
+		"INSERT INTO gene VALUES(1,\"g1\");\n"
+		"INSERT INTO exon VALUES(1,1,0,1,200,\"+\",\"ENG0066\",\"ENSE0066\");\n"
+		"INSERT INTO alignment VALUES(1,\"r1\",99,0,1,20,X'50060000',101,101,0,200,0,1);\n"
 		"INSERT INTO overlapping VALUES(1,1,1,101);";
 
 	int fd = xmkstemp (path);
@@ -58,9 +60,21 @@ START_TEST (test_db_merge)
 		create_db (db_paths[i]);
 
 	sqlite3 *db = db_create (":memory:");
+	sqlite3_stmt *stmt = NULL;
 
 	db_merge (db, num_db, db_paths);
 
+	// Contigs and genes shared by all databases are merged into one
+	stmt = db_prepare (db, "SELECT COUNT(*) FROM contig");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	db_finalize (stmt);
+
+	stmt = db_prepare (db, "SELECT COUNT(*) FROM gene");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	db_finalize (stmt);
+
 	db_close (db);
 
 	for (i = 0; i < num_db; i++)
@@ -93,6 +107,52 @@ START_TEST (test_db_merge_in_line)
 }
 END_TEST
 
+START_TEST (test_db_merge_shard)
+{
+	char db_path[] = "/tmp/ponga1.db.XXXXXX";
+	char shard_path[] = "/tmp/ponga2.db.XXXXXX";
+	sqlite3_stmt *stmt = NULL;
+
+	create_db (db_path);
+
+	// The shard holds only alignments
+	int fd = xmkstemp (shard_path);
+	close (fd);
+
+	sqlite3 *shard = db_create (shard_path);
+	db_exec (shard,
+		"INSERT INTO contig VALUES(0,\"chr1\");\n"
+		"INSERT INTO alignment VALUES(2,\"r2\",99,0,1,20,X'50060000',101,101,0,200,0,1);\n"
+		"INSERT INTO overlapping VALUES(1,2,1,101);\n"
+		"INSERT INTO source VALUES(2,1,\"ponga2.bam\",1);");
+	db_close (shard);
+
+	sqlite3 *db = db_connect (db_path);
+
+	db_merge_shard (db, shard_path);
+
+	stmt = db_prepare (db, "SELECT COUNT(*) FROM alignment");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 2);
+	db_finalize (stmt);
+
+	stmt = db_prepare (db, "SELECT exon_id FROM overlapping WHERE alignment_id = 2");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	db_finalize (stmt);
+
+	stmt = db_prepare (db, "SELECT done FROM source WHERE id = 2");
+	ck_assert_int_eq (db_step (stmt), SQLITE_ROW);
+	ck_assert_int_eq (db_column_int (stmt, 0), 1);
+	db_finalize (stmt);
+
+	db_close (db);
+
+	xunlink (db_path);
+	xunlink (shard_path);
+}
+END_TEST
+
 Suite *
 make_db_merge_suite (void)
 {
@@ -106,6 +166,7 @@ make_db_merge_suite (void)
 
 	tcase_add_test (tc_core, test_db_merge);
 	tcase_add_test (tc_core, test_db_merge_in_line);
+	tcase_add_test (tc_core, test_db_merge_shard);
 
 	suite_add_tcase (s, tc_core);
 
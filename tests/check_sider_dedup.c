@@ -45,22 +45,25 @@ populate_db (sqlite3 *db)
 {
 	static const char schema[] =
 		"BEGIN TRANSACTION;\n"
-		"INSERT INTO alignment VALUES(1,'id1',66,'chr1',1,60,'100M',101,101,'chr2',1,10,1);\n"
-		"INSERT INTO alignment VALUES(2,'id1',66,'chr1',1,60,'100M',101,101,'chr2',1,10,1);\n"
-		"INSERT INTO alignment VALUES(3,'id2',66,'chr1',1,60,'100M',101,101,'chr2',1,10,1);\n"
-		"INSERT INTO alignment VALUES(4,'id3',66,'chr1',1,60,'100M',101,101,'chr3',1,10,1);\n"
-		"INSERT INTO alignment VALUES(5,'id4',66,'chr1',2,60,'100M',101,101,'chr2',10,10,1);\n"
-		"INSERT INTO alignment VALUES(6,'id2',66,'chr2',1,60,'100M',101,101,'chr1',1,10,1);\n"
-		"INSERT INTO alignment VALUES(7,'id3',66,'chr3',1,60,'100M',101,101,'chr1',1,10,1);\n"
-		"INSERT INTO alignment VALUES(8,'id4',66,'chr2',10,60,'100M',101,101,'chr1',2,10,1);\n"
-		"INSERT INTO alignment VALUES(9,'id5',66,'chr3',1,60,'100M',101,101,'chr3',1000,10,1);\n"
-		"INSERT INTO alignment VALUES(10,'id6',66,'chr3',1,60,'100M',101,101,'chr3',1000,10,1);\n"
-		"INSERT INTO alignment VALUES(11,'id5',66,'chr3',1000,60,'100M',101,101,'chr3',1,10,1);\n"
-		"INSERT INTO alignment VALUES(12,'id6',66,'chr3',1000,60,'100M',101,101,'chr3',1,10,1);\n"
-		"INSERT INTO alignment VALUES(13,'id7',66,'chr3',1,60,'100M',101,101,'chr3',1000,10,2);\n"
-		"INSERT INTO alignment VALUES(14,'id7',66,'chr3',1000,60,'100M',101,101,'chr3',1,10,2);\n"
-		"INSERT INTO alignment VALUES(15,'id8',66,'chr3',1,60,'100M',101,101,'chr3',1000,10,1);\n"
-		"INSERT INTO alignment VALUES(16,'id8',66,'chr3',1000,60,'100M',101,101,'chr3',1,10,1);\n"
+		"INSERT INTO contig VALUES (0,'chr1');\n"
+		"INSERT INTO contig VALUES (1,'chr2');\n"
+		"INSERT INTO contig VALUES (2,'chr3');\n"
+		"INSERT INTO alignment VALUES(1,'id1',66,0,1,60,'100M',101,101,1,1,10,1);\n"
+		"INSERT INTO alignment VALUES(2,'id1',66,0,1,60,'100M',101,101,1,1,10,1);\n"
+		"INSERT INTO alignment VALUES(3,'id2',66,0,1,60,'100M',101,101,1,1,10,1);\n"
+		"INSERT INTO alignment VALUES(4,'id3',66,0,1,60,'100M',101,101,2,1,10,1);\n"
+		"INSERT INTO alignment VALUES(5,'id4',66,0,2,60,'100M',101,101,1,10,10,1);\n"
+		"INSERT INTO alignment VALUES(6,'id2',66,1,1,60,'100M',101,101,0,1,10,1);\n"
+		"INSERT INTO alignment VALUES(7,'id3',66,2,1,60,'100M',101,101,0,1,10,1);\n"
+		"INSERT INTO alignment VALUES(8,'id4',66,1,10,60,'100M',101,101,0,2,10,1);\n"
+		"INSERT INTO alignment VALUES(9,'id5',66,2,1,60,'100M',101,101,2,1000,10,1);\n"
+		"INSERT INTO alignment VALUES(10,'id6',66,2,1,60,'100M',101,101,2,1000,10,1);\n"
+		"INSERT INTO alignment VALUES(11,'id5',66,2,1000,60,'100M',101,101,2,1,10,1);\n"
+		"INSERT INTO alignment VALUES(12,'id6',66,2,1000,60,'100M',101,101,2,1,10,1);\n"
+		"INSERT INTO alignment VALUES(13,'id7',66,2,1,60,'100M',101,101,2,1000,10,2);\n"
+		"INSERT INTO alignment VALUES(14,'id7',66,2,1000,60,'100M',101,101,2,1,10,2);\n"
+		"INSERT INTO alignment VALUES(15,'id8',66,2,1,60,'100M',101,101,2,1000,10,1);\n"
+		"INSERT INTO alignment VALUES(16,'id8',66,2,1000,60,'100M',101,101,2,1,10,1);\n"
 		"COMMIT;";
 
 	db_exec (db, schema);
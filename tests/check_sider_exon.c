@@ -22,13 +22,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <dirent.h>
 #include <check.h>
 #include "check_sider.h"
 
 #include "../src/wrapper.h"
 #include "../src/log.h"
 #include "../src/hash.h"
-#include "../src/ibitree.h"
+#include "../src/iindex.h"
 #include "../src/utils.h"
 #include "../src/db.h"
 #include "../src/exon.h"
@@ -42,6 +43,7 @@ struct _TestExonTree
 
 	sqlite3 *db;
 	sqlite3_stmt *exon_stmt;
+	sqlite3_stmt *gene_stmt;
 	sqlite3_stmt *overlapping_stmt;
 
 	ChrStd *cs;
@@ -99,7 +101,7 @@ create_gtf (char *gtf_path)
 }
 
 static void
-catch_id (IBiTreeLookupData *ldata, void *id)
+catch_id (IIndexLookupData *ldata, void *id)
 {
 	* (int *) id = * (int *) ldata->data;
 }
@@ -134,13 +136,14 @@ test_exon_tree_init (TestExonTree *t)
 
 	t->db = create_db (t->db_path);
 	t->exon_stmt = db_prepare_exon_stmt (t->db);
+	t->gene_stmt = db_prepare_gene_stmt (t->db);
 	t->overlapping_stmt = db_prepare_overlapping_stmt (t->db);
 
 	t->cs = chr_std_new ();
 
 	create_gtf (t->gtf_path);
 
-	t->exon_tree = exon_tree_new (t->exon_stmt,
+	t->exon_tree = exon_tree_new (t->exon_stmt, t->gene_stmt,
 			t->overlapping_stmt, t->cs);
 }
 
@@ -151,6 +154,7 @@ test_exon_tree_destroy (TestExonTree *t)
 		return;
 
 	db_finalize (t->exon_stmt);
+	db_finalize (t->gene_stmt);
 	db_finalize (t->overlapping_stmt);
 
 	db_close (t->db);
@@ -171,7 +175,7 @@ START_TEST (test_exon_tree_index_dump)
 	TestExonTree t;
 	test_exon_tree_init (&t);
 
-	IBiTree *tree = NULL;
+	IIndex *tree = NULL;
 	sqlite3_stmt *search_stmt = NULL;
 
 	int tree_id = 0;
@@ -213,7 +217,7 @@ START_TEST (test_exon_tree_index_dump)
 
 			// If looking for [start end] into tree,
 			// it must find the same id into database
-			ibitree_lookup (tree, start, end, -1, -1, 0,
+			iindex_lookup (tree, start, end, -1, -1, 0,
 					catch_id, &tree_id);
 
 			ck_assert_int_eq (tree_id, i + 1);
@@ -225,6 +229,248 @@ START_TEST (test_exon_tree_index_dump)
 }
 END_TEST
 
+START_TEST (test_exon_tree_index)
+{
+	// Init ExonTree struct and create database
+	// and gtf files
+	TestExonTree t;
+	test_exon_tree_init (&t);
+
+	ExonTree *exon_tree = NULL;
+	IIndex *tree = NULL;
+	sqlite3_stmt *search_stmt = NULL;
+	sqlite3_stmt *contig_stmt = NULL;
+
+	int tree_id = 0;
+	long start = 0;
+	long end = 0;
+	int i = 0;
+
+	// Dump the exons and contigs, as a previous run would
+	exon_tree_index_dump (t.exon_tree, t.gtf_path);
+
+	contig_stmt = db_prepare_contig_stmt (t.db);
+	chr_std_dump (t.cs, contig_stmt);
+	db_finalize (contig_stmt);
+
+	/* RUN FOOLS */
+	exon_tree = exon_tree_new (t.exon_stmt, t.gene_stmt,
+			t.overlapping_stmt, t.cs);
+	exon_tree_index (exon_tree, t.db);
+
+	ck_assert_int_eq (hash_size (exon_tree->idx), 1);
+
+	tree = hash_lookup (exon_tree->idx, "chr1");
+	ck_assert (tree != NULL);
+
+	// The tree must match the database
+	search_stmt = prepare_exon_search_stmt (t.db);
+
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			start = db_column_int64 (search_stmt, 1);
+			end = db_column_int64 (search_stmt, 2);
+
+			tree_id = 0;
+			iindex_lookup (tree, start, end, -1, -1, 0,
+					catch_id, &tree_id);
+
+			ck_assert_int_eq (tree_id, i + 1);
+		}
+
+	ck_assert_int_eq (i, gtf_size);
+
+	// Cleanup all the mess
+	db_finalize (search_stmt);
+	exon_tree_free (exon_tree);
+	test_exon_tree_destroy (&t);
+}
+END_TEST
+
+START_TEST (test_exon_tree_index_dump_cached)
+{
+	// Init ExonTree struct and create database
+	// and gtf files
+	TestExonTree t1, t2, t3;
+	test_exon_tree_init (&t1);
+	test_exon_tree_init (&t2);
+	test_exon_tree_init (&t3);
+
+	char cache_dir[] = "/tmp/ponga.cache.XXXXXX";
+	char alias_path[] = "/tmp/ponga.alias.XXXXXX";
+	char *cache_file = NULL;
+	FILE *fp = NULL;
+	IIndex *tree = NULL;
+	sqlite3_stmt *search_stmt = NULL;
+	struct dirent *dir = NULL;
+	DIR *dp = NULL;
+
+	int tree_id = 0;
+	int num_files = 0;
+	long start = 0;
+	long end = 0;
+	int i = 0;
+
+	ck_assert (mkdtemp (cache_dir) != NULL);
+
+	/* RUN FOOLS */
+
+	// The first run parses the annotation
+	// and fills the cache
+	exon_tree_index_dump_cached (t1.exon_tree, t1.gtf_path, cache_dir);
+
+	// The second run loads the cache, without
+	// parsing the annotation again
+	exon_tree_index_dump_cached (t2.exon_tree, t1.gtf_path, cache_dir);
+
+	ck_assert_int_eq (hash_size (t2.exon_tree->cache), 0);
+	ck_assert_int_eq (hash_size (t2.exon_tree->idx), 1);
+
+	tree = hash_lookup (t2.exon_tree->idx, "chr1");
+	ck_assert (tree != NULL);
+
+	// The index is loaded as built
+	ck_assert_int_eq (tree->built, 1);
+	ck_assert_int_eq (iindex_size (tree), gtf_size);
+
+	// The gene ids are kept
+	ck_assert_int_eq (hash_size (t2.exon_tree->genes), 1);
+	ck_assert_int_eq (* (int *) hash_lookup (t2.exon_tree->genes, "ponga"),
+			* (int *) hash_lookup (t1.exon_tree->genes, "ponga"));
+
+	// The exons loaded must match the ones parsed
+	search_stmt = prepare_exon_search_stmt (t2.db);
+
+	for (i = 0; db_step (search_stmt) == SQLITE_ROW; i++)
+		{
+			start = db_column_int64 (search_stmt, 1);
+			end = db_column_int64 (search_stmt, 2);
+
+			ck_assert_int_eq (start, gtf_pos[i][0]);
+			ck_assert_int_eq (end, gtf_pos[i][1]);
+			ck_assert_str_eq ((char *) db_column_text (search_stmt, 3), gtf_id[i]);
+
+			tree_id = 0;
+			iindex_lookup (tree, start, end, -1, -1, 0,
+					catch_id, &tree_id);
+
+			ck_assert_int_eq (tree_id, i + 1);
+		}
+
+	ck_assert_int_eq (i, gtf_size);
+
+	// Another contig alias table standardizes
+	// the contigs differently: The cache of the
+	// first run must not be used
+	fp = xfdopen (xmkstemp (alias_path), "w");
+	xfprintf (fp, "chr1\tponga1\n");
+	xfclose (fp);
+
+	chr_std_load_alias (t3.cs, alias_path);
+	exon_tree_index_dump_cached (t3.exon_tree, t1.gtf_path, cache_dir);
+
+	ck_assert_int_eq (hash_size (t3.exon_tree->cache), gtf_size);
+	ck_assert (hash_lookup (t3.exon_tree->idx, "ponga1") != NULL);
+	ck_assert (hash_lookup (t3.exon_tree->idx, "chr1") == NULL);
+
+	xunlink (alias_path);
+
+	// Cleanup all the mess
+	dp = opendir (cache_dir);
+	ck_assert (dp != NULL);
+
+	while ((dir = readdir (dp)) != NULL)
+		{
+			if (dir->d_name[0] == '.')
+				continue;
+
+			xasprintf (&cache_file, "%s/%s", cache_dir, dir->d_name);
+			xunlink (cache_file);
+			xfree (cache_file);
+			num_files++;
+		}
+
+	closedir (dp);
+	rmdir (cache_dir);
+
+	// One cache for each alias table, no
+	// temporary file left
+	ck_assert_int_eq (num_files, 2);
+
+	db_finalize (search_stmt);
+	test_exon_tree_destroy (&t1);
+	test_exon_tree_destroy (&t2);
+	test_exon_tree_destroy (&t3);
+}
+END_TEST
+
+START_TEST (test_exon_tree_index_dump_cached_corrupted)
+{
+	// Init ExonTree struct and create database
+	// and gtf files
+	TestExonTree t1, t2;
+	test_exon_tree_init (&t1);
+	test_exon_tree_init (&t2);
+
+	char cache_dir[] = "/tmp/ponga.cache.XXXXXX";
+	char *cache_file = NULL;
+	struct dirent *dir = NULL;
+	DIR *dp = NULL;
+	FILE *fp = NULL;
+	uint32_t offset = 0xffffffff;
+
+	ck_assert (mkdtemp (cache_dir) != NULL);
+
+	exon_tree_index_dump_cached (t1.exon_tree, t1.gtf_path, cache_dir);
+
+	dp = opendir (cache_dir);
+	ck_assert (dp != NULL);
+
+	while ((dir = readdir (dp)) != NULL && dir->d_name[0] == '.')
+		;
+
+	ck_assert (dir != NULL);
+	xasprintf (&cache_file, "%s/%s", cache_dir, dir->d_name);
+	closedir (dp);
+
+	// Keep the size: Either the pool does not end with
+	// NUL, or the name of the first contig points
+	// beyond the pool. The header has 56 bytes and the
+	// contigs come right after it
+	fp = xfopen (cache_file, "r+b");
+
+	if (_i == 0)
+		{
+			ck_assert_int_eq (fseek (fp, -1, SEEK_END), 0);
+			ck_assert_int_eq (fputc ('x', fp), 'x');
+		}
+	else
+		{
+			ck_assert_int_eq (fseek (fp, 56, SEEK_SET), 0);
+			ck_assert_int_eq (fwrite (&offset, sizeof (offset), 1, fp), 1);
+		}
+
+	xfclose (fp);
+
+	/* RUN FOOLS */
+
+	// The corrupted cache is ignored and
+	// the annotation is parsed again
+	exon_tree_index_dump_cached (t2.exon_tree, t1.gtf_path, cache_dir);
+
+	ck_assert_int_eq (hash_size (t2.exon_tree->cache), gtf_size);
+	ck_assert (hash_lookup (t2.exon_tree->idx, "chr1") != NULL);
+
+	// Cleanup all the mess
+	xunlink (cache_file);
+	xfree (cache_file);
+	rmdir (cache_dir);
+
+	test_exon_tree_destroy (&t1);
+	test_exon_tree_destroy (&t2);
+}
+END_TEST
+
 static sqlite3_stmt *
 prepare_overlapping_search_stmt (sqlite3 *db)
 {
@@ -233,6 +479,48 @@ prepare_overlapping_search_stmt (sqlite3 *db)
 	return db_prepare (db, sql);
 }
 
+START_TEST (test_exon_tree_lookup)
+{
+	// Init ExonTree struct and create database
+	// and gtf files
+	TestExonTree t;
+	test_exon_tree_init (&t);
+
+	int i = 0;
+	int chr_id = 0;
+
+	// All exons fall into the first bin: The
+	// alignments beyond it are rejected before
+	// the interval lookup
+	int alignment_size = 5;
+	int alignment_acm[] = {1, 0, 5, 1, 0};
+	int alignment_pos[][2] = {
+		{850,  EXON_BIN_SIZE + 100},
+		{EXON_BIN_SIZE + 100, EXON_BIN_SIZE + 200},
+		{1,    EXON_BIN_SIZE * 5},
+		{50,   60},
+		{910,  990}
+	};
+
+	/* RUN FOOLS */
+	exon_tree_index_dump (t.exon_tree, t.gtf_path);
+	chr_id = chr_std_id (t.cs, "chr1");
+
+	for (i = 0; i < alignment_size; i++)
+		ck_assert_int_eq (exon_tree_lookup (t.exon_tree, chr_id,
+					alignment_pos[i][0], alignment_pos[i][1], -1, -1, 0),
+				alignment_acm[i]);
+
+	// Contigs with no exon at all
+	ck_assert_int_eq (exon_tree_lookup (t.exon_tree, chr_std_id (t.cs, "chr2"),
+				1, 100, -1, -1, 0), 0);
+	ck_assert_int_eq (exon_tree_lookup (t.exon_tree, -1,
+				1, 100, -1, -1, 0), 0);
+
+	test_exon_tree_destroy (&t);
+}
+END_TEST
+
 START_TEST (test_exon_tree_lookup_dump)
 {
 
@@ -276,9 +564,9 @@ START_TEST (test_exon_tree_lookup_dump)
 	/* ADD IDS: 1, 2, 4, 4 */
 	for (i = 0; i < alignment_size; i++)
 		{
-			acm = exon_tree_lookup_dump (t.exon_tree, "chr1",
+			acm = exon_tree_lookup_dump (t.exon_tree, chr_std_id (t.cs, "chr1"),
 					alignment_pos[i][0], alignment_pos[i][1],
-					-1, -1, 0, alignment_ids[i]);
+					-1, -1, 0, alignment_ids[i], NULL, NULL);
 			ck_assert_int_eq (acm, alignment_acm[i]);
 		}
 
@@ -315,6 +603,10 @@ make_exon_suite (void)
 	tc_core = tcase_create ("Core");
 
 	tcase_add_test (tc_core, test_exon_tree_index_dump);
+	tcase_add_test (tc_core, test_exon_tree_index);
+	tcase_add_test (tc_core, test_exon_tree_index_dump_cached);
+	tcase_add_loop_test (tc_core, test_exon_tree_index_dump_cached_corrupted, 0, 2);
+	tcase_add_test (tc_core, test_exon_tree_lookup);
 	tcase_add_test (tc_core, test_exon_tree_lookup_dump);
 	suite_add_tcase (s, tc_core);
 
@@ -120,12 +120,16 @@ populate_db (sqlite3 *db, const char *bam1, const char *bam2)
 	// Database dump
 	xasprintf (&sql,
 		"BEGIN TRANSACTION;\n"
-		"INSERT INTO source VALUES (1,1,'%s');\n"
-		"INSERT INTO source VALUES (2,1,'%s');\n"
-		"INSERT INTO alignment VALUES (1,'q1',97,'chr1',1,100,'100M',100,100,'chr1',1,1,1);\n"
-		"INSERT INTO alignment VALUES (2,'q2',97,'chr2',1,100,'100M',100,100,'chr1',1,1,2);\n"
-		"INSERT INTO alignment VALUES (3,'q3',97,'chr3',1,100,'100M',100,100,'chr1',1,1,1);\n"
-		"INSERT INTO alignment VALUES (4,'q4',97,'chr4',1,100,'100M',100,100,'chr1',1,1,2);\n"
+		"INSERT INTO source VALUES (1,1,'%s',1);\n"
+		"INSERT INTO source VALUES (2,1,'%s',1);\n"
+		"INSERT INTO contig VALUES (0,'chr1');\n"
+		"INSERT INTO contig VALUES (1,'chr2');\n"
+		"INSERT INTO contig VALUES (2,'chr3');\n"
+		"INSERT INTO contig VALUES (3,'chr4');\n"
+		"INSERT INTO alignment VALUES (1,'q1',97,0,1,100,'100M',100,100,0,1,1,1);\n"
+		"INSERT INTO alignment VALUES (2,'q2',97,1,1,100,'100M',100,100,0,1,1,2);\n"
+		"INSERT INTO alignment VALUES (3,'q3',97,2,1,100,'100M',100,100,0,1,1,1);\n"
+		"INSERT INTO alignment VALUES (4,'q4',97,3,1,100,'100M',100,100,0,1,1,2);\n"
 		"INSERT INTO clustering VALUES (1,2,1,3,100);\n"
 		"INSERT INTO clustering VALUES (2,2,2,3,100);\n"
 		"INSERT INTO clustering VALUES (3,2,3,3,100);\n"
@@ -134,10 +138,10 @@ populate_db (sqlite3 *db, const char *bam1, const char *bam2)
 		"INSERT INTO cluster_merging VALUES (2,2,2);\n"
 		"INSERT INTO cluster_merging VALUES (3,3,2);\n"
 		"INSERT INTO cluster_merging VALUES (4,4,2);\n"
-		"INSERT INTO retrocopy VALUES (1,'chr1',1,200,'PONGA1',1,100,2,1,0.0);\n"
-		"INSERT INTO retrocopy VALUES (2,'chr2',1,200,'PONGA2',1,100,2,1,0.0);\n"
-		"INSERT INTO retrocopy VALUES (3,'chr3',1,200,'PONGA1',1,100,2,1,0.0);\n"
-		"INSERT INTO retrocopy VALUES (4,'chr4',1,200,'PONGA2',1,100,2,1,0.0);\n"
+		"INSERT INTO retrocopy VALUES (1,0,1,200,'PONGA1',1,100,2,1,0.0);\n"
+		"INSERT INTO retrocopy VALUES (2,1,1,200,'PONGA2',1,100,2,1,0.0);\n"
+		"INSERT INTO retrocopy VALUES (3,2,1,200,'PONGA1',1,100,2,1,0.0);\n"
+		"INSERT INTO retrocopy VALUES (4,3,1,200,'PONGA2',1,100,2,1,0.0);\n"
 		"COMMIT;", bam1, bam2);
 
 	db_exec (db, sql);
@@ -152,6 +156,7 @@ START_TEST (test_genotype)
 
 	sqlite3 *db = NULL;
 	sqlite3_stmt *stmt = NULL;
+	ChrStd *cs = NULL;
 
 	db = create_db (db_file);
 	create_file (bam_sorted_file);
@@ -164,8 +169,10 @@ START_TEST (test_genotype)
 	index_bam (bam_sorted_file);
 	stmt = db_prepare_genotype_stmt (db);
 
-	genotype (stmt, 2, 0);
+	cs = chr_std_new ();
+	genotype (stmt, cs, 2, 0);
 
+	chr_std_free (cs);
 	db_finalize (stmt);
 	db_close (db);
 
@@ -408,6 +408,51 @@ START_TEST (test_gff_filter)
 }
 END_TEST
 
+START_TEST (test_gff_read_filtered_keys)
+{
+	GffFile *gff = NULL;
+	GffEntry *entry = NULL;
+	GffFilter *filter = NULL;
+
+	int i = 0;
+
+	char gff_path[] = "/tmp/ponga.gff3.XXXXXX";
+	create_gff (gff_body, gff_path);
+
+	gff = gff_open_for_reading (gff_path);
+	entry = gff_entry_new ();
+	filter = gff_filter_new ();
+
+	gff_filter_insert_feature (filter, "exon");
+	gff_filter_insert_hard_attribute (filter, "transcript_type", "protein_coding");
+	gff_filter_insert_key (filter, "exon_id");
+	gff_filter_insert_key (filter, "gene_id");
+
+	while (gff_read_filtered (gff, entry, filter))
+		{
+			// Only the keys asked for and the ones
+			// required by the filter
+			ck_assert_int_eq (entry->num_attributes, 3);
+			ck_assert_str_eq (gff_attribute_find (entry, "exon_id"), "ENSE1");
+			ck_assert_str_eq (gff_attribute_find (entry, "gene_id"), "ENSG1");
+			ck_assert_str_eq (gff_attribute_find (entry, "transcript_type"), "protein_coding");
+			ck_assert (gff_attribute_find (entry, "gene_name") == NULL);
+			ck_assert_str_eq (entry->seqname, "chr1");
+			ck_assert_int_eq (entry->start, 1000);
+			ck_assert_int_eq (entry->end, 1100);
+			i++;
+		}
+
+	ck_assert_int_eq (i, 1);
+
+	gff_close (gff);
+	gff_entry_free (entry);
+	gff_filter_free (filter);
+
+	xunlink (gff_path);
+}
+END_TEST
+
 START_TEST (test_gff_looks_like_gff_file)
 {
 	const char *filenames[10] = {
@@ -453,6 +498,7 @@ make_gff_suite (void)
 	tcase_add_test (tc_core, test_gff_header);
 	tcase_add_test (tc_core, test_gff_read);
 	tcase_add_test (tc_core, test_gff_filter);
+	tcase_add_test (tc_core, test_gff_read_filtered_keys);
 	tcase_add_test (tc_core, test_gff_looks_like_gff_file);
 
 	tcase_add_exit_test (tc_abort, test_open_fatal,      EXIT_FAILURE);
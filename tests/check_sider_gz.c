@@ -59,6 +59,20 @@ create_big_text_gz (char *path)
 	xfclose (fp);
 }
 
+static void
+create_bgzf (const char *cnt, char *path)
+{
+	BGZF *fp = NULL;
+	int fd;
+
+	fd = xmkstemp (path);
+	fp = bgzf_dopen (fd, "w");
+
+	bgzf_write (fp, cnt, strlen (cnt));
+
+	bgzf_close (fp);
+}
+
 static void
 create_long_line_gz (char *path)
 {
@@ -197,6 +211,44 @@ START_TEST (test_read2)
 }
 END_TEST
 
+START_TEST (test_read_bgzf)
+{
+	GzFile *gz = NULL;
+	char gz_path[] = "/tmp/ponga.txt.gz.XXXXXX";
+	char *line = NULL;
+	int i = 0;
+	int l = 0;
+	size_t n = 0;
+
+	const char *gz_cnt_ex =
+		"=> 1 ponga\n"
+		"=> 2 ponga\n"
+		"=> 3 ponga\n"
+		"=> 4 ponga";
+
+	create_bgzf (gz_cnt_ex, gz_path);
+
+	gz_set_threads (2);
+	gz = gz_open_for_reading (gz_path);
+	gz_set_threads (1);
+
+	ck_assert (gz_is_bgzf (gz));
+
+	while (gz_getline (gz, &line, &n))
+		{
+			sscanf (line, "%*s %d", &l);
+			ck_assert_int_eq (l, ++i);
+		}
+
+	ck_assert_int_eq (gz_get_num_line (gz), 4);
+	ck_assert_str_eq (line, "=> 4 ponga");
+
+	xfree (line);
+	gz_close (gz);
+	xunlink (gz_path);
+}
+END_TEST
+
 START_TEST (test_read_long_line)
 {
 	GzFile *gz = NULL;
@@ -234,6 +286,7 @@ make_gz_suite (void)
 	tcase_add_test (tc_core, test_read1);
 	tcase_add_test (tc_core, test_read2);
 	tcase_add_test (tc_core, test_read_long_line);
+	tcase_add_test (tc_core, test_read_bgzf);
 
 	tcase_add_exit_test (tc_abort, test_open_fatal,  EXIT_FAILURE);
 	tcase_add_exit_test (tc_abort, test_close_fatal, EXIT_FAILURE);
@@ -0,0 +1,102 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include "check_sider.h"
+
+#include "../src/wrapper.h"
+#include "../src/utils.h"
+#include "../src/heap.h"
+
+static int
+cmp_int (const void *a, const void *b)
+{
+	return * (const int *) a - * (const int *) b;
+}
+
+START_TEST (test_heap_push_pop)
+{
+	Heap *heap = heap_new (cmp_int, xfree);
+	int values[] = {5, 3, 9, 1, 7, 3, 0, 8, 2, 6};
+	int values_size = 10;
+	int *v = NULL;
+	int prev = -1;
+	int i = 0;
+
+	for (i = 0; i < values_size; i++)
+		{
+			v = xcalloc (1, sizeof (int));
+			*v = values[i];
+			heap_push (heap, v);
+		}
+
+	ck_assert_int_eq (heap_len (heap), values_size);
+	ck_assert_int_eq (* (int *) heap_peek (heap), 0);
+
+	for (i = 0; i < values_size; i++)
+		{
+			v = heap_pop (heap);
+			ck_assert_int_ge (*v, prev);
+			prev = *v;
+			xfree (v);
+		}
+
+	ck_assert_int_eq (heap_len (heap), 0);
+	ck_assert (heap_peek (heap) == NULL);
+	ck_assert (heap_pop (heap) == NULL);
+
+	heap_free (heap);
+}
+END_TEST
+
+START_TEST (test_heap_free)
+{
+	Heap *heap = heap_new ((CompareFunc) strcmp, xfree);
+
+	heap_push (heap, xstrdup ("ponga3"));
+	heap_push (heap, xstrdup ("ponga1"));
+	heap_push (heap, xstrdup ("ponga2"));
+
+	ck_assert_str_eq ((char *) heap_peek (heap), "ponga1");
+
+	// Let valgrind catch leaks
+	heap_free (heap);
+}
+END_TEST
+
+Suite *
+make_heap_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("Heap");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_heap_push_pop);
+	tcase_add_test (tc_core, test_heap_free);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
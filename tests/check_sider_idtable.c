@@ -0,0 +1,132 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <check.h>
+#include "check_sider.h"
+
+#include "../src/idtable.h"
+
+#define ID_BUFSIZ 32
+
+static void
+sum_values (const char *id, uint8_t *value, int *sum)
+{
+	*sum += *value;
+}
+
+START_TEST (test_idtable_insert_lookup)
+{
+	IdTable *table = idtable_new ();
+	char id[ID_BUFSIZ];
+	uint8_t *value = NULL;
+	int size = 5000;
+	int i = 0;
+
+	// Force some growing
+	for (i = 0; i < size; i++)
+		{
+			snprintf (id, ID_BUFSIZ, "ponga.%d", i);
+			value = idtable_insert (table, id);
+			ck_assert_int_eq (*value, 0);
+			*value = i % 8 + 1;
+		}
+
+	ck_assert_uint_eq (idtable_size (table), size);
+
+	// Inserting again must keep the value
+	value = idtable_insert (table, "ponga.0");
+	ck_assert_int_eq (*value, 1);
+	ck_assert_uint_eq (idtable_size (table), size);
+
+	for (i = 0; i < size; i++)
+		{
+			snprintf (id, ID_BUFSIZ, "ponga.%d", i);
+			value = idtable_lookup (table, id);
+			ck_assert (value != NULL);
+			ck_assert_int_eq (*value, i % 8 + 1);
+		}
+
+	ck_assert (idtable_lookup (table, "pongada") == NULL);
+
+	idtable_free (table);
+}
+END_TEST
+
+START_TEST (test_idtable_remove)
+{
+	IdTable *table = idtable_new ();
+	char id[ID_BUFSIZ];
+	int size = 5000;
+	int sum = 0;
+	int i = 0;
+
+	for (i = 0; i < size; i++)
+		{
+			snprintf (id, ID_BUFSIZ, "ponga.%d", i);
+			*idtable_insert (table, id) = 1;
+		}
+
+	// Remove the even ids
+	for (i = 0; i < size; i += 2)
+		{
+			snprintf (id, ID_BUFSIZ, "ponga.%d", i);
+			ck_assert_int_eq (idtable_remove (table, id), 1);
+		}
+
+	ck_assert_int_eq (idtable_remove (table, "ponga.0"), 0);
+	ck_assert_uint_eq (idtable_size (table), size / 2);
+
+	// The odd ids must survive the
+	// backward shifting
+	for (i = 0; i < size; i++)
+		{
+			snprintf (id, ID_BUFSIZ, "ponga.%d", i);
+			if (i % 2)
+				ck_assert (idtable_lookup (table, id) != NULL);
+			else
+				ck_assert (idtable_lookup (table, id) == NULL);
+		}
+
+	idtable_foreach (table, (IdFunc) sum_values, &sum);
+	ck_assert_int_eq (sum, size / 2);
+
+	idtable_free (table);
+}
+END_TEST
+
+Suite *
+make_idtable_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("IdTable");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+
+	tcase_add_test (tc_core, test_idtable_insert_lookup);
+	tcase_add_test (tc_core, test_idtable_remove);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
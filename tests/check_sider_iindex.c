@@ -0,0 +1,295 @@
+/*
+ * sideRETRO - A pipeline for detecting Somatic Insertion of DE novo RETROcopies
+ * Copyright (C) 2019-2020 Thiago L. A. Miller <tmiller@mochsl.org.br
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <check.h>
+#include "check_sider.h"
+
+#include "../src/wrapper.h"
+#include "../src/list.h"
+#include "../src/iindex.h"
+
+static IIndex *idx = NULL;
+static List *list = NULL;
+
+static void
+setup (void)
+{
+	idx = iindex_new (xfree);
+	list = list_new (NULL);
+}
+
+static void
+teardown (void)
+{
+	iindex_free (idx);
+	list_free (list);
+}
+
+START_TEST (test_iindex_insert)
+{
+	int i = 0;
+
+	for (; i < 10; i++)
+		iindex_insert (idx, i, i + 1, xstrdup ("ponga"));
+
+	iindex_build (idx);
+	ck_assert_int_eq (iindex_size (idx), i);
+}
+END_TEST
+
+static void
+catcher (IIndexLookupData *ldata, void *user_data)
+{
+	List *list = user_data;
+	list_append (list, ldata->data);
+}
+
+START_TEST (test_iindex_lookup)
+{
+	ListElmt *cur = NULL;
+	int acm = 0;
+	int i = 0;
+
+	iindex_insert (idx, 1, 10, xstrdup ("1-10"));
+	iindex_insert (idx, 9, 12, xstrdup ("9-12"));
+	iindex_insert (idx, 5, 10, xstrdup ("5-10"));
+	iindex_insert (idx, 1, 5, xstrdup ("1-5"));
+	iindex_insert (idx, 1, 1, xstrdup ("1-1"));
+	iindex_build (idx);
+
+	acm = iindex_lookup (idx, 6, 20, -1, -1, 0, catcher, list);
+	ck_assert_int_eq (acm, 3);
+	ck_assert_int_eq (list_size (list), 3);
+
+	cur = list_head (list);
+	const char *overlap[] = {"1-10", "5-10", "9-12"};
+
+	for (; cur != NULL; cur = list_next (cur), i++)
+		ck_assert_str_eq (list_data (cur), overlap[i]);
+}
+END_TEST
+
+START_TEST (test_iindex_lookup_frac)
+{
+	ListElmt *cur = NULL;
+	int acm = 0;
+	int i = 0;
+
+	iindex_insert (idx, 1, 10, xstrdup ("1-10"));
+	iindex_insert (idx, 5, 15, xstrdup ("5-15"));
+	iindex_insert (idx, 10, 20, xstrdup ("10-20"));
+	iindex_insert (idx, 15, 25, xstrdup ("15-25"));
+	iindex_build (idx);
+
+	acm = iindex_lookup (idx, 1, 20, 1.0, 0.5, 0, catcher, list);
+	ck_assert_int_eq (acm, 3);
+	ck_assert_int_eq (list_size (list), 3);
+
+	cur = list_head (list);
+	const char *overlap[] = {"1-10", "5-15", "10-20"};
+
+	for (; cur != NULL; cur = list_next (cur), i++)
+		ck_assert_str_eq (list_data (cur), overlap[i]);
+}
+END_TEST
+
+START_TEST (test_iindex_lookup_either)
+{
+	ListElmt *cur = NULL;
+	int acm = 0;
+	int i = 0;
+
+	iindex_insert (idx, 1, 10, xstrdup ("1-10"));
+	iindex_insert (idx, 5, 15, xstrdup ("5-15"));
+	iindex_insert (idx, 10, 20, xstrdup ("10-20"));
+	iindex_insert (idx, 15, 25, xstrdup ("15-25"));
+	iindex_build (idx);
+
+	acm = iindex_lookup (idx, 1, 20, 0.5, 0.5, 1, catcher, list);
+	ck_assert_int_eq (acm, 4);
+	ck_assert_int_eq (list_size (list), 4);
+
+	cur = list_head (list);
+	const char *overlap[] = {"1-10", "5-15", "10-20", "15-25"};
+
+	for (; cur != NULL; cur = list_next (cur), i++)
+		ck_assert_str_eq (list_data (cur), overlap[i]);
+}
+END_TEST
+
+START_TEST (test_iindex_iter)
+{
+	IIndexIter iter;
+	const IIndexNode *node = NULL;
+	long i = 0;
+	int acm = 0;
+
+	// Enough intervals to go beyond the linear scan
+	for (i = 999; i >= 0; i--)
+		iindex_insert (idx, i * 10, i * 10 + 14, NULL);
+
+	iindex_build (idx);
+	iindex_iter_init (&iter, idx, 4995, 5030);
+
+	i = 499;
+	while (iindex_iter_next (&iter, &node))
+		{
+			ck_assert_int_eq (node->low, i * 10);
+			acm++;
+			i++;
+		}
+
+	ck_assert_int_eq (acm, 5);
+
+	// Nothing beyond the last interval
+	iindex_iter_init (&iter, idx, 10014, 20000);
+	ck_assert_int_eq (iindex_iter_next (&iter, &node), 0);
+}
+END_TEST
+
+START_TEST (test_iindex_rebuild)
+{
+	ListElmt *cur = NULL;
+	int acm = 0;
+	int i = 0;
+
+	iindex_insert (idx, 5, 10, xstrdup ("5-10:1"));
+	iindex_insert (idx, 1, 3, xstrdup ("1-3"));
+	iindex_build (idx);
+
+	iindex_insert (idx, 5, 10, xstrdup ("5-10:2"));
+	iindex_build (idx);
+
+	acm = iindex_lookup (idx, 1, 20, -1, -1, 0, catcher, list);
+	ck_assert_int_eq (acm, 3);
+
+	cur = list_head (list);
+	const char *overlap[] = {"1-3", "5-10:1", "5-10:2"};
+
+	for (; cur != NULL; cur = list_next (cur), i++)
+		ck_assert_str_eq (list_data (cur), overlap[i]);
+}
+END_TEST
+
+START_TEST (test_iindex_load)
+{
+	IIndex *loaded = NULL;
+	IIndexNode *nodes = NULL;
+	ListElmt *cur = NULL;
+	int acm = 0;
+	int i = 0;
+
+	iindex_insert (idx, 5, 10, xstrdup ("5-10"));
+	iindex_insert (idx, 1, 3, xstrdup ("1-3"));
+	iindex_insert (idx, 8, 20, xstrdup ("8-20"));
+	iindex_insert (idx, 30, 40, xstrdup ("30-40"));
+	iindex_build (idx);
+
+	// A copy of the nodes as built
+	nodes = xcalloc (iindex_size (idx), sizeof (IIndexNode));
+	memcpy (nodes, idx->nodes, iindex_size (idx) * sizeof (IIndexNode));
+
+	loaded = iindex_new (NULL);
+	iindex_load (loaded, nodes, iindex_size (idx));
+
+	ck_assert_int_eq (loaded->built, 1);
+	ck_assert_int_eq (loaded->max_level, idx->max_level);
+
+	acm = iindex_lookup (loaded, 9, 35, -1, -1, 0, catcher, list);
+	ck_assert_int_eq (acm, 3);
+
+	cur = list_head (list);
+	const char *overlap[] = {"5-10", "8-20", "30-40"};
+
+	for (; cur != NULL; cur = list_next (cur), i++)
+		ck_assert_str_eq (list_data (cur), overlap[i]);
+
+	iindex_free (loaded);
+}
+END_TEST
+
+START_TEST (test_iindex_cursor_lookup)
+{
+	IIndexCursor *cursor = NULL;
+	ListElmt *cur = NULL;
+	int acm = 0;
+	int i = 0;
+
+	iindex_insert (idx, 1, 10, xstrdup ("1-10"));
+	iindex_insert (idx, 5, 15, xstrdup ("5-15"));
+	iindex_insert (idx, 10, 100, xstrdup ("10-100"));
+	iindex_insert (idx, 15, 25, xstrdup ("15-25"));
+	iindex_insert (idx, 60, 70, xstrdup ("60-70"));
+	iindex_build (idx);
+
+	cursor = iindex_cursor_new (idx);
+
+	// Sweep forward
+	acm = iindex_cursor_lookup (cursor, 8, 12, -1, -1, 0, catcher, list);
+	ck_assert_int_eq (acm, 3);
+
+	acm = iindex_cursor_lookup (cursor, 16, 20, -1, -1, 0, catcher, list);
+	ck_assert_int_eq (acm, 2);
+
+	acm = iindex_cursor_lookup (cursor, 65, 65, -1, -1, 0, catcher, list);
+	ck_assert_int_eq (acm, 2);
+
+	// Go back: It must fall back to the tree
+	acm = iindex_cursor_lookup (cursor, 1, 1, -1, -1, 0, catcher, list);
+	ck_assert_int_eq (acm, 1);
+
+	cur = list_head (list);
+	const char *overlap[] = {"1-10", "5-15", "10-100", "10-100",
+		"15-25", "10-100", "60-70", "1-10"};
+
+	ck_assert_int_eq (list_size (list), 8);
+
+	for (; cur != NULL; cur = list_next (cur), i++)
+		ck_assert_str_eq (list_data (cur), overlap[i]);
+
+	iindex_cursor_free (cursor);
+}
+END_TEST
+
+Suite *
+make_iindex_suite (void)
+{
+	Suite *s;
+	TCase *tc_core;
+
+	s = suite_create ("IIndex");
+
+	/* Core test case */
+	tc_core = tcase_create ("Core");
+	tcase_add_checked_fixture (tc_core, setup, teardown);
+
+	tcase_add_test (tc_core, test_iindex_insert);
+	tcase_add_test (tc_core, test_iindex_lookup);
+	tcase_add_test (tc_core, test_iindex_lookup_frac);
+	tcase_add_test (tc_core, test_iindex_lookup_either);
+	tcase_add_test (tc_core, test_iindex_iter);
+	tcase_add_test (tc_core, test_iindex_rebuild);
+	tcase_add_test (tc_core, test_iindex_load);
+	tcase_add_test (tc_core, test_iindex_cursor_lookup);
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
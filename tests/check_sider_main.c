@@ -60,8 +60,7 @@ main (void)
 	srunner_add_suite (sr, make_array_suite ());
 	srunner_add_suite (sr, make_utils_suite ());
 	srunner_add_suite (sr, make_sam_suite ());
-	srunner_add_suite (sr, make_bitree_suite ());
-	srunner_add_suite (sr, make_ibitree_suite ());
+	srunner_add_suite (sr, make_iindex_suite ());
 	srunner_add_suite (sr, make_str_suite ());
 	srunner_add_suite (sr, make_db_suite ());
 	srunner_add_suite (sr, make_chr_suite ());
@@ -83,6 +82,8 @@ main (void)
 	srunner_add_suite (sr, make_fasta_suite ());
 	srunner_add_suite (sr, make_vcf_suite ());
 	srunner_add_suite (sr, make_gz_suite ());
+	srunner_add_suite (sr, make_heap_suite ());
+	srunner_add_suite (sr, make_idtable_suite ());
 	srunner_set_tap (sr, "-");
 
 	srunner_run_all (sr, CK_NORMAL);
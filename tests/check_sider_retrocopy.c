@@ -44,32 +44,58 @@ create_db (char *db_path)
 static void
 populate_db (sqlite3 *db)
 {
-	// Database dump
+	// Database dump. The cigars are packed BAM
+	// operations: X'40060000A4000000' is 100M10S,
+	// X'E0060000' is 110M and X'A500000040060000'
+	// is 10H100M
 	static const char schema[] =
 		"BEGIN TRANSACTION;\n"
-		"INSERT INTO exon VALUES (1,'gene1','chr1',1,3000,'+','eg1','ee1');\n"
-		"INSERT INTO exon VALUES (2,'gene2_1','chr2',1,3000,'-','eg2','ee2');\n"
-		"INSERT INTO exon VALUES (3,'gene2_2','chr2',2000,5000,'-','eg3','ee3');\n"
-		"INSERT INTO exon VALUES (4,'gene3_1','chr3',1000,3000,'+','eg4','ee4');\n"
-		"INSERT INTO exon VALUES (5,'gene3_2','chr3',5000,8000,'+','eg5','ee5');\n"
-		"INSERT INTO exon VALUES (6,'gene4_1','chr4',1000,5000,'+','eg6','ee6');\n"
-		"INSERT INTO exon VALUES (7,'gene4_2','chr5',1000,5000,'+','eg7','ee7');\n"
-		"INSERT INTO exon VALUES (8,'gene5_1','chr6',1,3000,'-','eg8','ee8');\n"
-		"INSERT INTO exon VALUES (9,'gene5_2','chr6',2000,5000,'-','eg9','ee9');\n"
-		"INSERT INTO exon VALUES (10,'gene5_3','chr7',10000,13000,'+','eg10','ee10');\n"
-		"INSERT INTO exon VALUES (11,'gene5_4','chr7',15000,18000,'+','eg11','ee11');\n"
-		"INSERT INTO alignment VALUES (1,'q1',0x800,'chr10',1,20,'100M10S',100,100,'chr10',1,1,1);\n"
-		"INSERT INTO alignment VALUES (12,'q1',0x800,'chr10',1,20,'100M10S',100,100,'chr10',1,8,1);\n"
-		"INSERT INTO alignment VALUES (2,'q4',97,'chr11',1,20,'110M',100,50,'chr11',1,8,1);\n"
-		"INSERT INTO alignment VALUES (3,'q5',97,'chr11',200,20,'110M',100,50,'chr11',1,8,1);\n"
-		"INSERT INTO alignment VALUES (4,'q2',0x800,'chr12',250,20,'10H100M',100,100,'chr12',1,8,1);\n"
-		"INSERT INTO alignment VALUES (5,'q3',0x800,'chr12',200,20,'100M10S',100,50,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES (6,'q6',97,'chr13',1,20,'100M10S',100,50,'chr13',1,8,1);\n"
-		"INSERT INTO alignment VALUES (7,'q7',97,'chr13',200,20,'100M10S',100,50,'chr13',1,8,1);\n"
-		"INSERT INTO alignment VALUES (8,'q8',97,'chr14',1,20,'100M10S',100,50,'chr14',1,8,1);\n"
-		"INSERT INTO alignment VALUES (9,'q9',97,'chr14',200,20,'100M10S',100,50,'chr14',1,8,1);\n"
-		"INSERT INTO alignment VALUES (10,'q10',97,'chr14',400,20,'100M10S',100,50,'chr14',1,8,1);\n"
-		"INSERT INTO alignment VALUES (11,'q11',97,'chr14',500,20,'100M10S',100,50,'chr14',1,8,1);\n"
+		"INSERT INTO contig VALUES (0,'chr1');\n"
+		"INSERT INTO contig VALUES (1,'chr10');\n"
+		"INSERT INTO contig VALUES (2,'chr11');\n"
+		"INSERT INTO contig VALUES (3,'chr12');\n"
+		"INSERT INTO contig VALUES (4,'chr13');\n"
+		"INSERT INTO contig VALUES (5,'chr14');\n"
+		"INSERT INTO contig VALUES (6,'chr2');\n"
+		"INSERT INTO contig VALUES (7,'chr3');\n"
+		"INSERT INTO contig VALUES (8,'chr4');\n"
+		"INSERT INTO contig VALUES (9,'chr5');\n"
+		"INSERT INTO contig VALUES (10,'chr6');\n"
+		"INSERT INTO contig VALUES (11,'chr7');\n"
+		"INSERT INTO gene VALUES (1,'gene1');\n"
+		"INSERT INTO gene VALUES (2,'gene2_1');\n"
+		"INSERT INTO gene VALUES (3,'gene2_2');\n"
+		"INSERT INTO gene VALUES (4,'gene3_1');\n"
+		"INSERT INTO gene VALUES (5,'gene3_2');\n"
+		"INSERT INTO gene VALUES (6,'gene4_1');\n"
+		"INSERT INTO gene VALUES (7,'gene4_2');\n"
+		"INSERT INTO gene VALUES (8,'gene5_1');\n"
+		"INSERT INTO gene VALUES (9,'gene5_2');\n"
+		"INSERT INTO gene VALUES (10,'gene5_3');\n"
+		"INSERT INTO gene VALUES (11,'gene5_4');\n"
+		"INSERT INTO exon VALUES (1,1,0,1,3000,'+','eg1','ee1');\n"
+		"INSERT INTO exon VALUES (2,2,6,1,3000,'-','eg2','ee2');\n"
+		"INSERT INTO exon VALUES (3,3,6,2000,5000,'-','eg3','ee3');\n"
+		"INSERT INTO exon VALUES (4,4,7,1000,3000,'+','eg4','ee4');\n"
+		"INSERT INTO exon VALUES (5,5,7,5000,8000,'+','eg5','ee5');\n"
+		"INSERT INTO exon VALUES (6,6,8,1000,5000,'+','eg6','ee6');\n"
+		"INSERT INTO exon VALUES (7,7,9,1000,5000,'+','eg7','ee7');\n"
+		"INSERT INTO exon VALUES (8,8,10,1,3000,'-','eg8','ee8');\n"
+		"INSERT INTO exon VALUES (9,9,10,2000,5000,'-','eg9','ee9');\n"
+		"INSERT INTO exon VALUES (10,10,11,10000,13000,'+','eg10','ee10');\n"
+		"INSERT INTO exon VALUES (11,11,11,15000,18000,'+','eg11','ee11');\n"
+		"INSERT INTO alignment VALUES (1,'q1',0x800,1,1,20,X'40060000A4000000',100,100,1,1,1,1);\n"
+		"INSERT INTO alignment VALUES (12,'q1',0x800,1,1,20,X'40060000A4000000',100,100,1,1,8,1);\n"
+		"INSERT INTO alignment VALUES (2,'q4',97,2,1,20,X'E0060000',100,50,2,1,8,1);\n"
+		"INSERT INTO alignment VALUES (3,'q5',97,2,200,20,X'E0060000',100,50,2,1,8,1);\n"
+		"INSERT INTO alignment VALUES (4,'q2',0x800,3,250,20,X'A500000040060000',100,100,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES (5,'q3',0x800,3,200,20,X'40060000A4000000',100,50,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES (6,'q6',97,4,1,20,X'40060000A4000000',100,50,4,1,8,1);\n"
+		"INSERT INTO alignment VALUES (7,'q7',97,4,200,20,X'40060000A4000000',100,50,4,1,8,1);\n"
+		"INSERT INTO alignment VALUES (8,'q8',97,5,1,20,X'40060000A4000000',100,50,5,1,8,1);\n"
+		"INSERT INTO alignment VALUES (9,'q9',97,5,200,20,X'40060000A4000000',100,50,5,1,8,1);\n"
+		"INSERT INTO alignment VALUES (10,'q10',97,5,400,20,X'40060000A4000000',100,50,5,1,8,1);\n"
+		"INSERT INTO alignment VALUES (11,'q11',97,5,500,20,X'40060000A4000000',100,50,5,1,8,1);\n"
 		"INSERT INTO clustering VALUES (1,2,1,3,100);\n"
 		"INSERT INTO clustering VALUES (2,2,2,3,100);\n"
 		"INSERT INTO clustering VALUES (3,2,3,3,100);\n"
@@ -81,17 +107,17 @@ populate_db (sqlite3 *db)
 		"INSERT INTO clustering VALUES (9,2,9,3,100);\n"
 		"INSERT INTO clustering VALUES (10,2,10,3,100);\n"
 		"INSERT INTO clustering VALUES (11,2,11,3,100);\n"
-		"INSERT INTO cluster VALUES (1,2,'chr10',1,300,'gene1',31);\n"
-		"INSERT INTO cluster VALUES (2,2,'chr11',1,300,'gene2_1',31);\n"
-		"INSERT INTO cluster VALUES (3,2,'chr11',200,500,'gene2_2',31);\n"
-		"INSERT INTO cluster VALUES (4,2,'chr12',1,300,'gene3_1',31);\n"
-		"INSERT INTO cluster VALUES (5,2,'chr12',200,500,'gene3_2',31);\n"
-		"INSERT INTO cluster VALUES (6,2,'chr13',1,300,'gene4_1',31);\n"
-		"INSERT INTO cluster VALUES (7,2,'chr13',200,500,'gene4_2',31);\n"
-		"INSERT INTO cluster VALUES (8,2,'chr14',1,300,'gene5_1',31);\n"
-		"INSERT INTO cluster VALUES (9,2,'chr14',200,500,'gene5_2',31);\n"
-		"INSERT INTO cluster VALUES (10,2,'chr14',400,600,'gene5_3',31);\n"
-		"INSERT INTO cluster VALUES (11,2,'chr14',500,700,'gene5_4',31);\n"
+		"INSERT INTO cluster VALUES (1,2,1,1,300,1,31);\n"
+		"INSERT INTO cluster VALUES (2,2,2,1,300,2,31);\n"
+		"INSERT INTO cluster VALUES (3,2,2,200,500,3,31);\n"
+		"INSERT INTO cluster VALUES (4,2,3,1,300,4,31);\n"
+		"INSERT INTO cluster VALUES (5,2,3,200,500,5,31);\n"
+		"INSERT INTO cluster VALUES (6,2,4,1,300,6,31);\n"
+		"INSERT INTO cluster VALUES (7,2,4,200,500,7,31);\n"
+		"INSERT INTO cluster VALUES (8,2,5,1,300,8,31);\n"
+		"INSERT INTO cluster VALUES (9,2,5,200,500,9,31);\n"
+		"INSERT INTO cluster VALUES (10,2,5,400,600,10,31);\n"
+		"INSERT INTO cluster VALUES (11,2,5,500,700,11,31);\n"
 		"COMMIT;";
 
 	db_exec (db, schema);
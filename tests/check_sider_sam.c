@@ -20,6 +20,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <check.h>
 #include "check_sider.h"
 
@@ -128,6 +131,131 @@ START_TEST (test_sam_test_sorted_order)
 }
 END_TEST
 
+START_TEST (test_sam_is_stream)
+{
+	char file[] = "/tmp/ponga.sam.XXXXXX";
+	char fifo[] = "/tmp/ponga.fifo.XXXXXX";
+	int fd;
+
+	fd = xmkstemp (file);
+	close (fd);
+
+	// Reuse the unique name for the pipe
+	fd = xmkstemp (fifo);
+	close (fd);
+	xunlink (fifo);
+
+	ck_assert_int_eq (mkfifo (fifo, 0600), 0);
+
+	ck_assert_int_eq (sam_is_stream ("-"), 1);
+	ck_assert_int_eq (sam_is_stream (fifo), 1);
+	ck_assert_int_eq (sam_is_stream (file), 0);
+
+	xunlink (file);
+	xunlink (fifo);
+}
+END_TEST
+
+static void
+set_seq (bam1_t *align, const char *seq, int l_qseq)
+{
+	int i = 0;
+
+	// The name 'r', padded to 4 bytes,
+	// no cigar and the packed sequence
+	align->core.l_qname = 4;
+	align->core.l_extranul = 2;
+	align->core.n_cigar = 0;
+	align->core.l_qseq = l_qseq;
+	align->l_data = 4 + (l_qseq + 1) / 2;
+
+	if ((size_t) align->l_data > (size_t) align->m_data)
+		{
+			align->m_data = align->l_data;
+			align->data = xrealloc (align->data, align->m_data);
+		}
+
+	memset (align->data, 0, align->l_data);
+	align->data[0] = 'r';
+
+	for (i = 0; i < l_qseq; i++)
+		bam_get_seq (align)[i >> 1] |=
+			seq_nt16_table[(unsigned char) seq[i]] << ((~i & 1) << 2);
+}
+
+static int
+scalar_base_overly_freq (const bam1_t *align, float freq)
+{
+	int bases[5] = {};
+	int max = 0;
+	int i = 0;
+
+	if (align->core.l_qseq <= 0 || freq >= 1)
+		return 0;
+
+	for (i = 0; i < align->core.l_qseq; i++)
+		{
+			int j = seq_nt16_int[bam_seqi (bam_get_seq (align), i)];
+			if (++bases[j] > max)
+				max = bases[j];
+		}
+
+	return ((float) max / align->core.l_qseq) > freq;
+}
+
+START_TEST (test_sam_is_base_overly_freq)
+{
+	const char nt[] = "ACGTNACGTRYACGT";
+	const float freqs[] = {0.2, 0.3, 0.5, 0.75, 0.9, 0.99};
+	char seq[1024];
+	bam1_t *align = bam_init1 ();
+	int l_qseq = 0;
+	int i, j;
+
+	ck_assert (align != NULL);
+
+	srand (42);
+
+	// Odd and even lengths, across and beyond the
+	// lanes chunk of 128 bases, with N and the
+	// other ambiguous codes
+	for (l_qseq = 1; l_qseq < 600; l_qseq++)
+		{
+			for (i = 0; i < l_qseq; i++)
+				seq[i] = nt[rand () % (sizeof (nt) - 1)];
+
+			// Overly frequent prefixes trigger
+			// the early exit
+			if (l_qseq % 3 == 0)
+				for (i = 0; i < l_qseq * 3 / 4; i++)
+					seq[i] = "ACGTN"[l_qseq % 5];
+
+			set_seq (align, seq, l_qseq);
+
+			for (j = 0; j < 6; j++)
+				ck_assert_int_eq (sam_is_base_overly_freq (align, freqs[j]),
+						scalar_base_overly_freq (align, freqs[j]));
+		}
+
+	// A long run of N: the last lane
+	memset (seq, 'N', 300);
+	seq[0] = 'A';
+	set_seq (align, seq, 301);
+	ck_assert_int_eq (sam_is_base_overly_freq (align, 0.9), 1);
+
+	// A balanced read never exceeds
+	set_seq (align, "ACGTACGT", 8);
+	ck_assert_int_eq (sam_is_base_overly_freq (align, 0.25), 0);
+	ck_assert_int_eq (sam_is_base_overly_freq (align, 0.24), 1);
+
+	// The filter is off
+	set_seq (align, "AAAAAAAAA", 9);
+	ck_assert_int_eq (sam_is_base_overly_freq (align, 1), 0);
+
+	bam_destroy1 (align);
+}
+END_TEST
+
 Suite *
 make_sam_suite (void)
 {
@@ -142,6 +270,8 @@ make_sam_suite (void)
 	tcase_add_test (tc_core, test_sam_to_bam);
 	tcase_add_test (tc_core, test_sam_to_bam_fp);
 	tcase_add_test (tc_core, test_sam_test_sorted_order);
+	tcase_add_test (tc_core, test_sam_is_stream);
+	tcase_add_test (tc_core, test_sam_is_base_overly_freq);
 	suite_add_tcase (s, tc_core);
 
 	return s;
@@ -230,6 +230,24 @@ START_TEST (test_exists)
 }
 END_TEST
 
+START_TEST (test_file_size)
+{
+	char file[] = "/tmp/pongaXXXXXX";
+	int fd = 0;
+
+	fd = xmkstemp (file);
+	ck_assert_int_eq (file_size (file), 0);
+
+	ck_assert_int_eq (write (fd, "ponga", 5), 5);
+	close (fd);
+
+	ck_assert_int_eq (file_size (file), 5);
+	ck_assert_int_eq (file_size ("pongatrongaflofa"), -1);
+
+	xunlink (file);
+}
+END_TEST
+
 START_TEST (test_xstrdup_concat)
 {
 	char *surname = "ponguita";
@@ -384,6 +402,7 @@ make_utils_suite (void)
 	tcase_add_test (tc_core, test_path_file);
 	tcase_add_test (tc_core, test_which);
 	tcase_add_test (tc_core, test_exists);
+	tcase_add_test (tc_core, test_file_size);
 	tcase_add_test (tc_core, test_xstrdup_concat);
 	tcase_add_test (tc_core, test_xasprintf_concat);
 	tcase_add_test (tc_core, test_mkdir_p);
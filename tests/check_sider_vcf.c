@@ -140,34 +140,62 @@ create_fasta (char *fasta_file)
 static void
 populate_db (sqlite3 *db)
 {
-	// Database dump
+	// Database dump. The cigars are packed BAM
+	// operations: X'40060000A4000000' is 100M10S,
+	// X'E0060000' is 110M and X'A500000040060000'
+	// is 10H100M
 	static const char schema[] =
 		"BEGIN TRANSACTION;\n"
-		"INSERT INTO source VALUES (1,1,'PONGA');\n"
-		"INSERT INTO exon VALUES (1,'gene1','chr1',1,3000,'+','eg1','ee1');\n"
-		"INSERT INTO exon VALUES (2,'gene2_1','chr2',1,3000,'-','eg2','ee2');\n"
-		"INSERT INTO exon VALUES (3,'gene2_2','chr2',2000,5000,'-','eg3','ee3');\n"
-		"INSERT INTO exon VALUES (4,'gene3_1','chr3',1000,3000,'+','eg4','ee4');\n"
-		"INSERT INTO exon VALUES (5,'gene3_2','chr3',5000,8000,'+','eg5','ee5');\n"
-		"INSERT INTO exon VALUES (6,'gene4_1','chr4',1000,5000,'+','eg6','ee6');\n"
-		"INSERT INTO exon VALUES (7,'gene4_2','chr5',1000,5000,'+','eg7','ee7');\n"
-		"INSERT INTO exon VALUES (8,'gene5_1','chr6',1,3000,'-','eg8','ee8');\n"
-		"INSERT INTO exon VALUES (9,'gene5_2','chr6',2000,5000,'-','eg9','ee9');\n"
-		"INSERT INTO exon VALUES (10,'gene5_3','chr7',10000,13000,'+','eg10','ee10');\n"
-		"INSERT INTO exon VALUES (11,'gene5_4','chr7',15000,18000,'+','eg11','ee11');\n"
-		"INSERT INTO exon VALUES (12,'gene6','chr10',1,300,'+','eg12','ee12');\n"
-		"INSERT INTO alignment VALUES (1,'q1',0x800,'chr10',1,20,'100M10S',100,100,'chr10',1,1,1);\n"
-		"INSERT INTO alignment VALUES (12,'q1',0x800,'chr10',1,20,'100M10S',100,100,'chr10',1,8,1);\n"
-		"INSERT INTO alignment VALUES (2,'q4',97,'chr11',1,20,'110M',100,50,'chr11',1,8,1);\n"
-		"INSERT INTO alignment VALUES (3,'q5',97,'chr11',200,20,'110M',100,50,'chr11',1,8,1);\n"
-		"INSERT INTO alignment VALUES (4,'q2',0x800,'chr12',250,20,'10H100M',100,100,'chr12',1,8,1);\n"
-		"INSERT INTO alignment VALUES (5,'q3',0x800,'chr12',200,20,'100M10S',100,50,'chr1',1,8,1);\n"
-		"INSERT INTO alignment VALUES (6,'q6',97,'chr13',1,20,'100M10S',100,50,'chr13',1,8,1);\n"
-		"INSERT INTO alignment VALUES (7,'q7',97,'chr13',200,20,'100M10S',100,50,'chr13',1,8,1);\n"
-		"INSERT INTO alignment VALUES (8,'q8',97,'chr14',1,20,'100M10S',100,50,'chr14',1,8,1);\n"
-		"INSERT INTO alignment VALUES (9,'q9',97,'chr14',200,20,'100M10S',100,50,'chr14',1,8,1);\n"
-		"INSERT INTO alignment VALUES (10,'q10',97,'chr14',400,20,'100M10S',100,50,'chr14',1,8,1);\n"
-		"INSERT INTO alignment VALUES (11,'q11',97,'chr14',500,20,'100M10S',100,50,'chr14',1,8,1);\n"
+		"INSERT INTO source VALUES (1,1,'PONGA',1);\n"
+		"INSERT INTO contig VALUES (0,'chr1');\n"
+		"INSERT INTO contig VALUES (1,'chr10');\n"
+		"INSERT INTO contig VALUES (2,'chr11');\n"
+		"INSERT INTO contig VALUES (3,'chr12');\n"
+		"INSERT INTO contig VALUES (4,'chr13');\n"
+		"INSERT INTO contig VALUES (5,'chr14');\n"
+		"INSERT INTO contig VALUES (6,'chr2');\n"
+		"INSERT INTO contig VALUES (7,'chr3');\n"
+		"INSERT INTO contig VALUES (8,'chr4');\n"
+		"INSERT INTO contig VALUES (9,'chr5');\n"
+		"INSERT INTO contig VALUES (10,'chr6');\n"
+		"INSERT INTO contig VALUES (11,'chr7');\n"
+		"INSERT INTO contig VALUES (12,'chrY');\n"
+		"INSERT INTO gene VALUES (1,'gene1');\n"
+		"INSERT INTO gene VALUES (2,'gene2_1');\n"
+		"INSERT INTO gene VALUES (3,'gene2_2');\n"
+		"INSERT INTO gene VALUES (4,'gene3_1');\n"
+		"INSERT INTO gene VALUES (5,'gene3_2');\n"
+		"INSERT INTO gene VALUES (6,'gene4_1');\n"
+		"INSERT INTO gene VALUES (7,'gene4_2');\n"
+		"INSERT INTO gene VALUES (8,'gene5_1');\n"
+		"INSERT INTO gene VALUES (9,'gene5_2');\n"
+		"INSERT INTO gene VALUES (10,'gene5_3');\n"
+		"INSERT INTO gene VALUES (11,'gene5_4');\n"
+		"INSERT INTO gene VALUES (12,'gene6');\n"
+		"INSERT INTO exon VALUES (1,1,0,1,3000,'+','eg1','ee1');\n"
+		"INSERT INTO exon VALUES (2,2,6,1,3000,'-','eg2','ee2');\n"
+		"INSERT INTO exon VALUES (3,3,6,2000,5000,'-','eg3','ee3');\n"
+		"INSERT INTO exon VALUES (4,4,7,1000,3000,'+','eg4','ee4');\n"
+		"INSERT INTO exon VALUES (5,5,7,5000,8000,'+','eg5','ee5');\n"
+		"INSERT INTO exon VALUES (6,6,8,1000,5000,'+','eg6','ee6');\n"
+		"INSERT INTO exon VALUES (7,7,9,1000,5000,'+','eg7','ee7');\n"
+		"INSERT INTO exon VALUES (8,8,10,1,3000,'-','eg8','ee8');\n"
+		"INSERT INTO exon VALUES (9,9,10,2000,5000,'-','eg9','ee9');\n"
+		"INSERT INTO exon VALUES (10,10,11,10000,13000,'+','eg10','ee10');\n"
+		"INSERT INTO exon VALUES (11,11,11,15000,18000,'+','eg11','ee11');\n"
+		"INSERT INTO exon VALUES (12,12,1,1,300,'+','eg12','ee12');\n"
+		"INSERT INTO alignment VALUES (1,'q1',0x800,1,1,20,X'40060000A4000000',100,100,1,1,1,1);\n"
+		"INSERT INTO alignment VALUES (12,'q1',0x800,1,1,20,X'40060000A4000000',100,100,1,1,8,1);\n"
+		"INSERT INTO alignment VALUES (2,'q4',97,2,1,20,X'E0060000',100,50,2,1,8,1);\n"
+		"INSERT INTO alignment VALUES (3,'q5',97,2,200,20,X'E0060000',100,50,2,1,8,1);\n"
+		"INSERT INTO alignment VALUES (4,'q2',0x800,3,250,20,X'A500000040060000',100,100,3,1,8,1);\n"
+		"INSERT INTO alignment VALUES (5,'q3',0x800,3,200,20,X'40060000A4000000',100,50,0,1,8,1);\n"
+		"INSERT INTO alignment VALUES (6,'q6',97,4,1,20,X'40060000A4000000',100,50,4,1,8,1);\n"
+		"INSERT INTO alignment VALUES (7,'q7',97,4,200,20,X'40060000A4000000',100,50,4,1,8,1);\n"
+		"INSERT INTO alignment VALUES (8,'q8',97,5,1,20,X'40060000A4000000',100,50,5,1,8,1);\n"
+		"INSERT INTO alignment VALUES (9,'q9',97,5,200,20,X'40060000A4000000',100,50,5,1,8,1);\n"
+		"INSERT INTO alignment VALUES (10,'q10',97,5,400,20,X'40060000A4000000',100,50,5,1,8,1);\n"
+		"INSERT INTO alignment VALUES (11,'q11',97,5,500,20,X'40060000A4000000',100,50,5,1,8,1);\n"
 		"INSERT INTO clustering VALUES (1,2,1,3,100);\n"
 		"INSERT INTO clustering VALUES (2,2,2,3,100);\n"
 		"INSERT INTO clustering VALUES (3,2,3,3,100);\n"
@@ -179,17 +207,17 @@ populate_db (sqlite3 *db)
 		"INSERT INTO clustering VALUES (9,2,9,3,100);\n"
 		"INSERT INTO clustering VALUES (10,2,10,3,100);\n"
 		"INSERT INTO clustering VALUES (11,2,11,3,100);\n"
-		"INSERT INTO cluster VALUES (1,2,'chr10',1,300,'gene1',31);\n"
-		"INSERT INTO cluster VALUES (2,2,'chr11',1,300,'gene2_1',31);\n"
-		"INSERT INTO cluster VALUES (3,2,'chr11',200,500,'gene2_2',31);\n"
-		"INSERT INTO cluster VALUES (4,2,'chr12',1,300,'gene3_1',31);\n"
-		"INSERT INTO cluster VALUES (5,2,'chr12',200,500,'gene3_2',31);\n"
-		"INSERT INTO cluster VALUES (6,2,'chr13',1,300,'gene4_1',31);\n"
-		"INSERT INTO cluster VALUES (7,2,'chr13',200,500,'gene4_2',31);\n"
-		"INSERT INTO cluster VALUES (8,2,'chr14',1,300,'gene5_1',31);\n"
-		"INSERT INTO cluster VALUES (9,2,'chr14',200,500,'gene5_2',31);\n"
-		"INSERT INTO cluster VALUES (10,2,'chr14',400,600,'gene5_3',31);\n"
-		"INSERT INTO cluster VALUES (11,2,'chr14',500,700,'gene5_4',31);\n"
+		"INSERT INTO cluster VALUES (1,2,1,1,300,1,31);\n"
+		"INSERT INTO cluster VALUES (2,2,2,1,300,2,31);\n"
+		"INSERT INTO cluster VALUES (3,2,2,200,500,3,31);\n"
+		"INSERT INTO cluster VALUES (4,2,3,1,300,4,31);\n"
+		"INSERT INTO cluster VALUES (5,2,3,200,500,5,31);\n"
+		"INSERT INTO cluster VALUES (6,2,4,1,300,6,31);\n"
+		"INSERT INTO cluster VALUES (7,2,4,200,500,7,31);\n"
+		"INSERT INTO cluster VALUES (8,2,5,1,300,8,31);\n"
+		"INSERT INTO cluster VALUES (9,2,5,200,500,9,31);\n"
+		"INSERT INTO cluster VALUES (10,2,5,400,600,10,31);\n"
+		"INSERT INTO cluster VALUES (11,2,5,500,700,11,31);\n"
 		"INSERT INTO cluster_merging VALUES(1,1,2);\n"
 		"INSERT INTO cluster_merging VALUES(2,2,2);\n"
 		"INSERT INTO cluster_merging VALUES(2,3,2);\n"
@@ -202,14 +230,14 @@ populate_db (sqlite3 *db)
 		"INSERT INTO cluster_merging VALUES(7,10,2);\n"
 		"INSERT INTO cluster_merging VALUES(7,11,2);\n"
 		"INSERT INTO cluster_merging VALUES(8,1,2);\n"
-		"INSERT INTO retrocopy VALUES(1,'chr10',1,300,'gene1',1,101,2,-1,0);\n"
-		"INSERT INTO retrocopy VALUES(2,'chr11',1,500,'gene2_1/gene2_2',2,350,1,0.0,0.0);\n"
-		"INSERT INTO retrocopy VALUES(3,'chr12',1,500,'gene3_1/gene3_2',4,250,2,0.0,0.0);\n"
-		"INSERT INTO retrocopy VALUES(4,'chr13',1,300,'gene4_1',8,150,1,0.0,0.0);\n"
-		"INSERT INTO retrocopy VALUES(5,'chr13',200,500,'gene4_2',8,350,1,0.0,0.0);\n"
-		"INSERT INTO retrocopy VALUES(6,'chr14',1,500,'gene5_1/gene5_2',10,350,1,0.0,0.0);\n"
-		"INSERT INTO retrocopy VALUES(7,'chr14',400,700,'gene5_3/gene5_4',12,600,1,0.0,0.0);\n"
-		"INSERT INTO retrocopy VALUES(8,'chrY',1,300,'gene1',1,101,2,1,0);\n"
+		"INSERT INTO retrocopy VALUES(1,1,1,300,'gene1',1,101,2,-1,0);\n"
+		"INSERT INTO retrocopy VALUES(2,2,1,500,'gene2_1/gene2_2',2,350,1,0.0,0.0);\n"
+		"INSERT INTO retrocopy VALUES(3,3,1,500,'gene3_1/gene3_2',4,250,2,0.0,0.0);\n"
+		"INSERT INTO retrocopy VALUES(4,4,1,300,'gene4_1',8,150,1,0.0,0.0);\n"
+		"INSERT INTO retrocopy VALUES(5,4,200,500,'gene4_2',8,350,1,0.0,0.0);\n"
+		"INSERT INTO retrocopy VALUES(6,5,1,500,'gene5_1/gene5_2',10,350,1,0.0,0.0);\n"
+		"INSERT INTO retrocopy VALUES(7,5,400,700,'gene5_3/gene5_4',12,600,1,0.0,0.0);\n"
+		"INSERT INTO retrocopy VALUES(8,12,1,300,'gene1',1,101,2,1,0);\n"
 		"INSERT INTO genotype VALUES(1,1,0,0,0.0,0.0,0.0);\n"
 		"INSERT INTO genotype VALUES(1,2,0,0,0.0,0.0,0.0);\n"
 		"INSERT INTO genotype VALUES(1,3,0,0,0.0,0.0,0.0);\n"
@@ -230,6 +258,31 @@ START_TEST (test_vcf)
 	char fasta_file[] = "/tmp/ponga.fa.XXXXXX";
 
 	sqlite3 *db = NULL;
+	FILE *fp = NULL;
+	char line[BUFSIZ];
+	char chr[64];
+	const char *sr = NULL;
+	int pos = 0;
+	int i = 0;
+
+	// The split reads at the breakpoint: 'q1' clips
+	// the right side of chr10 and chrY, and 'q2' and
+	// 'q3' clip both sides of chr12
+	struct
+	{
+		const char *chr;
+		int         pos;
+		int         sr;
+	} sites[] = {
+		{"chr10", 100, 1},
+		{"chr11", 349, 0},
+		{"chr12", 249, 2},
+		{"chr13", 149, 0},
+		{"chr13", 349, 0},
+		{"chr14", 349, 0},
+		{"chr14", 599, 0},
+		{"chrY",  100, 1}
+	};
 
 	db = create_db (db_file);
 	create_vcf (vcf_file);
@@ -241,6 +294,29 @@ START_TEST (test_vcf)
 	VCFOption opt = {.fasta_file = fasta_file};
 	vcf (db, vcf_file, &opt);
 
+	fp = xfopen (vcf_file, "r");
+
+	while (fgets (line, BUFSIZ, fp) != NULL)
+		{
+			if (line[0] == '#')
+				continue;
+
+			ck_assert_int_lt (i, sizeof (sites) / sizeof (sites[0]));
+			ck_assert_int_eq (sscanf (line, "%63s %d", chr, &pos), 2);
+			ck_assert_str_eq (chr, sites[i].chr);
+			ck_assert_int_eq (pos, sites[i].pos);
+
+			// No SR field means no split read
+			sr = strstr (line, ";SR=");
+			ck_assert_int_eq (sr != NULL ? atoi (sr + 4) : 0, sites[i].sr);
+
+			i++;
+		}
+
+	ck_assert_int_eq (i, sizeof (sites) / sizeof (sites[0]));
+
+	xfclose (fp);
+
 	db_close (db);
 	xunlink (db_file);
 	xunlink (fasta_file);